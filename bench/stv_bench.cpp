@@ -0,0 +1,510 @@
+// Micro-benchmarks of the serving hot paths over a fixed synthetic library.
+//
+//   stv-bench [--library DIR] [benchmark flags]
+//
+// The library (9 seasons of 10 episodes, 22 minutes each) is generated
+// into DIR, by default ./stv-bench-library, on the first run and reused
+// afterwards. Inputs are seeded and channel time is pinned, so results are
+// comparable between commits. `cmake --build . --target bench` runs every
+// benchmark and writes JSON results to bench_output.txt in the source tree.
+
+#include "seinfeld_tv/arena.hpp"
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/gop_index.hpp"
+#include "seinfeld_tv/guide.hpp"
+#include "seinfeld_tv/hls_service.hpp"
+#include "seinfeld_tv/metrics.hpp"
+#include "seinfeld_tv/mux.hpp"
+#include "seinfeld_tv/nal.hpp"
+#include "seinfeld_tv/play_history.hpp"
+#include "seinfeld_tv/playout.hpp"
+#include "seinfeld_tv/scheduler.hpp"
+#include "seinfeld_tv/segment_cache.hpp"
+#include "seinfeld_tv/segmenter.hpp"
+#include "seinfeld_tv/session_table.hpp"
+#include "seinfeld_tv/shuffle.hpp"
+#include "seinfeld_tv/station.hpp"
+
+#include "synthetic.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace seinfeld_tv;
+
+namespace {
+
+/// Monday 2026-01-05 00:00 UTC in channel time: fixed so the schedule,
+/// and so every timeline and playlist benchmark, is the same each run.
+constexpr Pts kEpoch = Pts{1767571200} * kPtsPerSecond;
+
+std::filesystem::path g_library = "stv-bench-library";
+
+struct Fixture {
+    std::shared_ptr<const Catalog> catalog;
+    std::unique_ptr<Station> station;
+    std::unique_ptr<Playout> playout;
+};
+
+Fixture& fixture()
+{
+    static Fixture f = [] {
+        Fixture f;
+        f.catalog = make_synthetic_library(g_library / "media", g_library / "catalog.bin");
+        f.station = std::make_unique<Station>(f.catalog);
+        f.station->add_channel("bench", SchedulePlan{}, kEpoch);
+        f.playout = std::make_unique<Playout>(f.station->library(), *f.station->channel(0u));
+        return f;
+    }();
+    return f;
+}
+
+/// Deterministic index stream; cheap enough not to show in the results.
+struct Sequence {
+    std::uint64_t state;
+
+    std::uint64_t next(std::uint64_t bound) noexcept
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return (state >> 33) % bound;
+    }
+};
+
+void BM_CatalogFindEpisode(benchmark::State& state)
+{
+    const auto& catalog = *fixture().catalog;
+    Sequence seq{1};
+    for (auto _ : state) {
+        const auto& r = catalog.episode(static_cast<EpisodeId>(seq.next(catalog.size())));
+        benchmark::DoNotOptimize(catalog.find(r.season, r.episode));
+    }
+}
+BENCHMARK(BM_CatalogFindEpisode);
+
+void BM_CatalogFindHash(benchmark::State& state)
+{
+    const auto& catalog = *fixture().catalog;
+    Sequence seq{2};
+    for (auto _ : state) {
+        const auto& r = catalog.episode(static_cast<EpisodeId>(seq.next(catalog.size())));
+        benchmark::DoNotOptimize(catalog.find(r.hash));
+    }
+}
+BENCHMARK(BM_CatalogFindHash);
+
+void BM_TimelineAt(benchmark::State& state)
+{
+    auto timeline = fixture().station->channel(0u)->scheduler().timeline();
+    const Pts span = timeline->end_pts() - timeline->begin_pts();
+    Sequence seq{3};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(timeline->at(timeline->begin_pts() + static_cast<Pts>(seq.next(span))));
+}
+BENCHMARK(BM_TimelineAt);
+
+void BM_TimelineBuild(benchmark::State& state)
+{
+    const auto& catalog = *fixture().catalog;
+    const SchedulePlan plan;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(build_timeline(catalog, plan, kEpoch, kPtsPerWeek));
+}
+BENCHMARK(BM_TimelineBuild)->Unit(benchmark::kMillisecond);
+
+/// What the shuffle airs at a random instant within a year: the memoised
+/// round is almost never the one asked for, so this includes summing it.
+void BM_ShuffleAt(benchmark::State& state)
+{
+    SeekableShuffle shuffle(*fixture().catalog, 7);
+    Sequence seq{9};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(shuffle.at(static_cast<Pts>(seq.next(365 * 24 * 3600)) * kPtsPerSecond));
+}
+BENCHMARK(BM_ShuffleAt);
+
+/// The next airing after the current one, as a timeline build walks it.
+void BM_ShuffleNext(benchmark::State& state)
+{
+    SeekableShuffle shuffle(*fixture().catalog, 7);
+    auto slot = shuffle.at(0);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(slot = shuffle.after(slot));
+}
+BENCHMARK(BM_ShuffleNext);
+
+void BM_GopIndexSeek(benchmark::State& state)
+{
+    auto& f = fixture();
+    const auto index = f.station->library().gop_index(*f.catalog, f.catalog->episode(0));
+    const auto duration = static_cast<std::uint64_t>(index->view().duration_pts);
+    Sequence seq{4};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(index->seek(static_cast<Pts>(seq.next(duration))));
+}
+BENCHMARK(BM_GopIndexSeek);
+
+void BM_GopIndexOpen(benchmark::State& state)
+{
+    const auto& catalog = *fixture().catalog;
+    const auto& record = catalog.episode(0);
+    const std::filesystem::path media(catalog.path(record));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GopIndex::open_or_build(media, record.hash));
+}
+BENCHMARK(BM_GopIndexOpen)->Unit(benchmark::kMicrosecond);
+
+void BM_SegmentPlan(benchmark::State& state)
+{
+    auto& f = fixture();
+    const auto& record = f.catalog->episode(0);
+    const auto index = f.station->library().gop_index(*f.catalog, record);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(plan_segments(index->view(), 0, record.duration_pts, 6 * kPtsPerSecond));
+}
+BENCHMARK(BM_SegmentPlan)->Unit(benchmark::kMicrosecond);
+
+/// Cuts one six-second segment and copies its bytes out, as a segment
+/// cache builder does.
+void BM_SegmentMux(benchmark::State& state)
+{
+    auto& f = fixture();
+    const auto& record = f.catalog->episode(0);
+    const auto index = f.station->library().gop_index(*f.catalog, record);
+    const auto source = std::make_shared<const SourceFile>(std::filesystem::path(f.catalog->path(record)));
+    const auto spans = plan_segments(index->view(), 0, record.duration_pts, 6 * kPtsPerSecond);
+    Sequence seq{5};
+    std::uint64_t bytes = 0;
+    for (auto _ : state) {
+        const auto ref = make_segment(source, index->view(), spans[seq.next(spans.size())]);
+        CachedSegment out;
+        out.bytes.resize(ref.size());
+        std::size_t at = 0;
+        for (const auto& e : ref.extents) {
+            if (::pread(source->fd(), out.bytes.data() + at, e.length, static_cast<off_t>(e.offset)) < 0)
+                state.SkipWithError("pread failed");
+            at += e.length;
+        }
+        bytes += at;
+        benchmark::DoNotOptimize(out.bytes.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+BENCHMARK(BM_SegmentMux)->Unit(benchmark::kMicrosecond);
+
+/// One cut segment of episode 0, read into memory.
+std::vector<std::byte> source_segment(std::size_t n)
+{
+    auto& f = fixture();
+    const auto& record = f.catalog->episode(0);
+    const auto index = f.station->library().gop_index(*f.catalog, record);
+    const auto source = std::make_shared<const SourceFile>(std::filesystem::path(f.catalog->path(record)));
+    const auto spans = plan_segments(index->view(), 0, record.duration_pts, 6 * kPtsPerSecond);
+    const auto ref = make_segment(source, index->view(), spans[n % spans.size()]);
+    std::vector<std::byte> bytes(ref.size());
+    std::size_t at = 0;
+    for (const auto& e : ref.extents) {
+        if (::pread(source->fd(), bytes.data() + at, e.length, static_cast<off_t>(e.offset)) < 0)
+            throw std::runtime_error("stv-bench: pread failed");
+        at += e.length;
+    }
+    return bytes;
+}
+
+/// Demuxes a segment and remuxes it into an arena, as a rewriting cache
+/// builder does; arg 0 is TS to TS, arg 1 TS to an fMP4 fragment.
+void BM_SegmentRemux(benchmark::State& state)
+{
+    const auto segment = source_segment(7);
+    const auto to = state.range(0) ? Container::Fmp4 : Container::MpegTs;
+    SegmentArena arena;
+    MuxState mux;
+    for (auto _ : state) {
+        {
+            std::pmr::vector<std::byte> out(&arena);
+            remux_ts(segment, to, kPtsPerHour, mux, &arena, out);
+            benchmark::DoNotOptimize(out.data());
+        }
+        arena.reset();
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * segment.size()));
+    state.counters["upstream_allocs"] = static_cast<double>(arena.upstream_allocations());
+}
+BENCHMARK(BM_SegmentRemux)->ArgName("fmp4")->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+
+void BM_Fmp4Init(benchmark::State& state)
+{
+    const auto segment = source_segment(0);
+    SegmentArena arena;
+    for (auto _ : state) {
+        {
+            std::pmr::vector<std::byte> out(&arena);
+            fmp4_init_from_ts(segment, &arena, out);
+            benchmark::DoNotOptimize(out.data());
+        }
+        arena.reset();
+    }
+}
+BENCHMARK(BM_Fmp4Init)->Unit(benchmark::kMicrosecond);
+
+/// Start-code scan over 4 MiB of slice-like bytes with a NAL every ~4 KiB.
+void BM_StartCodeScan(benchmark::State& state)
+{
+    std::vector<std::uint8_t> es(4 << 20);
+    Sequence seq{8};
+    for (auto& b : es)
+        b = static_cast<std::uint8_t>(seq.next(256));
+    for (std::size_t i = 0; i + 3 < es.size(); i += 4000 + seq.next(200)) {
+        es[i] = es[i + 1] = 0;
+        es[i + 2] = 1;
+    }
+    const std::uint8_t* end = es.data() + es.size();
+    for (auto _ : state) {
+        std::size_t units = 0;
+        for (const std::uint8_t* p = es.data(); p < end; ++units)
+            p = nal::find_start_code(p, end);
+        benchmark::DoNotOptimize(units);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * es.size()));
+}
+BENCHMARK(BM_StartCodeScan)->Unit(benchmark::kMicrosecond);
+
+constexpr std::uint64_t kCachedSegments = 4096;
+
+SegmentCache& warm_cache()
+{
+    static SegmentCache* cache = [] {
+        auto* c = new SegmentCache(std::size_t{256} << 20);
+        for (std::uint64_t i = 0; i < kCachedSegments; ++i) {
+            auto v = std::make_shared<CachedSegment>();
+            v->bytes.resize(16 * 1024);
+            c->insert({0, 0, i}, std::move(v));
+        }
+        return c;
+    }();
+    return *cache;
+}
+
+void BM_CacheHit(benchmark::State& state)
+{
+    auto& cache = warm_cache();
+    Sequence seq{6};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cache.find({0, 0, seq.next(kCachedSegments)}));
+}
+BENCHMARK(BM_CacheHit)->ThreadRange(1, 4);
+
+void BM_CacheMiss(benchmark::State& state)
+{
+    auto& cache = warm_cache();
+    Sequence seq{7};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cache.find({0, 1, seq.next(kCachedSegments)}));
+}
+BENCHMARK(BM_CacheMiss)->ThreadRange(1, 4);
+
+constexpr std::size_t kViewers = 10'000;
+
+SessionTable& busy_sessions()
+{
+    static SessionTable* table = [] {
+        auto* t = new SessionTable;
+        for (std::size_t i = 0; i < kViewers; ++i)
+            t->touch("viewer-" + std::to_string(i), static_cast<std::uint32_t>(i % 8), kEpoch);
+        return t;
+    }();
+    return *table;
+}
+
+/// A request's session lookup for one of ten thousand viewers.
+void BM_SessionTouch(benchmark::State& state)
+{
+    auto& table = busy_sessions();
+    std::vector<std::string> keys;
+    for (std::size_t i = 0; i < kViewers; ++i)
+        keys.push_back("viewer-" + std::to_string(i));
+    Sequence seq{9};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(table.touch(keys[seq.next(kViewers)], 0, kEpoch));
+}
+BENCHMARK(BM_SessionTouch);
+
+/// The once-a-second sweeps over ten thousand viewers: reaping (nobody
+/// is idle) and per-channel counts.
+void BM_SessionSweep(benchmark::State& state)
+{
+    auto& table = busy_sessions();
+    std::vector<std::size_t> counts;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.reap(kEpoch - kPtsPerSecond));
+        benchmark::DoNotOptimize(table.count(&counts));
+    }
+}
+BENCHMARK(BM_SessionSweep)->Unit(benchmark::kMicrosecond);
+
+/// Renders one playlist variant from the live window an hour in.
+void BM_PlaylistRender(benchmark::State& state)
+{
+    const Pts now = kEpoch + kPtsPerHour;
+    auto window = fixture().playout->window(now);
+    PlaylistFormat format;
+    format.delta = state.range(0) & 1;
+    format.part_target = state.range(0) & 2 ? 2 * kPtsPerSecond : 0;
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        const auto body = HlsService::render_playlist(*window, now, format);
+        bytes += body.size();
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+BENCHMARK(BM_PlaylistRender)->ArgName("variant")->DenseRange(0, 3);
+
+/// Answers a six-hour guide request from the pre-rendered buckets, at a
+/// different time of the week each iteration.
+void BM_GuideAppend(benchmark::State& state)
+{
+    ProgramGuide guide(*fixture().station->channel(0u));
+    Sequence seq{11};
+    std::string out;
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        out.clear();
+        guide.append(out, kEpoch + static_cast<Pts>(seq.next(6 * 24 * 3600)) * kPtsPerSecond, 6 * kPtsPerHour);
+        bytes += out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+BENCHMARK(BM_GuideAppend);
+
+/// One per-thread counter bumped from every benchmark thread, as the
+/// server threads bump cache hits.
+void BM_CounterAdd(benchmark::State& state)
+{
+    static metrics::Counter counter;
+    for (auto _ : state)
+        counter.add();
+    benchmark::DoNotOptimize(counter.value());
+}
+BENCHMARK(BM_CounterAdd)->ThreadRange(1, 8);
+
+void BM_HistogramRecord(benchmark::State& state)
+{
+    static metrics::Histogram histogram;
+    Sequence seq{static_cast<std::uint64_t>(state.thread_index()) + 1};
+    for (auto _ : state)
+        histogram.record(seq.next(1u << 30));
+}
+BENCHMARK(BM_HistogramRecord)->ThreadRange(1, 8);
+
+/// A day of viewing on four channels: 2,000 viewers a minute.
+std::vector<PlayEvent> history_rows(std::size_t rows)
+{
+    Sequence seq{13};
+    std::vector<PlayEvent> out(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        auto& e = out[i];
+        e.kind = PlayKind::ViewerMinute;
+        e.channel = static_cast<std::uint32_t>(seq.next(4));
+        e.episode = episode_key(static_cast<std::uint16_t>(1 + seq.next(9)), static_cast<std::uint16_t>(1 + seq.next(10)));
+        e.channel_pts = kEpoch + static_cast<Pts>(i / 2000) * 60 * kPtsPerSecond;
+        e.viewer = seq.next(100000);
+        e.offset_s = static_cast<std::uint32_t>(seq.next(22) * 60);
+        e.seconds = 60;
+    }
+    return out;
+}
+
+/// One viewer-minute handed to the flusher from every benchmark thread,
+/// as the server threads do for each segment crossing a minute.
+void BM_PlayHistoryRecord(benchmark::State& state)
+{
+    static PlayHistory history(std::filesystem::temp_directory_path() / "stv-bench-history.log");
+    PlayEvent event;
+    event.kind = PlayKind::ViewerMinute;
+    event.viewer = static_cast<std::uint64_t>(state.thread_index());
+    event.seconds = 60;
+    for (auto _ : state) {
+        event.channel_pts += 60 * kPtsPerSecond;
+        history.record(event);
+    }
+}
+BENCHMARK(BM_PlayHistoryRecord)->ThreadRange(1, 8);
+
+/// Sorts and encodes a full block, the flusher's work per write.
+void BM_HistoryEncode(benchmark::State& state)
+{
+    const auto rows = history_rows(PlayHistoryOptions{}.block_rows);
+    std::vector<PlayEvent> scratch;
+    std::vector<std::uint8_t> out;
+    for (auto _ : state) {
+        scratch = rows;
+        out.clear();
+        encode_history_block(scratch, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * rows.size()));
+    state.counters["bytes_per_row"] = static_cast<double>(out.size()) / static_cast<double>(rows.size());
+}
+BENCHMARK(BM_HistoryEncode);
+
+/// One episode's retention curve over sixteen blocks.
+void BM_WatchCurve(benchmark::State& state)
+{
+    const auto path = std::filesystem::temp_directory_path() / "stv-bench-curve.log";
+    {
+        std::vector<std::uint8_t> bytes;
+        for (int block = 0; block < 16; ++block) {
+            auto rows = history_rows(PlayHistoryOptions{}.block_rows);
+            encode_history_block(rows, bytes);
+        }
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f || std::fwrite(bytes.data(), 1, bytes.size(), f) != bytes.size() || std::fclose(f) != 0)
+            throw std::runtime_error("cannot write " + path.string());
+    }
+    const HistoryLog log(path);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(watch_curve(log, episode_key(4, 7)).data());
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * log.rows()));
+}
+BENCHMARK(BM_WatchCurve);
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // Take our own flag out before the library sees the rest.
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--library" && i + 1 < argc)
+            g_library = argv[++i];
+        else
+            argv[kept++] = argv[i];
+    }
+    argc = kept;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 2;
+    try {
+        fixture();
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-bench: %s\n", e.what());
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "synthetic.hpp"
+
+#include "seinfeld_tv/library_scan.hpp"
+#include "seinfeld_tv/mux.hpp"
+#include "seinfeld_tv/posix.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// PTS of the first frame, leaving room for the muxer's PCR lead.
+constexpr Pts kStartPts = kPtsPerSecond;
+constexpr Pts kBumperDuration = 3 * kPtsPerSecond;
+
+std::uint64_t splitmix64(std::uint64_t& state) noexcept
+{
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/// Filler that never forms a start code or an emulation-prevention pattern.
+void append_filler(std::pmr::vector<std::uint8_t>& out, std::size_t n, std::uint64_t& rng)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out.push_back(static_cast<std::uint8_t>(splitmix64(rng) | 0x10));
+}
+
+} // namespace
+
+std::vector<std::byte> synthetic_ts(Pts duration, Pts gop_duration, int frame_rate, std::uint64_t seed)
+{
+    if (duration <= 0 || gop_duration <= 0 || frame_rate <= 0)
+        throw std::invalid_argument("synthetic: durations and frame rate must be positive");
+    const Pts frame_pts = kPtsPerSecond / frame_rate;
+    const auto frames = static_cast<std::size_t>(duration / frame_pts);
+    const auto gop_frames = static_cast<std::size_t>(std::max<Pts>(gop_duration / frame_pts, 1));
+
+    // AUD, SPS (High@3.1, 1280x720), PPS, IDR slice header.
+    static constexpr std::uint8_t kKeyFrame[] = {
+        0x00, 0x00, 0x00, 0x01, 0x09, 0x10,
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x1f, 0xac, 0xd9, 0x40, 0x50, 0x05, 0xb9,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xe3, 0xcb,
+        0x00, 0x00, 0x01, 0x65, 0x88};
+    static constexpr std::uint8_t kFrame[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0x30, 0x00, 0x00, 0x01, 0x41, 0x9a};
+    // One silent 44.1 kHz AAC-LC ADTS frame per video frame keeps the
+    // audio track in step; 9 bytes of payload follow the header.
+    static constexpr std::uint8_t kAdts[] = {0xff, 0xf1, 0x50, 0x80, 0x02, 0x1f, 0xfc};
+
+    std::pmr::vector<PesPacket> packets;
+    packets.reserve(2 * frames);
+    std::uint64_t rng = seed;
+    for (std::size_t i = 0; i < frames; ++i) {
+        const Pts pts = kStartPts + static_cast<Pts>(i) * frame_pts;
+        const bool key = i % gop_frames == 0;
+        auto& video = packets.emplace_back(std::pmr::get_default_resource());
+        video.stream_type = VideoTraits<nal::Codec::H264>::kStreamType;
+        video.pts = video.dts = pts;
+        video.random_access = key;
+        if (key) {
+            video.payload.assign(std::begin(kKeyFrame), std::end(kKeyFrame));
+            append_filler(video.payload, 300 + splitmix64(rng) % 200, rng);
+        } else {
+            video.payload.assign(std::begin(kFrame), std::end(kFrame));
+            append_filler(video.payload, 40 + splitmix64(rng) % 120, rng);
+        }
+
+        auto& audio = packets.emplace_back(std::pmr::get_default_resource());
+        audio.stream_type = AudioTraits<AudioCodec::Aac>::kStreamType;
+        audio.pts = audio.dts = pts;
+        audio.payload.assign(std::begin(kAdts), std::end(kAdts));
+        append_filler(audio.payload, 9, rng);
+    }
+
+    std::pmr::vector<std::byte> out;
+    MuxState state;
+    TsMuxer<nal::Codec::H264, AudioCodec::Aac>::mux(packets, 0, state, out);
+    return {out.begin(), out.end()};
+}
+
+std::shared_ptr<const Catalog> make_synthetic_library(const std::filesystem::path& root,
+                                                      const std::filesystem::path& catalog_path,
+                                                      const SyntheticLibraryOptions& options)
+{
+    std::filesystem::create_directories(root);
+    for (std::uint16_t season = 1; season <= options.seasons; ++season) {
+        for (std::uint16_t episode = 1; episode <= options.episodes_per_season; ++episode) {
+            char name[64];
+            std::snprintf(name, sizeof name, "Synthetic - S%02uE%02u - Episode %u.ts", unsigned{season},
+                          unsigned{episode}, unsigned{episode});
+            const auto path = root / name;
+            const auto data = synthetic_ts(options.episode_duration, options.gop_duration, options.frame_rate,
+                                           options.seed * 1000 + season * 100u + episode);
+            std::error_code ec;
+            if (std::filesystem::file_size(path, ec) == data.size())
+                continue;
+            write_file_atomic(path, data);
+        }
+    }
+
+    LibraryScanner scanner(root, catalog_path);
+    const auto report = scanner.rescan_all();
+    if (!report.problems.empty())
+        throw std::runtime_error("synthetic: " + report.problems.front());
+    std::shared_ptr<const Catalog> catalog;
+    if (report.changed() || !std::filesystem::exists(catalog_path))
+        catalog = scanner.publish();
+    else
+        catalog = std::make_shared<const Catalog>(catalog_path);
+    if (!catalog->clips().empty())
+        return catalog;
+
+    // Scans carry clips over but never invent them: add the bumpers once.
+    CatalogBuilder builder;
+    for (const auto& r : catalog->episodes()) {
+        builder.add_episode({r.season, r.episode, std::string(catalog->title(r)), std::string(catalog->path(r)),
+                             r.hash, r.file_size, r.duration_pts, r.mtime_ns, catalog->loudness(r)});
+        if (catalog->id_of(r) % 3 == 0)
+            builder.add_clip({r.season, r.episode, 0, std::min(kBumperDuration, r.duration_pts), "bumper"});
+    }
+    builder.write(catalog_path, catalog->generation() + 1);
+    return std::make_shared<const Catalog>(catalog_path);
+}
+
+} // namespace seinfeld_tv
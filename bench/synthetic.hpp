@@ -0,0 +1,41 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/media_time.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Shape of a generated library. The same options always produce
+/// byte-identical masters, and so the same content hashes, which keeps
+/// benchmark and load-test runs comparable between commits.
+struct SyntheticLibraryOptions {
+    std::uint16_t seasons = 9;
+    std::uint16_t episodes_per_season = 10;
+    Pts episode_duration = 22 * kPtsPerMinute;
+    Pts gop_duration = 2 * kPtsPerSecond;
+    /// Video frames per second. Frames are a few hundred bytes of filler,
+    /// so this sets the file size while GOP and segment structure follow
+    /// the durations above.
+    int frame_rate = 2;
+    std::uint64_t seed = 1;
+};
+
+/// One 720p H.264 + AAC transport stream, muxed by TsMuxer: an IDR with
+/// in-band SPS/PPS every `gop_duration`. Frame sizes vary with `seed`.
+std::vector<std::byte> synthetic_ts(Pts duration, Pts gop_duration, int frame_rate, std::uint64_t seed);
+
+/// Writes "Synthetic - SxxEyy - Episode N.ts" under `root` for every
+/// episode (files already of the right size are kept), scans the tree
+/// and publishes the catalog at `catalog_path`. Every third episode gets
+/// a three-second "bumper" clip at its start.
+std::shared_ptr<const Catalog> make_synthetic_library(const std::filesystem::path& root,
+                                                      const std::filesystem::path& catalog_path,
+                                                      const SyntheticLibraryOptions& options = {});
+
+} // namespace seinfeld_tv
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Process-wide cache of fixed-size memory blocks, and of runs of 2^k
+/// contiguous blocks for allocations too large to bump.
+///
+/// Blocks and runs come from the system allocator once and are recycled
+/// indefinitely afterwards (up to `max_cached` blocks' worth of each
+/// size), so steady-state segment building never returns memory to the
+/// OS or goes back to malloc. The mutex is only taken when an arena grows
+/// past the blocks and runs it retains between resets, which is rare once
+/// the arena has warmed up.
+class BlockPool {
+public:
+    static constexpr std::size_t kDefaultBlockSize = 64 * 1024;
+    /// Run sizes: block_size() << k for k below this (up to 32 MiB with
+    /// the default block).
+    static constexpr unsigned kRunClasses = 10;
+
+    explicit BlockPool(std::size_t block_size = kDefaultBlockSize, std::size_t max_cached = 4096);
+    ~BlockPool();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    /// Shared pool used by arenas that are not given one explicitly.
+    static BlockPool& global();
+
+    std::size_t block_size() const noexcept { return block_size_; }
+
+    void* acquire();
+    void release(void* block) noexcept;
+
+    /// Smallest run class holding `bytes`, or kRunClasses if none does.
+    unsigned run_class(std::size_t bytes) const noexcept;
+    /// A run of block_size() << run_class bytes; class 0 is a block.
+    void* acquire_run(unsigned run_class);
+    void release_run(void* run, unsigned run_class) noexcept;
+
+    /// Blocks cached, not counting runs.
+    std::size_t cached() const;
+
+private:
+    const std::size_t block_size_;
+    const std::size_t max_cached_;
+    mutable std::mutex mutex_;
+    std::vector<void*> free_;
+    std::vector<void*> free_runs_[kRunClasses]; ///< [0] unused: blocks are free_
+};
+
+/// Bump allocator for everything one output segment needs (demuxed PES
+/// packets, muxer scratch, extent lists), exposed as a std::pmr resource.
+///
+/// Deallocation is a no-op; `reset()` frees everything at once when the
+/// segment has been sent. The arena keeps up to `retain_blocks` blocks
+/// across resets (4 MiB by default, about one 6 s top-rendition segment)
+/// and hands the rest back to its BlockPool, so a warmed-up arena
+/// allocates without touching any shared state at all. Requests over
+/// half a block (PES payloads, output buffers) each get a whole run of
+/// blocks from the pool, and up to `retain_blocks` blocks' worth of runs
+/// are kept across resets as well. Only
+/// requests beyond the largest run, or over-aligned ones, go to
+/// `upstream`; upstream_allocations() counts them. Not thread-safe: use
+/// one arena per segment builder.
+class SegmentArena final : public std::pmr::memory_resource {
+public:
+    explicit SegmentArena(BlockPool& pool = BlockPool::global(), std::size_t retain_blocks = 64,
+                          std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~SegmentArena() override;
+
+    SegmentArena(const SegmentArena&) = delete;
+    SegmentArena& operator=(const SegmentArena&) = delete;
+
+    /// Invalidates every allocation made since the previous reset.
+    void reset() noexcept;
+
+    /// Bytes handed out since the last reset (including alignment padding).
+    std::size_t used() const noexcept { return used_; }
+    /// Largest `used()` seen at any reset; useful for sizing retain_blocks.
+    std::size_t high_water() const noexcept { return high_water_; }
+    /// Requests that fell back to `upstream` since construction; nonzero
+    /// means the segment path is calling malloc.
+    std::size_t upstream_allocations() const noexcept { return upstream_allocations_; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) noexcept override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    struct Large {
+        void* ptr;
+        std::size_t bytes;
+        std::size_t alignment;
+    };
+    struct Run {
+        void* ptr;
+        unsigned run_class;
+        bool busy;
+    };
+
+    void* allocate_run(unsigned run_class);
+
+    BlockPool& pool_;
+    std::pmr::memory_resource* upstream_;
+    std::size_t retain_blocks_;
+    std::vector<void*> blocks_; ///< blocks_[current_] is being bumped
+    std::size_t current_ = 0;
+    std::size_t offset_ = 0;
+    std::vector<Run> runs_; ///< busy: handed out since the last reset
+    std::vector<Large> large_;
+    std::size_t used_ = 0;
+    std::size_t high_water_ = 0;
+    std::size_t upstream_allocations_ = 0;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "seinfeld_tv/http_server.hpp"
+#include "seinfeld_tv/session_table.hpp"
+#include "seinfeld_tv/transcode.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace seinfeld_tv {
+
+struct BandwidthOptions {
+    /// How far each batch moves a session's estimate towards what it
+    /// measured (an EWMA weight).
+    double weight = 0.3;
+    /// Deliveries smaller or quicker than this say more about latency and
+    /// buffering than throughput and are ignored.
+    std::uint64_t min_bytes = 64 * 1024;
+    std::chrono::microseconds min_elapsed{1000};
+};
+
+/// Per-session throughput from send completions.
+///
+/// record() runs once per delivered segment on the server threads and
+/// only appends to a per-thread shard. update() runs on a timer. It takes
+/// every shard's batch and sums bytes and time per session, then folds
+/// the resulting rates into the SessionTable under a single lock. So the
+/// estimate costs a few stores per request and one pass per tick,
+/// however many viewers there are.
+class BandwidthEstimator {
+public:
+    explicit BandwidthEstimator(BandwidthOptions options = {}) : options_(options) {}
+
+    /// HttpResponse::delivery_tag for a session's response; never zero.
+    static std::uint64_t tag(SessionHandle h) noexcept
+    {
+        return std::uint64_t{h.slot} << 32 | h.generation;
+    }
+
+    void record(const HttpDelivery& delivery);
+
+    /// Applies everything recorded since the last call; returns the number
+    /// of sessions whose estimate changed.
+    std::size_t update(SessionTable& sessions);
+
+private:
+    static constexpr std::size_t kShards = 16;
+
+    struct Pending {
+        std::uint64_t tag;
+        std::uint64_t bytes;
+        std::int64_t ns;
+    };
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<Pending> pending;
+    };
+
+    BandwidthOptions options_;
+    std::array<Shard, kShards> shards_;
+    std::vector<Pending> batch_; ///< update()'s scratch, reused
+};
+
+/// Index into `ladder` (ordered best first, as default_ladder() is) of
+/// the best rendition whose video and audio bitrate, times `headroom`,
+/// fits in `bps`; the last rendition when none does. nullopt while the
+/// bandwidth is unknown (0) or the ladder is empty.
+std::optional<std::size_t> rendition_hint(std::span<const Rendition> ladder, std::uint32_t bps,
+                                          double headroom = 1.5) noexcept;
+
+} // namespace seinfeld_tv
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "seinfeld_tv/content_hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace seinfeld_tv {
+
+/// Incremental BLAKE3 hasher (unkeyed, 256-bit output).
+class Blake3 {
+public:
+    static constexpr std::size_t kChunkSize = 1024;
+    static constexpr std::size_t kBlockSize = 64;
+
+    Blake3() noexcept;
+
+    void update(const void* data, std::size_t size) noexcept;
+    void update(std::span<const std::byte> data) noexcept { update(data.data(), data.size()); }
+
+    /// Digest of everything added so far; the hasher can keep going.
+    ContentHash finalize() const noexcept;
+
+private:
+    struct ChunkState {
+        std::uint32_t cv[8];
+        std::uint64_t counter = 0;
+        std::uint8_t block[kBlockSize]{};
+        std::uint8_t block_len = 0;
+        std::uint8_t blocks_compressed = 0;
+
+        std::size_t len() const noexcept { return kBlockSize * blocks_compressed + block_len; }
+    };
+
+    void push_chunk_cv(const std::uint32_t cv[8], std::uint64_t total_chunks) noexcept;
+
+    ChunkState chunk_;
+    /// Chaining values of completed subtrees, one per set bit of the chunk count.
+    std::uint32_t stack_[54][8];
+    std::uint8_t stack_len_ = 0;
+};
+
+/// BLAKE3 of a byte range.
+ContentHash blake3(std::span<const std::byte> data) noexcept;
+
+} // namespace seinfeld_tv
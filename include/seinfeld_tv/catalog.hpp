@@ -0,0 +1,139 @@
+#pragma once
+
+#include "seinfeld_tv/catalog_format.hpp"
+#include "seinfeld_tv/loudness.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace seinfeld_tv {
+
+using EpisodeRecord = catalog_format::EpisodeRecord;
+using ClipRecord = catalog_format::ClipRecord;
+
+/// Index of an episode within a catalog generation. Ids are dense and
+/// follow (season, episode) order; they are only stable within one file.
+using EpisodeId = std::uint32_t;
+
+inline constexpr EpisodeId kInvalidEpisode = ~EpisodeId{0};
+
+/// Read-only view of a memory-mapped catalog index.
+///
+/// Opening validates the header and every string reference once, after
+/// which all lookups read straight from the mapping and never allocate.
+/// Returned pointers and views live as long as the Catalog.
+class Catalog {
+public:
+    explicit Catalog(const std::filesystem::path& path);
+
+    Catalog(Catalog&&) noexcept = default;
+    Catalog& operator=(Catalog&&) noexcept = default;
+
+    std::uint64_t generation() const noexcept { return header_->generation; }
+    std::size_t size() const noexcept { return episodes_.size(); }
+
+    std::span<const EpisodeRecord> episodes() const noexcept { return episodes_; }
+    std::span<const ClipRecord> clips() const noexcept { return clips_; }
+
+    const EpisodeRecord& episode(EpisodeId id) const noexcept { return episodes_[id]; }
+    EpisodeId id_of(const EpisodeRecord& record) const noexcept
+    {
+        return static_cast<EpisodeId>(&record - episodes_.data());
+    }
+
+    /// Returns nullptr when no such episode is catalogued.
+    const EpisodeRecord* find(std::uint16_t season, std::uint16_t episode) const noexcept;
+    const EpisodeRecord* find(const ContentHash& hash) const noexcept;
+
+    /// All episodes of one season, contiguous in id order.
+    std::span<const EpisodeRecord> season(std::uint16_t season) const noexcept;
+
+    std::span<const ClipRecord> clips_of(const EpisodeRecord& record) const noexcept
+    {
+        return clips_.subspan(record.first_clip, record.clip_count);
+    }
+
+    std::string_view path(const EpisodeRecord& record) const noexcept
+    {
+        return string_at(record.path_offset, record.path_length);
+    }
+    std::string_view title(const EpisodeRecord& record) const noexcept
+    {
+        return string_at(record.title_offset, record.title_length);
+    }
+    std::string_view label(const ClipRecord& clip) const noexcept
+    {
+        return string_at(clip.label_offset, clip.label_length);
+    }
+
+    /// Cached loudness measurement, nullopt if the episode was never measured.
+    std::optional<Loudness> loudness(const EpisodeRecord& record) const noexcept;
+
+    /// Records a measurement in place in the catalog at `path`. Mapped
+    /// readers (the mapping is shared) see it without reopening; the new
+    /// values are written before the flag that makes them valid.
+    static void store_loudness(const std::filesystem::path& path, EpisodeId id, const Loudness& loudness);
+
+private:
+    std::string_view string_at(std::uint32_t offset, std::uint32_t length) const noexcept
+    {
+        return {strings_ + offset, length};
+    }
+    void validate() const;
+
+    MappedFile file_;
+    const catalog_format::CatalogHeader* header_ = nullptr;
+    std::span<const EpisodeRecord> episodes_;
+    std::span<const ClipRecord> clips_;
+    std::span<const catalog_format::HashIndexEntry> hash_index_;
+    const char* strings_ = nullptr;
+    std::uint64_t strings_size_ = 0;
+};
+
+/// Description of one episode handed to CatalogBuilder.
+struct EpisodeInfo {
+    std::uint16_t season = 0;
+    std::uint16_t episode = 0;
+    std::string title;
+    std::string path;
+    ContentHash hash;
+    std::uint64_t file_size = 0;
+    Pts duration_pts = 0;
+    std::int64_t mtime_ns = 0;
+    std::optional<Loudness> loudness;
+};
+
+/// A named span inside an episode ("Kramer entrance", "the contest" ...).
+struct ClipInfo {
+    std::uint16_t season = 0;
+    std::uint16_t episode = 0;
+    Pts in_pts = 0;
+    Pts out_pts = 0;
+    std::string label;
+};
+
+/// Offline writer for catalog images.
+class CatalogBuilder {
+public:
+    void add_episode(EpisodeInfo info) { episodes_.push_back(std::move(info)); }
+    void add_clip(ClipInfo clip) { clips_.push_back(std::move(clip)); }
+
+    /// Writes the image to `path` atomically so a concurrently mapped older
+    /// generation is never torn.
+    ///
+    /// Throws std::invalid_argument on duplicate episodes, duplicate hashes
+    /// or clips that reference an unknown episode.
+    void write(const std::filesystem::path& path, std::uint64_t generation) const;
+
+private:
+    std::vector<EpisodeInfo> episodes_;
+    std::vector<ClipInfo> clips_;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/media_time.hpp"
+
+#include <bit>
+#include <cstdint>
+
+/// On-disk layout of the episode catalog index.
+///
+/// The file is a flat little-endian image that is mapped read-only and read
+/// in place; nothing is parsed into heap objects. Sections follow the header
+/// in this order, each 64-byte aligned:
+///
+///   CatalogHeader
+///   EpisodeRecord[episode_count]   sorted by (season, episode)
+///   ClipRecord[clip_count]         sorted by (episode_id, in_pts)
+///   HashIndexEntry[episode_count]  sorted by content hash
+///   string table                   UTF-8, not NUL-terminated
+namespace seinfeld_tv::catalog_format {
+
+static_assert(std::endian::native == std::endian::little, "catalog images are little-endian");
+
+inline constexpr char kMagic[8] = {'S', 'T', 'V', 'C', 'A', 'T', 'L', 'G'};
+inline constexpr std::uint32_t kVersion = 1;
+inline constexpr std::uint64_t kSectionAlignment = 64;
+
+struct CatalogHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t generation;
+    std::uint64_t file_size;
+    std::uint32_t episode_count;
+    std::uint32_t clip_count;
+    std::uint64_t episodes_offset;
+    std::uint64_t clips_offset;
+    std::uint64_t hash_index_offset;
+    std::uint64_t strings_offset;
+    std::uint64_t strings_size;
+    std::uint8_t reserved[48];
+};
+static_assert(sizeof(CatalogHeader) == 128);
+
+struct EpisodeRecord {
+    ContentHash hash;
+    std::uint64_t file_size;
+    Pts duration_pts;
+    std::uint32_t path_offset;
+    std::uint32_t path_length;
+    std::uint32_t title_offset;
+    std::uint32_t title_length;
+    std::uint32_t first_clip;
+    std::uint32_t clip_count;
+    std::uint16_t season;
+    std::uint16_t episode;
+    std::uint32_t flags;
+    float loudness_lufs; ///< valid with kEpisodeLoudness
+    float sample_peak;   ///< linear, valid with kEpisodeLoudness
+    std::int64_t mtime_ns; ///< file modification time when hashed, 0 if unknown
+};
+static_assert(sizeof(EpisodeRecord) == 96);
+
+/// EpisodeRecord::flags
+inline constexpr std::uint32_t kEpisodeLoudness = 1u << 0;
+
+struct ClipRecord {
+    std::uint32_t episode_id;
+    std::uint32_t label_offset;
+    std::uint32_t label_length;
+    std::uint32_t flags;
+    Pts in_pts;
+    Pts out_pts;
+};
+static_assert(sizeof(ClipRecord) == 32);
+
+struct HashIndexEntry {
+    ContentHash hash;
+    std::uint32_t episode_id;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(HashIndexEntry) == 40);
+
+constexpr std::uint64_t align_section(std::uint64_t offset) noexcept
+{
+    return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+} // namespace seinfeld_tv::catalog_format
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/thread_pool.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace seinfeld_tv {
+
+namespace chunk_format {
+
+static_assert(std::endian::native == std::endian::little, "chunk manifests are little-endian");
+
+inline constexpr char kMagic[8] = {'S', 'T', 'V', 'C', 'H', 'U', 'N', 'K'};
+inline constexpr std::uint32_t kVersion = 1;
+
+/// Sidecar layout: header, then ChunkEntry chunks[chunk_count].
+struct ChunkHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    ContentHash root;
+    std::uint64_t source_size;
+    std::uint64_t chunk_count;
+    std::uint32_t min_size;
+    std::uint32_t avg_size;
+    std::uint32_t max_size;
+    std::uint8_t reserved[52];
+};
+static_assert(sizeof(ChunkHeader) == 128);
+
+} // namespace chunk_format
+
+/// One content-defined chunk of a file.
+struct ChunkEntry {
+    std::uint64_t offset = 0;
+    std::uint32_t length = 0;
+    std::uint32_t reserved = 0;
+    ContentHash hash; ///< BLAKE3 of the chunk bytes
+};
+static_assert(sizeof(ChunkEntry) == 48);
+
+/// FastCDC size bounds. Cut points are where a gear rolling hash over the
+/// last 64 bytes has enough zero bits (normalized chunking: stricter
+/// before avg_size, looser after), so they move with the content when
+/// bytes are inserted or removed earlier in the file.
+struct CdcParams {
+    std::uint32_t min_size = 256 * 1024;
+    std::uint32_t avg_size = 1024 * 1024; ///< power of two
+    std::uint32_t max_size = 4 * 1024 * 1024;
+};
+
+/// Length of the first chunk of `data`.
+std::size_t cdc_cut(std::span<const std::byte> data, const CdcParams& params = {}) noexcept;
+
+/// A file's chunk list and the content hash derived from it.
+///
+/// The content hash is a two-level tree: BLAKE3 over the chunk digests and
+/// lengths. Chunks hash independently, so one file spreads across every
+/// core. A re-mux that only rewrites the container header changes the
+/// first chunk or two and leaves the rest of the list intact, which
+/// shared_fraction() measures.
+struct ChunkManifest {
+    CdcParams params;
+    std::uint64_t source_size = 0;
+    std::vector<ChunkEntry> chunks;
+    ContentHash root;
+
+    static ContentHash root_of(std::span<const ChunkEntry> chunks, const CdcParams& params) noexcept;
+
+    /// Fraction of this file's bytes in chunks that also occur in `older`.
+    double shared_fraction(const ChunkManifest& older) const;
+
+    /// `<media>.chunks`, beside the file.
+    static std::filesystem::path sidecar_path(const std::filesystem::path& media);
+
+    void write(const std::filesystem::path& sidecar) const;
+    /// Throws std::runtime_error if the sidecar is malformed.
+    static ChunkManifest read(const std::filesystem::path& sidecar);
+};
+
+/// Chunks and hashes `path`. With a pool, chunk hashing fans out across
+/// its workers while the boundary scan continues; called from inside a
+/// pool worker it runs inline instead of blocking that worker.
+ChunkManifest chunk_file(const std::filesystem::path& path, WorkStealingPool* pool = nullptr,
+                         const CdcParams& params = {});
+
+/// Content hash of `path`; chunk_file(path, pool).root.
+ContentHash hash_file(const std::filesystem::path& path, WorkStealingPool* pool = nullptr);
+
+} // namespace seinfeld_tv
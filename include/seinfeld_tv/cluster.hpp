@@ -0,0 +1,130 @@
+#pragma once
+
+#include "seinfeld_tv/metrics.hpp"
+#include "seinfeld_tv/segment_cache.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace seinfeld_tv {
+
+struct ClusterNode {
+    std::string host;
+    std::uint16_t port = 0;
+
+    /// "host:port", which also seeds the node's hash.
+    std::string name() const { return host + ':' + std::to_string(port); }
+};
+
+/// Parses a comma-separated "host:port" list. Throws std::invalid_argument
+/// on a malformed entry.
+std::vector<ClusterNode> parse_nodes(std::string_view list);
+
+/// Which node of a fixed cluster owns each segment.
+///
+/// Ownership is rendezvous (highest random weight) hashing: every node
+/// scores each key with a hash seeded by its name and the highest score
+/// wins. All nodes agree without coordination so long as they share the
+/// node list and the key means the same thing everywhere (HlsService
+/// uses the segment's start time, not its node-local sequence number).
+/// Adding or removing a node moves only the keys it wins or held, 1/N of
+/// them.
+class ClusterMap {
+public:
+    /// `self` indexes `nodes`. Throws std::invalid_argument if out of range.
+    ClusterMap(std::vector<ClusterNode> nodes, std::size_t self);
+
+    std::size_t owner(const SegmentKey& key) const noexcept;
+    bool owns(const SegmentKey& key) const noexcept { return owner(key) == self_; }
+
+    const ClusterNode& node(std::size_t i) const noexcept { return nodes_[i]; }
+    std::size_t size() const noexcept { return nodes_.size(); }
+    std::size_t self() const noexcept { return self_; }
+
+private:
+    std::vector<ClusterNode> nodes_;
+    std::vector<std::uint64_t> seeds_;
+    std::size_t self_;
+};
+
+struct PeerFetchOptions {
+    unsigned threads = 4;
+    /// Connect, send and receive timeout of one fetch.
+    std::chrono::milliseconds timeout{2000};
+    /// After a failed fetch, the key is served from origin for this long.
+    std::chrono::milliseconds failure_ttl{10'000};
+    /// Fetches queued beyond this are refused, and their requests go to origin.
+    std::size_t max_queued = 1024;
+};
+
+struct PeerFetchStats {
+    std::uint64_t fetched = 0;
+    std::uint64_t failed = 0;
+    std::uint64_t refused = 0; ///< queue full
+    std::uint64_t bytes = 0;
+};
+
+/// Copies segments this node does not own from their owners into the
+/// local SegmentCache, so a cluster reads each segment from origin
+/// storage once instead of once per node.
+///
+/// request() only queues; a few threads run plain blocking HTTP GETs,
+/// one per connection, against the owner's HTTP port. Concurrent
+/// requests for one key share one fetch. A failed key is remembered for
+/// a while and reported as such, and the caller serves it from origin
+/// rather than stalling viewers on a dead peer.
+class PeerFetcher {
+public:
+    PeerFetcher(const ClusterMap& cluster, SegmentCache& cache, PeerFetchOptions options = {});
+    ~PeerFetcher();
+
+    PeerFetcher(const PeerFetcher&) = delete;
+    PeerFetcher& operator=(const PeerFetcher&) = delete;
+
+    enum class Status { Pending, Failed };
+
+    /// Starts or joins the fetch of `path` from node `owner` into the
+    /// cache under `key`. Pending: poll the cache until it appears.
+    Status request(const SegmentKey& key, std::size_t owner, std::string path);
+
+    PeerFetchStats stats() const;
+
+    /// Duration of every fetch, failed ones included.
+    const metrics::Histogram& fetch_latency() const noexcept { return fetch_latency_; }
+
+private:
+    struct Job {
+        SegmentKey key;
+        std::size_t owner;
+        std::string path;
+    };
+
+    void run(std::stop_token stop);
+    void fetch(const Job& job);
+
+    const ClusterMap& cluster_;
+    SegmentCache& cache_;
+    PeerFetchOptions options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any wake_;
+    std::deque<Job> queue_;
+    std::unordered_set<SegmentKey, SegmentKeyHash> pending_; ///< queued or in flight
+    /// Failed keys, to when they may be tried again.
+    std::unordered_map<SegmentKey, std::chrono::steady_clock::time_point, SegmentKeyHash> failed_;
+    PeerFetchStats stats_;
+    metrics::Histogram fetch_latency_;
+    std::vector<std::jthread> threads_;
+};
+
+} // namespace seinfeld_tv
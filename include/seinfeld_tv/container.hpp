@@ -0,0 +1,83 @@
+#pragma once
+
+#include "seinfeld_tv/media_time.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace seinfeld_tv {
+
+enum class Container : std::uint8_t {
+    Unknown,
+    MpegTs, ///< 188-byte transport stream packets
+    Fmp4,   ///< fragmented ISO-BMFF (CMAF): ftyp/moov then moof/mdat pairs
+};
+
+inline constexpr std::size_t kTsPacketSize = 188;
+
+/// Contiguous byte range within a source file.
+struct FileExtent {
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+static_assert(sizeof(FileExtent) == 16);
+
+/// GOP flags.
+inline constexpr std::uint16_t kGopClosed = 1u << 0;    ///< starts on an IDR; nothing references earlier frames
+inline constexpr std::uint16_t kGopParamSets = 1u << 1; ///< SPS/PPS are repeated in-band at the GOP start
+
+/// One group of pictures: a point where a segment may start without
+/// decoding anything earlier, and the bytes up to the next such point.
+/// `pts` is relative to the first keyframe of the file. The layout is
+/// packed and shared with the on-disk GOP sidecar.
+struct GopEntry {
+    Pts pts;
+    std::uint64_t offset;
+    std::uint32_t size;
+    std::uint16_t flags;
+    std::uint16_t param_set; ///< index into the codec parameter-set fingerprints
+};
+static_assert(sizeof(GopEntry) == 24);
+
+/// Non-owning view of what the segmenter needs to cut a file by byte
+/// range: where GOPs start, and which bytes must precede any cut so that a
+/// player can start decoding there. Backed either by a fresh scan or by a
+/// mapped GOP sidecar.
+struct GopView {
+    Container container = Container::Unknown;
+    /// TS: the first PAT and PMT packets, prepended to every segment.
+    /// fMP4: ftyp+moov, served once as the init segment.
+    std::span<const FileExtent> init;
+    std::span<const GopEntry> gops;
+    /// 64-bit fingerprints of each distinct SPS/PPS (or avcC/hvcC) set.
+    std::span<const std::uint64_t> param_sets;
+    std::uint64_t file_size = 0;
+    Pts duration_pts = 0;
+};
+
+/// Result of one demux pass over a source file.
+struct ContainerLayout {
+    Container container = Container::Unknown;
+    std::vector<FileExtent> init;
+    std::vector<GopEntry> gops;
+    std::vector<std::uint64_t> param_sets;
+    std::uint64_t file_size = 0;
+    Pts duration_pts = 0;
+    std::uint16_t video_pid = 0;
+    std::uint8_t video_stream_type = 0;
+
+    GopView view() const noexcept { return {container, init, gops, param_sets, file_size, duration_pts}; }
+};
+
+/// Sniffs the container type from the first bytes of a file.
+Container detect_container(std::span<const std::byte> head) noexcept;
+
+/// One demux pass over a whole file image. Throws std::runtime_error if
+/// the file is not a supported container or has no video track.
+ContainerLayout scan_container(std::span<const std::byte> file);
+ContainerLayout scan_ts(std::span<const std::byte> file);
+ContainerLayout scan_fmp4(std::span<const std::byte> file);
+
+} // namespace seinfeld_tv
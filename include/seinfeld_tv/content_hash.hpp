@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace seinfeld_tv {
+
+/// 256-bit content digest identifying a media file and everything derived
+/// from it (GOP sidecars, cached segments, loudness measurements).
+struct ContentHash {
+    std::array<std::uint8_t, 32> bytes{};
+
+    friend auto operator<=>(const ContentHash&, const ContentHash&) = default;
+
+    bool is_zero() const noexcept
+    {
+        for (auto b : bytes)
+            if (b != 0)
+                return false;
+        return true;
+    }
+
+    /// First eight bytes as an integer; digests are uniform so this is a
+    /// good hash-table key on its own.
+    std::uint64_t prefix() const noexcept
+    {
+        std::uint64_t v;
+        std::memcpy(&v, bytes.data(), sizeof v);
+        return v;
+    }
+
+    std::string to_hex() const;
+    static std::optional<ContentHash> from_hex(std::string_view hex);
+};
+
+static_assert(sizeof(ContentHash) == 32);
+
+inline std::string ContentHash::to_hex() const
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string out(bytes.size() * 2, '0');
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0xf];
+    }
+    return out;
+}
+
+inline std::optional<ContentHash> ContentHash::from_hex(std::string_view hex)
+{
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    };
+    ContentHash h;
+    if (hex.size() != h.bytes.size() * 2)
+        return std::nullopt;
+    for (std::size_t i = 0; i < h.bytes.size(); ++i) {
+        int hi = nibble(hex[2 * i]);
+        int lo = nibble(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return std::nullopt;
+        h.bytes[i] = static_cast<std::uint8_t>(hi << 4 | lo);
+    }
+    return h;
+}
+
+} // namespace seinfeld_tv
+
+template <>
+struct std::hash<seinfeld_tv::ContentHash> {
+    std::size_t operator()(const seinfeld_tv::ContentHash& h) const noexcept { return h.prefix(); }
+};
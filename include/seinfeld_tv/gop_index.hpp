@@ -0,0 +1,87 @@
+#pragma once
+
+#include "seinfeld_tv/container.hpp"
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace seinfeld_tv {
+
+namespace gop_format {
+
+static_assert(std::endian::native == std::endian::little, "GOP sidecars are little-endian");
+
+inline constexpr char kMagic[8] = {'S', 'T', 'V', 'G', 'O', 'P', 'I', 'X'};
+inline constexpr std::uint32_t kVersion = 1;
+
+/// Sidecar layout: header, then std::uint64_t param_sets[param_set_count],
+/// FileExtent init[init_count], GopEntry gops[gop_count], each section
+/// 8-byte aligned by construction.
+struct GopHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    ContentHash hash; ///< content hash of the media file this indexes
+    std::uint64_t source_size;
+    Pts duration_pts;
+    std::uint32_t gop_count;
+    std::uint32_t init_count;
+    std::uint32_t param_set_count;
+    std::uint8_t container;
+    std::uint8_t video_stream_type;
+    std::uint16_t video_pid;
+    std::uint8_t reserved[48];
+};
+static_assert(sizeof(GopHeader) == 128);
+
+} // namespace gop_format
+
+/// Keyframe/GOP index of one episode file, stored as a sidecar next to it
+/// and memory-mapped on use.
+///
+/// The sidecar is keyed by the catalog's content hash: if the media file is
+/// replaced, the stored hash no longer matches and the index is rebuilt
+/// with a single demux pass. Channel joins, seeks and segment cuts then
+/// binary-search the mapped array instead of re-scanning the container.
+class GopIndex {
+public:
+    /// `<media>.gop`, beside the episode file.
+    static std::filesystem::path sidecar_path(const std::filesystem::path& media);
+
+    /// Maps the sidecar for `media` if it exists and matches `hash`, otherwise
+    /// scans `media`, writes a fresh sidecar and maps that.
+    static GopIndex open_or_build(const std::filesystem::path& media, const ContentHash& hash);
+    static GopIndex open_or_build(const std::filesystem::path& media, const ContentHash& hash,
+                                  const std::filesystem::path& sidecar);
+
+    /// Serialises a scan result to `sidecar` atomically.
+    static void write(const std::filesystem::path& sidecar, const ContainerLayout& layout, const ContentHash& hash);
+
+    /// Maps an existing sidecar. Throws std::runtime_error if it is malformed.
+    explicit GopIndex(const std::filesystem::path& sidecar);
+
+    GopIndex(GopIndex&&) noexcept = default;
+    GopIndex& operator=(GopIndex&&) noexcept = default;
+
+    const ContentHash& hash() const noexcept { return header_->hash; }
+    std::uint64_t source_size() const noexcept { return header_->source_size; }
+    Container container() const noexcept { return static_cast<Container>(header_->container); }
+    std::span<const GopEntry> gops() const noexcept { return view_.gops; }
+    const GopView& view() const noexcept { return view_; }
+
+    /// Index of the GOP that contains `pts` (the last one starting at or
+    /// before it); 0 for times before the first keyframe. Requires a
+    /// non-empty index.
+    std::size_t seek(Pts pts) const noexcept;
+
+private:
+    MappedFile file_;
+    const gop_format::GopHeader* header_ = nullptr;
+    GopView view_;
+};
+
+} // namespace seinfeld_tv
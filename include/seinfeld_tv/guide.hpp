@@ -0,0 +1,55 @@
+#pragma once
+
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/rcu.hpp"
+#include "seinfeld_tv/station.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// A channel's electronic program guide, pre-rendered as JSON.
+///
+/// The channel's timeline is cut into fixed half-hour buckets, and each
+/// bucket keeps the JSON of the programs starting in it plus that of the
+/// program already airing when it begins. Answering "the next N hours"
+/// is then a concatenation of a few strings, with no timeline search and
+/// nothing from the playout path. A program is one episode airing: the
+/// parts of an episode split by breaks, and the breaks between them, are
+/// listed as one entry.
+///
+/// Buckets are rebuilt, under a try-lock, by the first request that sees
+/// the scheduler's revision move; other requests meanwhile answer from
+/// the previous buckets, published through an RCU cell.
+class ProgramGuide {
+public:
+    static constexpr Pts kBucket = 30 * kPtsPerMinute;
+
+    explicit ProgramGuide(const Channel& channel);
+
+    /// Appends `{"channel":NAME,"programs":[...]}` for the programs airing
+    /// in the buckets covering [from, from + span). Each program is
+    /// `{"start":T,"end":T,"season":S,"episode":E,"title":S}`, times in
+    /// ISO 8601 UTC.
+    void append(std::string& out, Pts from, Pts span);
+
+private:
+    struct Buckets {
+        std::uint64_t revision = 0;
+        Pts origin = 0; ///< channel time of bucket 0, a multiple of kBucket
+        std::vector<std::string> starting; ///< programs starting in each bucket
+        std::vector<std::string> carried;  ///< the program airing as each begins
+    };
+
+    void refresh(bool wait);
+
+    const Channel& channel_;
+    std::string head_;
+    rcu::Cell<Buckets> buckets_;
+    std::mutex refresh_mutex_;
+};
+
+} // namespace seinfeld_tv
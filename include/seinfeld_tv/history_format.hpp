@@ -0,0 +1,55 @@
+#pragma once
+
+#include "seinfeld_tv/media_time.hpp"
+
+#include <bit>
+#include <cstdint>
+
+/// On-disk layout of the play-history log.
+///
+/// The log is a sequence of self-contained blocks, appended one write(2)
+/// each, so a reader can map a log that is still growing and a crash can
+/// only truncate the last block. A block holds up to a few ten thousand
+/// events sorted by (kind, channel, episode, channel_pts, viewer) and
+/// stored column by column:
+///
+///   BlockHeader
+///   std::uint32_t dictionary[dictionary_size]   episode keys, ascending
+///   kKind, kChannel, kEpisode, kSeconds         run-length: (value, run) varints
+///   kPts, kViewer, kOffset                      zigzag varint deltas from the previous row
+///
+/// then zero padding to a multiple of kBlockAlignment. kEpisode holds
+/// indexes into the dictionary. Sorting makes the first columns a
+/// handful of runs and the deltas a byte or two each, so a viewer-minute
+/// costs a few bytes.
+namespace seinfeld_tv::history_format {
+
+static_assert(std::endian::native == std::endian::little, "history blocks are little-endian");
+
+inline constexpr char kMagic[4] = {'S', 'T', 'V', 'H'};
+inline constexpr std::uint32_t kVersion = 1;
+inline constexpr std::uint64_t kBlockAlignment = 8;
+
+enum Column : std::uint32_t { kKind, kChannel, kEpisode, kSeconds, kPts, kViewer, kOffset, kColumns };
+
+struct BlockHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t rows;
+    std::uint32_t dictionary_size;
+    Pts min_pts; ///< kPts deltas start from here
+    Pts max_pts;
+    std::uint32_t column_bytes[kColumns]; ///< in Column order, after the dictionary
+    std::uint32_t payload_bytes;          ///< dictionary and columns, without padding
+    std::uint32_t checksum;               ///< FNV-1a of the payload
+    std::uint32_t reserved;
+};
+static_assert(sizeof(BlockHeader) == 72);
+
+/// Offset of the block after one at `offset` with `payload_bytes`.
+constexpr std::uint64_t next_block(std::uint64_t offset, std::uint32_t payload_bytes) noexcept
+{
+    return (offset + sizeof(BlockHeader) + payload_bytes + kBlockAlignment - 1) & ~(kBlockAlignment - 1);
+}
+
+} // namespace seinfeld_tv::history_format
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "seinfeld_tv/bandwidth.hpp"
+#include "seinfeld_tv/cluster.hpp"
+#include "seinfeld_tv/guide.hpp"
+#include "seinfeld_tv/http_server.hpp"
+#include "seinfeld_tv/metrics.hpp"
+#include "seinfeld_tv/play_history.hpp"
+#include "seinfeld_tv/playout.hpp"
+#include "seinfeld_tv/rcu.hpp"
+#include "seinfeld_tv/session_table.hpp"
+#include "seinfeld_tv/station.hpp"
+
+#include <array>
+#include <compare>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// How render_playlist() lists a window.
+struct PlaylistFormat {
+    std::size_t max_segments = 10;
+    int target_seconds = 6;
+    /// Delta update: segments that ended more than six target durations
+    /// before the live edge are replaced by EXT-X-SKIP.
+    bool delta = false;
+    /// Non-zero: LL-HLS, with the parts of recent segments and of the one
+    /// airing now. Must be at least the longest part.
+    Pts part_target = 0;
+};
+
+/// HLS routes over a station's channels, for use as an HttpHandler:
+///
+///   /<channel>/live.m3u8              media playlist; `_HLS_msn=N` blocks
+///                                     until segment N is listed
+///   /<channel>/ll.m3u8                the same with LL-HLS parts;
+///                                     `_HLS_part=P` blocks on part P
+///   /<channel>/<sequence>.ts|.m4s     media segment
+///   /<channel>/<sequence>.<part>.ts   partial segment (also .m4s)
+///   /<channel>/init-<sequence>.mp4    fMP4 init segment of the run whose
+///                                     first segment is <sequence>
+///   /<channel>/hint.json?session=K    K's bandwidth estimate and the
+///                                     ladder rendition it can sustain
+///                                     (does not open a session)
+///   /<channel>/guide.json?hours=H     the channel's programs over the
+///                                     next H hours (default 6, at most
+///                                     48), from its ProgramGuide
+///   /guide.json?hours=H               the same for every channel
+///   /metrics                          Prometheus text exposition
+///
+/// Either playlist takes `_HLS_skip=YES` for a delta update. Any request
+/// may carry `session=<key>`, which opens or refreshes that viewer's entry
+/// in sessions(); players keep the query on playlist reloads. Segments
+/// sent to a session feed its bandwidth estimate once the server wires
+/// on_delivered() to HttpServerOptions::on_delivered.
+///
+/// Playlists are rendered once per move of the live edge (a new segment
+/// or part), every variant at once, into one immutable refcounted buffer
+/// that each poll is answered from without copying. Segments already
+/// built into the library's SegmentCache (rendition 0) are sent from
+/// memory; everything else goes zero-copy from the source file. Requests
+/// for a segment or playlist that will exist shortly are parked by the
+/// server instead of failing.
+///
+/// In cluster mode, a full segment this node does not own is copied from
+/// its owner into the cache while the request is parked, and served from
+/// there; origin storage is only read for it if the owner cannot be
+/// reached. Nodes number segments independently, so peers ask for one by
+/// its start and duration instead:
+///
+///   /<channel>/at-<pts>-<duration>.ts|.m4s   the segment starting at
+///                                            channel time <pts>; 404
+///                                            unless this node has one
+///                                            cut the same way
+class HlsService {
+public:
+    /// Channels must all have been added to `station` already.
+    explicit HlsService(Station& station, PlayoutOptions options = {});
+
+    HttpResponse handle(const HttpRequest& request);
+
+    /// Source rendition key in the segment cache.
+    static constexpr std::uint32_t kSourceRendition = 0;
+
+    /// nullptr for unknown channels.
+    Playout* playout(std::string_view channel) noexcept;
+
+    /// Viewers seen with a `session` key; the owner reaps idle ones.
+    SessionTable& sessions() noexcept { return sessions_; }
+
+    /// HttpServerOptions::on_delivered target.
+    void on_delivered(const HttpDelivery& delivery) { bandwidth_.record(delivery); }
+
+    /// Folds deliveries since the last call into the session estimates;
+    /// meant for a timer, about once a second. Returns sessions updated.
+    std::size_t update_estimates() { return bandwidth_.update(sessions_); }
+
+    /// Turns on cluster mode; call once, before serving. Every node must
+    /// run the same channels with the same node list.
+    void enable_cluster(ClusterMap cluster, PeerFetchOptions options = {});
+
+    /// nullptr unless clustered.
+    const PeerFetcher* peers() const noexcept { return peers_.get(); }
+
+    /// Starts copying the segments of `keys` (SegmentCache::hot_keys() of
+    /// an earlier process) that this node neither has nor owns from their
+    /// owners, so a restarted node's cache is warm before viewers ask.
+    /// Keys no longer in a window are skipped. Returns the fetches queued;
+    /// always 0 unless clustered.
+    std::size_t warm(std::span<const SegmentKey> keys);
+
+    /// Records every airing and viewer-minute into `history`: a session
+    /// served the segment that airs across a minute boundary watched that
+    /// minute. Call once, before serving.
+    void enable_history(PlayHistory& history);
+
+    /// Appends more families to /metrics, e.g. the HTTP server's own.
+    /// Call before serving; sources run on server threads.
+    void add_metrics(std::function<void(metrics::Exposition&)> source) { metric_sources_.push_back(std::move(source)); }
+
+    /// The /metrics page: request and segment build latencies, cache
+    /// hits, viewers and scheduler lag per channel, peer fetches, then
+    /// every add_metrics() source.
+    std::string render_metrics() const;
+
+    /// The media playlist of `window` as listed at `now`. The window must
+    /// have at least one available segment.
+    static std::string render_playlist(const LiveWindow& window, Pts now, const PlaylistFormat& format);
+
+private:
+    enum Variant : std::size_t { kFull, kDelta, kParts, kPartsDelta, kVariants };
+    enum Route : std::size_t { kPlaylistRoute, kMediaRoute, kOtherRoute, kRoutes };
+
+    /// Where the live edge is: the first segment not yet listed whole,
+    /// and how many of its parts have aired.
+    struct Edge {
+        std::uint64_t sequence = 0;
+        std::size_t parts = 0;
+
+        friend auto operator<=>(const Edge&, const Edge&) = default;
+    };
+
+    /// Every playlist variant for one live edge.
+    struct Rendered {
+        Edge edge;
+        std::array<std::string, kVariants> bodies;
+    };
+
+    struct ChannelState {
+        std::unique_ptr<Playout> playout;
+        std::unique_ptr<ProgramGuide> guide;
+        rcu::Cell<std::shared_ptr<const Rendered>> rendered{std::make_unique<const std::shared_ptr<const Rendered>>()};
+        std::mutex render_mutex;
+        // Guarded by render_mutex. Both only ever grow, as the spec requires.
+        int target_seconds = 0;
+        Pts part_target = 0;
+    };
+
+    HttpResponse dispatch(const HttpRequest& request);
+    std::shared_ptr<const Rendered> playlists(ChannelState& state, const LiveWindow& window, Pts now);
+    HttpResponse playlist(ChannelState& state, const HttpRequest& request, bool parts);
+    HttpResponse media(ChannelState& state, std::string_view file, std::optional<SessionHandle> session);
+    HttpResponse peer_segment(ChannelState& state, std::string_view file);
+    /// Asks the owner of `s` for it unless that is this node; nullopt then.
+    std::optional<PeerFetcher::Status> fetch_from_owner(const Channel& channel, const LiveSegment& s,
+                                                        const SegmentKey& key);
+    /// Records a viewer-minute if `s` airs across a minute boundary.
+    void log_viewing(ChannelState& state, const LiveSegment& s, SessionHandle session);
+    HttpResponse hint(std::optional<SessionHandle> session) const;
+    HttpResponse guide(ChannelState* state, const HttpRequest& request);
+
+    Station& station_;
+    std::vector<std::unique_ptr<ChannelState>> channels_;
+    SessionTable sessions_;
+    BandwidthEstimator bandwidth_;
+    std::vector<Rendition> ladder_ = default_ladder();
+    std::optional<ClusterMap> cluster_;
+    std::unique_ptr<PeerFetcher> peers_; ///< declared after cluster_, which it refers to
+    PlayHistory* history_ = nullptr;
+    std::array<metrics::Histogram, kRoutes> latency_;
+    std::vector<std::function<void(metrics::Exposition&)>> metric_sources_;
+};
+
+} // namespace seinfeld_tv
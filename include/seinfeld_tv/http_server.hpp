@@ -0,0 +1,135 @@
+#pragma once
+
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/segmenter.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// A parsed request line. Views point into the connection's buffer and
+/// are valid only during the handler call.
+struct HttpRequest {
+    std::string_view method;
+    std::string_view path;  ///< without the query
+    std::string_view query; ///< after '?', not decoded
+    bool keep_alive = true;
+
+    /// Value of `name` in the query string, if present.
+    std::optional<std::string_view> param(std::string_view name) const noexcept;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string_view content_type = "text/plain"; ///< static storage
+    std::string_view cache_control;                ///< static storage; omitted if empty
+    std::string body;
+    /// Refcounted body, sent without copying; `shared_owner` keeps it alive.
+    std::shared_ptr<const void> shared_owner;
+    std::span<const std::byte> shared;
+    /// File-backed body, spliced from page cache to the socket.
+    std::optional<SegmentRef> file;
+    /// Non-zero: no answer yet. The server parks the connection without a
+    /// thread and calls the handler again at this channel time.
+    Pts retry_at = 0;
+    /// Non-zero: reported to HttpServerOptions::on_delivered once sent.
+    std::uint64_t delivery_tag = 0;
+
+    static HttpResponse text(int status, std::string body, std::string_view content_type = "text/plain");
+    static HttpResponse of_shared(std::shared_ptr<const void> owner, std::span<const std::byte> bytes,
+                                  std::string_view content_type);
+    static HttpResponse of_file(SegmentRef ref, std::string_view content_type);
+    static HttpResponse wait_until(Pts at);
+
+    std::uint64_t body_size() const noexcept;
+};
+
+/// Called on a server thread for every request; must not block.
+using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+
+/// A tagged response that was sent in full. `bytes` is what reached the
+/// client while it was being sent: the response size corrected by the
+/// change in the socket's send queue, so bytes still sitting in the
+/// kernel buffer at the end are not counted.
+struct HttpDelivery {
+    std::uint64_t tag = 0;
+    std::uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed{0};
+};
+
+/// Called on a server thread after each tagged response; must not block.
+using DeliveryHook = std::function<void(const HttpDelivery&)>;
+
+struct HttpServerOptions {
+    std::string address = "0.0.0.0";
+    std::uint16_t port = 8080; ///< 0 picks a free port; see HttpServer::port()
+    unsigned threads = std::thread::hardware_concurrency();
+    unsigned ring_entries = 4096;
+    /// Per-thread cap; further connections are accepted and closed.
+    std::size_t max_connections = 16384;
+    std::chrono::milliseconds idle_timeout{30'000};
+    std::chrono::milliseconds send_timeout{30'000};
+    /// Longest a request may be parked by HttpResponse::wait_until.
+    std::chrono::milliseconds max_hold{20'000};
+    DeliveryHook on_delivered;
+};
+
+struct HttpServerStats {
+    std::uint64_t accepted = 0;
+    std::uint64_t active = 0;
+    std::uint64_t requests = 0;
+    std::uint64_t parked = 0; ///< requests currently waiting on retry_at
+    std::uint64_t bytes_sent = 0;
+};
+
+/// HTTP/1.1 front end: one io_uring per thread, C++20 coroutines per
+/// connection.
+///
+/// Every thread owns a ring and its own SO_REUSEPORT listening socket on
+/// the same port, so the kernel spreads connections across threads and
+/// nothing is shared between them on the request path. A connection is a
+/// coroutine frame plus a small buffer; reads, writes, timeouts and
+/// long-poll waits are ring operations, so 10k idle or parked clients
+/// cost no threads and no context switches. File-backed bodies are
+/// spliced from the page cache through a per-thread pool of pipes.
+///
+/// Only GET and HEAD without request bodies are served; that is all HLS
+/// clients send.
+class HttpServer {
+public:
+    /// Binds the listening sockets; throws std::system_error on failure.
+    HttpServer(HttpServerOptions options, HttpHandler handler);
+    ~HttpServer();
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    /// Starts the server threads.
+    void start();
+    /// Cancels everything in flight, closes connections and joins.
+    void stop();
+
+    std::uint16_t port() const noexcept { return port_; }
+    HttpServerStats stats() const noexcept;
+
+private:
+    struct Worker;
+
+    HttpServerOptions options_;
+    HttpHandler handler_;
+    std::uint16_t port_ = 0;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+} // namespace seinfeld_tv
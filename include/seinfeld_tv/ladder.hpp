@@ -0,0 +1,55 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/report_log.hpp"
+#include "seinfeld_tv/task_graph.hpp"
+#include "seinfeld_tv/thread_pool.hpp"
+#include "seinfeld_tv/transcode.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+struct LadderSource {
+    std::string name; ///< for logs, e.g. "S04E11"
+    std::filesystem::path media;
+    ContentHash hash;
+    float gain_db = 0; ///< from the catalog's cached loudness, 0 if unmeasured
+};
+
+/// Every catalogued episode as a ladder source, with audio gain that
+/// normalizes measured episodes to kTargetLufs.
+std::vector<LadderSource> ladder_sources(const Catalog& catalog);
+
+struct LadderOptions {
+    /// Outputs go to `<output_dir>/<content hash>/<rendition>.ts`.
+    std::filesystem::path output_dir;
+    std::vector<Rendition> renditions = default_ladder();
+    /// Chunks are whole GOPs adding up to at least this much.
+    Pts chunk_target = 30 * kPtsPerSecond;
+};
+
+struct LadderReport {
+    std::vector<StageStats> stages;
+    std::chrono::nanoseconds wall{0};
+    std::uint64_t tasks = 0;
+    unsigned workers = 0;
+};
+
+/// Builds the ABR ladder for `sources` as one task graph on `pool`:
+///
+///   index(episode) --> encode/<rendition>(chunk) x N --> assemble/<rendition>
+///
+/// Indexing maps or builds the GOP sidecar and then fans out one encode
+/// task per GOP-aligned chunk per rendition, so a long episode becomes many
+/// independently stealable tasks and the tail of the run stays parallel.
+/// Progress and per-stage timings are appended to `log` when non-null.
+LadderReport build_ladders(std::span<const LadderSource> sources, TranscodeBackend& backend,
+                           WorkStealingPool& pool, const LadderOptions& options, ReportLog* log = nullptr);
+
+} // namespace seinfeld_tv
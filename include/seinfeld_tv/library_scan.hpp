@@ -0,0 +1,102 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/thread_pool.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Season, episode and title recovered from a master's file name, e.g.
+/// "Seinfeld - S04E11 - The Contest.ts".
+struct EpisodeName {
+    std::uint16_t season = 0;
+    std::uint16_t episode = 0;
+    std::string title;
+};
+
+/// Finds the first SxxEyy tag (case-insensitive); the title is whatever
+/// follows it with separators turned into spaces.
+std::optional<EpisodeName> parse_episode_name(std::string_view filename);
+
+/// True for containers the segmenter can serve (.ts, .m2ts, .mp4, .m4v).
+bool is_media_file(const std::filesystem::path& path);
+
+/// What a rescan found.
+struct ScanReport {
+    std::size_t added = 0;
+    std::size_t updated = 0; ///< re-hashed because size or mtime changed
+    std::size_t removed = 0;
+    std::size_t unchanged = 0;
+    std::vector<std::string> problems; ///< unreadable files, duplicate episodes
+
+    bool changed() const noexcept { return added || updated || removed; }
+};
+
+/// Incremental catalog maintenance for a directory tree of masters.
+///
+/// Keeps the size, mtime and content hash of every tracked file, seeded
+/// from the existing catalog (which records mtimes for this purpose), so
+/// a rescan only re-hashes and re-indexes files that actually changed.
+/// publish() writes the next catalog generation atomically; loudness
+/// measurements and clips carry over for content that did not change.
+///
+/// Content hashes are chunk-tree roots (chunking.hpp) and each file's
+/// chunk list is kept in a `.chunks` sidecar, so an edit that rewrites
+/// only the container header is recognised as the same programme.
+class LibraryScanner {
+public:
+    /// Each changed file is hashed across all of `pool`, one at a time;
+    /// GOP indexing then runs for all of them in parallel.
+    LibraryScanner(std::filesystem::path root, std::filesystem::path catalog_path, WorkStealingPool* pool = nullptr);
+
+    const std::filesystem::path& root() const noexcept { return root_; }
+    const std::filesystem::path& catalog_path() const noexcept { return catalog_path_; }
+    std::size_t size() const noexcept { return files_.size(); }
+
+    /// Walks the whole tree.
+    ScanReport rescan_all();
+
+    /// Re-examines only `paths`: files, directories (walked) or paths that
+    /// no longer exist (their entries are dropped).
+    ScanReport rescan(std::span<const std::filesystem::path> paths);
+
+    /// Writes the tracked state as the next catalog generation and maps it.
+    std::shared_ptr<const Catalog> publish();
+
+private:
+    struct FileState {
+        std::uint64_t size = 0;
+        std::int64_t mtime_ns = 0;
+        ContentHash hash;
+        /// Hash of the previous version when an edit left most chunks
+        /// intact (a re-muxed header): its loudness still applies.
+        std::optional<ContentHash> ancestor;
+        Pts duration_pts = 0;
+        EpisodeName name;
+    };
+
+    void examine(std::vector<std::filesystem::path> candidates, ScanReport& report);
+    void drop_under(const std::string& path, ScanReport& report);
+    /// Tracked files in the order publish() keeps them: one per episode
+    /// and per hash, the newest first.
+    std::vector<std::pair<const std::string*, const FileState*>> resolve(ScanReport* report) const;
+
+    std::filesystem::path root_;
+    std::filesystem::path catalog_path_;
+    WorkStealingPool* pool_;
+    std::map<std::string, FileState> files_;
+    /// Entries dropped by the current rescan, for rename detection.
+    std::vector<std::pair<std::string, FileState>> dropped_;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/library_scan.hpp"
+#include "seinfeld_tv/posix.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <set>
+#include <unordered_map>
+
+namespace seinfeld_tv {
+
+/// Drives a LibraryScanner from inotify events instead of periodic walks.
+///
+/// Every directory under the root is watched for completed writes,
+/// renames and deletions. Events are batched until the tree has been quiet
+/// for `settle` (a copy in progress keeps postponing the rescan). Then
+/// only the touched paths are rescanned and, if anything changed, a new
+/// catalog generation is published. If the kernel queue overflows, the
+/// watcher falls back to a full rescan, which stat-skips unchanged files.
+class LibraryWatcher {
+public:
+    using PublishFn = std::function<void(std::shared_ptr<const Catalog>, const ScanReport&)>;
+
+    LibraryWatcher(LibraryScanner& scanner, PublishFn on_publish,
+                   std::chrono::milliseconds settle = std::chrono::seconds(2));
+
+    LibraryWatcher(const LibraryWatcher&) = delete;
+    LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+
+    /// Watches until stop(). Scanner and publish errors propagate.
+    void run();
+
+    /// Makes run() return; safe from any thread or a signal handler.
+    void stop() noexcept;
+
+private:
+    void watch_tree(const std::filesystem::path& dir);
+    void drain_events();
+    void flush();
+
+    LibraryScanner& scanner_;
+    PublishFn on_publish_;
+    std::chrono::milliseconds settle_;
+    UniqueFd inotify_;
+    UniqueFd wake_;
+    std::unordered_map<int, std::filesystem::path> dirs_;
+    std::set<std::filesystem::path> dirty_;
+    bool overflow_ = false;
+    std::chrono::steady_clock::time_point last_event_;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "seinfeld_tv/metrics.hpp"
+#include "seinfeld_tv/report_log.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+struct LoadTestOptions {
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 8080;
+    std::vector<std::string> channels; ///< players pick one at random on joining
+    std::size_t players = 100;         ///< kept watching at once after the ramp
+    unsigned threads = 1;
+    std::chrono::seconds duration{60};
+    std::chrono::seconds ramp{10};        ///< first joins are spread over this
+    std::chrono::seconds mean_watch{120}; ///< exponential; a leaver is replaced
+    double low_latency = 0.5;             ///< fraction of players on ll.m3u8
+    double blocking = 0.5;                ///< fraction of the rest using _HLS_msn reloads instead of polling
+    std::uint32_t median_bandwidth_bps = 8'000'000; ///< of each player's link, log-normal
+    std::chrono::seconds hint_every{10};  ///< hint.json polls, and how often a link's rate drifts
+    std::uint64_t seed = 1;
+};
+
+struct LoadTestReport {
+    std::uint64_t joins = 0;
+    std::uint64_t leaves = 0;
+    std::uint64_t requests = 0;
+    std::uint64_t errors = 0;   ///< failed connections, timeouts and non-200 responses
+    std::uint64_t resyncs = 0;  ///< players that fell out of the window and re-tuned
+    std::uint64_t rebuffers = 0;
+    std::uint64_t switches = 0; ///< rendition changes after the first pick
+    std::uint64_t bytes = 0;
+    std::chrono::nanoseconds stalled{0};
+    std::chrono::nanoseconds wall{0};
+    metrics::Histogram::Snapshot segments; ///< request to last byte of whole segments
+    metrics::Histogram::Snapshot parts;    ///< same, for LL-HLS parts
+    /// Request to response head of segments and parts: the server's share,
+    /// which the paced body reads above mostly hide.
+    metrics::Histogram::Snapshot first_byte;
+    metrics::Histogram::Snapshot playlists; ///< non-blocking playlist loads only
+    metrics::Histogram::Snapshot startup;  ///< join to first frame
+};
+
+/// Drives a running stv-serve with simulated HLS and LL-HLS players.
+///
+/// Each player holds one keep-alive connection and behaves like a real
+/// one: it tunes in three segments (or parts) behind the live edge,
+/// reloads its playlist by polling at the target duration or by blocking
+/// _HLS_msn/_HLS_part requests, fetches whatever is new, and plays it out
+/// of a modelled buffer, counting a rebuffer whenever that runs dry.
+/// Reads are paced to the player's link rate, which drifts over time, so
+/// the server's bandwidth estimates move and the rendition it hints
+/// (polled from hint.json) switches. Players run on `threads` epoll
+/// loops, many per thread.
+///
+/// Appends to `log`, when given, a load.latency line for each of
+/// segments, parts, first bytes, playlists and startup, then a load.total
+/// line.
+LoadTestReport run_load_test(const LoadTestOptions& options, ReportLog* log = nullptr);
+
+} // namespace seinfeld_tv
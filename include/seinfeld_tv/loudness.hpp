@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// EBU R128 / ITU-R BS.1770-4 programme loudness.
+struct Loudness {
+    float integrated_lufs = 0;
+    float sample_peak = 0; ///< linear, max |sample| over all channels
+};
+
+/// Delivery target; EBU R128 is -23 LUFS, ATSC A/85 is -24 LKFS.
+inline constexpr float kTargetLufs = -23.0f;
+
+/// Gain in dB that brings `measured` to `target_lufs`, limited so the
+/// sample peak stays below full scale.
+float normalization_gain_db(const Loudness& measured, float target_lufs = kTargetLufs) noexcept;
+
+/// Streaming integrated-loudness meter for interleaved float PCM.
+///
+/// K-weighting runs as two cascaded biquads per channel with all channels
+/// of a frame held in one SIMD register (AVX2: 4 channels, SSE2/NEON: 2),
+/// chosen at run time with a scalar fallback. 400 ms gating blocks with
+/// 75% overlap are assembled from 100 ms sub-block energies, then the
+/// absolute (-70 LUFS) and relative (-10 LU) gates are applied.
+class LoudnessMeter {
+public:
+    static constexpr unsigned kMaxChannels = 8;
+
+    /// Channel weights follow BS.1770 for 1, 2 and 5.1 (L R C LFE Ls Rs)
+    /// layouts. Throws std::invalid_argument for unsupported layouts.
+    LoudnessMeter(unsigned channels, unsigned sample_rate);
+
+    /// `frames` interleaved frames of `channels()` samples each.
+    void add(const float* samples, std::size_t frames);
+
+    /// Integrated loudness so far; nullopt until one block passes the gates.
+    std::optional<Loudness> result() const;
+
+    unsigned channels() const noexcept { return channels_; }
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    void filter(const float* samples, std::size_t frames);
+    void finish_sub_block();
+
+    unsigned channels_;
+    Biquad shelf_{};
+    Biquad highpass_{};
+    double weights_[kMaxChannels]{};
+    /// Direct-form-II-transposed state: shelf z1, z2, high-pass z1, z2.
+    alignas(32) double state_[4][kMaxChannels]{};
+    /// Per-channel sum of squares over the current sub-block.
+    alignas(32) double energy_[kMaxChannels]{};
+    std::size_t sub_block_frames_;
+    std::size_t sub_block_fill_ = 0;
+    double sub_blocks_[4]{}; ///< ring of weighted sub-block mean squares
+    std::size_t sub_block_count_ = 0;
+    std::vector<double> block_energy_;
+    float peak_ = 0;
+};
+
+/// Multiplies `n` samples by `gain` (linear) and clamps to [-1, 1]; the
+/// gain stage on the PCM output path. Vectorised like the meter.
+void apply_gain(float* samples, std::size_t n, float gain) noexcept;
+
+/// Decodes the first audio track of `media` with ffmpeg to 48 kHz stereo
+/// float PCM and measures it. Throws on decode failure.
+Loudness measure_file_loudness(const std::filesystem::path& media, const std::string& ffmpeg = "ffmpeg");
+
+} // namespace seinfeld_tv
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+namespace seinfeld_tv {
+
+/// Read-only shared mapping of an entire file.
+///
+/// The mapping is MAP_SHARED so in-place updates made through the file
+/// descriptor (pwrite) are visible to readers without remapping.
+class MappedFile {
+public:
+    MappedFile() noexcept = default;
+    explicit MappedFile(const std::filesystem::path& path);
+    MappedFile(MappedFile&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+    {
+    }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const std::byte* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    std::span<const std::byte> bytes() const noexcept { return {data_, size_}; }
+    explicit operator bool() const noexcept { return data_ != nullptr; }
+
+    /// Hints the kernel to fault the whole mapping in ahead of use.
+    void will_need() const noexcept;
+
+    /// Hints that the mapping will be read once front to back, so pages
+    /// behind the reader can be reclaimed early.
+    void sequential() const noexcept;
+
+private:
+    void unmap() noexcept;
+
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace seinfeld_tv
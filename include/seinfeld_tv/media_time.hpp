@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace seinfeld_tv {
+
+/// Presentation timestamps are carried in MPEG 90 kHz ticks everywhere.
+using Pts = std::int64_t;
+
+inline constexpr Pts kPtsPerSecond = 90'000;
+inline constexpr Pts kPtsPerMinute = 60 * kPtsPerSecond;
+inline constexpr Pts kPtsPerHour = 60 * kPtsPerMinute;
+inline constexpr Pts kPtsPerDay = 24 * kPtsPerHour;
+
+constexpr Pts pts_from_ms(std::int64_t ms) noexcept
+{
+    return ms * (kPtsPerSecond / 1000);
+}
+
+constexpr std::int64_t pts_to_ms(Pts pts) noexcept
+{
+    return pts / (kPtsPerSecond / 1000);
+}
+
+/// Converts `ticks` at `timescale` Hz to 90 kHz without overflowing for
+/// any realistic media duration.
+constexpr Pts rescale_to_pts(std::uint64_t ticks, std::uint32_t timescale) noexcept
+{
+    return static_cast<Pts>(ticks / timescale * kPtsPerSecond + ticks % timescale * kPtsPerSecond / timescale);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/// Hot-path counters and latency histograms, exported in the Prometheus
+/// text format.
+///
+/// Every metric keeps one slot per thread, each on its own cache lines,
+/// and writers only touch their own: recording is a relaxed add with no
+/// line bouncing between cores. Slots are summed only when scraped.
+namespace seinfeld_tv::metrics {
+
+/// Slots per metric. Threads beyond this share slots, which stays correct
+/// (adds are atomic) but brings the contention back.
+inline constexpr std::size_t kSlots = 64;
+
+/// The calling thread's slot; threads claim them round-robin on first use.
+std::size_t thread_slot() noexcept;
+
+/// A monotonically increasing count.
+class Counter {
+public:
+    void add(std::uint64_t n = 1) noexcept { cells_[thread_slot()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    /// Sum over slots; concurrent adds may or may not be included.
+    std::uint64_t value() const noexcept;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Cell, kSlots> cells_{};
+};
+
+/// Latency histogram with HDR-style log-linear buckets: 2^kSubBits per
+/// power of two, so every value from 1 ns to 2^kMaxBits ns (about 18
+/// minutes) is kept within 12.5%; larger values land in the last bucket.
+class Histogram {
+public:
+    static constexpr unsigned kSubBits = 3;
+    static constexpr unsigned kMaxBits = 40;
+    static constexpr std::size_t kBuckets = std::size_t{kMaxBits - kSubBits + 1} << kSubBits;
+
+    /// Merged counts of every slot.
+    struct Snapshot {
+        std::array<std::uint64_t, kBuckets> counts{};
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0; ///< of recorded values
+
+        /// Recorded values at or below `value`, counting each bucket whose
+        /// lower edge it reaches.
+        std::uint64_t count_at_or_below(std::uint64_t value) const noexcept;
+        /// Value at quantile `q` in [0, 1]: the middle of its bucket; 0 if
+        /// nothing was recorded.
+        std::uint64_t quantile(double q) const noexcept;
+    };
+
+    Histogram();
+
+    void record(std::uint64_t value) noexcept
+    {
+        auto& s = slots_[thread_slot()];
+        s.counts[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+        s.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+    void record(std::chrono::nanoseconds elapsed) noexcept
+    {
+        record(static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(elapsed.count(), 0)));
+    }
+
+    Snapshot snapshot() const noexcept;
+
+    static std::size_t bucket(std::uint64_t value) noexcept;
+    /// Smallest value that lands in bucket `i`.
+    static std::uint64_t lower_bound(std::size_t i) noexcept;
+
+private:
+    struct alignas(64) Slot {
+        std::array<std::atomic<std::uint64_t>, kBuckets> counts{};
+        std::atomic<std::uint64_t> sum{0};
+    };
+    // On the heap: a histogram is ~150 KiB.
+    std::unique_ptr<Slot[]> slots_;
+};
+
+/// Times a scope into a histogram.
+class Timer {
+public:
+    explicit Timer(Histogram& histogram) noexcept
+        : histogram_(histogram), start_(std::chrono::steady_clock::now())
+    {
+    }
+    ~Timer() { histogram_.record(std::chrono::steady_clock::now() - start_); }
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/// `key="value"` with the value escaped, for Exposition's `labels`.
+std::string label(std::string_view key, std::string_view value);
+
+/// Builds a Prometheus text-format (0.0.4) page. Each family() is
+/// followed by its samples; `labels` is a comma-separated list from
+/// label(), or empty.
+class Exposition {
+public:
+    static constexpr std::string_view kContentType = "text/plain; version=0.0.4";
+
+    void family(std::string_view name, std::string_view type, std::string_view help);
+    void sample(std::string_view name, std::string_view labels, std::uint64_t value);
+    void sample(std::string_view name, std::string_view labels, double value);
+
+    /// A histogram family's samples, `name`_bucket/_sum/_count, for
+    /// values recorded in nanoseconds and exported in seconds.
+    void latency(std::string_view name, std::string_view labels, const Histogram& histogram);
+
+    const std::string& text() const noexcept { return out_; }
+    std::string take() noexcept { return std::move(out_); }
+
+private:
+    void series(std::string_view name, std::string_view labels);
+
+    std::string out_;
+};
+
+} // namespace seinfeld_tv::metrics
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "seinfeld_tv/container.hpp"
+#include "seinfeld_tv/nal.hpp"
+#include "seinfeld_tv/ts_demux.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace seinfeld_tv {
+
+enum class AudioCodec : std::uint8_t { None, Aac };
+
+/// Per-codec constants the muxers are specialised on, so NAL header
+/// layout and stream types are folded in at compile time.
+template <nal::Codec V>
+struct VideoTraits;
+
+template <>
+struct VideoTraits<nal::Codec::H264> {
+    static constexpr std::uint8_t kStreamType = 0x1b;
+    static constexpr char kSampleEntry[5] = "avc1";
+    static constexpr unsigned type(std::uint8_t first) noexcept { return first & 0x1fu; }
+    static constexpr bool is_parameter_set(unsigned type) noexcept { return type == 7 || type == 8; }
+    static constexpr bool is_delimiter(unsigned type) noexcept { return type == 9; }
+    /// Access unit delimiter, any slice type.
+    static constexpr std::array<std::uint8_t, 2> kDelimiter{0x09, 0xf0};
+};
+
+template <>
+struct VideoTraits<nal::Codec::Hevc> {
+    static constexpr std::uint8_t kStreamType = 0x24;
+    static constexpr char kSampleEntry[5] = "hvc1";
+    static constexpr unsigned type(std::uint8_t first) noexcept { return (first >> 1) & 0x3fu; }
+    static constexpr bool is_parameter_set(unsigned type) noexcept { return type >= 32 && type <= 34; }
+    static constexpr bool is_delimiter(unsigned type) noexcept { return type == 35; }
+    static constexpr std::array<std::uint8_t, 3> kDelimiter{0x46, 0x01, 0x50};
+};
+
+template <AudioCodec A>
+struct AudioTraits;
+
+template <>
+struct AudioTraits<AudioCodec::None> {
+    static constexpr bool kPresent = false;
+};
+
+template <>
+struct AudioTraits<AudioCodec::Aac> {
+    static constexpr bool kPresent = true;
+    static constexpr std::uint8_t kStreamType = 0x0f; ///< ADTS
+    static constexpr std::uint8_t kStreamId = 0xc0;
+};
+
+/// What a muxer carries from one segment to the next of the same output.
+struct MuxState {
+    std::array<std::uint8_t, 4> continuity{}; ///< PAT, PMT, video, audio
+    std::uint32_t fragment_sequence = 1;      ///< fMP4 mfhd
+};
+
+/// Writes demuxed PES packets (ts_demux.hpp) as MPEG-TS.
+///
+/// Instantiated per codec pair: PIDs, stream types and PES framing are
+/// constants, and the per-packet loop has no codec branches. Output is
+/// appended to `out`, which should live in the same SegmentArena as the
+/// demuxer's packets.
+template <nal::Codec V, AudioCodec A>
+class TsMuxer {
+public:
+    static constexpr std::uint16_t kPmtPid = 0x1000;
+    static constexpr std::uint16_t kVideoPid = 0x100;
+    static constexpr std::uint16_t kAudioPid = 0x101;
+
+    /// PAT, PMT, then `packets` with their timestamps moved by `offset`
+    /// ticks (modulo 2^33). Every video access unit starts with a
+    /// delimiter and every random access point carries a PCR.
+    static void mux(std::span<const PesPacket> packets, std::int64_t offset, MuxState& state,
+                    std::pmr::vector<std::byte>& out);
+};
+
+/// Writes demuxed PES packets as fragmented MP4 (CMAF): Annex-B access
+/// units become length-prefixed samples, ADTS frames become raw AAC.
+/// Track 1 is video and track 2 audio, both with a 90 kHz timescale.
+template <nal::Codec V, AudioCodec A>
+class Fmp4Muxer {
+public:
+    static constexpr std::uint32_t kTimescale = 90'000;
+
+    /// ftyp + moov, from the parameter sets of the first random access
+    /// point and the first ADTS header. Throws std::runtime_error when
+    /// `packets` has neither.
+    static void init_segment(std::span<const PesPacket> packets, std::pmr::vector<std::byte>& out);
+
+    /// One moof + mdat holding every sample of `packets`, decode times
+    /// moved by `offset` ticks.
+    static void fragment(std::span<const PesPacket> packets, std::int64_t offset, MuxState& state,
+                         std::pmr::vector<std::byte>& out);
+};
+
+extern template class TsMuxer<nal::Codec::H264, AudioCodec::Aac>;
+extern template class TsMuxer<nal::Codec::H264, AudioCodec::None>;
+extern template class TsMuxer<nal::Codec::Hevc, AudioCodec::Aac>;
+extern template class TsMuxer<nal::Codec::Hevc, AudioCodec::None>;
+extern template class Fmp4Muxer<nal::Codec::H264, AudioCodec::Aac>;
+extern template class Fmp4Muxer<nal::Codec::H264, AudioCodec::None>;
+extern template class Fmp4Muxer<nal::Codec::Hevc, AudioCodec::Aac>;
+extern template class Fmp4Muxer<nal::Codec::Hevc, AudioCodec::None>;
+
+/// Demuxes a TS segment into `mr` and remuxes it as `to` (a media
+/// fragment for Fmp4). The instantiation is picked once per segment from
+/// the program map. Throws std::runtime_error for codecs without a muxer.
+void remux_ts(std::span<const std::byte> segment, Container to, std::int64_t offset, MuxState& state,
+              std::pmr::memory_resource* mr, std::pmr::vector<std::byte>& out);
+
+/// fMP4 init segment for the streams of a TS segment.
+void fmp4_init_from_ts(std::span<const std::byte> segment, std::pmr::memory_resource* mr,
+                       std::pmr::vector<std::byte>& out);
+
+} // namespace seinfeld_tv
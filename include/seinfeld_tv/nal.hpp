@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/// H.264/HEVC Annex-B elementary stream helpers.
+namespace seinfeld_tv::nal {
+
+enum class Codec : std::uint8_t { H264, Hevc };
+
+/// Returns a pointer to the first byte after the next `00 00 01` start code
+/// in [p, end), or `end` if there is none. Scans 16 or 32 bytes per step
+/// (SSE2/AVX2, NEON) where available. Emulation prevention guarantees a
+/// NAL payload never contains `00 00 01`, so no unescaping is needed.
+const std::uint8_t* find_start_code(const std::uint8_t* p, const std::uint8_t* end) noexcept;
+
+/// Copies the RBSP of a NAL unit (start code removed) into `out`, dropping
+/// the emulation-prevention byte of every `00 00 03`. Stops when `out` is
+/// full; returns the bytes written.
+std::size_t unescape_rbsp(std::span<const std::uint8_t> nal, std::span<std::uint8_t> out) noexcept;
+
+/// What the start of an access unit tells us about random access.
+struct AccessUnitInfo {
+    bool random_access = false; ///< IDR / IRAP picture present
+    bool closed = false;        ///< IDR (H.264) or IDR_W_RADL/IDR_N_LP (HEVC)
+    bool has_param_sets = false;
+    /// FNV-1a over every in-band parameter-set NAL, 0 when none.
+    std::uint64_t param_fingerprint = 0;
+};
+
+/// Classifies the NAL units in the leading bytes of an access unit. The
+/// buffer may be truncated; classification stops at the first slice.
+AccessUnitInfo inspect_access_unit(Codec codec, std::span<const std::uint8_t> es) noexcept;
+
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr std::uint64_t kFnvPrime = 0x100000001b3ull;
+
+constexpr std::uint64_t fnv1a(std::span<const std::uint8_t> bytes, std::uint64_t h = kFnvOffset) noexcept
+{
+    for (auto b : bytes) {
+        h ^= b;
+        h *= kFnvPrime;
+    }
+    return h;
+}
+
+} // namespace seinfeld_tv::nal
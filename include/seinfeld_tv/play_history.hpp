@@ -0,0 +1,187 @@
+#pragma once
+
+#include "seinfeld_tv/catalog_format.hpp"
+#include "seinfeld_tv/history_format.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/posix.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace seinfeld_tv {
+
+enum class PlayKind : std::uint8_t {
+    Airing = 0,       ///< an entry began airing on a channel
+    ViewerMinute = 1, ///< a viewer was served the segment airing a minute boundary
+};
+
+/// One row of the play-history log.
+struct PlayEvent {
+    Pts channel_pts = 0;        ///< when the airing started, or the minute watched
+    std::uint64_t viewer = 0;   ///< session id; 0 for airings
+    std::uint32_t channel = 0;
+    std::uint32_t episode = 0;  ///< episode_key()
+    std::uint32_t offset_s = 0; ///< into the episode: the minute watched, or the airing's in-point
+    std::uint32_t seconds = 0;  ///< airtime: the airing's length, or 60
+    PlayKind kind = PlayKind::Airing;
+};
+
+/// Season and episode number, stable across catalog generations, unlike
+/// EpisodeId.
+constexpr std::uint32_t episode_key(std::uint16_t season, std::uint16_t episode) noexcept
+{
+    return std::uint32_t{season} << 16 | episode;
+}
+constexpr std::uint32_t episode_key(const catalog_format::EpisodeRecord& r) noexcept
+{
+    return episode_key(r.season, r.episode);
+}
+
+/// Sorts `rows` and appends their encoded block (see history_format.hpp)
+/// to `out`.
+void encode_history_block(std::span<PlayEvent> rows, std::vector<std::uint8_t>& out);
+
+struct PlayHistoryOptions {
+    /// Events per block; a full block is written at the next drain.
+    std::size_t block_rows = std::size_t{1} << 16;
+    /// A partial block is written once this old, bounding what a crash loses.
+    std::chrono::seconds max_block_age{60};
+    std::chrono::milliseconds drain_every{250};
+};
+
+/// Append-only play-history log: every airing and viewer-minute, written
+/// as columnar blocks by a background thread.
+///
+/// Serving threads hand events over without locks: each has its own
+/// single-producer ring, and record() is a bounds check, a 40-byte copy
+/// and a release store. The flusher drains every ring a few times a
+/// second, and sorts and encodes a block at a time off the request path.
+/// A full ring drops the event and counts it; nothing ever waits on the
+/// disk. A thread's first record() allocates its ring under a mutex.
+class PlayHistory {
+public:
+    /// Events each thread may have in flight between drains.
+    static constexpr std::size_t kRingEvents = std::size_t{1} << 12;
+
+    /// Opens (or creates) `path` for appending and starts the flusher.
+    explicit PlayHistory(const std::filesystem::path& path, PlayHistoryOptions options = {});
+    /// Stops the flusher and writes out everything recorded.
+    ~PlayHistory();
+
+    PlayHistory(const PlayHistory&) = delete;
+    PlayHistory& operator=(const PlayHistory&) = delete;
+
+    void record(const PlayEvent& event) noexcept;
+
+    /// Drains every ring and writes what is pending as a block now.
+    void flush();
+
+    struct Stats {
+        std::uint64_t events = 0;  ///< recorded
+        std::uint64_t dropped = 0; ///< on a full ring
+        std::uint64_t blocks = 0;
+        std::uint64_t bytes = 0;   ///< written
+        std::uint64_t failed = 0;  ///< blocks lost to write errors
+    };
+    Stats stats() const;
+
+private:
+    struct Ring;
+
+    Ring& ring();
+    void run(std::stop_token stop);
+    /// Moves every ring's events into pending_; under flush_mutex_.
+    void drain();
+    /// Writes up to block_rows of pending_; under flush_mutex_.
+    void write_block();
+
+    PlayHistoryOptions options_;
+    UniqueFd fd_;
+    std::uint64_t id_;
+
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_; ///< kept until destruction
+
+    std::mutex flush_mutex_;
+    std::vector<PlayEvent> pending_;
+    std::vector<std::uint8_t> encoded_;
+    std::chrono::steady_clock::time_point block_opened_;
+    std::atomic<std::uint64_t> blocks_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+    std::atomic<std::uint64_t> failed_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable_any wake_;
+    std::jthread flusher_; ///< last: it uses everything above
+};
+
+/// One block of a mapped log, still encoded.
+struct HistoryBlock {
+    const history_format::BlockHeader* header = nullptr;
+    std::span<const std::uint32_t> dictionary; ///< episode keys, ascending
+    std::span<const std::uint8_t> columns[history_format::kColumns];
+
+    std::size_t rows() const noexcept { return header->rows; }
+};
+
+/// Read-only view of a play-history log. Opening maps the file and
+/// checks every block once; a block cut short by a crash or a concurrent
+/// append ends the log there.
+class HistoryLog {
+public:
+    /// Throws std::runtime_error("history: ...") on a corrupt block.
+    explicit HistoryLog(const std::filesystem::path& path);
+
+    std::span<const HistoryBlock> blocks() const noexcept { return blocks_; }
+    std::uint64_t rows() const noexcept { return rows_; }
+    /// Whether the file ends in a partial block.
+    bool truncated() const noexcept { return truncated_; }
+
+private:
+    MappedFile file_;
+    std::vector<HistoryBlock> blocks_;
+    std::uint64_t rows_ = 0;
+    bool truncated_ = false;
+};
+
+/// (value, run length) pairs of a run-length column.
+std::vector<std::pair<std::uint32_t, std::uint32_t>> history_runs(const HistoryBlock& block,
+                                                                  history_format::Column column);
+/// Every row's value of a run-length column, into `out`.
+void expand_history_column(const HistoryBlock& block, history_format::Column column,
+                           std::vector<std::uint32_t>& out);
+/// Every row's value of a delta column, into `out`.
+void undelta_history_column(const HistoryBlock& block, history_format::Column column,
+                            std::vector<std::int64_t>& out);
+/// The block's rows, in stored order.
+std::vector<PlayEvent> history_events(const HistoryBlock& block);
+
+struct EpisodeViews {
+    std::uint32_t episode = 0; ///< episode_key()
+    std::uint64_t viewer_minutes = 0;
+    std::uint64_t airings = 0;
+};
+
+/// The `top` episodes by viewer-minutes. Counted from the run-length
+/// episode and kind columns alone, without expanding a row.
+std::vector<EpisodeViews> most_watched(const HistoryLog& log, std::size_t top);
+
+/// Viewer-minutes of `episode` by minute into it: its retention curve,
+/// whose steep falls are the drop-off points. Blocks that never saw the
+/// episode are skipped on their dictionary; in the rest, the episode
+/// column is filtered with SIMD compares into a selection of rows.
+std::vector<std::uint64_t> watch_curve(const HistoryLog& log, std::uint32_t episode);
+
+} // namespace seinfeld_tv
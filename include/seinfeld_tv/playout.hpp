@@ -0,0 +1,205 @@
+#pragma once
+
+#include "seinfeld_tv/gop_index.hpp"
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/metrics.hpp"
+#include "seinfeld_tv/play_history.hpp"
+#include "seinfeld_tv/rcu.hpp"
+#include "seinfeld_tv/segmenter.hpp"
+#include "seinfeld_tv/station.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace seinfeld_tv {
+
+struct PlayoutOptions {
+    Pts target_duration = 6 * kPtsPerSecond;
+    /// Segments listed in the live playlist.
+    std::size_t playlist_segments = 10;
+    /// Segments kept addressable behind the playlist for slow clients.
+    std::size_t history_segments = 20;
+    /// How far past the live edge segments are planned, so a blocking
+    /// playlist request knows when the segment it waits for will exist.
+    Pts lookahead = 30 * kPtsPerSecond;
+    /// LL-HLS partial segments are cut from whole GOPs up to this long;
+    /// 0 plans none.
+    Pts part_target = 2 * kPtsPerSecond;
+};
+
+/// An LL-HLS partial segment: a keyframe-aligned slice of a LiveSegment,
+/// listed and served before the whole segment has aired.
+struct LivePart {
+    Pts channel_pts = 0;
+    Pts duration_pts = 0;
+    SegmentRef ref;
+
+    Pts available_pts() const noexcept { return channel_pts + duration_pts; }
+};
+
+/// One segment of a channel's live sequence.
+struct LiveSegment {
+    std::uint64_t sequence = 0;
+    std::uint64_t discontinuity = 0; ///< discontinuity sequence it belongs to
+    Pts channel_pts = 0;             ///< channel time it starts airing
+    Pts duration_pts = 0;            ///< airtime, as listed in the playlist
+    bool new_source = false;         ///< first segment after a source change
+    SegmentRef ref;
+    /// fMP4 sources: the init segment shared by the run of segments cut
+    /// from the same airing, and the sequence of the run's first segment.
+    std::shared_ptr<const SegmentRef> init;
+    std::uint64_t init_sequence = 0;
+    Container container = Container::Unknown;
+    /// Back to back over the segment's airtime; empty without part_target.
+    std::vector<LivePart> parts;
+
+    /// Channel time from which it may be listed: once it has fully aired.
+    Pts available_pts() const noexcept { return channel_pts + duration_pts; }
+    /// Number of leading parts that have aired by `now`.
+    std::size_t available_parts(Pts now) const noexcept;
+};
+
+/// Immutable snapshot of a channel's segment sequence: recent history,
+/// the live edge and planned segments beyond it, contiguous in sequence.
+struct LiveWindow {
+    std::vector<std::shared_ptr<const LiveSegment>> segments;
+
+    const LiveSegment* find(std::uint64_t sequence) const noexcept;
+    /// Index one past the last segment available at `now`.
+    std::size_t available_end(Pts now) const noexcept;
+};
+
+/// Where one segment sat in a channel's sequence, kept across restarts so
+/// a new process carries on the numbering of the last.
+struct SequencePoint {
+    Pts channel_pts = 0;
+    std::uint64_t sequence = 0;
+    std::uint64_t discontinuity = 0;
+};
+static_assert(sizeof(SequencePoint) == 24);
+
+/// Maps a channel's timeline onto a contiguous sequence of keyframe-aligned
+/// segments, the way an HLS media playlist numbers them.
+///
+/// Segments are planned from the channel's current timeline a little
+/// ahead of the live edge and published as a new LiveWindow through an
+/// RCU cell; readers never lock. Whichever reader first notices the
+/// window is short extends it, under a try-lock, so there is no playout
+/// thread. Each airing opens its source once and is cut with
+/// plan_segments() against the library's shared GOP index. A timeline
+/// change (plan edit, new catalog generation) takes effect once the
+/// already-planned lookahead has aired, behind a discontinuity.
+///
+/// A break splice that does not land on a clean splice point is served
+/// from its pre-encoded bridge (see splice.hpp), which replaces only the
+/// straddling GOP; without one the cut falls on the nearest keyframe.
+///
+/// Numbering starts at channel time / target duration when the playout
+/// is created and then counts segments, so it increases across restarts;
+/// resume() carries on an earlier process's numbering exactly instead.
+class Playout {
+public:
+    Playout(Library& library, const Channel& channel, PlayoutOptions options = {});
+
+    using WindowGuard = rcu::Cell<LiveWindow>::ReadGuard;
+
+    /// The segment window, extended first if it does not reach
+    /// `now + lookahead`.
+    WindowGuard window(Pts now);
+
+    const Channel& channel() const noexcept { return channel_; }
+    const PlayoutOptions& options() const noexcept { return options_; }
+
+    /// Channel time up to which segments are planned; 0 before the first
+    /// window().
+    Pts planned_until() const noexcept { return planned_until_.load(std::memory_order_acquire); }
+
+    /// How long each extension of the window took to plan and cut.
+    const metrics::Histogram& build_latency() const noexcept { return build_latency_; }
+    /// How far the planned window fell short of now + lookahead each time
+    /// a request had to extend it, in nanoseconds of channel time. A
+    /// window restarted after nobody watched is not lag, and not recorded.
+    const metrics::Histogram& plan_lag() const noexcept { return plan_lag_; }
+
+    /// The window's segments as sequence points, oldest first.
+    std::vector<SequencePoint> positions() const;
+
+    /// Numbers the first segment planned as `points` (positions() of an
+    /// earlier process, sorted by channel time) did, if it is among them,
+    /// so viewers see one unbroken sequence across a restart. Call before
+    /// the first window().
+    void resume(std::vector<SequencePoint> points);
+
+    /// Records each airing into `history` as it is first cut. Call
+    /// before the first window().
+    void set_history(PlayHistory* history);
+
+private:
+    static constexpr Pts kNoAiring = -1;
+
+    /// Identity of the timeline entry being cut.
+    struct Airing {
+        Pts start_pts = kNoAiring;
+        ContentHash hash;
+        Pts in_pts = 0;
+        Pts out_pts = 0;
+
+        friend bool operator==(const Airing&, const Airing&) = default;
+    };
+
+    /// A span of the airing, cut either from the source or, for the GOP
+    /// straddling a splice, served whole from its bridge file.
+    struct PlannedSpan {
+        SegmentSpan span;
+        std::shared_ptr<const SourceFile> bridge;
+    };
+
+    void extend(Pts now);
+    /// Cuts the whole airing, whatever part of it is still to come, so
+    /// every playout of it (and every node of a cluster) cuts the same
+    /// segments.
+    std::vector<PlannedSpan> plan_spans(const TimelineEntry& entry, const EpisodeRecord& record,
+                                        const std::filesystem::path& media) const;
+    std::vector<LivePart> make_parts(const SegmentSpan& span, Pts from, Pts to) const;
+    /// Records the airing entry `index` of `timeline` belongs to, unless
+    /// it continues one already recorded: an episode resuming from a
+    /// break, or the same entry again in a restarted window.
+    void log_airing(const Timeline& timeline, std::size_t index, const EpisodeRecord& record);
+
+    Library& library_;
+    const Channel& channel_;
+    PlayoutOptions options_;
+    rcu::Cell<LiveWindow> window_;
+    std::atomic<Pts> planned_until_{0};
+    metrics::Histogram build_latency_;
+    metrics::Histogram plan_lag_;
+
+    std::mutex extend_mutex_;
+    // Planner state, guarded by extend_mutex_.
+    std::uint64_t next_sequence_ = 0;
+    std::uint64_t discontinuity_ = 0;
+    Airing airing_;
+    bool started_ = false;
+    std::shared_ptr<const SourceFile> source_;
+    std::shared_ptr<const GopIndex> index_;
+    std::shared_ptr<const SegmentRef> init_;
+    std::uint64_t init_sequence_ = 0;
+    std::vector<PlannedSpan> spans_;
+    std::size_t next_span_ = 0;
+    bool after_bridge_ = false;
+    PlayHistory* history_ = nullptr;
+    // The last airing recorded, merged over its parts as the guide's
+    // programs are: its episode, where its last part ends in channel
+    // time, and that part's out-point.
+    EpisodeId logged_episode_ = kInvalidEpisode;
+    Pts logged_until_ = kNoAiring;
+    Pts logged_out_pts_ = 0;
+    std::vector<SequencePoint> resume_;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <system_error>
+#include <utility>
+
+namespace seinfeld_tv {
+
+/// Throws std::system_error for the current errno, tagged with `what`.
+[[noreturn]] void throw_errno(const char* what);
+
+/// Owning wrapper around a POSIX file descriptor.
+class UniqueFd {
+public:
+    UniqueFd() noexcept = default;
+    explicit UniqueFd(int fd) noexcept : fd_(fd) {}
+    UniqueFd(UniqueFd&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+    UniqueFd& operator=(UniqueFd&& other) noexcept
+    {
+        if (this != &other)
+            reset(std::exchange(other.fd_, -1));
+        return *this;
+    }
+    UniqueFd(const UniqueFd&) = delete;
+    UniqueFd& operator=(const UniqueFd&) = delete;
+    ~UniqueFd() { reset(); }
+
+    int get() const noexcept { return fd_; }
+    explicit operator bool() const noexcept { return fd_ >= 0; }
+    int release() noexcept { return std::exchange(fd_, -1); }
+    void reset(int fd = -1) noexcept;
+
+private:
+    int fd_ = -1;
+};
+
+/// Writes the whole buffer, retrying on short writes and EINTR.
+void write_all(int fd, const void* data, std::size_t size);
+
+/// Flushes `fd` to stable storage.
+void fsync_or_throw(int fd);
+
+/// Replaces `path` with `data` atomically: writes a temp file beside it, fsyncs it and
+/// renames it over the target, so readers that have the old file mapped
+/// keep a consistent image and new opens see only complete files.
+void write_file_atomic(const std::filesystem::path& path, std::span<const std::byte> data);
+
+} // namespace seinfeld_tv
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "seinfeld_tv/container.hpp"
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/station.hpp"
+#include "seinfeld_tv/timeline.hpp"
+#include "seinfeld_tv/uring.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace seinfeld_tv {
+
+struct PrefetchOptions {
+    /// Airings starting within this far of now are warmed.
+    Pts lead = 10 * kPtsPerMinute;
+    /// Leading segments of each airing read ahead, at this target length.
+    std::size_t segments = 5;
+    Pts target_duration = 6 * kPtsPerSecond;
+    /// Read size and reads in flight: bounds what one prefetch adds to the
+    /// storage queue.
+    std::size_t read_size = std::size_t{1} << 20;
+    unsigned queue_depth = 4;
+};
+
+struct PrefetchStats {
+    std::uint64_t airings = 0; ///< airings warmed
+    std::uint64_t bytes = 0;   ///< bytes read into the page cache
+    std::uint64_t failures = 0;
+};
+
+/// Warms the page cache for the start of upcoming airings, so the first
+/// segments of the next episode are served from memory rather than cold
+/// from network storage at the episode boundary.
+///
+/// For each airing about to start, it opens (building if needed) the GOP
+/// index, hints the leading segments' extents with POSIX_FADV_WILLNEED
+/// and reads them through its own io_uring. Segments are sent from the
+/// page cache with sendfile, so that is the tier warmed; the segment
+/// cache only holds rewritten segments and is filled on demand.
+///
+/// Reads are issued in the idle I/O class and the constructor moves the
+/// calling thread there too, so readahead started by the hints queues
+/// behind live reads. Like Ring, a Prefetcher is driven from the thread
+/// that created it.
+class Prefetcher {
+public:
+    explicit Prefetcher(Library& library, PrefetchOptions options = {});
+
+    /// Warms every airing of `timeline` starting in [now, now + lead) that
+    /// has not been warmed yet, by this or any other channel. Files that
+    /// fail to open or index are counted and skipped. Returns the bytes read.
+    std::uint64_t prefetch(const Timeline& timeline, Pts now);
+
+    const PrefetchStats& stats() const noexcept { return stats_; }
+
+private:
+    std::uint64_t read_extents(int fd, const std::vector<FileExtent>& extents);
+
+    Library& library_;
+    PrefetchOptions options_;
+    Ring ring_;
+    std::vector<std::byte> buffer_;
+    std::vector<Completion> slots_;
+    /// (content, source in point) warmed, to the channel time it airs;
+    /// dropped once aired so a later repeat is warmed again.
+    std::map<std::pair<ContentHash, Pts>, Pts> warmed_;
+    PrefetchStats stats_;
+};
+
+} // namespace seinfeld_tv
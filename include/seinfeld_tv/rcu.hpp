@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/// Epoch-based read-copy-update for hot-path readers.
+///
+/// Readers never block and never write shared cache lines other than their
+/// own slot: entering a read section stores the current global epoch into a
+/// per-thread slot, leaving clears it. Writers swap a pointer, bump the
+/// epoch, and free the previous version once no slot still shows an epoch
+/// older than the swap.
+namespace seinfeld_tv::rcu {
+
+/// Upper bound on threads that are simultaneously registered as readers.
+inline constexpr std::size_t kMaxReaderThreads = 512;
+
+/// Enters/leaves a read-side critical section on the calling thread.
+/// Sections nest; only the outermost pair touches the thread's slot.
+/// The first call on a thread claims a slot (lock-free) and the slot is
+/// returned when the thread exits.
+void read_lock() noexcept;
+void read_unlock() noexcept;
+
+/// Advances the global epoch and returns the new value. Anything unlinked
+/// before this call is unreachable to sections that start at or after it.
+std::uint64_t advance() noexcept;
+
+/// True when no reader is still inside a section that began before `epoch`.
+bool quiescent_since(std::uint64_t epoch) noexcept;
+
+/// Spins (yielding) until quiescent_since(epoch). Writer side only.
+void wait_for_readers(std::uint64_t epoch) noexcept;
+
+class ReadSection {
+public:
+    ReadSection() noexcept { read_lock(); }
+    ~ReadSection() { read_unlock(); }
+    ReadSection(const ReadSection&) = delete;
+    ReadSection& operator=(const ReadSection&) = delete;
+};
+
+/// Single pointer published with RCU semantics.
+///
+/// `read()` is wait-free; `publish()` is lock-free (an atomic exchange plus a
+/// push onto a lock-free retire list). Old versions are freed by `reclaim()`,
+/// which every publish runs opportunistically.
+template <typename T>
+class Cell {
+public:
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const Cell& cell) noexcept
+        {
+            read_lock();
+            ptr_ = cell.current_.load(std::memory_order_seq_cst);
+        }
+        ReadGuard(ReadGuard&& other) noexcept : ptr_(other.ptr_), owns_(other.owns_) { other.owns_ = false; }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ReadGuard& operator=(ReadGuard&&) = delete;
+        ~ReadGuard()
+        {
+            if (owns_)
+                read_unlock();
+        }
+
+        const T* get() const noexcept { return ptr_; }
+        const T* operator->() const noexcept { return ptr_; }
+        const T& operator*() const noexcept { return *ptr_; }
+        explicit operator bool() const noexcept { return ptr_ != nullptr; }
+
+    private:
+        const T* ptr_ = nullptr;
+        bool owns_ = true;
+    };
+
+    Cell() noexcept = default;
+    explicit Cell(std::unique_ptr<const T> initial) noexcept : current_(initial.release()) {}
+    Cell(const Cell&) = delete;
+    Cell& operator=(const Cell&) = delete;
+
+    /// Callers guarantee no reader still holds a guard on this cell.
+    ~Cell()
+    {
+        delete current_.load(std::memory_order_relaxed);
+        Retired* r = retired_.exchange(nullptr, std::memory_order_acquire);
+        while (r) {
+            Retired* next = r->next;
+            delete r->ptr;
+            delete r;
+            r = next;
+        }
+    }
+
+    ReadGuard read() const noexcept { return ReadGuard(*this); }
+
+    /// Safe only when the caller already holds a read section (or is the
+    /// sole writer); used for nested lookups under an existing guard.
+    const T* unsafe_get() const noexcept { return current_.load(std::memory_order_acquire); }
+
+    void publish(std::unique_ptr<const T> next)
+    {
+        const T* old = current_.exchange(next.release(), std::memory_order_seq_cst);
+        if (old) {
+            auto* node = new Retired{old, advance(), nullptr};
+            node->next = retired_.load(std::memory_order_relaxed);
+            while (!retired_.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+            }
+        }
+        reclaim();
+    }
+
+    /// Frees every retired version that no reader can still observe.
+    void reclaim() noexcept
+    {
+        Retired* list = retired_.exchange(nullptr, std::memory_order_acquire);
+        Retired* keep = nullptr;
+        while (list) {
+            Retired* next = list->next;
+            if (quiescent_since(list->epoch)) {
+                delete list->ptr;
+                delete list;
+            } else {
+                list->next = keep;
+                keep = list;
+            }
+            list = next;
+        }
+        while (keep) {
+            Retired* next = keep->next;
+            keep->next = retired_.load(std::memory_order_relaxed);
+            while (!retired_.compare_exchange_weak(keep->next, keep, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+            }
+            keep = next;
+        }
+    }
+
+    /// Blocks the calling writer until every retired version is freed.
+    void synchronize() noexcept
+    {
+        wait_for_readers(advance());
+        reclaim();
+    }
+
+private:
+    struct Retired {
+        const T* ptr;
+        std::uint64_t epoch;
+        Retired* next;
+    };
+
+    std::atomic<const T*> current_{nullptr};
+    std::atomic<Retired*> retired_{nullptr};
+};
+
+} // namespace seinfeld_tv::rcu
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "seinfeld_tv/posix.hpp"
+
+#include <filesystem>
+#include <string_view>
+
+namespace seinfeld_tv {
+
+/// Where offline jobs and benchmarks record timings by default (relative
+/// to the working directory; the repository root ignores it).
+inline constexpr std::string_view kBenchOutputPath = "bench_output.txt";
+
+/// Append-only, line-oriented report file shared by concurrent writers.
+/// Each line goes out in a single write(2) on an O_APPEND descriptor, so
+/// lines from different threads or processes never interleave.
+class ReportLog {
+public:
+    explicit ReportLog(const std::filesystem::path& path = kBenchOutputPath);
+
+    /// Appends `text` plus a newline.
+    void line(std::string_view text);
+
+private:
+    UniqueFd fd_;
+};
+
+} // namespace seinfeld_tv
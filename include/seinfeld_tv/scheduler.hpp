@@ -0,0 +1,118 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/rcu.hpp"
+#include "seinfeld_tv/timeline.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace seinfeld_tv {
+
+inline constexpr Pts kPtsPerWeek = 7 * kPtsPerDay;
+
+/// What a block of airtime draws from.
+enum class BlockKind : std::uint8_t {
+    Shuffle,  ///< whole library, in the channel's SeekableShuffle order
+    Marathon, ///< one season (0 = whole series) in broadcast order
+    Episodes, ///< an explicit operator-chosen list, in order
+    Clips,    ///< catalog clips whose label contains `clip_label`
+};
+
+/// A recurring slot in the weekly grid, e.g. "Thursday 20:00, 4h, season 4".
+struct ProgramBlock {
+    Pts week_offset = 0; ///< start relative to SchedulePlan::week_origin
+    Pts duration = 0;
+    BlockKind kind = BlockKind::Shuffle;
+    std::uint16_t season = 0;
+    std::vector<std::pair<std::uint16_t, std::uint16_t>> episodes;
+    std::string clip_label;
+};
+
+/// Bumpers and ad breaks inside full episodes.
+struct BreakPlan {
+    Pts every = 0; ///< source time between breaks; 0 for none
+    /// Breaks air, in rotation, the catalog clips whose label contains this.
+    std::string clip_label = "bumper";
+    std::size_t clips_per_break = 1;
+    /// How far a break may move from its nominal point to land where the
+    /// episode can be cut without re-encoding.
+    Pts window = 30 * kPtsPerSecond;
+};
+
+/// Operator-facing description of a channel's programming.
+///
+/// Blocks repeat every week and must not overlap; airtime not covered by a
+/// block falls back to shuffle.
+struct SchedulePlan {
+    Pts week_origin = 0; ///< channel time of the week's first instant
+    std::uint64_t seed = 0;
+    std::vector<ProgramBlock> blocks;
+    BreakPlan breaks;
+};
+
+/// Chooses where a break goes: given the episode, a nominal source time,
+/// the plan's window and where the break's first clip starts, returns the
+/// source time to cut at, or nullopt to cut at the nominal point.
+using SpliceFinder = std::function<std::optional<Pts>(const Catalog&, EpisodeId episode, Pts at, Pts window,
+                                                      EpisodeId insert, Pts insert_in)>;
+
+/// Expands `plan` into a flat timeline covering [from, from + horizon).
+/// Full episodes are split around breaks as `plan.breaks` asks, each break
+/// placed by `splices` when given. Throws std::invalid_argument for
+/// overlapping or empty blocks.
+std::vector<TimelineEntry> build_timeline(const Catalog& catalog, const SchedulePlan& plan, Pts from,
+                                          Pts horizon = kPtsPerWeek, const SpliceFinder& splices = {});
+
+/// Owns a channel's plan and publishes its precomputed timeline.
+///
+/// The playout thread reads through `timeline()`/`now_playing()` which are
+/// wait-free. Rebuilds and plan edits construct a complete new Timeline off
+/// the hot path and swap it in with an RCU publish; nothing here takes a
+/// lock, so an operator edit can never stall frame delivery.
+class Scheduler {
+public:
+    Scheduler(std::shared_ptr<const Catalog> catalog, SchedulePlan plan, SpliceFinder splices = {});
+
+    using TimelineGuard = rcu::Cell<Timeline>::ReadGuard;
+
+    TimelineGuard timeline() const noexcept { return timeline_.read(); }
+
+    /// Position at channel time `t`, copied out so no guard is held.
+    std::optional<TimelinePosition> now_playing(Pts t) const noexcept;
+
+    /// Bumped after every timeline publish, so derived views (the program
+    /// guide) can tell theirs is stale with one load.
+    std::uint64_t revision() const noexcept { return revision_.load(std::memory_order_acquire); }
+
+    /// Regenerates the week starting at `from` with the current plan.
+    void rebuild(Pts from);
+
+    /// Publishes `entries`, built from the current plan and catalog by an
+    /// earlier process (see snapshot.hpp), instead of rebuilding them.
+    void restore(std::vector<TimelineEntry> entries);
+
+    /// A copy of the current plan.
+    SchedulePlan plan() const { return *plan_.read(); }
+
+    /// Replaces the plan and immediately republishes from `from`.
+    void set_plan(SchedulePlan plan, Pts from);
+
+    /// Swaps in a new catalog generation (e.g. after a library rescan).
+    void set_catalog(std::shared_ptr<const Catalog> catalog, Pts from);
+
+private:
+    rcu::Cell<std::shared_ptr<const Catalog>> catalog_;
+    rcu::Cell<SchedulePlan> plan_;
+    rcu::Cell<Timeline> timeline_;
+    SpliceFinder splices_;
+    std::atomic<std::uint64_t> revision_{0};
+};
+
+} // namespace seinfeld_tv
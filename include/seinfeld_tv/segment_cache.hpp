@@ -0,0 +1,117 @@
+#pragma once
+
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/metrics.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Identifies one media segment of one rendition of one channel.
+struct SegmentKey {
+    std::uint32_t channel = 0;
+    std::uint32_t rendition = 0; ///< index into the channel's ladder
+    std::uint64_t sequence = 0;  ///< media sequence number
+
+    friend bool operator==(const SegmentKey&, const SegmentKey&) = default;
+};
+
+struct SegmentKeyHash {
+    std::size_t operator()(const SegmentKey& k) const noexcept
+    {
+        std::uint64_t x = k.sequence ^ (std::uint64_t{k.channel} << 40) ^ (std::uint64_t{k.rendition} << 24);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return static_cast<std::size_t>(x);
+    }
+};
+
+/// A fully built segment ready to be written to viewers.
+struct CachedSegment {
+    std::vector<std::byte> bytes;
+    Pts start_pts = 0;
+    Pts duration_pts = 0;
+};
+
+struct SegmentCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t coalesced = 0; ///< misses that waited on another caller's build
+    std::uint64_t inserts = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t rejected = 0; ///< values larger than a shard's budget
+    std::uint64_t bytes = 0;
+    std::uint64_t entries = 0;
+
+    double hit_rate() const noexcept
+    {
+        const auto lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+/// Concurrent segment cache with a hard byte budget.
+///
+/// Keys hash to one of N shards, each with its own lock and an equal
+/// share of the budget. Eviction is S3-FIFO: new entries go to a small
+/// probationary FIFO (10% of the shard) and only those hit again while
+/// there are promoted to the main FIFO. A ghost list of recently evicted
+/// keys sends re-requested segments straight to main. A viewer seeking
+/// through an archive therefore cannot flush the live edge that every
+/// other viewer is reading. Hits only bump a 2-bit counter under a
+/// shared lock; nothing is relinked on the read path.
+///
+/// get_or_build coalesces concurrent misses on the same key, so a
+/// thundering herd on a new segment runs its builder once. Hits and
+/// misses are per-thread counters rather than per-shard atomics, since a
+/// live edge that every viewer reads lives in a single shard.
+class SegmentCache {
+public:
+    using Value = std::shared_ptr<const CachedSegment>;
+    using Builder = std::function<Value()>;
+
+    explicit SegmentCache(std::size_t byte_budget, std::size_t shards = 16);
+    ~SegmentCache();
+
+    SegmentCache(const SegmentCache&) = delete;
+    SegmentCache& operator=(const SegmentCache&) = delete;
+
+    /// nullptr on a miss.
+    Value find(const SegmentKey& key);
+
+    /// Returns the cached value or runs `build` once across all
+    /// concurrent callers for `key`. A null or throwing build is not
+    /// cached; its exception reaches every waiter.
+    Value get_or_build(const SegmentKey& key, const Builder& build);
+
+    /// Inserts or replaces `key`, evicting as needed to stay in budget.
+    void insert(const SegmentKey& key, Value value);
+
+    /// Keys worth warming after a restart: every shard's main FIFO (hit
+    /// again after admission), newest first, then its probationary one.
+    std::vector<SegmentKey> hot_keys() const;
+
+    std::size_t byte_budget() const noexcept { return budget_; }
+    SegmentCacheStats stats() const noexcept;
+
+    /// Bytes charged for `value`, including bookkeeping overhead.
+    static std::size_t charge(const CachedSegment& value) noexcept;
+
+private:
+    struct Node;
+    struct Shard;
+
+    Shard& shard_of(const SegmentKey& key) const noexcept;
+
+    std::size_t budget_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    metrics::Counter hits_;
+    metrics::Counter misses_;
+};
+
+} // namespace seinfeld_tv
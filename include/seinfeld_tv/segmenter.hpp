@@ -0,0 +1,108 @@
+#pragma once
+
+#include "seinfeld_tv/container.hpp"
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/posix.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// An open episode file shared by every segment cut from it. Holding the
+/// descriptor keeps the inode alive across library rescans and lets all
+/// sends hit the same page cache.
+class SourceFile {
+public:
+    explicit SourceFile(const std::filesystem::path& path);
+
+    int fd() const noexcept { return fd_.get(); }
+    std::uint64_t size() const noexcept { return size_; }
+    const std::filesystem::path& path() const noexcept { return path_; }
+
+private:
+    UniqueFd fd_;
+    std::uint64_t size_ = 0;
+    std::filesystem::path path_;
+};
+
+/// Keyframe-aligned cut of a source: byte range plus its time span.
+struct SegmentSpan {
+    Pts start_pts;
+    Pts end_pts;
+    std::uint64_t begin_offset;
+    std::uint64_t end_offset;
+
+    Pts duration() const noexcept { return end_pts - start_pts; }
+};
+
+/// A servable segment: an ordered list of byte ranges of one source file.
+/// Segments are never materialised in memory; they are streamed from page
+/// cache with sendfile(2)/splice(2). The extent list may live in a
+/// per-segment arena; copies use the default resource.
+struct SegmentRef {
+    std::shared_ptr<const SourceFile> source;
+    Pts start_pts = 0;
+    Pts duration_pts = 0;
+    std::pmr::vector<FileExtent> extents;
+
+    std::uint64_t size() const noexcept
+    {
+        std::uint64_t n = 0;
+        for (const auto& e : extents)
+            n += e.length;
+        return n;
+    }
+};
+
+/// Cuts source range [in_pts, out_pts) into segments that start on
+/// keyframes and last at least `target` (except the last one). The first
+/// segment starts at the last keyframe at or before `in_pts`; the last ends
+/// at the first keyframe at or after `out_pts`, or at end of file.
+std::vector<SegmentSpan> plan_segments(const GopView& index, Pts in_pts, Pts out_pts, Pts target);
+
+/// Splits a span into LL-HLS partial segments: runs of whole GOPs, each
+/// cut before it would exceed `part_target`. A GOP longer than the target
+/// is a part of its own, so every part starts on a keyframe.
+std::vector<SegmentSpan> plan_parts(const GopView& index, const SegmentSpan& span, Pts part_target);
+
+/// Builds the extent list for one span. TS segments are prefixed with the
+/// source's PAT/PMT packets so each one is independently decodable; fMP4
+/// fragments reference the separate init segment.
+SegmentRef make_segment(std::shared_ptr<const SourceFile> source, const GopView& index,
+                        const SegmentSpan& span,
+                        std::pmr::memory_resource* mr = std::pmr::get_default_resource());
+
+/// The fMP4 init segment (ftyp+moov). Empty extents for TS sources.
+SegmentRef make_init_segment(std::shared_ptr<const SourceFile> source, const GopView& index);
+
+enum class SendStatus {
+    Done,
+    WouldBlock, ///< socket buffer full; call again when writable
+};
+
+/// Progress through a SegmentRef across non-blocking sends.
+struct SendCursor {
+    std::size_t extent = 0;
+    std::uint64_t offset = 0; ///< bytes already sent from the current extent
+    std::uint64_t total = 0;
+    /// splice(2) fallback for sources sendfile(2) rejects. Bytes already
+    /// moved into the pipe but not yet out to the socket are `in_pipe`.
+    UniqueFd pipe_read;
+    UniqueFd pipe_write;
+    std::uint64_t in_pipe = 0;
+    bool use_splice = false;
+};
+
+/// Streams the segment to `out_fd` without copying through userspace.
+/// Uses sendfile(2); if the source filesystem does not support it, falls
+/// back to splice(2) through a pipe. Throws std::system_error on I/O
+/// errors and if the source shrinks underneath us.
+SendStatus send_segment(int out_fd, const SegmentRef& segment, SendCursor& cursor);
+
+} // namespace seinfeld_tv
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "seinfeld_tv/media_time.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// A session's slot and the generation the slot had when the handle was
+/// issued. Once the session is reaped and the slot reused, the old handle
+/// no longer matches and every operation on it is a no-op.
+struct SessionHandle {
+    std::uint32_t slot = 0;
+    std::uint32_t generation = 0;
+
+    friend bool operator==(const SessionHandle&, const SessionHandle&) = default;
+};
+
+/// One session's measured throughput over a batch of deliveries.
+struct BandwidthSample {
+    SessionHandle session;
+    std::uint32_t bps = 0;
+};
+
+/// A copy of one session's state.
+struct SessionInfo {
+    std::uint32_t channel = 0;
+    std::uint32_t rendition = 0;
+    std::uint32_t bandwidth_bps = 0; ///< 0 until an estimate is recorded
+    std::uint64_t last_sequence = 0; ///< last media segment served
+    std::uint64_t segments = 0;      ///< media segments served
+    Pts joined = 0;
+    Pts last_seen = 0;
+};
+
+/// Per-viewer state for every open session, one column per field.
+///
+/// Sessions are named by an opaque client key (the `session` query
+/// parameter) and live in fixed slots. A flat open-addressed index maps
+/// key hashes to slots, and each field is a dense array indexed by slot.
+/// So the once-a-second sweeps (reaping, per-channel counts) stream
+/// through one or two arrays instead of chasing a node per viewer. A
+/// slot's generation is odd while it is in use and is bumped when the
+/// session opens and when it is reaped, so handles go stale instead of
+/// pointing at whoever gets the slot next.
+///
+/// Keys are identified by a 64-bit hash only: two keys that collide
+/// share a session. One mutex guards the table. Every operation is a
+/// probe and a few stores, and sweeps over a full table of 64k sessions
+/// take tens of microseconds.
+class SessionTable {
+public:
+    static constexpr std::size_t kDefaultCapacity = std::size_t{1} << 16;
+
+    explicit SessionTable(std::size_t capacity = kDefaultCapacity);
+
+    SessionTable(const SessionTable&) = delete;
+    SessionTable& operator=(const SessionTable&) = delete;
+
+    /// The session named `key`, opened on `channel` if it is new, with its
+    /// last-seen time moved to `now`. nullopt when the table is full. A
+    /// known session that switches channel keeps its slot and join time.
+    std::optional<SessionHandle> touch(std::string_view key, std::uint32_t channel, Pts now);
+
+    /// The open session named `key`, without opening or refreshing it.
+    std::optional<SessionHandle> find(std::string_view key) const;
+
+    /// Records one media segment served. False for a stale handle.
+    bool served(SessionHandle h, std::uint64_t sequence, std::uint32_t rendition, Pts now);
+
+    /// Stores the session's latest bandwidth estimate. False for a stale handle.
+    bool set_bandwidth(SessionHandle h, std::uint32_t bps);
+
+    /// Folds a batch of samples into the estimates under one lock: each
+    /// moves `weight` of the way from the current estimate to the sample,
+    /// and a session's first sample is taken as is. Stale handles are
+    /// skipped. Returns the number applied.
+    std::size_t blend_bandwidth(std::span<const BandwidthSample> samples, double weight);
+
+    std::optional<SessionInfo> get(SessionHandle h) const;
+
+    /// Closes every session last seen before `cutoff`; returns how many.
+    std::size_t reap(Pts cutoff);
+
+    /// Open sessions in total, and per channel id, with `counts` resized as needed.
+    std::size_t count(std::vector<std::size_t>* counts = nullptr) const;
+
+    std::size_t capacity() const noexcept { return generation_.size(); }
+
+private:
+    static constexpr std::uint32_t kEmpty = ~std::uint32_t{0};
+
+    bool live(std::uint32_t slot, std::uint32_t generation) const noexcept
+    {
+        return slot < generation_.size() && generation_[slot] == generation && (generation & 1) != 0;
+    }
+    std::size_t bucket_of(std::uint64_t key) const noexcept;
+    void unindex(std::uint32_t slot) noexcept;
+
+    mutable std::mutex mutex_;
+    std::vector<std::uint32_t> index_; ///< power of two, at least twice the capacity
+    std::vector<std::uint32_t> free_;  ///< slots not in use, lowest at the back
+    std::uint32_t high_ = 0;           ///< one past the highest slot ever used; sweeps stop here
+
+    // Columns, indexed by slot.
+    std::vector<std::uint64_t> key_;
+    std::vector<std::uint32_t> generation_;
+    std::vector<std::uint32_t> channel_;
+    std::vector<std::uint32_t> rendition_;
+    std::vector<std::uint32_t> bandwidth_;
+    std::vector<std::uint64_t> last_sequence_;
+    std::vector<std::uint64_t> segments_;
+    std::vector<Pts> joined_;
+    std::vector<Pts> last_seen_;
+};
+
+} // namespace seinfeld_tv
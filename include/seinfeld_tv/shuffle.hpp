@@ -0,0 +1,94 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/media_time.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// A keyed pseudo-random permutation of [0, size), evaluated pointwise.
+///
+/// A balanced Feistel network over the smallest even-width bit domain
+/// holding `size`, with values that land outside [0, size) walked
+/// through the network again. The domain is under 4x `size`, so a lookup
+/// is a handful of rounds of arithmetic, with no table. The same size
+/// and key give the same permutation on every platform.
+class FeistelPermutation {
+public:
+    /// Throws std::invalid_argument if `size` is 0.
+    FeistelPermutation(std::uint64_t size, std::uint64_t key);
+
+    /// `i` must be below size().
+    std::uint64_t operator()(std::uint64_t i) const noexcept;
+
+    std::uint64_t size() const noexcept { return size_; }
+
+private:
+    static constexpr int kRounds = 6;
+
+    std::uint64_t encrypt(std::uint64_t x) const noexcept;
+
+    std::uint64_t size_;
+    unsigned half_bits_;
+    std::uint64_t half_mask_;
+    std::array<std::uint64_t, kRounds> keys_;
+};
+
+/// One airing of a SeekableShuffle.
+struct ShuffleSlot {
+    EpisodeId episode = 0;
+    Pts start = 0;    ///< relative to the shuffle's origin
+    Pts duration = 0;
+    std::int64_t round = 0;  ///< pass through the library
+    std::uint32_t index = 0; ///< position within the round
+};
+
+/// The whole library in a fresh random order each round, back to back,
+/// as a pure function of time.
+///
+/// Every round airs every episode once, so all rounds last the same and
+/// the round airing at `t` is one division. Round r's order is a
+/// FeistelPermutation keyed by (seed, r), and episode k of it is O(1).
+/// Where in the round `t` falls is a binary search over that round's
+/// start offsets, which are summed once per round and memoised. Nothing
+/// depends on a start point or on having simulated earlier rounds, so a
+/// channel's shuffle agrees across restarts and cluster nodes.
+///
+/// Not thread-safe: at() updates the memoised round.
+class SeekableShuffle {
+public:
+    /// Episodes with no airtime are left out.
+    SeekableShuffle(const Catalog& catalog, std::uint64_t seed);
+
+    bool empty() const noexcept { return ids_.empty(); }
+    /// Length of one round.
+    Pts round_length() const noexcept { return round_length_; }
+
+    /// The airing covering `t` (ticks since the origin, may be negative).
+    /// The shuffle must not be empty.
+    ShuffleSlot at(Pts t);
+
+    /// The airing after `slot`.
+    ShuffleSlot after(const ShuffleSlot& slot);
+
+    /// Episode `index` (below the number of episodes) of round `round`.
+    EpisodeId episode(std::int64_t round, std::uint32_t index) const noexcept;
+
+private:
+    const std::vector<Pts>& offsets(std::int64_t round);
+    FeistelPermutation order(std::int64_t round) const;
+
+    std::uint64_t seed_;
+    std::vector<EpisodeId> ids_;
+    std::vector<Pts> durations_; ///< by position in ids_
+    Pts round_length_ = 0;
+
+    std::int64_t cached_round_ = 0;
+    bool cached_ = false;
+    std::vector<Pts> offsets_; ///< start of each index of cached_round_
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/hls_service.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+#include "seinfeld_tv/playout.hpp"
+#include "seinfeld_tv/scheduler.hpp"
+#include "seinfeld_tv/segment_cache.hpp"
+#include "seinfeld_tv/snapshot_format.hpp"
+#include "seinfeld_tv/station.hpp"
+#include "seinfeld_tv/timeline.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace seinfeld_tv {
+
+/// Stable 64-bit digest of everything in `plan` that shapes a timeline.
+std::uint64_t plan_fingerprint(const SchedulePlan& plan);
+
+/// Writes the warm state of a serving process to `path`, atomically: each
+/// channel's timeline and segment window, the segment cache's hot keys
+/// and the GOP indexes mapped. `timeline_from` is what the timelines were
+/// built from. Loudness needs no snapshot; it is stored in the catalog.
+void save_snapshot(const std::filesystem::path& path, Station& station, HlsService& hls, Pts timeline_from);
+
+/// Read-only view of a mapped snapshot.
+///
+/// Opening validates the header and every section once; lookups then read
+/// straight from the mapping. A restarted stv-serve takes a channel's
+/// timeline from here instead of rebuilding it when the catalog
+/// generation, timeline anchor and plan all still match, resumes its
+/// segment numbering, and warms its cache and indexes in the background.
+class Snapshot {
+public:
+    /// Throws std::runtime_error("snapshot: ...") on a malformed file.
+    explicit Snapshot(const std::filesystem::path& path);
+
+    Pts saved_pts() const noexcept { return header_->saved_pts; }
+
+    /// Whether the timelines were built from `from` against `catalog`.
+    bool matches(const Catalog& catalog, Pts from) const noexcept;
+
+    /// nullptr when the snapshot has no such channel.
+    const snapshot_format::ChannelRecord* channel(std::string_view name) const noexcept;
+
+    std::span<const TimelineEntry> timeline(const snapshot_format::ChannelRecord& channel) const noexcept
+    {
+        return entries_.subspan(channel.first_entry, channel.entry_count);
+    }
+    std::span<const SequencePoint> positions(const snapshot_format::ChannelRecord& channel) const noexcept
+    {
+        return points_.subspan(channel.first_point, channel.point_count);
+    }
+    std::span<const SegmentKey> hot_segments() const noexcept { return keys_; }
+    std::span<const ContentHash> indexes() const noexcept { return indexes_; }
+
+private:
+    std::string_view name(const snapshot_format::ChannelRecord& channel) const noexcept
+    {
+        return {strings_ + channel.name_offset, channel.name_length};
+    }
+
+    MappedFile file_;
+    const snapshot_format::SnapshotHeader* header_ = nullptr;
+    std::span<const snapshot_format::ChannelRecord> channels_;
+    std::span<const TimelineEntry> entries_;
+    std::span<const SequencePoint> points_;
+    std::span<const SegmentKey> keys_;
+    std::span<const ContentHash> indexes_;
+    const char* strings_ = nullptr;
+};
+
+} // namespace seinfeld_tv
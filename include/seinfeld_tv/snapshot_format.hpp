@@ -0,0 +1,71 @@
+#pragma once
+
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/media_time.hpp"
+
+#include <bit>
+#include <cstdint>
+
+/// On-disk layout of the warm-state snapshot stv-serve writes at shutdown.
+///
+/// Like the catalog, a flat little-endian image read in place through a
+/// mapping. Sections follow the header in this order, each 64-byte
+/// aligned:
+///
+///   SnapshotHeader
+///   ChannelRecord[channel_count]
+///   TimelineEntry[entry_count]      every channel's timeline, back to back
+///   SequencePoint[point_count]      every channel's window, back to back
+///   SegmentKey[key_count]           hot segment cache keys
+///   ContentHash[index_count]        episodes with a mapped GOP index
+///   string table                    channel names, UTF-8
+namespace seinfeld_tv::snapshot_format {
+
+static_assert(std::endian::native == std::endian::little, "snapshot images are little-endian");
+
+inline constexpr char kMagic[8] = {'S', 'T', 'V', 'S', 'N', 'A', 'P', 'S'};
+inline constexpr std::uint32_t kVersion = 1;
+inline constexpr std::uint64_t kSectionAlignment = 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t file_size;
+    std::uint64_t catalog_generation; ///< the timelines' episode ids refer to it
+    Pts saved_pts;                    ///< channel time of the save
+    Pts timeline_from;                ///< what every timeline was built from
+    std::uint32_t channel_count;
+    std::uint32_t reserved0;
+    std::uint64_t channels_offset;
+    std::uint64_t entries_offset;
+    std::uint64_t entry_count;
+    std::uint64_t points_offset;
+    std::uint64_t point_count;
+    std::uint64_t keys_offset;
+    std::uint64_t key_count;
+    std::uint64_t indexes_offset;
+    std::uint64_t index_count;
+    std::uint64_t strings_offset;
+    std::uint64_t strings_size;
+    std::uint8_t reserved[48];
+};
+static_assert(sizeof(SnapshotHeader) == 192);
+
+struct ChannelRecord {
+    std::uint32_t name_offset;
+    std::uint32_t name_length;
+    std::uint64_t plan_fingerprint; ///< plan_fingerprint() of the plan it aired
+    std::uint64_t first_entry;
+    std::uint64_t entry_count;
+    std::uint64_t first_point;
+    std::uint64_t point_count;
+};
+static_assert(sizeof(ChannelRecord) == 48);
+
+constexpr std::uint64_t align_section(std::uint64_t offset) noexcept
+{
+    return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+
+} // namespace seinfeld_tv::snapshot_format
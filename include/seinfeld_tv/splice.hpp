@@ -0,0 +1,77 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/container.hpp"
+#include "seinfeld_tv/content_hash.hpp"
+#include "seinfeld_tv/media_time.hpp"
+#include "seinfeld_tv/segmenter.hpp"
+#include "seinfeld_tv/transcode.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+namespace seinfeld_tv {
+
+class Library;
+class Timeline;
+
+/// Breaks are spliced into episodes by byte range wherever possible.
+///
+/// The GOP index already records, per GOP, whether it is closed (starts on
+/// an IDR that nothing before it references) and which codec parameter set
+/// it uses. A cut at the start of a closed GOP is clean: the program up to
+/// it and from it are plain byte ranges. The scheduler moves each break to
+/// the nearest clean point, preferring one whose parameters match the
+/// break's first clip. Where there is none, only the GOP straddling the
+/// cut is re-encoded, into a head that ends at the cut and a tail that
+/// starts there on an IDR; playout serves those bridges in its place.
+
+/// Nearest clean splice point to `at`, within `window` either side: the
+/// start of a closed GOP, with parameter set `params` if given.
+std::optional<Pts> find_splice_point(const GopView& index, Pts at, Pts window,
+                                     std::optional<std::uint64_t> params = std::nullopt);
+
+/// Fingerprint of the codec parameter set in force at `pts`, if recorded.
+std::optional<std::uint64_t> params_at(const GopView& index, Pts pts) noexcept;
+
+/// How a source is cut at `pts`.
+struct SplicePlan {
+    Pts pts = 0;
+    bool clean = false;
+    /// The GOP containing `pts`; re-encoded into bridges unless clean.
+    SegmentSpan straddle{};
+};
+
+/// Requires a non-empty index.
+SplicePlan plan_splice(const GopView& index, Pts pts);
+
+enum class BridgeEnd {
+    Head, ///< straddling GOP up to the cut, ending the program before a break
+    Tail, ///< straddling GOP from the cut, resuming the program after it
+};
+
+/// `<media>.splice`, beside the episode file.
+std::filesystem::path bridge_dir(const std::filesystem::path& media);
+
+/// `<media>.splice/<hash>-<pts>-head.ts` (or -tail.ts); the hash keeps a
+/// replaced master from picking up stale bridges.
+std::filesystem::path bridge_path(const std::filesystem::path& media, const ContentHash& hash, Pts pts,
+                                  BridgeEnd end);
+
+/// Encodes one bridge of `plan` to its bridge path, atomically.
+void encode_bridge(TranscodeBackend& backend, const std::filesystem::path& media, const ContentHash& hash,
+                   const SplicePlan& plan, BridgeEnd end);
+
+/// Encodes every missing bridge for break splices of `timeline` airing in
+/// [from, until). Returns how many were encoded. A failed encode is
+/// skipped: playout then cuts that splice at the nearest keyframe.
+std::size_t prepare_bridges(Library& library, const Timeline& timeline, Pts from, Pts until,
+                            TranscodeBackend& backend);
+
+/// SpliceFinder body over the library's GOP indexes (see scheduler.hpp).
+std::optional<Pts> choose_splice_point(Library& library, const Catalog& catalog, EpisodeId episode, Pts at,
+                                       Pts window, EpisodeId insert, Pts insert_in);
+
+} // namespace seinfeld_tv
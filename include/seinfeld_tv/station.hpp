@@ -0,0 +1,129 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/gop_index.hpp"
+#include "seinfeld_tv/rcu.hpp"
+#include "seinfeld_tv/scheduler.hpp"
+#include "seinfeld_tv/segment_cache.hpp"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Default byte budget of the shared segment cache.
+inline constexpr std::size_t kDefaultSegmentBudget = std::size_t{512} << 20;
+
+/// Resources shared by every channel in the process: the current catalog
+/// generation, the mapped GOP indexes and the built-segment cache.
+///
+/// GOP indexes are cached by content hash, so they survive catalog
+/// rescans for files that did not change and are mapped once no matter
+/// how many channels air the episode. Concurrent first requests for the
+/// same episode wait on a single open_or_build.
+class Library {
+public:
+    explicit Library(std::shared_ptr<const Catalog> catalog, std::size_t segment_budget = kDefaultSegmentBudget);
+
+    /// Segments keyed by (Channel::id(), rendition, sequence).
+    SegmentCache& segments() noexcept { return segments_; }
+
+    /// The current catalog generation; wait-free.
+    std::shared_ptr<const Catalog> catalog() const { return *catalog_.read(); }
+
+    /// Mapped GOP index for `record` of `catalog`, building the sidecar if
+    /// needed. Rethrows the build error to every waiter, and a later call
+    /// retries.
+    std::shared_ptr<const GopIndex> gop_index(const Catalog& catalog, const EpisodeRecord& record);
+
+    /// Publishes a new catalog generation and drops cached indexes for
+    /// content it no longer references.
+    void set_catalog(std::shared_ptr<const Catalog> catalog);
+
+    /// Number of GOP indexes currently mapped.
+    std::size_t cached_indexes() const;
+
+    /// Content hashes of the GOP indexes currently mapped, or being built.
+    std::vector<ContentHash> cached_index_hashes() const;
+
+private:
+    static constexpr std::size_t kShards = 16;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<ContentHash, std::shared_future<std::shared_ptr<const GopIndex>>> indexes;
+    };
+
+    Shard& shard_of(const ContentHash& hash) noexcept { return shards_[hash.bytes[0] % kShards]; }
+
+    rcu::Cell<std::shared_ptr<const Catalog>> catalog_;
+    Shard shards_[kShards];
+    SegmentCache segments_;
+};
+
+/// One virtual channel: a named schedule on the shared library.
+class Channel {
+public:
+    Channel(std::uint32_t id, std::string name, std::shared_ptr<const Catalog> catalog, SchedulePlan plan,
+            SpliceFinder splices = {})
+        : id_(id), name_(std::move(name)), scheduler_(std::move(catalog), std::move(plan), std::move(splices))
+    {
+    }
+
+    /// Dense index within the station; stable for the process lifetime.
+    std::uint32_t id() const noexcept { return id_; }
+    const std::string& name() const noexcept { return name_; }
+    Scheduler& scheduler() noexcept { return scheduler_; }
+    const Scheduler& scheduler() const noexcept { return scheduler_; }
+
+private:
+    std::uint32_t id_;
+    std::string name_;
+    Scheduler scheduler_;
+};
+
+/// Many channels in one process over one Library, so themed channels cost
+/// a timeline each instead of a second copy of every mapping and cache.
+///
+/// Channels are added during start-up, before lookups begin; after that
+/// the channel set is read-only and lookups take no locks.
+class Station {
+public:
+    explicit Station(std::shared_ptr<const Catalog> catalog, std::size_t segment_budget = kDefaultSegmentBudget);
+
+    Library& library() noexcept { return library_; }
+
+    /// Adds a channel and publishes its timeline from `from`. Breaks are
+    /// placed on clean splice points of the library's GOP indexes. Throws
+    /// std::invalid_argument if the name is taken.
+    Channel& add_channel(std::string name, SchedulePlan plan, Pts from);
+
+    /// Adds a channel with a timeline restored from a snapshot rather
+    /// than built; `entries` must come from this plan and catalog.
+    Channel& add_channel(std::string name, SchedulePlan plan, std::vector<TimelineEntry> entries);
+
+    /// nullptr for unknown names or ids.
+    Channel* channel(std::string_view name) noexcept;
+    Channel* channel(std::uint32_t id) noexcept { return id < channels_.size() ? channels_[id].get() : nullptr; }
+    std::size_t size() const noexcept { return channels_.size(); }
+
+    /// Rebuilds every channel from `from` on a new catalog generation.
+    void set_catalog(std::shared_ptr<const Catalog> catalog, Pts from);
+
+    /// Extends every channel's timeline, e.g. from a daily maintenance task.
+    void rebuild(Pts from);
+
+private:
+    Channel& emplace_channel(std::string name, SchedulePlan plan);
+
+    Library library_;
+    std::vector<std::unique_ptr<Channel>> channels_;
+};
+
+} // namespace seinfeld_tv
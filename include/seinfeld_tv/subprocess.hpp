@@ -0,0 +1,42 @@
+#pragma once
+
+#include "seinfeld_tv/posix.hpp"
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace seinfeld_tv {
+
+/// Child process spawned with posix_spawnp, optionally with its stdout
+/// connected to a pipe we read from (e.g. ffmpeg decoding to raw PCM).
+class Subprocess {
+public:
+    enum class Stdout { Inherit, Pipe, Null };
+
+    /// Throws std::system_error if the program cannot be started.
+    explicit Subprocess(const std::vector<std::string>& argv, Stdout out = Stdout::Null);
+    Subprocess(Subprocess&& other) noexcept;
+    Subprocess& operator=(Subprocess&&) = delete;
+    Subprocess(const Subprocess&) = delete;
+    Subprocess& operator=(const Subprocess&) = delete;
+    /// Kills and reaps the child if wait() was never called.
+    ~Subprocess();
+
+    /// Read end of the child's stdout, or -1.
+    int stdout_fd() const noexcept { return stdout_.get(); }
+
+    /// Closes our end of the pipe, reaps the child and returns its exit
+    /// status (128 + signal number if it was killed).
+    int wait();
+
+private:
+    pid_t pid_ = -1;
+    UniqueFd stdout_;
+};
+
+/// Runs `argv` to completion. Throws std::runtime_error on non-zero exit.
+void run_process(const std::vector<std::string>& argv);
+
+} // namespace seinfeld_tv
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace seinfeld_tv {
+
+namespace subtitle_format {
+
+static_assert(std::endian::native == std::endian::little, "subtitle indexes are little-endian");
+
+inline constexpr char kMagic[8] = {'S', 'T', 'V', 'S', 'U', 'B', 'I', 'X'};
+inline constexpr std::uint32_t kVersion = 1;
+inline constexpr std::uint32_t kSkipInterval = 64;
+
+/// Index layout: header, then CueRecord cues[cue_count] sorted by
+/// (episode_id, start_pts), TermRecord terms[term_count] sorted by term
+/// bytes, SkipEntry skips[skip_count], the postings blob, and a string
+/// table holding term spellings and cue text.
+///
+/// A term's postings are, for every cue containing it in ascending cue
+/// order: varint(cue - previous cue), varint(position count), then
+/// varint deltas of the term's word positions within the cue. Every
+/// kSkipInterval postings a SkipEntry records where the next posting
+/// starts, so intersections can jump over long lists of common words.
+struct SubtitleHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint64_t catalog_generation; ///< episode ids refer to this catalog
+    std::uint64_t file_size;
+    std::uint32_t cue_count;
+    std::uint32_t term_count;
+    std::uint64_t cues_offset;
+    std::uint64_t terms_offset;
+    std::uint64_t postings_offset;
+    std::uint64_t postings_size;
+    std::uint64_t strings_offset;
+    std::uint64_t strings_size;
+    std::uint64_t skips_offset;
+    std::uint32_t skip_count;
+    std::uint8_t reserved[28];
+};
+static_assert(sizeof(SubtitleHeader) == 128);
+
+/// CueRecord::flags
+inline constexpr std::uint32_t kCueClip = 1u << 0; ///< a catalog clip label, not dialogue
+
+struct CueRecord {
+    Pts start_pts;
+    Pts end_pts;
+    std::uint32_t episode_id;
+    std::uint32_t text_offset;
+    std::uint32_t text_length;
+    std::uint32_t flags;
+};
+static_assert(sizeof(CueRecord) == 32);
+
+struct TermRecord {
+    std::uint32_t string_offset;
+    std::uint32_t string_length;
+    std::uint32_t cue_count;
+    std::uint32_t postings_size;
+    std::uint64_t postings_offset;
+    std::uint32_t first_skip;  ///< (cue_count - 1) / kSkipInterval entries
+    std::uint32_t reserved;
+};
+static_assert(sizeof(TermRecord) == 32);
+
+/// Resume point before posting (k + 1) * kSkipInterval of a term.
+struct SkipEntry {
+    std::uint32_t last_cue;    ///< cue of the posting just before it
+    std::uint32_t byte_offset; ///< relative to the term's postings
+};
+static_assert(sizeof(SkipEntry) == 8);
+
+} // namespace subtitle_format
+
+/// One timed subtitle line.
+struct SubtitleCue {
+    Pts start_pts = 0;
+    Pts end_pts = 0;
+    std::string text;
+};
+
+/// Parses SubRip text. Markup tags are stripped and multi-line cues are
+/// joined with spaces; malformed blocks are skipped.
+std::vector<SubtitleCue> parse_srt(std::string_view srt);
+
+/// Search terms of `text`: ASCII letter and digit runs, lowercased, with
+/// apostrophes dropped so "don't" and "dont" match.
+std::vector<std::string> subtitle_terms(std::string_view text);
+
+struct SubtitleHit {
+    EpisodeId episode = kInvalidEpisode;
+    Pts start_pts = 0;
+    Pts end_pts = 0;
+    std::string_view text; ///< the matching line, valid while the index lives
+    bool clip = false;
+};
+
+/// Memory-mapped inverted index over subtitle lines and clip labels,
+/// stored as `<catalog>.subs` beside the catalog it was built from.
+class SubtitleIndex {
+public:
+    static std::filesystem::path path_for(const std::filesystem::path& catalog);
+
+    /// Maps and validates the index. Throws std::runtime_error if malformed.
+    explicit SubtitleIndex(const std::filesystem::path& path);
+
+    std::uint64_t catalog_generation() const noexcept { return header_->catalog_generation; }
+    std::size_t cue_count() const noexcept { return cues_.size(); }
+    std::size_t term_count() const noexcept { return terms_.size(); }
+
+    /// Cues containing the terms of `phrase` consecutively, in (episode,
+    /// time) order, at most `limit` of them. Phrases do not span cues.
+    std::vector<SubtitleHit> search(std::string_view phrase, std::size_t limit = 50) const;
+
+private:
+    const subtitle_format::TermRecord* find_term(std::string_view term) const noexcept;
+    std::string_view string_at(std::uint32_t offset, std::uint32_t length) const noexcept
+    {
+        return {strings_ + offset, length};
+    }
+
+    MappedFile file_;
+    const subtitle_format::SubtitleHeader* header_ = nullptr;
+    std::span<const subtitle_format::CueRecord> cues_;
+    std::span<const subtitle_format::TermRecord> terms_;
+    std::span<const subtitle_format::SkipEntry> skips_;
+    const std::uint8_t* postings_ = nullptr;
+    const char* strings_ = nullptr;
+};
+
+/// Offline writer for subtitle indexes.
+class SubtitleIndexBuilder {
+public:
+    void add_cues(EpisodeId episode, std::span<const SubtitleCue> cues);
+    /// Indexes every clip label of `catalog` as a cue spanning the clip.
+    void add_clips(const Catalog& catalog);
+
+    /// Writes the index atomically, recording the catalog generation.
+    void write(const std::filesystem::path& path, std::uint64_t catalog_generation) const;
+
+private:
+    struct Pending {
+        EpisodeId episode;
+        std::uint32_t flags;
+        SubtitleCue cue;
+    };
+    std::vector<Pending> cues_;
+};
+
+} // namespace seinfeld_tv
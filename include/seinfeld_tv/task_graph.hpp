@@ -0,0 +1,98 @@
+#pragma once
+
+#include "seinfeld_tv/thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Aggregate timing for every node that ran under one stage name.
+struct StageStats {
+    std::string name;
+    std::uint64_t tasks = 0;
+    std::chrono::nanoseconds busy{0};  ///< summed task run time
+    std::chrono::nanoseconds longest{0};
+    std::chrono::steady_clock::time_point first_start{};
+    std::chrono::steady_clock::time_point last_end{};
+};
+
+/// Dependency graph of tasks executed on a WorkStealingPool.
+///
+/// Nodes may be added before `run()` or, from inside a running node, as
+/// children of that node's successors (`add_child`): this lets an
+/// indexing task fan out into per-chunk work discovered only at run time,
+/// with the join node still waiting for every chunk. If a node throws, the
+/// remaining nodes are skipped and `run()` rethrows the first exception.
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+    using Progress = std::function<void(std::uint64_t done, std::uint64_t total)>;
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    NodeId add(std::string_view stage, std::function<void()> fn);
+
+    /// `after` does not start until `before` has finished.
+    void precede(NodeId before, NodeId after);
+
+    /// From inside a running node: adds a node that `join` waits for. The
+    /// caller must itself precede `join`, which keeps `join` from becoming
+    /// ready before the child is registered.
+    NodeId add_child(std::string_view stage, std::function<void()> fn, NodeId join);
+
+    /// Called (from a worker) after each completed node, at most every
+    /// `interval`.
+    void on_progress(Progress fn, std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+
+    void run(WorkStealingPool& pool);
+
+    /// Per-stage timings, in order of first appearance. Valid after run().
+    std::vector<StageStats> stats() const;
+
+private:
+    struct Node final : PoolTask {
+        void run() override;
+
+        TaskGraph* graph = nullptr;
+        std::function<void()> fn;
+        std::size_t stage = 0;
+        std::atomic<std::uint32_t> pending{0};
+        std::vector<Node*> successors;
+        std::chrono::steady_clock::time_point start{};
+        std::chrono::steady_clock::time_point end{};
+    };
+
+    NodeId add_locked(std::string_view stage, std::function<void()> fn);
+    void finished(Node& n);
+
+    mutable std::mutex mutex_; ///< guards node/stage allocation, never held while running tasks
+    std::deque<Node> nodes_;
+    std::vector<std::string> stages_;
+    WorkStealingPool* pool_ = nullptr;
+
+    std::atomic<std::uint64_t> remaining_{0};
+    std::atomic<std::uint64_t> done_{0};
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    bool complete_ = false;
+    std::atomic<bool> failed_{false};
+    std::exception_ptr error_;
+
+    Progress progress_;
+    std::chrono::milliseconds progress_interval_{1000};
+    std::atomic<std::int64_t> next_progress_ns_{0};
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "seinfeld_tv/ws_deque.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Unit of work scheduled on a WorkStealingPool. The pool never owns tasks;
+/// whoever submits one keeps it alive until it has run.
+class PoolTask {
+public:
+    virtual ~PoolTask() = default;
+    virtual void run() = 0;
+};
+
+/// Fixed set of workers, each with its own Chase-Lev deque.
+///
+/// Tasks submitted from a worker go to the bottom of that worker's deque
+/// (LIFO, cache-warm); idle workers steal from the top of a random victim
+/// (FIFO, so thieves take the oldest and usually largest pieces of work).
+/// Tasks submitted from outside the pool land in a shared injection queue.
+/// Workers park on an atomic wait when there is nothing to steal.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(PoolTask* task);
+
+    unsigned size() const noexcept { return static_cast<unsigned>(workers_.size()); }
+
+    /// Index of the calling worker in this pool, or -1 for outside threads.
+    int current_worker() const noexcept;
+
+private:
+    struct alignas(64) Worker {
+        WsDeque<PoolTask> deque;
+        std::thread thread;
+    };
+
+    void worker_loop(unsigned index);
+    PoolTask* find_work(unsigned index, std::uint64_t& rng) noexcept;
+    void notify() noexcept;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex inject_mutex_;
+    std::deque<PoolTask*> injected_;
+    std::atomic<std::size_t> injected_count_{0};
+    alignas(64) std::atomic<std::uint32_t> signal_{0};
+    std::atomic<unsigned> sleepers_{0};
+    std::atomic<bool> stop_{false};
+};
+
+} // namespace seinfeld_tv
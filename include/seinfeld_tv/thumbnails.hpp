@@ -0,0 +1,133 @@
+#pragma once
+
+#include "seinfeld_tv/ladder.hpp"
+#include "seinfeld_tv/media_time.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Decoder ffmpeg is asked to use for thumbnails.
+enum class HwDecode : std::uint8_t {
+    None,  ///< software decode and scale
+    Cuda,  ///< NVDEC decode, scale_cuda
+    Vaapi, ///< VA-API decode, scale_vaapi
+};
+
+/// Keyframes of one source to decode: `input` holds the source's init
+/// bytes and then whole GOPs, each of which contributes the one keyframe
+/// it starts with.
+struct FrameJob {
+    std::filesystem::path input;
+    std::size_t keyframes = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/// `count` RGB24 frames of width x height, back to back.
+struct FrameBatch {
+    int width = 0;
+    int height = 0;
+    std::size_t count = 0;
+    std::vector<std::uint8_t> rgb;
+
+    std::size_t frame_bytes() const noexcept { return static_cast<std::size_t>(width) * height * 3; }
+    const std::uint8_t* frame(std::size_t i) const noexcept { return rgb.data() + i * frame_bytes(); }
+};
+
+/// Decodes and scales keyframes. Called concurrently from pool workers;
+/// implementations must be thread-safe.
+class FrameDecoder {
+public:
+    virtual ~FrameDecoder() = default;
+    /// Throws if the input does not yield exactly `job.keyframes` frames.
+    virtual FrameBatch decode(const FrameJob& job) = 0;
+    /// Why decodes fell back from hardware to software; empty if they
+    /// did not.
+    virtual std::string fallback_reason() const { return {}; }
+};
+
+/// Shells out to `ffmpeg` with `-skip_frame nokey`, so only keyframes
+/// are decoded, and pipes back raw scaled RGB. With a hardware decoder,
+/// frames are scaled on the GPU and only the small tiles are
+/// downloaded. The first hardware failure switches the decoder to
+/// software for good, so a host without the GPU or driver still
+/// finishes the run.
+class FfmpegFrameDecoder final : public FrameDecoder {
+public:
+    explicit FfmpegFrameDecoder(std::string ffmpeg = "ffmpeg", HwDecode hw = HwDecode::None,
+                                std::string vaapi_device = "/dev/dri/renderD128");
+
+    FrameBatch decode(const FrameJob& job) override;
+    std::string fallback_reason() const override;
+
+    /// Whether decodes still go to the hardware decoder.
+    bool hardware() const noexcept { return hw_ != HwDecode::None && !hw_failed_.load(std::memory_order_relaxed); }
+
+private:
+    FrameBatch run(const FrameJob& job, HwDecode hw) const;
+
+    std::string ffmpeg_;
+    HwDecode hw_;
+    std::string vaapi_device_;
+    std::atomic<bool> hw_failed_{false};
+    mutable std::mutex fallback_mutex_;
+    std::string fallback_reason_; ///< the first hardware failure
+};
+
+/// Baseline JPEG of an RGB24 image. Throws std::runtime_error when built
+/// without libjpeg.
+std::vector<std::byte> encode_jpeg(const std::uint8_t* rgb, int width, int height, int quality);
+
+struct ThumbnailOptions {
+    /// Outputs go to `<output_dir>/<content hash>/thumbs-<W>x<H>-<interval>s/`:
+    /// sprite-NNN.jpg sheets and thumbs.vtt, which maps each interval to
+    /// its tile as `sprite-NNN.jpg#xywh=x,y,w,h`. A directory whose
+    /// thumbs.vtt exists is complete and skipped.
+    std::filesystem::path output_dir;
+    Pts interval = 10 * kPtsPerSecond;
+    /// Tile size; frames are scaled to exactly this.
+    int width = 160;
+    int height = 90;
+    /// Tiles per sprite sheet.
+    int columns = 10;
+    int rows = 10;
+    int quality = 75;
+    /// Keyframes decoded per FrameDecoder call: large enough that process
+    /// and GPU context start-up is amortised, small enough that one long
+    /// episode still spreads over several workers.
+    std::size_t batch = 64;
+};
+
+struct ThumbnailReport {
+    std::vector<StageStats> stages;
+    std::chrono::nanoseconds wall{0};
+    std::uint64_t tasks = 0;
+    std::uint64_t sheets = 0;
+    std::uint64_t skipped = 0; ///< sources whose thumbnails already existed
+    std::string fallback;      ///< FrameDecoder::fallback_reason() after the run
+    unsigned workers = 0;
+};
+
+/// Builds scrubbing thumbnails and sprite sheets for `sources` as one task
+/// graph on `pool`:
+///
+///   index(episode) --> decode(batch) x N --> pack
+///
+/// The GOP index picks, for each interval, the GOP it falls in; only the
+/// bytes of those GOPs are copied out for the decoder, and only their
+/// first frame is decoded. A GOP spanning several intervals is decoded
+/// once. Progress and per-stage timings are appended to `log` when
+/// non-null.
+ThumbnailReport build_thumbnails(std::span<const LadderSource> sources, FrameDecoder& decoder,
+                                 WorkStealingPool& pool, const ThumbnailOptions& options, ReportLog* log = nullptr);
+
+} // namespace seinfeld_tv
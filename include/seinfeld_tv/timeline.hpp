@@ -0,0 +1,81 @@
+#pragma once
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/media_time.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// One airing: `episode_id` plays source range [in_pts, out_pts) starting at
+/// channel time `start_pts`. Channel time is 90 kHz ticks since the Unix
+/// epoch so every node derives the same position from the wall clock.
+struct TimelineEntry {
+    Pts start_pts;
+    EpisodeId episode_id;
+    std::uint32_t flags;
+    Pts in_pts;
+    Pts out_pts;
+
+    Pts duration() const noexcept { return out_pts - in_pts; }
+    Pts end_pts() const noexcept { return start_pts + duration(); }
+};
+static_assert(sizeof(TimelineEntry) == 32);
+
+/// Current channel time from the system clock.
+inline Pts channel_time_now() noexcept
+{
+    const auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    // 90 kHz is 9 ticks per 100 us.
+    return std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count() * 9 / 100;
+}
+
+/// Entry flags.
+inline constexpr std::uint32_t kEntryClip = 1u << 0;       ///< range is a catalog clip, not a full episode
+inline constexpr std::uint32_t kEntryTruncated = 1u << 1;  ///< cut short to honour the next block
+inline constexpr std::uint32_t kEntrySplit = 1u << 2;      ///< part of an episode split by a break
+inline constexpr std::uint32_t kEntryBreak = 1u << 3;      ///< bumper or ad airing in a break
+
+/// Where the channel is at a given instant.
+struct TimelinePosition {
+    TimelineEntry entry;
+    std::size_t index;
+    Pts offset; ///< ticks since entry.start_pts
+
+    Pts source_pts() const noexcept { return entry.in_pts + offset; }
+};
+
+/// Immutable, precomputed schedule for a window of channel time.
+///
+/// Entries are contiguous and sorted; a Timeline is built off the hot path
+/// and published whole, so readers only ever binary-search a flat array.
+/// It keeps the catalog generation it was built from alive.
+class Timeline {
+public:
+    Timeline(std::shared_ptr<const Catalog> catalog, std::vector<TimelineEntry> entries)
+        : catalog_(std::move(catalog)), entries_(std::move(entries))
+    {
+    }
+
+    const Catalog& catalog() const noexcept { return *catalog_; }
+    const std::shared_ptr<const Catalog>& catalog_ptr() const noexcept { return catalog_; }
+    std::span<const TimelineEntry> entries() const noexcept { return entries_; }
+
+    Pts begin_pts() const noexcept { return entries_.empty() ? 0 : entries_.front().start_pts; }
+    Pts end_pts() const noexcept { return entries_.empty() ? 0 : entries_.back().end_pts(); }
+
+    /// Index of the entry airing at `t`, if any.
+    std::optional<std::size_t> index_at(Pts t) const noexcept;
+    std::optional<TimelinePosition> at(Pts t) const noexcept;
+
+private:
+    std::shared_ptr<const Catalog> catalog_;
+    std::vector<TimelineEntry> entries_;
+};
+
+} // namespace seinfeld_tv
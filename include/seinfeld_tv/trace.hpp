@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+/// Low-overhead event tracing for the hot paths.
+///
+/// Every thread records into its own fixed ring of 32-byte events with
+/// plain stores and one release store per event: no locks, no allocation
+/// after the thread's first event, and no cache line shared with other
+/// writers. When the ring is full the oldest events are overwritten, so a
+/// dump always shows the most recent stretch leading up to a stall.
+/// Timestamps are raw TSC reads on x86 (steady_clock elsewhere), scaled
+/// to microseconds only on export.
+///
+/// Names are "<category>.<event>" string literals; only the pointer is
+/// stored. Tracing is off until enable(true), and a disabled probe is one
+/// relaxed load.
+namespace seinfeld_tv::trace {
+
+/// Events kept per thread.
+inline constexpr std::size_t kRingEvents = std::size_t{1} << 14;
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+void enable(bool on) noexcept;
+
+/// Names the calling thread in exported traces.
+void set_thread_name(std::string_view name);
+
+/// Raw timestamp for complete().
+std::uint64_t now() noexcept;
+
+/// Records a span that began at `begin` and ends now.
+void complete(const char* name, std::uint64_t begin, std::uint64_t arg = 0) noexcept;
+/// Records a point event.
+void instant(const char* name, std::uint64_t arg = 0) noexcept;
+/// As complete(), for spans that cross coroutine suspensions and so may
+/// overlap others on the same thread; exported as an async pair.
+void async(const char* name, std::uint64_t begin, std::uint64_t arg = 0) noexcept;
+
+/// Records [construction, destruction) as one event.
+class Span {
+public:
+    explicit Span(const char* name, std::uint64_t arg = 0) noexcept
+        : name_(name), arg_(arg), begin_(enabled() ? now() : 0)
+    {
+    }
+    ~Span()
+    {
+        if (begin_)
+            complete(name_, begin_, arg_);
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    void set_arg(std::uint64_t arg) noexcept { arg_ = arg; }
+
+private:
+    const char* name_;
+    std::uint64_t arg_;
+    std::uint64_t begin_;
+};
+
+/// Span that may be suspended across, e.g. inside a coroutine.
+class AsyncSpan {
+public:
+    explicit AsyncSpan(const char* name, std::uint64_t arg = 0) noexcept
+        : name_(name), arg_(arg), begin_(enabled() ? now() : 0)
+    {
+    }
+    ~AsyncSpan()
+    {
+        if (begin_)
+            async(name_, begin_, arg_);
+    }
+    AsyncSpan(const AsyncSpan&) = delete;
+    AsyncSpan& operator=(const AsyncSpan&) = delete;
+
+    void set_arg(std::uint64_t arg) noexcept { arg_ = arg; }
+
+private:
+    const char* name_;
+    std::uint64_t arg_;
+    std::uint64_t begin_;
+};
+
+/// Every thread's buffered events as Chrome trace-event JSON, which
+/// chrome://tracing and Perfetto both load. Safe to call while threads
+/// keep recording; events overwritten mid-copy are left out.
+std::string export_chrome_json();
+
+/// export_chrome_json() written to `path` atomically.
+void write_chrome_json(const std::filesystem::path& path);
+
+} // namespace seinfeld_tv::trace
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "seinfeld_tv/media_time.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Rendition::height that keeps the source's frame size.
+inline constexpr int kSourceHeight = -1;
+
+/// One rung of the ABR ladder.
+struct Rendition {
+    std::string name;     ///< also the output file stem, e.g. "720p"
+    int height = 0;       ///< 0 for audio-only, kSourceHeight to keep the source's
+    int video_kbps = 0;
+    int audio_kbps = 128;
+
+    bool audio_only() const noexcept { return height == 0; }
+};
+
+/// 1080p / 720p / 480p / audio-only.
+std::vector<Rendition> default_ladder();
+
+/// Encode of one GOP-aligned chunk of a source into one rendition.
+struct ChunkJob {
+    std::filesystem::path source;
+    Pts start_pts = 0;
+    Pts end_pts = 0;
+    const Rendition* rendition = nullptr;
+    std::filesystem::path output;
+    float gain_db = 0; ///< loudness normalization applied to the audio
+};
+
+/// Does the actual encoding. Implementations are called concurrently from
+/// pool workers and must be thread-safe; each call should use a single
+/// core, since the pipeline gets its parallelism from running many chunks.
+class TranscodeBackend {
+public:
+    virtual ~TranscodeBackend() = default;
+    virtual void encode_chunk(const ChunkJob& job) = 0;
+    /// Joins chunk outputs, in order, into one rendition file.
+    virtual void concat(const std::vector<std::filesystem::path>& chunks, const std::filesystem::path& output) = 0;
+};
+
+/// Backend that shells out to `ffmpeg` (libx264/AAC into MPEG-TS), one
+/// single-threaded process per chunk.
+class FfmpegBackend final : public TranscodeBackend {
+public:
+    explicit FfmpegBackend(std::string ffmpeg = "ffmpeg") : ffmpeg_(std::move(ffmpeg)) {}
+
+    void encode_chunk(const ChunkJob& job) override;
+    void concat(const std::vector<std::filesystem::path>& chunks, const std::filesystem::path& output) override;
+
+private:
+    std::string ffmpeg_;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "seinfeld_tv/ts_packet.hpp"
+
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+
+namespace seinfeld_tv {
+
+/// One reassembled PES packet of the video or audio elementary stream.
+struct PesPacket {
+    std::uint16_t pid = 0;
+    std::uint8_t stream_type = 0;
+    std::uint8_t stream_id = 0;
+    std::int64_t pts = -1; ///< raw 33-bit value, -1 if absent
+    std::int64_t dts = -1;
+    bool random_access = false;
+    std::uint64_t offset = 0; ///< input offset of the packet that started it
+    std::pmr::vector<std::uint8_t> payload;
+
+    explicit PesPacket(std::pmr::memory_resource* mr) : payload(mr) {}
+};
+
+/// Reassembles the first program's video and audio PES packets from a run
+/// of TS packets (typically one segment, which starts with PAT/PMT).
+///
+/// All storage, including each payload, comes from the memory resource
+/// given at construction. Pair it with a SegmentArena: demux a segment,
+/// mux it, send it, then `clear()` and reset the arena, so the hundreds of
+/// per-packet buffers cost a handful of pointer bumps and one reset.
+class TsDemuxer {
+public:
+    explicit TsDemuxer(std::pmr::memory_resource* mr = std::pmr::get_default_resource());
+
+    /// Feeds whole 188-byte packets; `base_offset` is the file offset of
+    /// the first one. Throws std::runtime_error on lost sync.
+    void feed(std::span<const std::byte> packets, std::uint64_t base_offset = 0);
+
+    /// Completes any PES still being assembled.
+    void flush();
+
+    const ts::ProgramMap& program() const noexcept { return program_; }
+    std::pmr::vector<PesPacket>& packets() noexcept { return packets_; }
+
+    /// Drops all packets (keeping the program map) so the arena backing
+    /// them can be reset.
+    void clear() noexcept;
+
+private:
+    void on_packet(const ts::Packet& pkt, std::uint64_t offset);
+
+    std::pmr::memory_resource* mr_;
+    ts::ProgramMap program_;
+    std::uint16_t pmt_pid_ = ts::kNullPid;
+    std::pmr::vector<PesPacket> packets_;
+    /// Index into packets_ of the PES being assembled per stream, or -1.
+    std::ptrdiff_t open_video_ = -1;
+    std::ptrdiff_t open_audio_ = -1;
+    std::size_t last_video_size_ = 0;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "seinfeld_tv/container.hpp"
+#include "seinfeld_tv/media_time.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+/// MPEG-2 transport stream packet, PSI and PES header parsing shared by the
+/// GOP scanner and the demuxer. Everything here works on a single 188-byte
+/// packet in place.
+namespace seinfeld_tv::ts {
+
+inline constexpr std::uint8_t kSyncByte = 0x47;
+inline constexpr std::uint16_t kPatPid = 0x0000;
+inline constexpr std::uint16_t kNullPid = 0x1fff;
+inline constexpr std::int64_t kPtsWrap = std::int64_t{1} << 33;
+
+inline std::uint8_t u8(const std::byte* p) noexcept
+{
+    return std::to_integer<std::uint8_t>(*p);
+}
+
+inline std::uint16_t u16(const std::byte* p) noexcept
+{
+    return static_cast<std::uint16_t>(u8(p) << 8 | u8(p + 1));
+}
+
+inline bool is_video_stream_type(std::uint8_t type) noexcept
+{
+    return type == 0x1b    // H.264
+        || type == 0x24    // HEVC
+        || type == 0x02;   // MPEG-2 video
+}
+
+inline bool is_audio_stream_type(std::uint8_t type) noexcept
+{
+    return type == 0x0f    // AAC ADTS
+        || type == 0x03 || type == 0x04 // MPEG audio
+        || type == 0x81;   // AC-3
+}
+
+struct Packet {
+    std::uint16_t pid;
+    bool payload_start;
+    bool random_access;
+    std::uint8_t continuity;
+    const std::byte* payload;
+    std::size_t payload_size;
+};
+
+/// Returns nullopt if `p` does not start with a sync byte.
+inline std::optional<Packet> parse_packet(const std::byte* p) noexcept
+{
+    if (u8(p) != kSyncByte)
+        return std::nullopt;
+    Packet pkt{};
+    pkt.payload_start = (u8(p + 1) & 0x40) != 0;
+    pkt.pid = static_cast<std::uint16_t>((u8(p + 1) & 0x1f) << 8 | u8(p + 2));
+    pkt.continuity = u8(p + 3) & 0x0f;
+    const unsigned afc = (u8(p + 3) >> 4) & 0x3;
+    std::size_t header = 4;
+    if (afc & 0x2) {
+        const std::size_t af_len = u8(p + 4);
+        if (af_len > 0)
+            pkt.random_access = (u8(p + 5) & 0x40) != 0;
+        header += 1 + af_len;
+    }
+    if (!(afc & 0x1) || header >= kTsPacketSize)
+        return pkt;
+    pkt.payload = p + header;
+    pkt.payload_size = kTsPacketSize - header;
+    return pkt;
+}
+
+/// Returns the section following the pointer field, bounded by the section
+/// length, or an empty span if it does not fit in this packet.
+inline std::span<const std::byte> psi_section(const Packet& pkt) noexcept
+{
+    if (!pkt.payload_start || pkt.payload_size < 1)
+        return {};
+    const std::size_t pointer = u8(pkt.payload);
+    if (1 + pointer + 3 > pkt.payload_size)
+        return {};
+    const std::byte* s = pkt.payload + 1 + pointer;
+    const std::size_t length = 3 + (u16(s + 1) & 0x0fff);
+    if (1 + pointer + length > pkt.payload_size)
+        return {};
+    return {s, length};
+}
+
+/// PMT PID of the first program in a PAT section.
+inline std::optional<std::uint16_t> parse_pat(std::span<const std::byte> s) noexcept
+{
+    // Program loop starts after the 8-byte section header, ends before CRC.
+    for (std::size_t at = 8; s.size() >= 12 && at + 4 <= s.size() - 4; at += 4)
+        if (u16(&s[at]) != 0)
+            return u16(&s[at + 2]) & 0x1fff;
+    return std::nullopt;
+}
+
+struct ProgramMap {
+    std::uint16_t video_pid = 0;
+    std::uint8_t video_type = 0;
+    std::uint16_t audio_pid = 0;
+    std::uint8_t audio_type = 0;
+
+    bool has_video() const noexcept { return video_type != 0; }
+};
+
+/// First video and first audio elementary stream of a PMT section.
+inline ProgramMap parse_pmt(std::span<const std::byte> s) noexcept
+{
+    ProgramMap map;
+    if (s.size() < 16)
+        return map;
+    std::size_t at = 12 + (u16(&s[10]) & 0x0fff);
+    while (at + 5 <= s.size() - 4) {
+        const std::uint8_t type = u8(&s[at]);
+        const std::uint16_t pid = u16(&s[at + 1]) & 0x1fff;
+        if (!map.video_type && is_video_stream_type(type)) {
+            map.video_pid = pid;
+            map.video_type = type;
+        } else if (!map.audio_type && is_audio_stream_type(type)) {
+            map.audio_pid = pid;
+            map.audio_type = type;
+        }
+        at += 5 + (u16(&s[at + 3]) & 0x0fff);
+    }
+    return map;
+}
+
+inline std::int64_t read_timestamp(const std::byte* t) noexcept
+{
+    return (std::int64_t(u8(t) & 0x0e) << 29) | (std::int64_t(u8(t + 1)) << 22)
+        | (std::int64_t(u8(t + 2) & 0xfe) << 14) | (std::int64_t(u8(t + 3)) << 7)
+        | (std::int64_t(u8(t + 4)) >> 1);
+}
+
+struct PesHeader {
+    std::uint8_t stream_id;
+    std::optional<std::int64_t> pts; ///< raw 33-bit
+    std::optional<std::int64_t> dts;
+    std::size_t header_size;         ///< bytes before the elementary stream
+};
+
+/// Parses the PES header at the start of a payload_start packet.
+inline std::optional<PesHeader> parse_pes_header(const Packet& pkt) noexcept
+{
+    const std::byte* p = pkt.payload;
+    if (!pkt.payload_start || pkt.payload_size < 9)
+        return std::nullopt;
+    if (u8(p) != 0 || u8(p + 1) != 0 || u8(p + 2) != 1)
+        return std::nullopt;
+    PesHeader h{};
+    h.stream_id = u8(p + 3);
+    h.header_size = 9 + std::size_t{u8(p + 8)};
+    if (h.header_size > pkt.payload_size)
+        return std::nullopt;
+    const unsigned flags = u8(p + 7) >> 6;
+    if ((flags & 0x2) && h.header_size >= 14)
+        h.pts = read_timestamp(p + 9);
+    if (flags == 0x3 && h.header_size >= 19)
+        h.dts = read_timestamp(p + 14);
+    return h;
+}
+
+/// Maps 33-bit wrapping timestamps onto a monotonic timeline whose origin
+/// is the first value seen.
+class PtsUnwrapper {
+public:
+    Pts operator()(std::int64_t raw) noexcept
+    {
+        if (!have_first_) {
+            have_first_ = true;
+            first_ = last_ = raw;
+        }
+        std::int64_t delta = raw - (last_ % kPtsWrap);
+        if (delta < -kPtsWrap / 2)
+            delta += kPtsWrap;
+        else if (delta > kPtsWrap / 2)
+            delta -= kPtsWrap;
+        last_ += delta;
+        return last_ - first_;
+    }
+
+private:
+    bool have_first_ = false;
+    std::int64_t first_ = 0;
+    std::int64_t last_ = 0;
+};
+
+} // namespace seinfeld_tv::ts
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include <linux/io_uring.h>
+
+namespace seinfeld_tv {
+
+/// Result slot of one submitted operation: the coroutine to resume and the
+/// CQE result once it arrives. Its address is the SQE's user_data.
+struct Completion {
+    std::coroutine_handle<> waiter;
+    std::int32_t result = 0;
+    std::uint32_t flags = 0;
+};
+
+/// user_data of SQEs whose completions are ignored (linked timeouts,
+/// fire-and-forget cancels).
+inline constexpr std::uint64_t kIgnoredCompletion = 0;
+
+/// A single io_uring instance, driven from one thread.
+///
+/// Talks to the kernel through the raw syscalls and the mmapped SQ/CQ
+/// rings, so there is no liburing dependency. Not thread-safe: the
+/// intended use is one ring per core, each owned by its own thread.
+class Ring {
+public:
+    explicit Ring(unsigned entries);
+    ~Ring();
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    /// A zeroed SQE, submitting queued ones first if fewer than `room`
+    /// slots are free (operations with a linked timeout need two adjacent).
+    io_uring_sqe* sqe(unsigned room = 1);
+
+    /// Submits queued SQEs and waits for at least `wait_for` completions.
+    /// EINTR is not an error; returns early with nothing to reap.
+    void submit(unsigned wait_for = 0);
+
+    /// Resumes the coroutine of every available completion. Returns how
+    /// many CQEs were consumed.
+    unsigned dispatch();
+
+    int fd() const noexcept { return fd_; }
+    std::uint32_t features() const noexcept { return features_; }
+
+private:
+    void unmap() noexcept;
+
+    int fd_ = -1;
+    std::uint32_t features_ = 0;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqes_size_ = 0;
+
+    std::uint32_t* sq_head_ = nullptr;
+    std::uint32_t* sq_tail_ = nullptr;
+    std::uint32_t sq_mask_ = 0;
+    std::uint32_t sq_entries_ = 0;
+    std::uint32_t sqe_tail_ = 0;  ///< next SQE to hand out
+    std::uint32_t submitted_ = 0; ///< SQEs the kernel has consumed
+    std::uint32_t* cq_head_ = nullptr;
+    std::uint32_t* cq_tail_ = nullptr;
+    std::uint32_t cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+/// Awaitable for one prepared SQE; `co_await` yields the CQE result
+/// (negative errno on failure). The SQE goes to the kernel on the next
+/// Ring::submit. The Completion lives in the awaiting coroutine's frame,
+/// so the coroutine must not be destroyed while the operation is pending.
+class RingOp {
+public:
+    explicit RingOp(io_uring_sqe* sqe) noexcept : sqe_(sqe) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept
+    {
+        done_.waiter = h;
+        sqe_->user_data = reinterpret_cast<std::uint64_t>(&done_);
+    }
+    std::int32_t await_resume() const noexcept { return done_.result; }
+
+private:
+    io_uring_sqe* sqe_;
+    Completion done_;
+};
+
+/// Operation builders. Buffers and timespecs must outlive the await.
+///
+/// A non-null `timeout` is a linked timeout: if the operation has not
+/// completed within it, the kernel cancels it and it finishes with
+/// -ECANCELED.
+namespace uring {
+
+RingOp accept(Ring& ring, int fd);
+RingOp recv(Ring& ring, int fd, void* buf, std::size_t len, const __kernel_timespec* timeout = nullptr);
+RingOp send(Ring& ring, int fd, const void* buf, std::size_t len, int flags,
+            const __kernel_timespec* timeout = nullptr);
+/// `off_in` of -1 reads at the current position (pipes, sockets).
+RingOp splice(Ring& ring, int fd_in, std::int64_t off_in, int fd_out, std::size_t len, unsigned flags,
+              const __kernel_timespec* timeout = nullptr);
+RingOp read(Ring& ring, int fd, void* buf, std::size_t len);
+/// Queues a read at `offset` that completes into `done`, for batches
+/// reaped with submit + dispatch outside a coroutine (`done.waiter` may be
+/// std::noop_coroutine()). `ioprio` is an IOPRIO_PRIO_VALUE; 0 inherits
+/// the submitting thread's.
+void read_at(Ring& ring, int fd, void* buf, std::size_t len, std::uint64_t offset, std::uint16_t ioprio,
+             Completion& done);
+RingOp close(Ring& ring, int fd);
+/// Completes with -ETIME once `ts` (relative) has elapsed.
+RingOp sleep(Ring& ring, const __kernel_timespec& ts);
+
+/// Queues a no-op whose completion resumes `done.waiter`, so a coroutine
+/// parked outside the ring is resumed from Ring::dispatch rather than from
+/// inside whoever wakes it.
+void post(Ring& ring, Completion& done);
+
+/// Cancels every pending operation on `fd`, or on the whole ring if `fd`
+/// is negative. Completion ignored.
+void cancel_all(Ring& ring, int fd = -1);
+
+} // namespace uring
+
+/// Fire-and-forget coroutine: starts eagerly, frees its frame when it
+/// finishes. Exceptions escaping the body terminate, so bodies catch.
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/// Lazily started coroutine returning T to the coroutine that awaits it,
+/// which resumes by symmetric transfer when it finishes.
+template <typename T>
+class [[nodiscard]] Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept
+        {
+            struct Resume {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                {
+                    return h.promise().continuation;
+                }
+                void await_resume() const noexcept {}
+            };
+            return Resume{};
+        }
+        void return_value(T v) { value.emplace(std::move(v)); }
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&&) = delete;
+    ~Task()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume()
+    {
+        auto& p = handle_.promise();
+        if (p.error)
+            std::rethrow_exception(p.error);
+        return std::move(*p.value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// LEB128 unsigned varints: 7 bits per byte, low groups first, high bit
+/// set on every byte but the last.
+namespace seinfeld_tv::varint {
+
+inline constexpr unsigned kMaxBytes = 10;
+
+inline void put(std::vector<std::uint8_t>& out, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+/// Decodes one varint from [p, end) and advances `p`. Returns false on
+/// truncated or over-long input, leaving `p` unspecified.
+inline bool get(const std::uint8_t*& p, const std::uint8_t* end, std::uint64_t& v) noexcept
+{
+    std::uint64_t result = 0;
+    for (unsigned shift = 0; shift < 7 * kMaxBytes && p < end; shift += 7) {
+        const std::uint8_t b = *p++;
+        result |= std::uint64_t{b & 0x7fu} << shift;
+        if (!(b & 0x80)) {
+            v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace seinfeld_tv::varint
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace seinfeld_tv {
+
+/// Chase-Lev work-stealing deque of pointers (Lê et al., "Correct and
+/// Efficient Work-Stealing for Weak Memory Models", PPoPP'13).
+///
+/// The owning thread pushes and pops at the bottom; any thread may steal
+/// from the top. Buffers grow by doubling; retired buffers are kept until
+/// the deque is destroyed, since a concurrent thief may still read them.
+template <typename T>
+class WsDeque {
+public:
+    explicit WsDeque(std::size_t capacity = 256)
+    {
+        std::size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+        buffers_.push_back(std::make_unique<Buffer>(cap));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    WsDeque(const WsDeque&) = delete;
+    WsDeque& operator=(const WsDeque&) = delete;
+
+    /// Owner only.
+    void push(T* item)
+    {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        Buffer* buf = buffer_.load(std::memory_order_relaxed);
+        if (b - t > static_cast<std::int64_t>(buf->mask)) {
+            buf = grow(buf, t, b);
+        }
+        buf->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /// Owner only. Returns nullptr when empty.
+    T* pop() noexcept
+    {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Buffer* buf = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = buf->get(b);
+        if (t == b) {
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /// Any thread. Returns nullptr when empty or when it lost a race.
+    T* steal() noexcept
+    {
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        Buffer* buf = buffer_.load(std::memory_order_acquire);
+        T* item = buf->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+    bool empty() const noexcept
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Buffer {
+        explicit Buffer(std::size_t cap) : mask(cap - 1), slots(cap) {}
+        void put(std::int64_t i, T* v) noexcept
+        {
+            slots[static_cast<std::size_t>(i) & mask].store(v, std::memory_order_relaxed);
+        }
+        T* get(std::int64_t i) const noexcept
+        {
+            return slots[static_cast<std::size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+        std::size_t mask;
+        std::vector<std::atomic<T*>> slots;
+    };
+
+    Buffer* grow(Buffer* old, std::int64_t t, std::int64_t b)
+    {
+        auto next = std::make_unique<Buffer>((old->mask + 1) * 2);
+        for (std::int64_t i = t; i < b; ++i)
+            next->put(i, old->get(i));
+        Buffer* raw = next.get();
+        buffers_.push_back(std::move(next));
+        buffer_.store(raw, std::memory_order_release);
+        return raw;
+    }
+
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<Buffer*> buffer_{nullptr};
+    std::vector<std::unique_ptr<Buffer>> buffers_; ///< owner-only
+};
+
+} // namespace seinfeld_tv
@@ -0,0 +1,206 @@
+#include "seinfeld_tv/arena.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// Blocks are cache-line aligned so the first packet in each one is too.
+constexpr std::size_t kBlockAlignment = 64;
+
+} // namespace
+
+BlockPool::BlockPool(std::size_t block_size, std::size_t max_cached)
+    : block_size_((block_size + kBlockAlignment - 1) & ~(kBlockAlignment - 1)), max_cached_(max_cached)
+{
+    free_.reserve(max_cached_);
+}
+
+BlockPool::~BlockPool()
+{
+    for (void* b : free_)
+        std::free(b);
+    for (const auto& runs : free_runs_)
+        for (void* r : runs)
+            std::free(r);
+}
+
+BlockPool& BlockPool::global()
+{
+    static BlockPool pool;
+    return pool;
+}
+
+void* BlockPool::acquire()
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (!free_.empty()) {
+            void* b = free_.back();
+            free_.pop_back();
+            return b;
+        }
+    }
+    void* b = std::aligned_alloc(kBlockAlignment, block_size_);
+    if (!b)
+        throw std::bad_alloc();
+    return b;
+}
+
+void BlockPool::release(void* block) noexcept
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (free_.size() < max_cached_) {
+            free_.push_back(block);
+            return;
+        }
+    }
+    std::free(block);
+}
+
+unsigned BlockPool::run_class(std::size_t bytes) const noexcept
+{
+    unsigned c = 0;
+    while (c < kRunClasses && (block_size_ << c) < bytes)
+        ++c;
+    return c;
+}
+
+void* BlockPool::acquire_run(unsigned run_class)
+{
+    if (run_class == 0)
+        return acquire();
+    {
+        std::lock_guard lock(mutex_);
+        auto& runs = free_runs_[run_class];
+        if (!runs.empty()) {
+            void* r = runs.back();
+            runs.pop_back();
+            return r;
+        }
+    }
+    void* r = std::aligned_alloc(kBlockAlignment, block_size_ << run_class);
+    if (!r)
+        throw std::bad_alloc();
+    return r;
+}
+
+void BlockPool::release_run(void* run, unsigned run_class) noexcept
+{
+    if (run_class == 0)
+        return release(run);
+    {
+        std::lock_guard lock(mutex_);
+        auto& runs = free_runs_[run_class];
+        if (runs.size() < (max_cached_ >> run_class)) {
+            runs.push_back(run);
+            return;
+        }
+    }
+    std::free(run);
+}
+
+std::size_t BlockPool::cached() const
+{
+    std::lock_guard lock(mutex_);
+    return free_.size();
+}
+
+SegmentArena::SegmentArena(BlockPool& pool, std::size_t retain_blocks, std::pmr::memory_resource* upstream)
+    : pool_(pool), upstream_(upstream), retain_blocks_(std::max<std::size_t>(retain_blocks, 1))
+{
+    blocks_.reserve(retain_blocks_);
+}
+
+SegmentArena::~SegmentArena()
+{
+    reset();
+    for (void* b : blocks_)
+        pool_.release(b);
+    for (const auto& r : runs_)
+        pool_.release_run(r.ptr, r.run_class);
+}
+
+void* SegmentArena::allocate_run(unsigned run_class)
+{
+    for (auto& r : runs_) {
+        if (!r.busy && r.run_class == run_class) {
+            r.busy = true;
+            return r.ptr;
+        }
+    }
+    runs_.reserve(runs_.size() + 1);
+    void* p = pool_.acquire_run(run_class);
+    runs_.push_back({p, run_class, true});
+    return p;
+}
+
+void* SegmentArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t block = pool_.block_size();
+    if (bytes > block / 2 || alignment > kBlockAlignment) {
+        const unsigned run_class = pool_.run_class(bytes);
+        used_ += bytes;
+        if (alignment <= kBlockAlignment && run_class < BlockPool::kRunClasses)
+            return allocate_run(run_class);
+        void* p = upstream_->allocate(bytes, alignment);
+        large_.push_back({p, bytes, alignment});
+        ++upstream_allocations_;
+        return p;
+    }
+
+    for (;;) {
+        if (current_ < blocks_.size()) {
+            const std::size_t aligned = (offset_ + alignment - 1) & ~(alignment - 1);
+            if (aligned + bytes <= block) {
+                used_ += aligned + bytes - offset_;
+                offset_ = aligned + bytes;
+                return static_cast<std::byte*>(blocks_[current_]) + aligned;
+            }
+            if (current_ + 1 < blocks_.size()) {
+                ++current_;
+                offset_ = 0;
+                continue;
+            }
+        }
+        blocks_.push_back(pool_.acquire());
+        current_ = blocks_.size() - 1;
+        offset_ = 0;
+    }
+}
+
+void SegmentArena::reset() noexcept
+{
+    for (const auto& l : large_)
+        upstream_->deallocate(l.ptr, l.bytes, l.alignment);
+    large_.clear();
+    while (blocks_.size() > retain_blocks_) {
+        pool_.release(blocks_.back());
+        blocks_.pop_back();
+    }
+    // Keep the largest runs first: a segment's big payloads are what recur.
+    std::sort(runs_.begin(), runs_.end(), [](const Run& a, const Run& b) { return a.run_class > b.run_class; });
+    std::size_t budget = retain_blocks_;
+    std::size_t kept = 0;
+    for (auto r : runs_) {
+        const std::size_t blocks = std::size_t{1} << r.run_class;
+        if (blocks > budget) {
+            pool_.release_run(r.ptr, r.run_class);
+            continue;
+        }
+        budget -= blocks;
+        r.busy = false;
+        runs_[kept++] = r;
+    }
+    runs_.resize(kept);
+    high_water_ = std::max(high_water_, used_);
+    used_ = 0;
+    current_ = 0;
+    offset_ = 0;
+}
+
+} // namespace seinfeld_tv
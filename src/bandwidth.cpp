@@ -0,0 +1,73 @@
+#include "seinfeld_tv/bandwidth.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// Each thread sticks to one shard, so shards see no contention as long
+/// as there are no more server threads than shards.
+std::size_t shard_index(std::size_t shards) noexcept
+{
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t mine = next.fetch_add(1, std::memory_order_relaxed);
+    return mine % shards;
+}
+
+} // namespace
+
+void BandwidthEstimator::record(const HttpDelivery& delivery)
+{
+    if (delivery.bytes < options_.min_bytes || delivery.elapsed < options_.min_elapsed)
+        return;
+    auto& shard = shards_[shard_index(kShards)];
+    std::lock_guard lock(shard.mutex);
+    shard.pending.push_back({delivery.tag, delivery.bytes, delivery.elapsed.count()});
+}
+
+std::size_t BandwidthEstimator::update(SessionTable& sessions)
+{
+    batch_.clear();
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        batch_.insert(batch_.end(), shard.pending.begin(), shard.pending.end());
+        shard.pending.clear();
+    }
+    if (batch_.empty())
+        return 0;
+
+    // One rate per session per batch: total bytes over total send time,
+    // so a session's large segments outweigh its small ones.
+    std::sort(batch_.begin(), batch_.end(), [](const Pending& a, const Pending& b) { return a.tag < b.tag; });
+    std::vector<BandwidthSample> samples;
+    for (std::size_t i = 0; i < batch_.size();) {
+        const std::uint64_t tag = batch_[i].tag;
+        double bytes = 0, ns = 0;
+        for (; i < batch_.size() && batch_[i].tag == tag; ++i) {
+            bytes += static_cast<double>(batch_[i].bytes);
+            ns += static_cast<double>(batch_[i].ns);
+        }
+        const double bps = std::min(bytes * 8e9 / ns, double{std::numeric_limits<std::uint32_t>::max()});
+        samples.push_back({{static_cast<std::uint32_t>(tag >> 32), static_cast<std::uint32_t>(tag)},
+                           static_cast<std::uint32_t>(bps)});
+    }
+    return sessions.blend_bandwidth(samples, options_.weight);
+}
+
+std::optional<std::size_t> rendition_hint(std::span<const Rendition> ladder, std::uint32_t bps,
+                                          double headroom) noexcept
+{
+    if (bps == 0 || ladder.empty())
+        return std::nullopt;
+    for (std::size_t i = 0; i < ladder.size(); ++i) {
+        const double need = 1000.0 * (ladder[i].video_kbps + ladder[i].audio_kbps) * headroom;
+        if (need <= bps)
+            return i;
+    }
+    return ladder.size() - 1;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,320 @@
+#include "seinfeld_tv/blake3.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace seinfeld_tv {
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little, "BLAKE3 words are read little-endian");
+
+constexpr std::uint32_t kIv[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                                  0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+constexpr std::uint8_t kPermutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+
+constexpr std::uint32_t kChunkStart = 1u << 0;
+constexpr std::uint32_t kChunkEnd = 1u << 1;
+constexpr std::uint32_t kParent = 1u << 2;
+constexpr std::uint32_t kRoot = 1u << 3;
+
+inline void g(std::uint32_t* s, int a, int b, int c, int d, std::uint32_t mx, std::uint32_t my) noexcept
+{
+    s[a] = s[a] + s[b] + mx;
+    s[d] = std::rotr(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = std::rotr(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + my;
+    s[d] = std::rotr(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = std::rotr(s[b] ^ s[c], 7);
+}
+
+void compress(const std::uint32_t cv[8], const std::uint8_t block[64], std::uint64_t counter,
+              std::uint32_t block_len, std::uint32_t flags, std::uint32_t out[16]) noexcept
+{
+    std::uint32_t m[16];
+    std::memcpy(m, block, sizeof m);
+    std::uint32_t s[16] = {cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+                           kIv[0], kIv[1], kIv[2], kIv[3],
+                           static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32),
+                           block_len, flags};
+    for (int round = 0; round < 7; ++round) {
+        g(s, 0, 4, 8, 12, m[0], m[1]);
+        g(s, 1, 5, 9, 13, m[2], m[3]);
+        g(s, 2, 6, 10, 14, m[4], m[5]);
+        g(s, 3, 7, 11, 15, m[6], m[7]);
+        g(s, 0, 5, 10, 15, m[8], m[9]);
+        g(s, 1, 6, 11, 12, m[10], m[11]);
+        g(s, 2, 7, 8, 13, m[12], m[13]);
+        g(s, 3, 4, 9, 14, m[14], m[15]);
+        if (round < 6) {
+            std::uint32_t permuted[16];
+            for (int i = 0; i < 16; ++i)
+                permuted[i] = m[kPermutation[i]];
+            std::memcpy(m, permuted, sizeof m);
+        }
+    }
+    for (int i = 0; i < 8; ++i) {
+        out[i] = s[i] ^ s[i + 8];
+        out[i + 8] = s[i + 8] ^ cv[i];
+    }
+}
+
+/// Deferred final compression of a chunk or parent node.
+struct Output {
+    std::uint32_t cv[8];
+    std::uint8_t block[64];
+    std::uint64_t counter;
+    std::uint32_t block_len;
+    std::uint32_t flags;
+
+    void chaining_value(std::uint32_t out[8]) const noexcept
+    {
+        std::uint32_t full[16];
+        compress(cv, block, counter, block_len, flags, full);
+        std::memcpy(out, full, 8 * sizeof(std::uint32_t));
+    }
+
+    ContentHash root() const noexcept
+    {
+        std::uint32_t full[16];
+        compress(cv, block, 0, block_len, flags | kRoot, full);
+        ContentHash h;
+        std::memcpy(h.bytes.data(), full, h.bytes.size());
+        return h;
+    }
+};
+
+Output parent_output(const std::uint32_t left[8], const std::uint32_t right[8]) noexcept
+{
+    Output o;
+    std::memcpy(o.cv, kIv, sizeof o.cv);
+    std::memcpy(o.block, left, 32);
+    std::memcpy(o.block + 32, right, 32);
+    o.counter = 0;
+    o.block_len = 64;
+    o.flags = kParent;
+    return o;
+}
+
+constexpr std::uint8_t kSchedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+/// Portable vector types; GCC lowers them to SSE2/AVX2/NEON as the
+/// enclosing function's target allows.
+typedef std::uint32_t U32x4 __attribute__((vector_size(16)));
+typedef std::uint32_t U32x8 __attribute__((vector_size(32)));
+
+// Vectors are passed by reference throughout: by value, 32-byte vectors
+// would change the calling convention of these (always inlined) helpers.
+template <typename V>
+[[gnu::always_inline]] inline void xor_rotr(V& x, const V& y, int n) noexcept
+{
+    x ^= y;
+    x = (x >> n) | (x << (32 - n));
+}
+
+template <typename V>
+[[gnu::always_inline]] inline void g_v(V* s, int a, int b, int c, int d, const V& mx, const V& my) noexcept
+{
+    s[a] += s[b] + mx;
+    xor_rotr(s[d], s[a], 16);
+    s[c] += s[d];
+    xor_rotr(s[b], s[c], 12);
+    s[a] += s[b] + my;
+    xor_rotr(s[d], s[a], 8);
+    s[c] += s[d];
+    xor_rotr(s[b], s[c], 7);
+}
+
+/// Hashes N = lanes(V) whole chunks side by side, one chunk per lane, and
+/// writes their chaining values. Chunk i has counter `counter + i`.
+template <typename V>
+[[gnu::always_inline]] inline void hash_chunks(const std::uint8_t* input, std::uint64_t counter,
+                                               std::uint32_t (*out)[8]) noexcept
+{
+    constexpr int N = sizeof(V) / sizeof(std::uint32_t);
+    V h[8];
+    for (int i = 0; i < 8; ++i)
+        h[i] = V{} + kIv[i];
+    V ctr_lo, ctr_hi;
+    for (int l = 0; l < N; ++l) {
+        ctr_lo[l] = static_cast<std::uint32_t>(counter + static_cast<std::uint64_t>(l));
+        ctr_hi[l] = static_cast<std::uint32_t>((counter + static_cast<std::uint64_t>(l)) >> 32);
+    }
+    for (std::size_t b = 0; b < Blake3::kChunkSize / Blake3::kBlockSize; ++b) {
+        V m[16];
+        for (int l = 0; l < N; ++l) {
+            std::uint32_t words[16];
+            std::memcpy(words, input + static_cast<std::size_t>(l) * Blake3::kChunkSize + b * Blake3::kBlockSize,
+                        sizeof words);
+            for (int w = 0; w < 16; ++w)
+                m[w][l] = words[w];
+        }
+        std::uint32_t flags = 0;
+        if (b == 0)
+            flags |= kChunkStart;
+        if (b + 1 == Blake3::kChunkSize / Blake3::kBlockSize)
+            flags |= kChunkEnd;
+        V s[16] = {h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                   V{} + kIv[0], V{} + kIv[1], V{} + kIv[2], V{} + kIv[3],
+                   ctr_lo, ctr_hi, V{} + std::uint32_t{Blake3::kBlockSize}, V{} + flags};
+        for (const auto& r : kSchedule) {
+            g_v(s, 0, 4, 8, 12, m[r[0]], m[r[1]]);
+            g_v(s, 1, 5, 9, 13, m[r[2]], m[r[3]]);
+            g_v(s, 2, 6, 10, 14, m[r[4]], m[r[5]]);
+            g_v(s, 3, 7, 11, 15, m[r[6]], m[r[7]]);
+            g_v(s, 0, 5, 10, 15, m[r[8]], m[r[9]]);
+            g_v(s, 1, 6, 11, 12, m[r[10]], m[r[11]]);
+            g_v(s, 2, 7, 8, 13, m[r[12]], m[r[13]]);
+            g_v(s, 3, 4, 9, 14, m[r[14]], m[r[15]]);
+        }
+        for (int i = 0; i < 8; ++i)
+            h[i] = s[i] ^ s[i + 8];
+    }
+    for (int l = 0; l < N; ++l)
+        for (int i = 0; i < 8; ++i)
+            out[l][i] = h[i][l];
+}
+
+void hash_chunks_x4(const std::uint8_t* input, std::uint64_t counter, std::uint32_t (*out)[8]) noexcept
+{
+    hash_chunks<U32x4>(input, counter, out);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) void hash_chunks_x8(const std::uint8_t* input, std::uint64_t counter,
+                                                    std::uint32_t (*out)[8]) noexcept
+{
+    hash_chunks<U32x8>(input, counter, out);
+}
+#endif
+
+struct ChunkKernel {
+    void (*fn)(const std::uint8_t*, std::uint64_t, std::uint32_t (*)[8]) noexcept;
+    std::size_t lanes;
+};
+
+ChunkKernel chunk_kernel() noexcept
+{
+    static const ChunkKernel kernel = [] {
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx2"))
+            return ChunkKernel{hash_chunks_x8, 8};
+#endif
+        return ChunkKernel{hash_chunks_x4, 4};
+    }();
+    return kernel;
+}
+
+} // namespace
+
+Blake3::Blake3() noexcept
+{
+    std::memcpy(chunk_.cv, kIv, sizeof kIv);
+}
+
+void Blake3::push_chunk_cv(const std::uint32_t cv[8], std::uint64_t total_chunks) noexcept
+{
+    // Merge completed subtrees: one merge per trailing zero of the count.
+    std::uint32_t merged[8];
+    std::memcpy(merged, cv, sizeof merged);
+    while ((total_chunks & 1) == 0) {
+        --stack_len_;
+        parent_output(stack_[stack_len_], merged).chaining_value(merged);
+        total_chunks >>= 1;
+    }
+    std::memcpy(stack_[stack_len_++], merged, sizeof merged);
+}
+
+void Blake3::update(const void* data, std::size_t size) noexcept
+{
+    auto* in = static_cast<const std::uint8_t*>(data);
+    while (size > 0) {
+        if (chunk_.len() == kChunkSize) {
+            Output done;
+            std::memcpy(done.cv, chunk_.cv, sizeof done.cv);
+            std::memcpy(done.block, chunk_.block, sizeof done.block);
+            done.counter = chunk_.counter;
+            done.block_len = chunk_.block_len;
+            done.flags = kChunkEnd | (chunk_.blocks_compressed == 0 ? kChunkStart : 0);
+            std::uint32_t cv[8];
+            done.chaining_value(cv);
+            const std::uint64_t total = chunk_.counter + 1;
+            push_chunk_cv(cv, total);
+            chunk_ = ChunkState{};
+            std::memcpy(chunk_.cv, kIv, sizeof kIv);
+            chunk_.counter = total;
+        }
+        // Whole chunks go through the SIMD kernel several at a time; at
+        // least one byte is held back so finalize() has a last chunk.
+        if (chunk_.len() == 0) {
+            const auto kernel = chunk_kernel();
+            if (size > kernel.lanes * kChunkSize) {
+                std::uint32_t cvs[8][8];
+                kernel.fn(in, chunk_.counter, cvs);
+                for (std::size_t l = 0; l < kernel.lanes; ++l)
+                    push_chunk_cv(cvs[l], chunk_.counter + l + 1);
+                chunk_.counter += kernel.lanes;
+                in += kernel.lanes * kChunkSize;
+                size -= kernel.lanes * kChunkSize;
+                continue;
+            }
+        }
+        // Fill the chunk a block at a time, keeping the last block buffered
+        // so it can be finished with CHUNK_END.
+        const std::size_t want = std::min(size, kChunkSize - chunk_.len());
+        std::size_t taken = 0;
+        while (taken < want) {
+            if (chunk_.block_len == kBlockSize) {
+                std::uint32_t full[16];
+                compress(chunk_.cv, chunk_.block, chunk_.counter, kBlockSize,
+                         chunk_.blocks_compressed == 0 ? kChunkStart : 0, full);
+                std::memcpy(chunk_.cv, full, sizeof chunk_.cv);
+                ++chunk_.blocks_compressed;
+                chunk_.block_len = 0;
+            }
+            const std::size_t n = std::min(want - taken, kBlockSize - chunk_.block_len);
+            std::memcpy(chunk_.block + chunk_.block_len, in + taken, n);
+            chunk_.block_len = static_cast<std::uint8_t>(chunk_.block_len + n);
+            taken += n;
+        }
+        in += want;
+        size -= want;
+    }
+}
+
+ContentHash Blake3::finalize() const noexcept
+{
+    Output o;
+    std::memcpy(o.cv, chunk_.cv, sizeof o.cv);
+    std::memset(o.block, 0, sizeof o.block);
+    std::memcpy(o.block, chunk_.block, chunk_.block_len);
+    o.counter = chunk_.counter;
+    o.block_len = chunk_.block_len;
+    o.flags = kChunkEnd | (chunk_.blocks_compressed == 0 ? kChunkStart : 0);
+    for (int i = stack_len_ - 1; i >= 0; --i) {
+        std::uint32_t cv[8];
+        o.chaining_value(cv);
+        o = parent_output(stack_[i], cv);
+    }
+    return o.root();
+}
+
+ContentHash blake3(std::span<const std::byte> data) noexcept
+{
+    Blake3 h;
+    h.update(data);
+    return h.finalize();
+}
+
+} // namespace seinfeld_tv
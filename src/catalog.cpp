@@ -0,0 +1,269 @@
+#include "seinfeld_tv/catalog.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+using namespace catalog_format;
+
+namespace {
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("catalog: ") + what);
+}
+
+template <typename T>
+std::span<const T> section(const MappedFile& file, std::uint64_t offset, std::uint64_t count)
+{
+    if (offset % alignof(T) != 0 || offset > file.size()
+        || count > (file.size() - offset) / sizeof(T))
+        corrupt("section out of bounds");
+    return {reinterpret_cast<const T*>(file.data() + offset), static_cast<std::size_t>(count)};
+}
+
+} // namespace
+
+Catalog::Catalog(const std::filesystem::path& path)
+    : file_(path)
+{
+    if (file_.size() < sizeof(CatalogHeader))
+        corrupt("truncated header");
+    header_ = reinterpret_cast<const CatalogHeader*>(file_.data());
+    if (std::memcmp(header_->magic, kMagic, sizeof kMagic) != 0)
+        corrupt("bad magic");
+    if (header_->version != kVersion)
+        corrupt("unsupported version");
+    if (header_->header_size != sizeof(CatalogHeader) || header_->file_size != file_.size())
+        corrupt("size mismatch");
+
+    episodes_ = section<EpisodeRecord>(file_, header_->episodes_offset, header_->episode_count);
+    clips_ = section<ClipRecord>(file_, header_->clips_offset, header_->clip_count);
+    hash_index_ = section<HashIndexEntry>(file_, header_->hash_index_offset, header_->episode_count);
+    auto strings = section<char>(file_, header_->strings_offset, header_->strings_size);
+    strings_ = strings.data();
+    strings_size_ = strings.size();
+
+    validate();
+}
+
+void Catalog::validate() const
+{
+    auto check_string = [&](std::uint32_t offset, std::uint32_t length) {
+        if (std::uint64_t{offset} + length > strings_size_)
+            corrupt("string out of bounds");
+    };
+    for (std::size_t i = 0; i < episodes_.size(); ++i) {
+        const auto& e = episodes_[i];
+        check_string(e.path_offset, e.path_length);
+        check_string(e.title_offset, e.title_length);
+        if (std::uint64_t{e.first_clip} + e.clip_count > clips_.size())
+            corrupt("clip range out of bounds");
+        if (i > 0 && std::tie(episodes_[i - 1].season, episodes_[i - 1].episode) >= std::tie(e.season, e.episode))
+            corrupt("episodes not sorted");
+    }
+    for (const auto& c : clips_) {
+        check_string(c.label_offset, c.label_length);
+        if (c.episode_id >= episodes_.size())
+            corrupt("clip references unknown episode");
+    }
+    for (std::size_t i = 0; i < hash_index_.size(); ++i) {
+        if (hash_index_[i].episode_id >= episodes_.size())
+            corrupt("hash index references unknown episode");
+        if (i > 0 && !(hash_index_[i - 1].hash < hash_index_[i].hash))
+            corrupt("hash index not sorted");
+    }
+}
+
+const EpisodeRecord* Catalog::find(std::uint16_t season, std::uint16_t episode) const noexcept
+{
+    auto it = std::lower_bound(episodes_.begin(), episodes_.end(), std::pair{season, episode},
+        [](const EpisodeRecord& r, const std::pair<std::uint16_t, std::uint16_t>& key) {
+            return std::pair{r.season, r.episode} < key;
+        });
+    if (it == episodes_.end() || it->season != season || it->episode != episode)
+        return nullptr;
+    return &*it;
+}
+
+const EpisodeRecord* Catalog::find(const ContentHash& hash) const noexcept
+{
+    auto it = std::lower_bound(hash_index_.begin(), hash_index_.end(), hash,
+        [](const HashIndexEntry& e, const ContentHash& key) { return e.hash < key; });
+    if (it == hash_index_.end() || it->hash != hash)
+        return nullptr;
+    return &episodes_[it->episode_id];
+}
+
+std::span<const EpisodeRecord> Catalog::season(std::uint16_t season) const noexcept
+{
+    auto first = std::partition_point(episodes_.begin(), episodes_.end(),
+        [&](const EpisodeRecord& r) { return r.season < season; });
+    auto last = std::partition_point(first, episodes_.end(),
+        [&](const EpisodeRecord& r) { return r.season <= season; });
+    return {first, last};
+}
+
+std::optional<Loudness> Catalog::loudness(const EpisodeRecord& record) const noexcept
+{
+    if (!(record.flags & kEpisodeLoudness))
+        return std::nullopt;
+    return Loudness{record.loudness_lufs, record.sample_peak};
+}
+
+void Catalog::store_loudness(const std::filesystem::path& path, EpisodeId id, const Loudness& loudness)
+{
+    std::uint64_t record_offset = 0;
+    std::uint32_t flags = 0;
+    {
+        const Catalog catalog(path);
+        if (id >= catalog.size())
+            throw std::invalid_argument("catalog: episode id out of range");
+        record_offset = catalog.header_->episodes_offset + std::uint64_t{id} * sizeof(EpisodeRecord);
+        flags = catalog.episode(id).flags | kEpisodeLoudness;
+    }
+
+    UniqueFd fd(::open(path.c_str(), O_WRONLY | O_CLOEXEC));
+    if (!fd)
+        throw_errno("open");
+    auto put = [&](std::size_t field, const void* data, std::size_t size) {
+        const auto at = static_cast<off_t>(record_offset + field);
+        ssize_t n;
+        while ((n = ::pwrite(fd.get(), data, size, at)) < 0 && errno == EINTR) {
+        }
+        if (n < 0)
+            throw_errno("pwrite");
+        if (static_cast<std::size_t>(n) != size)
+            throw std::runtime_error("catalog: short write");
+    };
+    const float values[2] = {loudness.integrated_lufs, loudness.sample_peak};
+    static_assert(offsetof(EpisodeRecord, sample_peak) == offsetof(EpisodeRecord, loudness_lufs) + sizeof(float));
+    put(offsetof(EpisodeRecord, loudness_lufs), values, sizeof values);
+    put(offsetof(EpisodeRecord, flags), &flags, sizeof flags);
+    fsync_or_throw(fd.get());
+}
+
+void CatalogBuilder::write(const std::filesystem::path& path, std::uint64_t generation) const
+{
+    std::vector<const EpisodeInfo*> episodes;
+    episodes.reserve(episodes_.size());
+    for (const auto& e : episodes_)
+        episodes.push_back(&e);
+    std::sort(episodes.begin(), episodes.end(), [](const EpisodeInfo* a, const EpisodeInfo* b) {
+        return std::tie(a->season, a->episode) < std::tie(b->season, b->episode);
+    });
+    for (std::size_t i = 1; i < episodes.size(); ++i)
+        if (episodes[i - 1]->season == episodes[i]->season && episodes[i - 1]->episode == episodes[i]->episode)
+            throw std::invalid_argument("catalog: duplicate episode");
+
+    auto episode_id = [&](std::uint16_t season, std::uint16_t episode) {
+        auto it = std::lower_bound(episodes.begin(), episodes.end(), std::pair{season, episode},
+            [](const EpisodeInfo* e, const std::pair<std::uint16_t, std::uint16_t>& key) {
+                return std::pair{e->season, e->episode} < key;
+            });
+        if (it == episodes.end() || (*it)->season != season || (*it)->episode != episode)
+            throw std::invalid_argument("catalog: clip references unknown episode");
+        return static_cast<EpisodeId>(it - episodes.begin());
+    };
+
+    struct PendingClip {
+        EpisodeId episode_id;
+        const ClipInfo* info;
+    };
+    std::vector<PendingClip> clips;
+    clips.reserve(clips_.size());
+    for (const auto& c : clips_)
+        clips.push_back({episode_id(c.season, c.episode), &c});
+    std::sort(clips.begin(), clips.end(), [](const PendingClip& a, const PendingClip& b) {
+        return std::tie(a.episode_id, a.info->in_pts) < std::tie(b.episode_id, b.info->in_pts);
+    });
+
+    std::string strings;
+    auto intern = [&](std::string_view s, std::uint32_t& offset, std::uint32_t& length) {
+        offset = static_cast<std::uint32_t>(strings.size());
+        length = static_cast<std::uint32_t>(s.size());
+        strings.append(s);
+    };
+
+    std::vector<EpisodeRecord> records(episodes.size());
+    for (std::size_t i = 0; i < episodes.size(); ++i) {
+        const auto& e = *episodes[i];
+        auto& r = records[i];
+        r.hash = e.hash;
+        r.file_size = e.file_size;
+        r.duration_pts = e.duration_pts;
+        r.mtime_ns = e.mtime_ns;
+        r.season = e.season;
+        r.episode = e.episode;
+        if (e.loudness) {
+            r.flags |= kEpisodeLoudness;
+            r.loudness_lufs = e.loudness->integrated_lufs;
+            r.sample_peak = e.loudness->sample_peak;
+        }
+        intern(e.path, r.path_offset, r.path_length);
+        intern(e.title, r.title_offset, r.title_length);
+    }
+
+    std::vector<ClipRecord> clip_records(clips.size());
+    for (std::size_t i = 0; i < clips.size(); ++i) {
+        auto& r = clip_records[i];
+        r.episode_id = clips[i].episode_id;
+        r.in_pts = clips[i].info->in_pts;
+        r.out_pts = clips[i].info->out_pts;
+        intern(clips[i].info->label, r.label_offset, r.label_length);
+        auto& owner = records[r.episode_id];
+        if (owner.clip_count == 0)
+            owner.first_clip = static_cast<std::uint32_t>(i);
+        ++owner.clip_count;
+    }
+
+    std::vector<HashIndexEntry> hash_index(records.size());
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        hash_index[i].hash = records[i].hash;
+        hash_index[i].episode_id = static_cast<std::uint32_t>(i);
+    }
+    std::sort(hash_index.begin(), hash_index.end(),
+        [](const HashIndexEntry& a, const HashIndexEntry& b) { return a.hash < b.hash; });
+    for (std::size_t i = 1; i < hash_index.size(); ++i)
+        if (hash_index[i - 1].hash == hash_index[i].hash)
+            throw std::invalid_argument("catalog: duplicate content hash");
+
+    CatalogHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.header_size = sizeof header;
+    header.generation = generation;
+    header.episode_count = static_cast<std::uint32_t>(records.size());
+    header.clip_count = static_cast<std::uint32_t>(clip_records.size());
+    header.episodes_offset = align_section(sizeof header);
+    header.clips_offset = align_section(header.episodes_offset + records.size() * sizeof(EpisodeRecord));
+    header.hash_index_offset = align_section(header.clips_offset + clip_records.size() * sizeof(ClipRecord));
+    header.strings_offset = align_section(header.hash_index_offset + hash_index.size() * sizeof(HashIndexEntry));
+    header.strings_size = strings.size();
+    header.file_size = header.strings_offset + strings.size();
+
+    std::vector<std::byte> image(header.file_size);
+    auto put = [&](std::uint64_t offset, const void* data, std::size_t size) {
+        if (size > 0)
+            std::memcpy(image.data() + offset, data, size);
+    };
+    put(0, &header, sizeof header);
+    put(header.episodes_offset, records.data(), records.size() * sizeof(EpisodeRecord));
+    put(header.clips_offset, clip_records.data(), clip_records.size() * sizeof(ClipRecord));
+    put(header.hash_index_offset, hash_index.data(), hash_index.size() * sizeof(HashIndexEntry));
+    put(header.strings_offset, strings.data(), strings.size());
+
+    write_file_atomic(path, image);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,236 @@
+#include "seinfeld_tv/chunking.hpp"
+
+#include "seinfeld_tv/blake3.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/task_graph.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace seinfeld_tv {
+
+using namespace chunk_format;
+
+namespace {
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("chunks: ") + what);
+}
+
+/// Below this, thread hand-off costs more than it saves.
+constexpr std::size_t kParallelMinBytes = std::size_t{32} << 20;
+/// Bytes of chunks hashed per task.
+constexpr std::size_t kBatchBytes = std::size_t{16} << 20;
+
+constexpr std::array<std::uint64_t, 256> make_gear() noexcept
+{
+    std::array<std::uint64_t, 256> table{};
+    std::uint64_t x = 0x5354564344433031ULL; // "STVCDC01"
+    for (auto& v : table) {
+        x += 0x9e3779b97f4a7c15ULL;
+        std::uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        v = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr auto kGear = make_gear();
+
+/// Top `bits` bits: with a left-shifting gear hash these depend on the
+/// widest window of recent bytes.
+constexpr std::uint64_t top_mask(int bits) noexcept
+{
+    return bits <= 0 ? 0 : ~std::uint64_t{0} << (64 - bits);
+}
+
+void hash_chunks(std::span<const std::byte> data, std::span<ChunkEntry> chunks) noexcept
+{
+    for (auto& c : chunks)
+        c.hash = blake3(data.subspan(c.offset, c.length));
+}
+
+} // namespace
+
+std::size_t cdc_cut(std::span<const std::byte> data, const CdcParams& params) noexcept
+{
+    const std::size_t size = data.size();
+    if (size <= params.min_size)
+        return size;
+    const int bits = std::bit_width(params.avg_size) - 1;
+    const std::uint64_t mask_small = top_mask(bits + 2);
+    const std::uint64_t mask_large = top_mask(bits - 2);
+    const std::size_t end = std::min<std::size_t>(size, params.max_size);
+    const std::size_t normal = std::min<std::size_t>(end, params.avg_size);
+    const auto* p = reinterpret_cast<const std::uint8_t*>(data.data());
+
+    std::uint64_t fp = 0;
+    std::size_t i = params.min_size;
+    for (; i < normal; ++i) {
+        fp = (fp << 1) + kGear[p[i]];
+        if (!(fp & mask_small))
+            return i + 1;
+    }
+    for (; i < end; ++i) {
+        fp = (fp << 1) + kGear[p[i]];
+        if (!(fp & mask_large))
+            return i + 1;
+    }
+    return end;
+}
+
+ContentHash ChunkManifest::root_of(std::span<const ChunkEntry> chunks, const CdcParams& params) noexcept
+{
+    Blake3 h;
+    const std::uint32_t prefix[4] = {0x31434453 /* "SDC1" */, params.min_size, params.avg_size, params.max_size};
+    h.update(prefix, sizeof prefix);
+    for (const auto& c : chunks) {
+        const std::uint64_t length = c.length;
+        h.update(c.hash.bytes.data(), c.hash.bytes.size());
+        h.update(&length, sizeof length);
+    }
+    return h.finalize();
+}
+
+double ChunkManifest::shared_fraction(const ChunkManifest& older) const
+{
+    if (source_size == 0)
+        return 1.0;
+    std::unordered_set<ContentHash> known;
+    known.reserve(older.chunks.size());
+    for (const auto& c : older.chunks)
+        known.insert(c.hash);
+    std::uint64_t shared = 0;
+    for (const auto& c : chunks)
+        if (known.contains(c.hash))
+            shared += c.length;
+    return static_cast<double>(shared) / static_cast<double>(source_size);
+}
+
+std::filesystem::path ChunkManifest::sidecar_path(const std::filesystem::path& media)
+{
+    auto p = media;
+    p += ".chunks";
+    return p;
+}
+
+void ChunkManifest::write(const std::filesystem::path& sidecar) const
+{
+    ChunkHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.header_size = sizeof header;
+    header.root = root;
+    header.source_size = source_size;
+    header.chunk_count = chunks.size();
+    header.min_size = params.min_size;
+    header.avg_size = params.avg_size;
+    header.max_size = params.max_size;
+
+    std::vector<std::byte> image(sizeof header + chunks.size() * sizeof(ChunkEntry));
+    std::memcpy(image.data(), &header, sizeof header);
+    if (!chunks.empty())
+        std::memcpy(image.data() + sizeof header, chunks.data(), chunks.size() * sizeof(ChunkEntry));
+    write_file_atomic(sidecar, image);
+}
+
+ChunkManifest ChunkManifest::read(const std::filesystem::path& sidecar)
+{
+    MappedFile file(sidecar);
+    if (file.size() < sizeof(ChunkHeader))
+        corrupt("truncated header");
+    ChunkHeader header;
+    std::memcpy(&header, file.data(), sizeof header);
+    if (std::memcmp(header.magic, kMagic, sizeof kMagic) != 0)
+        corrupt("bad magic");
+    if (header.version != kVersion || header.header_size != sizeof(ChunkHeader))
+        corrupt("unsupported version");
+    if (header.chunk_count != (file.size() - sizeof header) / sizeof(ChunkEntry)
+        || (file.size() - sizeof header) % sizeof(ChunkEntry) != 0)
+        corrupt("size mismatch");
+
+    ChunkManifest m;
+    m.params = {header.min_size, header.avg_size, header.max_size};
+    m.source_size = header.source_size;
+    m.root = header.root;
+    m.chunks.resize(header.chunk_count);
+    if (!m.chunks.empty())
+        std::memcpy(m.chunks.data(), file.data() + sizeof header, m.chunks.size() * sizeof(ChunkEntry));
+    std::uint64_t expect = 0;
+    for (const auto& c : m.chunks) {
+        if (c.offset != expect)
+            corrupt("chunks not contiguous");
+        expect += c.length;
+    }
+    if (expect != m.source_size)
+        corrupt("chunks do not cover the file");
+    return m;
+}
+
+ChunkManifest chunk_file(const std::filesystem::path& path, WorkStealingPool* pool, const CdcParams& params)
+{
+    if (params.min_size == 0 || !std::has_single_bit(params.avg_size) || params.min_size > params.avg_size
+        || params.avg_size > params.max_size)
+        throw std::invalid_argument("chunks: bad CDC parameters");
+
+    MappedFile file(path);
+    file.sequential();
+    const auto data = file.bytes();
+    ChunkManifest m;
+    m.params = params;
+    m.source_size = data.size();
+
+    if (!pool || pool->current_worker() >= 0 || data.size() < kParallelMinBytes) {
+        for (std::uint64_t offset = 0; offset < data.size();) {
+            const auto length = cdc_cut(data.subspan(offset), params);
+            m.chunks.push_back({offset, static_cast<std::uint32_t>(length), 0, {}});
+            offset += length;
+        }
+        hash_chunks(data, m.chunks);
+    } else {
+        // The scan task finds boundaries and hands each ~16 MiB batch to a
+        // hashing child as soon as it is complete.
+        std::deque<std::vector<ChunkEntry>> batches;
+        TaskGraph graph;
+        const auto done = graph.add("chunk/join", [] {});
+        const auto scan = graph.add("chunk/scan", [&] {
+            std::vector<ChunkEntry> batch;
+            std::size_t batch_bytes = 0;
+            auto submit = [&] {
+                auto* b = &batches.emplace_back(std::move(batch));
+                graph.add_child("chunk/hash", [data, b] { hash_chunks(data, *b); }, done);
+                batch.clear();
+                batch_bytes = 0;
+            };
+            for (std::uint64_t offset = 0; offset < data.size();) {
+                const auto length = cdc_cut(data.subspan(offset), params);
+                batch.push_back({offset, static_cast<std::uint32_t>(length), 0, {}});
+                offset += length;
+                if ((batch_bytes += length) >= kBatchBytes)
+                    submit();
+            }
+            if (!batch.empty())
+                submit();
+        });
+        graph.precede(scan, done);
+        graph.run(*pool);
+        for (auto& b : batches)
+            m.chunks.insert(m.chunks.end(), b.begin(), b.end());
+    }
+    m.root = ChunkManifest::root_of(m.chunks, params);
+    return m;
+}
+
+ContentHash hash_file(const std::filesystem::path& path, WorkStealingPool* pool)
+{
+    return chunk_file(path, pool).root;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,273 @@
+#include "seinfeld_tv/cluster.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/trace.hpp"
+
+#include "http_detail.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// Largest body accepted from a peer; segments are a few MiB.
+constexpr std::size_t kMaxPeerBody = std::size_t{64} << 20;
+constexpr std::size_t kHeadLimit = 8192;
+
+std::uint64_t mix64(std::uint64_t x) noexcept
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/// FNV-1a: fixed across builds and platforms, unlike std::hash, so every
+/// node derives the same seeds.
+std::uint64_t name_seed(std::string_view name) noexcept
+{
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+using detail::iequals;
+
+UniqueFd connect_to(const ClusterNode& node, std::chrono::milliseconds timeout)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    const auto port = std::to_string(node.port);
+    if (const int rc = ::getaddrinfo(node.host.c_str(), port.c_str(), &hints, &found); rc != 0)
+        throw std::runtime_error("peer: " + node.host + ": " + ::gai_strerror(rc));
+    std::unique_ptr<addrinfo, decltype(&::freeaddrinfo)> list(found, &::freeaddrinfo);
+
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+    for (const addrinfo* a = list.get(); a; a = a->ai_next) {
+        UniqueFd fd(::socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol));
+        if (!fd)
+            continue;
+        // SO_SNDTIMEO also bounds connect().
+        ::setsockopt(fd.get(), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+        ::setsockopt(fd.get(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+        if (::connect(fd.get(), a->ai_addr, a->ai_addrlen) == 0)
+            return fd;
+    }
+    throw_errno("peer connect");
+}
+
+/// One blocking GET on a fresh connection. The body on a 200; throws
+/// otherwise.
+std::vector<std::byte> http_get(const ClusterNode& node, const std::string& path, std::chrono::milliseconds timeout)
+{
+    const auto fd = connect_to(node, timeout);
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + node.name() + "\r\nConnection: close\r\n\r\n";
+    write_all(fd.get(), request.data(), request.size());
+
+    std::string head;
+    std::size_t head_end;
+    char buf[4096];
+    while ((head_end = head.find("\r\n\r\n")) == std::string::npos) {
+        if (head.size() >= kHeadLimit)
+            throw std::runtime_error("peer: response head too large");
+        const ssize_t n = ::read(fd.get(), buf, sizeof buf);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throw_errno("peer read");
+        if (n == 0)
+            throw std::runtime_error("peer: connection closed");
+        head.append(buf, static_cast<std::size_t>(n));
+    }
+
+    // "HTTP/1.1 200 OK"
+    int status = 0;
+    if (head.size() < 12 || std::from_chars(head.data() + 9, head.data() + 12, status).ec != std::errc{})
+        throw std::runtime_error("peer: bad status line");
+    if (status != 200)
+        throw std::runtime_error("peer: status " + std::to_string(status));
+    std::optional<std::size_t> length;
+    for (std::size_t at = head.find("\r\n") + 2; at < head_end;) {
+        const auto eol = head.find("\r\n", at);
+        const std::string_view line(head.data() + at, eol - at);
+        if (const auto colon = line.find(':'); colon != std::string_view::npos && iequals(line.substr(0, colon), "content-length")) {
+            auto value = line.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ')
+                value.remove_prefix(1);
+            std::size_t v = 0;
+            if (std::from_chars(value.data(), value.data() + value.size(), v).ec == std::errc{})
+                length = v;
+        }
+        at = eol + 2;
+    }
+    if (!length || *length > kMaxPeerBody)
+        throw std::runtime_error("peer: missing or oversized Content-Length");
+
+    std::vector<std::byte> body(*length);
+    const std::size_t early = std::min(head.size() - (head_end + 4), *length);
+    std::memcpy(body.data(), head.data() + head_end + 4, early);
+    for (std::size_t got = early; got < body.size();) {
+        const ssize_t n = ::read(fd.get(), body.data() + got, body.size() - got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throw_errno("peer read");
+        if (n == 0)
+            throw std::runtime_error("peer: short body");
+        got += static_cast<std::size_t>(n);
+    }
+    return body;
+}
+
+} // namespace
+
+std::vector<ClusterNode> parse_nodes(std::string_view list)
+{
+    std::vector<ClusterNode> nodes;
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+        const auto item = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+        const auto colon = item.rfind(':');
+        unsigned port = 0;
+        if (colon == std::string_view::npos || colon == 0 ||
+            std::from_chars(item.data() + colon + 1, item.data() + item.size(), port).ec != std::errc{} || port == 0 ||
+            port > 65535)
+            throw std::invalid_argument("cluster: expected host:port, got \"" + std::string(item) + "\"");
+        nodes.push_back({std::string(item.substr(0, colon)), static_cast<std::uint16_t>(port)});
+    }
+    return nodes;
+}
+
+ClusterMap::ClusterMap(std::vector<ClusterNode> nodes, std::size_t self) : nodes_(std::move(nodes)), self_(self)
+{
+    if (self_ >= nodes_.size())
+        throw std::invalid_argument("cluster: self is not in the node list");
+    for (const auto& n : nodes_)
+        seeds_.push_back(name_seed(n.name()));
+}
+
+std::size_t ClusterMap::owner(const SegmentKey& key) const noexcept
+{
+    const std::uint64_t h = SegmentKeyHash{}(key);
+    std::size_t best = 0;
+    std::uint64_t best_score = 0;
+    for (std::size_t i = 0; i < seeds_.size(); ++i) {
+        const std::uint64_t score = mix64(seeds_[i] ^ h);
+        if (i == 0 || score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+PeerFetcher::PeerFetcher(const ClusterMap& cluster, SegmentCache& cache, PeerFetchOptions options)
+    : cluster_(cluster), cache_(cache), options_(options)
+{
+    for (unsigned i = 0; i < std::max(options_.threads, 1u); ++i)
+        threads_.emplace_back([this, i](std::stop_token stop) {
+            trace::set_thread_name(("peer-" + std::to_string(i)).c_str());
+            run(stop);
+        });
+}
+
+PeerFetcher::~PeerFetcher()
+{
+    for (auto& t : threads_)
+        t.request_stop();
+    wake_.notify_all();
+}
+
+PeerFetcher::Status PeerFetcher::request(const SegmentKey& key, std::size_t owner, std::string path)
+{
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock(mutex_);
+    if (const auto f = failed_.find(key); f != failed_.end()) {
+        if (f->second > now)
+            return Status::Failed;
+        failed_.erase(f);
+    }
+    if (pending_.contains(key))
+        return Status::Pending;
+    if (queue_.size() >= options_.max_queued) {
+        ++stats_.refused;
+        return Status::Failed;
+    }
+    pending_.insert(key);
+    queue_.push_back({key, owner, std::move(path)});
+    wake_.notify_one();
+    return Status::Pending;
+}
+
+PeerFetchStats PeerFetcher::stats() const
+{
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void PeerFetcher::run(std::stop_token stop)
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(mutex_);
+            if (!wake_.wait(lock, stop, [this] { return !queue_.empty(); }))
+                return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        fetch(job);
+    }
+}
+
+void PeerFetcher::fetch(const Job& job)
+{
+    trace::Span span("peer.fetch", job.key.sequence);
+    std::shared_ptr<CachedSegment> value;
+    {
+        metrics::Timer timer(fetch_latency_);
+        try {
+            value = std::make_shared<CachedSegment>();
+            value->bytes = http_get(cluster_.node(job.owner), job.path, options_.timeout);
+            cache_.insert(job.key, value);
+        } catch (const std::exception&) {
+            value.reset();
+        }
+    }
+
+    std::lock_guard lock(mutex_);
+    pending_.erase(job.key);
+    if (value) {
+        ++stats_.fetched;
+        stats_.bytes += value->bytes.size();
+    } else {
+        ++stats_.failed;
+        failed_[job.key] = std::chrono::steady_clock::now() + options_.failure_ttl;
+        // Entries only matter for the few seconds a segment is live.
+        if (failed_.size() > 4 * options_.max_queued)
+            std::erase_if(failed_, [now = std::chrono::steady_clock::now()](const auto& f) { return f.second <= now; });
+    }
+}
+
+} // namespace seinfeld_tv
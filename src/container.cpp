@@ -0,0 +1,56 @@
+#include "seinfeld_tv/container.hpp"
+
+#include "seinfeld_tv/ts_packet.hpp"
+#include "container_detail.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+Container detect_container(std::span<const std::byte> head) noexcept
+{
+    auto sync_at = [&](std::size_t i) { return std::to_integer<std::uint8_t>(head[i]) == ts::kSyncByte; };
+    if (head.size() >= 2 * kTsPacketSize + 1 && sync_at(0) && sync_at(kTsPacketSize) && sync_at(2 * kTsPacketSize))
+        return Container::MpegTs;
+    if (head.size() >= 8 && (std::memcmp(&head[4], "ftyp", 4) == 0 || std::memcmp(&head[4], "styp", 4) == 0))
+        return Container::Fmp4;
+    return Container::Unknown;
+}
+
+ContainerLayout scan_container(std::span<const std::byte> file)
+{
+    switch (detect_container(file)) {
+    case Container::MpegTs:
+        return scan_ts(file);
+    case Container::Fmp4:
+        return scan_fmp4(file);
+    case Container::Unknown:
+        break;
+    }
+    throw std::runtime_error("container: unrecognised format");
+}
+
+namespace detail {
+
+std::uint16_t intern_param_set(ContainerLayout& layout, std::uint64_t fingerprint)
+{
+    auto it = std::find(layout.param_sets.begin(), layout.param_sets.end(), fingerprint);
+    if (it == layout.param_sets.end())
+        it = layout.param_sets.insert(it, fingerprint);
+    return static_cast<std::uint16_t>(it - layout.param_sets.begin());
+}
+
+void fill_gop_sizes(ContainerLayout& layout) noexcept
+{
+    auto& g = layout.gops;
+    for (std::size_t i = 0; i < g.size(); ++i) {
+        const std::uint64_t end = i + 1 < g.size() ? g[i + 1].offset : layout.file_size;
+        g[i].size = static_cast<std::uint32_t>(end - g[i].offset);
+    }
+}
+
+} // namespace detail
+
+} // namespace seinfeld_tv
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "seinfeld_tv/container.hpp"
+
+namespace seinfeld_tv::detail {
+
+/// Index of `fingerprint` in layout.param_sets, appending it if new.
+std::uint16_t intern_param_set(ContainerLayout& layout, std::uint64_t fingerprint);
+
+/// Derives each GOP's byte size from the next GOP's offset (or EOF).
+void fill_gop_sizes(ContainerLayout& layout) noexcept;
+
+} // namespace seinfeld_tv::detail
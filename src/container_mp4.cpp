@@ -0,0 +1,221 @@
+#include "seinfeld_tv/container.hpp"
+
+#include "seinfeld_tv/nal.hpp"
+#include "container_detail.hpp"
+
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+namespace {
+
+constexpr std::uint32_t kNonSyncSample = 0x00010000;
+
+std::uint32_t be32(const std::byte* p) noexcept
+{
+    return std::uint32_t(std::to_integer<std::uint8_t>(p[0])) << 24
+        | std::uint32_t(std::to_integer<std::uint8_t>(p[1])) << 16
+        | std::uint32_t(std::to_integer<std::uint8_t>(p[2])) << 8
+        | std::uint32_t(std::to_integer<std::uint8_t>(p[3]));
+}
+
+std::uint64_t be64(const std::byte* p) noexcept
+{
+    return std::uint64_t(be32(p)) << 32 | be32(p + 4);
+}
+
+struct Box {
+    char type[4];
+    std::uint64_t offset; ///< of the box header, relative to the parent buffer
+    std::uint64_t size;   ///< including header
+    std::span<const std::byte> body;
+
+    bool is(const char* t) const noexcept { return std::memcmp(type, t, 4) == 0; }
+};
+
+/// Iterates sibling boxes in `buf`; stops at the first malformed header.
+class BoxReader {
+public:
+    explicit BoxReader(std::span<const std::byte> buf) noexcept : buf_(buf) {}
+
+    std::optional<Box> next() noexcept
+    {
+        if (pos_ > buf_.size() || buf_.size() - pos_ < 8)
+            return std::nullopt;
+        const std::byte* p = buf_.data() + pos_;
+        std::uint64_t size = be32(p);
+        std::size_t header = 8;
+        if (size == 1) {
+            if (buf_.size() - pos_ < 16)
+                return std::nullopt;
+            size = be64(p + 8);
+            header = 16;
+        } else if (size == 0) {
+            size = buf_.size() - pos_;
+        }
+        if (size < header || size > buf_.size() - pos_)
+            return std::nullopt;
+        Box box{};
+        std::memcpy(box.type, p + 4, 4);
+        box.offset = pos_;
+        box.size = size;
+        box.body = buf_.subspan(pos_ + header, size - header);
+        pos_ += size;
+        return box;
+    }
+
+private:
+    std::span<const std::byte> buf_;
+    std::size_t pos_ = 0;
+};
+
+std::optional<Box> find_child(std::span<const std::byte> parent, const char* type) noexcept
+{
+    BoxReader r(parent);
+    while (auto b = r.next())
+        if (b->is(type))
+            return b;
+    return std::nullopt;
+}
+
+struct VideoTrack {
+    std::uint32_t track_id = 0;
+    std::uint32_t timescale = 0;
+    /// FNV-1a of the stsd sample entries (avcC/hvcC live inside), 0 if absent.
+    std::uint64_t sample_description = 0;
+};
+
+std::optional<VideoTrack> find_video_track(std::span<const std::byte> moov) noexcept
+{
+    BoxReader r(moov);
+    while (auto trak = r.next()) {
+        if (!trak->is("trak"))
+            continue;
+        auto tkhd = find_child(trak->body, "tkhd");
+        auto mdia = find_child(trak->body, "mdia");
+        if (!tkhd || !mdia || tkhd->body.size() < 24)
+            continue;
+        auto hdlr = find_child(mdia->body, "hdlr");
+        auto mdhd = find_child(mdia->body, "mdhd");
+        if (!hdlr || !mdhd || hdlr->body.size() < 12 || std::memcmp(&hdlr->body[8], "vide", 4) != 0)
+            continue;
+        const bool v1 = std::to_integer<unsigned>(tkhd->body[0]) == 1;
+        const bool mdhd_v1 = std::to_integer<unsigned>(mdhd->body[0]) == 1;
+        if (mdhd->body.size() < (mdhd_v1 ? 24u : 16u))
+            continue;
+        VideoTrack t;
+        t.track_id = be32(&tkhd->body[v1 ? 20 : 12]);
+        t.timescale = be32(&mdhd->body[mdhd_v1 ? 20 : 12]);
+        if (auto minf = find_child(mdia->body, "minf"))
+            if (auto stbl = find_child(minf->body, "stbl"))
+                if (auto stsd = find_child(stbl->body, "stsd"))
+                    t.sample_description = nal::fnv1a(
+                        {reinterpret_cast<const std::uint8_t*>(stsd->body.data()), stsd->body.size()});
+        if (t.timescale != 0)
+            return t;
+    }
+    return std::nullopt;
+}
+
+struct FragmentInfo {
+    std::uint64_t decode_time = 0;
+    bool sync = true;
+    bool found = false;
+};
+
+/// Reads tfdt and the first sample's flags for `track_id` from a moof.
+FragmentInfo inspect_moof(std::span<const std::byte> moof, std::uint32_t track_id) noexcept
+{
+    FragmentInfo info;
+    BoxReader r(moof);
+    while (auto traf = r.next()) {
+        if (!traf->is("traf"))
+            continue;
+        auto tfhd = find_child(traf->body, "tfhd");
+        if (!tfhd || tfhd->body.size() < 8 || be32(&tfhd->body[4]) != track_id)
+            continue;
+        info.found = true;
+
+        std::optional<std::uint32_t> first_flags;
+        const std::uint32_t tfhd_flags = be32(&tfhd->body[0]) & 0xffffff;
+        std::size_t at = 8;
+        at += (tfhd_flags & 0x01) ? 8 : 0;
+        at += (tfhd_flags & 0x02) ? 4 : 0;
+        at += (tfhd_flags & 0x08) ? 4 : 0;
+        at += (tfhd_flags & 0x10) ? 4 : 0;
+        if ((tfhd_flags & 0x20) && at + 4 <= tfhd->body.size())
+            first_flags = be32(&tfhd->body[at]);
+
+        if (auto tfdt = find_child(traf->body, "tfdt")) {
+            const bool v1 = tfdt->body.size() >= 12 && std::to_integer<unsigned>(tfdt->body[0]) == 1;
+            if (v1)
+                info.decode_time = be64(&tfdt->body[4]);
+            else if (tfdt->body.size() >= 8)
+                info.decode_time = be32(&tfdt->body[4]);
+        }
+        if (auto trun = find_child(traf->body, "trun"); trun && trun->body.size() >= 8) {
+            const std::uint32_t flags = be32(&trun->body[0]) & 0xffffff;
+            std::size_t p = 8 + ((flags & 0x01) ? 4 : 0);
+            if ((flags & 0x04) && p + 4 <= trun->body.size()) {
+                first_flags = be32(&trun->body[p]);
+            } else if (flags & 0x400) {
+                p += (flags & 0x04) ? 4 : 0;
+                p += (flags & 0x100) ? 4 : 0;
+                p += (flags & 0x200) ? 4 : 0;
+                if (p + 4 <= trun->body.size())
+                    first_flags = be32(&trun->body[p]);
+            }
+        }
+        info.sync = !first_flags || !(*first_flags & kNonSyncSample);
+        break;
+    }
+    return info;
+}
+
+} // namespace
+
+ContainerLayout scan_fmp4(std::span<const std::byte> file)
+{
+    ContainerLayout layout;
+    layout.container = Container::Fmp4;
+    layout.file_size = file.size();
+
+    std::optional<VideoTrack> video;
+    std::optional<std::uint64_t> origin;
+    std::uint64_t last_decode = 0;
+
+    BoxReader r(file);
+    while (auto box = r.next()) {
+        if (box->is("moov")) {
+            video = find_video_track(box->body);
+            layout.init.push_back({0, box->offset + box->size});
+            continue;
+        }
+        if (!box->is("moof") || !video)
+            continue;
+        auto frag = inspect_moof(box->body, video->track_id);
+        if (!frag.found)
+            continue;
+        if (!origin)
+            origin = frag.decode_time;
+        last_decode = std::max(last_decode, frag.decode_time);
+        // CMAF fragments that begin on a sync sample begin on an IDR; codec
+        // parameters are out-of-band in the sample description.
+        if (frag.sync)
+            layout.gops.push_back({rescale_to_pts(frag.decode_time - *origin, video->timescale), box->offset, 0,
+                                   kGopClosed, 0});
+    }
+
+    if (!video)
+        throw std::runtime_error("container: no video track in fMP4");
+    if (video->sample_description)
+        layout.param_sets.push_back(video->sample_description);
+    detail::fill_gop_sizes(layout);
+    if (origin)
+        layout.duration_pts = rescale_to_pts(last_decode - *origin, video->timescale);
+    return layout;
+}
+
+} // namespace seinfeld_tv
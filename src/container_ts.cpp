@@ -0,0 +1,129 @@
+#include "seinfeld_tv/container.hpp"
+
+#include "seinfeld_tv/nal.hpp"
+#include "seinfeld_tv/ts_packet.hpp"
+#include "container_detail.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// Leading access-unit bytes inspected per PES; enough for AUD, SEI and
+/// parameter sets ahead of the first slice header.
+constexpr std::size_t kInspectBytes = 4096;
+
+} // namespace
+
+ContainerLayout scan_ts(std::span<const std::byte> file)
+{
+    ContainerLayout layout;
+    layout.container = Container::MpegTs;
+    layout.file_size = file.size();
+
+    std::optional<std::uint16_t> pmt_pid;
+    std::optional<std::uint64_t> pat_offset, pmt_offset;
+    ts::PtsUnwrapper unwrap;
+    Pts last_pts = 0;
+    bool have_video = false;
+    std::optional<nal::Codec> codec;
+    std::uint16_t current_params = 0;
+
+    // The PES currently being inspected for random-access NAL units.
+    struct Candidate {
+        bool active = false;
+        bool random_access = false;
+        std::uint64_t offset = 0;
+        Pts pts = 0;
+        std::vector<std::uint8_t> es;
+    } cand;
+    cand.es.reserve(kInspectBytes + kTsPacketSize);
+
+    auto finish = [&] {
+        if (!cand.active)
+            return;
+        cand.active = false;
+        nal::AccessUnitInfo info;
+        if (codec)
+            info = nal::inspect_access_unit(*codec, cand.es);
+        if (info.has_param_sets)
+            current_params = detail::intern_param_set(layout, info.param_fingerprint);
+        if (!cand.random_access && !info.random_access)
+            return;
+        std::uint16_t flags = 0;
+        if (info.closed)
+            flags |= kGopClosed;
+        if (info.has_param_sets)
+            flags |= kGopParamSets;
+        layout.gops.push_back({cand.pts, cand.offset, 0, flags, current_params});
+    };
+
+    const std::size_t packets = file.size() / kTsPacketSize;
+    for (std::size_t i = 0; i < packets; ++i) {
+        const std::uint64_t offset = std::uint64_t{i} * kTsPacketSize;
+        auto pkt = ts::parse_packet(file.data() + offset);
+        if (!pkt)
+            throw std::runtime_error("container: lost TS sync");
+
+        if (pkt->pid == ts::kPatPid && !pmt_pid) {
+            if ((pmt_pid = ts::parse_pat(ts::psi_section(*pkt))))
+                pat_offset = offset;
+            continue;
+        }
+        if (pmt_pid && pkt->pid == *pmt_pid && !have_video) {
+            const auto map = ts::parse_pmt(ts::psi_section(*pkt));
+            if (map.has_video()) {
+                layout.video_pid = map.video_pid;
+                layout.video_stream_type = map.video_type;
+                if (map.video_type == 0x1b)
+                    codec = nal::Codec::H264;
+                else if (map.video_type == 0x24)
+                    codec = nal::Codec::Hevc;
+                have_video = true;
+                pmt_offset = offset;
+            }
+            continue;
+        }
+        if (!have_video || pkt->pid != layout.video_pid)
+            continue;
+
+        if (pkt->payload_start) {
+            finish();
+            if (auto pes = ts::parse_pes_header(*pkt); pes && pes->pts) {
+                cand.active = true;
+                cand.pts = unwrap(*pes->pts);
+                cand.offset = offset;
+                cand.random_access = pkt->random_access;
+                last_pts = std::max(last_pts, cand.pts);
+                auto* es = reinterpret_cast<const std::uint8_t*>(pkt->payload);
+                cand.es.assign(es + pes->header_size, es + pkt->payload_size);
+            }
+        } else if (cand.active && pkt->payload) {
+            auto* p = reinterpret_cast<const std::uint8_t*>(pkt->payload);
+            cand.es.insert(cand.es.end(), p, p + pkt->payload_size);
+        }
+        if (cand.active && cand.es.size() >= kInspectBytes)
+            finish();
+    }
+    finish();
+
+    if (!have_video)
+        throw std::runtime_error("container: no video stream in TS");
+    layout.init.push_back({*pat_offset, kTsPacketSize});
+    layout.init.push_back({*pmt_offset, kTsPacketSize});
+    // Timestamps are re-based so the first keyframe is the file's origin.
+    if (!layout.gops.empty() && layout.gops.front().pts != 0) {
+        const Pts origin = layout.gops.front().pts;
+        for (auto& g : layout.gops)
+            g.pts -= origin;
+        last_pts -= origin;
+    }
+    layout.duration_pts = last_pts;
+    detail::fill_gop_sizes(layout);
+    return layout;
+}
+
+} // namespace seinfeld_tv
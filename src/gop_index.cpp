@@ -0,0 +1,120 @@
+#include "seinfeld_tv/gop_index.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace seinfeld_tv {
+
+using namespace gop_format;
+
+namespace {
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("gop index: ") + what);
+}
+
+} // namespace
+
+std::filesystem::path GopIndex::sidecar_path(const std::filesystem::path& media)
+{
+    auto p = media;
+    p += ".gop";
+    return p;
+}
+
+GopIndex GopIndex::open_or_build(const std::filesystem::path& media, const ContentHash& hash)
+{
+    return open_or_build(media, hash, sidecar_path(media));
+}
+
+GopIndex GopIndex::open_or_build(const std::filesystem::path& media, const ContentHash& hash,
+                                 const std::filesystem::path& sidecar)
+{
+    std::error_code ec;
+    if (std::filesystem::exists(sidecar, ec)) {
+        try {
+            GopIndex index(sidecar);
+            if (index.hash() == hash)
+                return index;
+        } catch (const std::runtime_error&) {
+            // Stale format or torn file from an older build: rebuild below.
+        }
+    }
+    MappedFile source(media);
+    write(sidecar, scan_container(source.bytes()), hash);
+    return GopIndex(sidecar);
+}
+
+void GopIndex::write(const std::filesystem::path& sidecar, const ContainerLayout& layout, const ContentHash& hash)
+{
+    GopHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.header_size = sizeof header;
+    header.hash = hash;
+    header.source_size = layout.file_size;
+    header.duration_pts = layout.duration_pts;
+    header.gop_count = static_cast<std::uint32_t>(layout.gops.size());
+    header.init_count = static_cast<std::uint32_t>(layout.init.size());
+    header.param_set_count = static_cast<std::uint32_t>(layout.param_sets.size());
+    header.container = static_cast<std::uint8_t>(layout.container);
+    header.video_stream_type = layout.video_stream_type;
+    header.video_pid = layout.video_pid;
+
+    std::vector<std::byte> image;
+    auto append = [&](const void* data, std::size_t size) {
+        auto* p = static_cast<const std::byte*>(data);
+        image.insert(image.end(), p, p + size);
+    };
+    append(&header, sizeof header);
+    append(layout.param_sets.data(), layout.param_sets.size() * sizeof(std::uint64_t));
+    append(layout.init.data(), layout.init.size() * sizeof(FileExtent));
+    append(layout.gops.data(), layout.gops.size() * sizeof(GopEntry));
+    write_file_atomic(sidecar, image);
+}
+
+GopIndex::GopIndex(const std::filesystem::path& sidecar)
+    : file_(sidecar)
+{
+    if (file_.size() < sizeof(GopHeader))
+        corrupt("truncated header");
+    header_ = reinterpret_cast<const GopHeader*>(file_.data());
+    if (std::memcmp(header_->magic, kMagic, sizeof kMagic) != 0)
+        corrupt("bad magic");
+    if (header_->version != kVersion || header_->header_size != sizeof(GopHeader))
+        corrupt("unsupported version");
+
+    const std::uint64_t params_off = sizeof(GopHeader);
+    const std::uint64_t init_off = params_off + std::uint64_t{header_->param_set_count} * sizeof(std::uint64_t);
+    const std::uint64_t gops_off = init_off + std::uint64_t{header_->init_count} * sizeof(FileExtent);
+    const std::uint64_t end = gops_off + std::uint64_t{header_->gop_count} * sizeof(GopEntry);
+    if (end != file_.size())
+        corrupt("size mismatch");
+
+    view_.container = static_cast<Container>(header_->container);
+    view_.param_sets = {reinterpret_cast<const std::uint64_t*>(file_.data() + params_off), header_->param_set_count};
+    view_.init = {reinterpret_cast<const FileExtent*>(file_.data() + init_off), header_->init_count};
+    view_.gops = {reinterpret_cast<const GopEntry*>(file_.data() + gops_off), header_->gop_count};
+    view_.file_size = header_->source_size;
+    view_.duration_pts = header_->duration_pts;
+
+    for (const auto& g : view_.gops)
+        if (g.offset + g.size > view_.file_size || (!view_.param_sets.empty() && g.param_set >= view_.param_sets.size()))
+            corrupt("entry out of bounds");
+}
+
+std::size_t GopIndex::seek(Pts pts) const noexcept
+{
+    auto gops = view_.gops;
+    auto it = std::upper_bound(gops.begin(), gops.end(), pts,
+        [](Pts t, const GopEntry& g) { return t < g.pts; });
+    return it == gops.begin() ? 0 : static_cast<std::size_t>(it - gops.begin() - 1);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,161 @@
+#include "seinfeld_tv/guide.hpp"
+
+#include "seinfeld_tv/timeline.hpp"
+
+#include "json_detail.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace seinfeld_tv {
+
+namespace {
+
+using detail::append_json_string;
+
+void append_time(std::string& out, Pts channel_pts)
+{
+    const std::time_t secs = static_cast<std::time_t>(channel_pts / kPtsPerSecond);
+    std::tm tm{};
+    ::gmtime_r(&secs, &tm);
+    char buf[64];
+    std::snprintf(buf, sizeof buf, "\"%04d-%02d-%02dT%02d:%02d:%02dZ\"", tm.tm_year + 1900, tm.tm_mon + 1,
+                  tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    out += buf;
+}
+
+/// Appends a non-empty `piece` to a JSON list, after a comma unless the
+/// list is still `empty`.
+void append_item(std::string& out, bool& empty, std::string_view piece)
+{
+    if (piece.empty())
+        return;
+    if (!empty)
+        out += ',';
+    out += piece;
+    empty = false;
+}
+
+/// One episode airing, breaks included.
+struct Program {
+    Pts start = 0;
+    Pts end = 0;
+    EpisodeId episode = kInvalidEpisode;
+    Pts out_pts = 0; ///< source time the last part ended at
+};
+
+std::vector<Program> programs(std::span<const TimelineEntry> entries)
+{
+    std::vector<Program> out;
+    for (const auto& e : entries) {
+        if (e.flags & kEntryBreak)
+            continue;
+        // A split part that resumes where the last program left off is the
+        // same airing, back from a break.
+        if (!out.empty() && (e.flags & kEntrySplit) && out.back().episode == e.episode_id &&
+            out.back().out_pts == e.in_pts) {
+            out.back().end = e.end_pts();
+            out.back().out_pts = e.out_pts;
+            continue;
+        }
+        out.push_back({e.start_pts, e.end_pts(), e.episode_id, e.out_pts});
+    }
+    return out;
+}
+
+Pts floor_to(Pts t, Pts step) noexcept
+{
+    const Pts q = t / step;
+    return (t % step != 0 && t < 0 ? q - 1 : q) * step;
+}
+
+} // namespace
+
+ProgramGuide::ProgramGuide(const Channel& channel) : channel_(channel)
+{
+    head_ = "{\"channel\":";
+    append_json_string(head_, channel.name());
+    head_ += ",\"programs\":[";
+}
+
+void ProgramGuide::append(std::string& out, Pts from, Pts span)
+{
+    const auto revision = channel_.scheduler().revision();
+    bool built, current;
+    {
+        auto guard = buckets_.read();
+        built = static_cast<bool>(guard);
+        current = built && guard->revision == revision;
+    }
+    // Only the very first build makes requests wait.
+    if (!current)
+        refresh(!built);
+
+    out += head_;
+    auto guard = buckets_.read();
+    if (guard && !guard->starting.empty() && span > 0) {
+        const auto n = static_cast<Pts>(guard->starting.size());
+        const Pts first = std::clamp(floor_to(from - guard->origin, kBucket) / kBucket, Pts{0}, n);
+        const Pts last = std::clamp((from + span - guard->origin + kBucket - 1) / kBucket, Pts{0}, n);
+        bool empty = true;
+        if (first < last)
+            append_item(out, empty, guard->carried[first]);
+        for (Pts b = first; b < last; ++b)
+            append_item(out, empty, guard->starting[b]);
+    }
+    out += "]}";
+}
+
+void ProgramGuide::refresh(bool wait)
+{
+    std::unique_lock lock(refresh_mutex_, std::defer_lock);
+    if (wait)
+        lock.lock();
+    else if (!lock.try_lock())
+        return;
+    // Read the revision first: a publish racing with the build leaves the
+    // new buckets marked stale, so they are built again.
+    const auto revision = channel_.scheduler().revision();
+    if (auto guard = buckets_.read(); guard && guard->revision == revision)
+        return;
+
+    auto next = std::make_unique<Buckets>();
+    next->revision = revision;
+    {
+        auto timeline = channel_.scheduler().timeline();
+        if (timeline && !timeline->entries().empty()) {
+            const auto& catalog = timeline->catalog();
+            next->origin = floor_to(timeline->begin_pts(), kBucket);
+            const auto n = static_cast<std::size_t>((timeline->end_pts() - next->origin + kBucket - 1) / kBucket);
+            next->starting.resize(n);
+            next->carried.resize(n);
+            std::string item;
+            for (const auto& p : programs(timeline->entries())) {
+                const auto& record = catalog.episode(p.episode);
+                item = "{\"start\":";
+                append_time(item, p.start);
+                item += ",\"end\":";
+                append_time(item, p.end);
+                item += ",\"season\":" + std::to_string(record.season);
+                item += ",\"episode\":" + std::to_string(record.episode);
+                item += ",\"title\":";
+                append_json_string(item, catalog.title(record));
+                item += '}';
+
+                const auto b = static_cast<std::size_t>((p.start - next->origin) / kBucket);
+                if (!next->starting[b].empty())
+                    next->starting[b] += ',';
+                next->starting[b] += item;
+                for (auto c = b + 1; c < n && next->origin + static_cast<Pts>(c) * kBucket < p.end; ++c)
+                    next->carried[c] = item;
+            }
+        }
+    }
+    buckets_.publish(std::move(next));
+}
+
+} // namespace seinfeld_tv
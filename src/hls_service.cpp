@@ -0,0 +1,603 @@
+#include "seinfeld_tv/hls_service.hpp"
+
+#include "seinfeld_tv/timeline.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+namespace seinfeld_tv {
+
+namespace {
+
+constexpr std::string_view kPlaylistType = "application/vnd.apple.mpegurl";
+constexpr std::string_view kTsType = "video/mp2t";
+constexpr std::string_view kFmp4Type = "video/mp4";
+constexpr std::string_view kJsonType = "application/json";
+// A blocking reload is only answered once the segment exists, so the
+// response can be shared by caches for as long as it is current.
+constexpr std::string_view kPlaylistCache = "max-age=1";
+constexpr std::string_view kSegmentCache = "max-age=3600";
+// The guide only moves on at bucket boundaries and on schedule edits.
+constexpr std::string_view kGuideCache = "max-age=60";
+constexpr Pts kGuideHours = 6;
+constexpr Pts kGuideMaxHours = 48;
+/// How often a request parked on a peer fetch looks for its segment.
+constexpr Pts kPeerPoll = kPtsPerSecond / 50;
+
+std::optional<std::uint64_t> parse_u64(std::string_view s) noexcept
+{
+    std::uint64_t v = 0;
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc{} || end != s.data() + s.size() || s.empty())
+        return std::nullopt;
+    return v;
+}
+
+void append_date_time(std::string& out, Pts channel_pts)
+{
+    const std::time_t secs = static_cast<std::time_t>(channel_pts / kPtsPerSecond);
+    const int ms = static_cast<int>(pts_to_ms(channel_pts % kPtsPerSecond));
+    std::tm tm{};
+    ::gmtime_r(&secs, &tm);
+    char buf[64];
+    std::snprintf(buf, sizeof buf, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tm.tm_year + 1900, tm.tm_mon + 1,
+                  tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, ms);
+    out += buf;
+}
+
+std::string_view extension(Container c) noexcept
+{
+    return c == Container::Fmp4 ? ".m4s" : ".ts";
+}
+
+/// Seconds with millisecond precision, as EXTINF and the LL-HLS
+/// attributes take them.
+void append_seconds(std::string& out, Pts duration)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.3f", static_cast<double>(duration) / static_cast<double>(kPtsPerSecond));
+    out += buf;
+}
+
+void append_part_uri(std::string& out, const LiveSegment& s, std::size_t part)
+{
+    out += std::to_string(s.sequence);
+    out += '.';
+    out += std::to_string(part);
+    out += extension(s.container);
+}
+
+} // namespace
+
+HlsService::HlsService(Station& station, PlayoutOptions options)
+    : station_(station)
+{
+    for (std::uint32_t id = 0; id < station.size(); ++id) {
+        auto state = std::make_unique<ChannelState>();
+        state->playout = std::make_unique<Playout>(station.library(), *station.channel(id), options);
+        state->guide = std::make_unique<ProgramGuide>(*station.channel(id));
+        state->target_seconds = static_cast<int>((options.target_duration + kPtsPerSecond - 1) / kPtsPerSecond);
+        state->part_target = options.part_target;
+        channels_.push_back(std::move(state));
+    }
+}
+
+Playout* HlsService::playout(std::string_view channel) noexcept
+{
+    auto* c = station_.channel(channel);
+    return c && c->id() < channels_.size() ? channels_[c->id()]->playout.get() : nullptr;
+}
+
+HttpResponse HlsService::handle(const HttpRequest& request)
+{
+    const auto& path = request.path;
+    const Route route = path.ends_with(".m3u8")                                                   ? kPlaylistRoute
+                        : path.ends_with(".ts") || path.ends_with(".m4s") || path.ends_with(".mp4") ? kMediaRoute
+                                                                                                      : kOtherRoute;
+    metrics::Timer timer(latency_[route]);
+    return dispatch(request);
+}
+
+HttpResponse HlsService::dispatch(const HttpRequest& request)
+{
+    std::string_view path = request.path.substr(1);
+    if (path == "metrics") {
+        auto r = HttpResponse::text(200, render_metrics(), metrics::Exposition::kContentType);
+        r.cache_control = "no-store";
+        return r;
+    }
+    if (path == "guide.json")
+        return guide(nullptr, request);
+    const auto slash = path.find('/');
+    if (slash == std::string_view::npos)
+        return HttpResponse::text(404, "not found\n");
+    auto* channel = station_.channel(path.substr(0, slash));
+    if (!channel || channel->id() >= channels_.size())
+        return HttpResponse::text(404, "no such channel\n");
+    auto& state = *channels_[channel->id()];
+    const auto file = path.substr(slash + 1);
+    const auto key = request.param("session");
+    if (file == "hint.json")
+        return hint(key ? sessions_.find(*key) : std::nullopt);
+    if (file == "guide.json")
+        return guide(&state, request);
+    if (file.starts_with("at-"))
+        return peer_segment(state, file.substr(3));
+    std::optional<SessionHandle> session;
+    if (key && !key->empty())
+        session = sessions_.touch(*key, channel->id(), channel_time_now());
+    if (file == "live.m3u8")
+        return playlist(state, request, false);
+    if (file == "ll.m3u8") {
+        if (state.playout->options().part_target == 0)
+            return HttpResponse::text(404, "channel has no partial segments\n");
+        return playlist(state, request, true);
+    }
+    return media(state, file, session);
+}
+
+void HlsService::enable_cluster(ClusterMap cluster, PeerFetchOptions options)
+{
+    peers_.reset();
+    cluster_.emplace(std::move(cluster));
+    peers_ = std::make_unique<PeerFetcher>(*cluster_, station_.library().segments(), options);
+}
+
+void HlsService::enable_history(PlayHistory& history)
+{
+    history_ = &history;
+    for (auto& state : channels_)
+        state->playout->set_history(&history);
+}
+
+std::string HlsService::render_metrics() const
+{
+    metrics::Exposition out;
+    constexpr std::array<std::string_view, kRoutes> kRouteNames = {"playlist", "media", "other"};
+    out.family("stv_request_seconds", "histogram", "Handler time per request, each retry of a parked one included.");
+    for (std::size_t r = 0; r < kRoutes; ++r)
+        out.latency("stv_request_seconds", metrics::label("route", kRouteNames[r]), latency_[r]);
+
+    out.family("stv_segment_build_seconds", "histogram", "Time to plan and cut each extension of a segment window.");
+    for (const auto& state : channels_)
+        out.latency("stv_segment_build_seconds", metrics::label("channel", state->playout->channel().name()),
+                    state->playout->build_latency());
+
+    const auto cache = station_.library().segments().stats();
+    out.family("stv_segment_cache_hits_total", "counter", "Segment cache lookups that hit.");
+    out.sample("stv_segment_cache_hits_total", "", cache.hits);
+    out.family("stv_segment_cache_misses_total", "counter", "Segment cache lookups that missed.");
+    out.sample("stv_segment_cache_misses_total", "", cache.misses);
+    out.family("stv_segment_cache_hit_ratio", "gauge", "Hits over lookups since start.");
+    out.sample("stv_segment_cache_hit_ratio", "", cache.hit_rate());
+    out.family("stv_segment_cache_bytes", "gauge", "Bytes held by the segment cache.");
+    out.sample("stv_segment_cache_bytes", "", cache.bytes);
+
+    std::vector<std::size_t> viewers;
+    sessions_.count(&viewers);
+    viewers.resize(channels_.size());
+    out.family("stv_viewers", "gauge", "Open viewer sessions.");
+    for (std::size_t i = 0; i < channels_.size(); ++i)
+        out.sample("stv_viewers", metrics::label("channel", channels_[i]->playout->channel().name()),
+                   std::uint64_t{viewers[i]});
+
+    // Lag is sampled where planning happens, when a request finds the
+    // window short, so an idle channel reports none.
+    out.family("stv_scheduler_lag_seconds", "histogram",
+               "How far segment planning was behind the live edge plus lookahead when a request extended it.");
+    for (const auto& state : channels_)
+        out.latency("stv_scheduler_lag_seconds", metrics::label("channel", state->playout->channel().name()),
+                    state->playout->plan_lag());
+    const Pts now = channel_time_now();
+    out.family("stv_timeline_ahead_seconds", "gauge", "Published schedule left after now.");
+    for (const auto& state : channels_) {
+        const auto& channel = state->playout->channel();
+        const Pts end = channel.scheduler().timeline()->end_pts();
+        out.sample("stv_timeline_ahead_seconds", metrics::label("channel", channel.name()),
+                   static_cast<double>(end - now) / kPtsPerSecond);
+    }
+
+    if (peers_) {
+        const auto p = peers_->stats();
+        out.family("stv_peer_fetch_seconds", "histogram", "Time to copy a segment from its owner, failures included.");
+        out.latency("stv_peer_fetch_seconds", "", peers_->fetch_latency());
+        out.family("stv_peer_fetches_total", "counter", "Peer fetches by outcome.");
+        out.sample("stv_peer_fetches_total", metrics::label("result", "fetched"), p.fetched);
+        out.sample("stv_peer_fetches_total", metrics::label("result", "failed"), p.failed);
+        out.sample("stv_peer_fetches_total", metrics::label("result", "refused"), p.refused);
+    }
+    for (const auto& source : metric_sources_)
+        source(out);
+    return out.take();
+}
+
+HttpResponse HlsService::hint(std::optional<SessionHandle> session) const
+{
+    const auto info = session ? sessions_.get(*session) : std::nullopt;
+    if (!info)
+        return HttpResponse::text(404, "no such session\n");
+    std::string body = "{\"bandwidth\":" + std::to_string(info->bandwidth_bps) + ",\"rendition\":";
+    if (const auto i = rendition_hint(ladder_, info->bandwidth_bps))
+        body += "\"" + ladder_[*i].name + "\"}\n";
+    else
+        body += "null}\n";
+    auto r = HttpResponse::text(200, std::move(body), kJsonType);
+    r.cache_control = "no-store";
+    return r;
+}
+
+HttpResponse HlsService::guide(ChannelState* state, const HttpRequest& request)
+{
+    Pts hours = kGuideHours;
+    if (const auto h = request.param("hours")) {
+        const auto v = parse_u64(*h);
+        if (!v || *v == 0 || *v > static_cast<std::uint64_t>(kGuideMaxHours))
+            return HttpResponse::text(400, "bad hours\n");
+        hours = static_cast<Pts>(*v);
+    }
+    const Pts now = channel_time_now();
+    const Pts span = hours * kPtsPerHour;
+    std::string body;
+    if (state) {
+        state->guide->append(body, now, span);
+    } else {
+        body = "{\"channels\":[";
+        for (std::size_t i = 0; i < channels_.size(); ++i) {
+            if (i > 0)
+                body += ',';
+            channels_[i]->guide->append(body, now, span);
+        }
+        body += ']';
+        body += '}';
+    }
+    body += '\n';
+    auto r = HttpResponse::text(200, std::move(body), kJsonType);
+    r.cache_control = kGuideCache;
+    return r;
+}
+
+HttpResponse HlsService::playlist(ChannelState& state, const HttpRequest& request, bool parts)
+{
+    bool delta = false;
+    if (auto skip = request.param("_HLS_skip")) {
+        if (*skip != "YES" && *skip != "v2")
+            return HttpResponse::text(400, "bad _HLS_skip\n");
+        delta = true;
+    }
+    const auto msn = request.param("_HLS_msn");
+    const auto part = request.param("_HLS_part");
+    if (part && !msn)
+        return HttpResponse::text(400, "_HLS_part without _HLS_msn\n");
+
+    const Pts now = channel_time_now();
+    std::shared_ptr<const Rendered> rendered;
+    {
+        auto window = state.playout->window(now);
+        const auto& segments = window->segments;
+        const auto end = window->available_end(now);
+        if (end == 0)
+            return HttpResponse::text(503, "channel is off the air\n");
+
+        if (msn) {
+            const auto want = parse_u64(*msn);
+            const auto want_part = part ? parse_u64(*part) : std::optional<std::uint64_t>(0);
+            if (!want || !want_part)
+                return HttpResponse::text(400, "bad _HLS_msn or _HLS_part\n");
+            if (const auto* s = window->find(*want)) {
+                // A part index past the segment's last means the segment
+                // itself; plain playlists list only whole segments.
+                const bool by_part = parts && part && *want_part < s->parts.size();
+                const Pts ready = by_part ? s->parts[*want_part].available_pts() : s->available_pts();
+                if (ready > now)
+                    return HttpResponse::wait_until(ready);
+            } else if (*want > segments[end - 1]->sequence) {
+                return HttpResponse::text(400, "_HLS_msn is too far ahead\n");
+            }
+        }
+        rendered = playlists(state, *window, now);
+    }
+
+    const auto& body = rendered->bodies[parts ? (delta ? kPartsDelta : kParts) : (delta ? kDelta : kFull)];
+    auto r = HttpResponse::of_shared(rendered, std::as_bytes(std::span(body)), kPlaylistType);
+    r.cache_control = kPlaylistCache;
+    return r;
+}
+
+std::shared_ptr<const HlsService::Rendered> HlsService::playlists(ChannelState& state, const LiveWindow& window,
+                                                                  Pts now)
+{
+    const auto& segments = window.segments;
+    const auto end = window.available_end(now);
+    Edge edge{segments[end - 1]->sequence + 1, 0};
+    if (end < segments.size())
+        edge.parts = segments[end]->available_parts(now);
+
+    // Anything rendered at or past this edge is current: all variants of
+    // it are complete, and a newer edge only lists more.
+    auto current = [&]() -> std::shared_ptr<const Rendered> {
+        auto guard = state.rendered.read();
+        return *guard && (*guard)->edge >= edge ? *guard : nullptr;
+    };
+    if (auto r = current())
+        return r;
+    std::lock_guard lock(state.render_mutex);
+    if (auto r = current())
+        return r;
+
+    for (std::size_t i = 0; i < end; ++i) {
+        const int rounded = static_cast<int>(std::lround(static_cast<double>(segments[i]->duration_pts) / kPtsPerSecond));
+        state.target_seconds = std::max(state.target_seconds, rounded);
+    }
+    for (const auto& s : segments)
+        for (const auto& p : s->parts)
+            state.part_target = std::max(state.part_target, p.duration_pts);
+
+    auto next = std::make_shared<Rendered>();
+    next->edge = edge;
+    PlaylistFormat format{state.playout->options().playlist_segments, state.target_seconds, false, 0};
+    next->bodies[kFull] = render_playlist(window, now, format);
+    format.delta = true;
+    next->bodies[kDelta] = render_playlist(window, now, format);
+    if (state.playout->options().part_target > 0) {
+        format.part_target = state.part_target;
+        next->bodies[kPartsDelta] = render_playlist(window, now, format);
+        format.delta = false;
+        next->bodies[kParts] = render_playlist(window, now, format);
+    }
+    std::shared_ptr<const Rendered> published = std::move(next);
+    state.rendered.publish(std::make_unique<const std::shared_ptr<const Rendered>>(published));
+    return published;
+}
+
+std::string HlsService::render_playlist(const LiveWindow& window, Pts now, const PlaylistFormat& format)
+{
+    const auto& segments = window.segments;
+    const auto end = window.available_end(now);
+    const auto begin = end - std::min(end, format.max_segments);
+    const Pts target = static_cast<Pts>(format.target_seconds) * kPtsPerSecond;
+    const bool with_parts = format.part_target > 0;
+
+    // The segment airing now, listed by its parts alone.
+    std::size_t live_parts = 0;
+    if (with_parts && end < segments.size())
+        live_parts = segments[end]->available_parts(now);
+    const Pts edge_pts = live_parts > 0 ? segments[end]->parts[live_parts - 1].available_pts()
+                                        : segments[end - 1]->available_pts();
+    const Pts skip_until = 6 * target;
+    std::size_t first = begin;
+    if (format.delta)
+        while (first < end && segments[first]->available_pts() <= edge_pts - skip_until)
+            ++first;
+    const auto listed_end = end + (live_parts > 0 ? 1 : 0);
+
+    std::string out;
+    out.reserve(256 + (listed_end - first) * (with_parts ? 320 : 96));
+    out += first > begin ? "#EXTM3U\n#EXT-X-VERSION:9\n" : "#EXTM3U\n#EXT-X-VERSION:6\n";
+    out += "#EXT-X-TARGETDURATION:";
+    out += std::to_string(format.target_seconds);
+    out += "\n#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,CAN-SKIP-UNTIL=";
+    append_seconds(out, skip_until);
+    if (with_parts) {
+        out += ",PART-HOLD-BACK=";
+        append_seconds(out, 3 * format.part_target);
+        out += "\n#EXT-X-PART-INF:PART-TARGET=";
+        append_seconds(out, format.part_target);
+    }
+    out += "\n#EXT-X-MEDIA-SEQUENCE:";
+    out += std::to_string(segments[begin]->sequence);
+    out += "\n#EXT-X-DISCONTINUITY-SEQUENCE:";
+    out += std::to_string(segments[begin]->discontinuity);
+    out += '\n';
+    if (first > begin) {
+        out += "#EXT-X-SKIP:SKIPPED-SEGMENTS=";
+        out += std::to_string(first - begin);
+        out += '\n';
+    }
+    for (std::size_t i = first; i < listed_end; ++i) {
+        const auto& s = *segments[i];
+        if (s.new_source && i != begin)
+            out += "#EXT-X-DISCONTINUITY\n";
+        if (i == first || s.new_source) {
+            if (s.init) {
+                out += "#EXT-X-MAP:URI=\"init-";
+                out += std::to_string(s.init_sequence);
+                out += ".mp4\"\n";
+            }
+            out += "#EXT-X-PROGRAM-DATE-TIME:";
+            append_date_time(out, s.channel_pts);
+            out += '\n';
+        }
+        // Parts are only worth listing near the edge, where clients
+        // tune in; older segments are fetched whole.
+        if (with_parts && s.available_pts() > edge_pts - 3 * target) {
+            const auto n = i < end ? s.parts.size() : live_parts;
+            for (std::size_t p = 0; p < n; ++p) {
+                out += "#EXT-X-PART:DURATION=";
+                append_seconds(out, s.parts[p].duration_pts);
+                out += ",URI=\"";
+                append_part_uri(out, s, p);
+                out += "\",INDEPENDENT=YES\n";
+            }
+        }
+        if (i < end) {
+            out += "#EXTINF:";
+            append_seconds(out, s.duration_pts);
+            out += ",\n";
+            out += std::to_string(s.sequence);
+            out += extension(s.container);
+            out += '\n';
+        }
+    }
+    if (with_parts && end < segments.size() && live_parts < segments[end]->parts.size()) {
+        out += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"";
+        append_part_uri(out, *segments[end], live_parts);
+        out += "\"\n";
+    }
+    return out;
+}
+
+HttpResponse HlsService::media(ChannelState& state, std::string_view file, std::optional<SessionHandle> session)
+{
+    const auto dot = file.rfind('.');
+    if (dot == std::string_view::npos)
+        return HttpResponse::text(404, "not found\n");
+    auto stem = file.substr(0, dot);
+    const auto ext = file.substr(dot);
+    const bool init = stem.starts_with("init-") && ext == ".mp4";
+    std::optional<std::uint64_t> part;
+    if (const auto part_dot = stem.find('.'); !init && part_dot != std::string_view::npos) {
+        part = parse_u64(stem.substr(part_dot + 1));
+        if (!part)
+            return HttpResponse::text(404, "not found\n");
+        stem = stem.substr(0, part_dot);
+    }
+    const auto sequence = parse_u64(init ? stem.substr(5) : stem);
+    if (!sequence || (!init && ext != ".ts" && ext != ".m4s"))
+        return HttpResponse::text(404, "not found\n");
+
+    const Pts now = channel_time_now();
+    auto window = state.playout->window(now);
+    const auto* s = window->find(*sequence);
+    if (!s) {
+        const bool expired = !window->segments.empty() && *sequence < window->segments.front()->sequence;
+        return HttpResponse::text(expired ? 410 : 404, expired ? "segment expired\n" : "not found\n");
+    }
+    if (init) {
+        if (!s->init || s->init_sequence != *sequence)
+            return HttpResponse::text(404, "not found\n");
+        auto r = HttpResponse::of_file(*s->init, kFmp4Type);
+        r.cache_control = kSegmentCache;
+        return r;
+    }
+    const auto type = s->container == Container::Fmp4 ? kFmp4Type : kTsType;
+    if (part) {
+        if (*part >= s->parts.size())
+            return HttpResponse::text(404, "not found\n");
+        const auto& p = s->parts[*part];
+        if (p.available_pts() > now)
+            return HttpResponse::wait_until(p.available_pts());
+        auto r = HttpResponse::of_file(p.ref, type);
+        r.cache_control = kSegmentCache;
+        if (session) {
+            if (*part == 0) {
+                sessions_.served(*session, *sequence, kSourceRendition, now);
+                log_viewing(state, *s, *session);
+            }
+            r.delivery_tag = BandwidthEstimator::tag(*session);
+        }
+        return r;
+    }
+    if (s->available_pts() > now)
+        return HttpResponse::wait_until(s->available_pts());
+
+    const auto& channel = state.playout->channel();
+    const SegmentKey key{channel.id(), kSourceRendition, *sequence};
+    auto cached = station_.library().segments().find(key);
+    if (!cached && peers_ && fetch_from_owner(channel, *s, key) == PeerFetcher::Status::Pending)
+        return HttpResponse::wait_until(now + kPeerPoll);
+    if (session) {
+        sessions_.served(*session, *sequence, kSourceRendition, now);
+        log_viewing(state, *s, *session);
+    }
+
+    HttpResponse r;
+    if (cached)
+        r = HttpResponse::of_shared(cached, cached->bytes, type);
+    else
+        r = HttpResponse::of_file(s->ref, type);
+    r.cache_control = kSegmentCache;
+    if (session)
+        r.delivery_tag = BandwidthEstimator::tag(*session);
+    return r;
+}
+
+std::optional<PeerFetcher::Status> HlsService::fetch_from_owner(const Channel& channel, const LiveSegment& s,
+                                                                const SegmentKey& key)
+{
+    const SegmentKey placement{channel.id(), kSourceRendition, static_cast<std::uint64_t>(s.channel_pts)};
+    const auto owner = cluster_->owner(placement);
+    if (owner == cluster_->self())
+        return std::nullopt;
+    std::string path = "/" + channel.name() + "/at-" + std::to_string(s.channel_pts) + "-" +
+                       std::to_string(s.duration_pts) + std::string(extension(s.container));
+    return peers_->request(key, owner, std::move(path));
+}
+
+std::size_t HlsService::warm(std::span<const SegmentKey> keys)
+{
+    if (!peers_)
+        return 0;
+    const Pts now = channel_time_now();
+    auto& cache = station_.library().segments();
+    std::size_t queued = 0;
+    for (const auto& key : keys) {
+        if (key.rendition != kSourceRendition || key.channel >= channels_.size() || cache.find(key))
+            continue;
+        auto& state = *channels_[key.channel];
+        auto window = state.playout->window(now);
+        const auto* s = window->find(key.sequence);
+        if (s && s->available_pts() <= now &&
+            fetch_from_owner(state.playout->channel(), *s, key) == PeerFetcher::Status::Pending)
+            ++queued;
+    }
+    return queued;
+}
+
+void HlsService::log_viewing(ChannelState& state, const LiveSegment& s, SessionHandle session)
+{
+    if (!history_)
+        return;
+    // With every segment fetched, exactly one per minute crosses it.
+    const Pts minute = (s.channel_pts + kPtsPerMinute - 1) / kPtsPerMinute * kPtsPerMinute;
+    if (minute >= s.available_pts())
+        return;
+    const auto& channel = state.playout->channel();
+    const auto timeline = channel.scheduler().timeline();
+    const auto pos = timeline->at(minute);
+    if (!pos || (pos->entry.flags & kEntryBreak) || pos->entry.episode_id >= timeline->catalog().size())
+        return;
+    const auto& record = timeline->catalog().episode(pos->entry.episode_id);
+    history_->record({minute, std::uint64_t{session.slot} << 32 | session.generation, channel.id(),
+                      episode_key(record), static_cast<std::uint32_t>(pos->source_pts() / kPtsPerSecond), 60,
+                      PlayKind::ViewerMinute});
+}
+
+HttpResponse HlsService::peer_segment(ChannelState& state, std::string_view file)
+{
+    // "<pts>-<duration>.<ext>"
+    const auto dash = file.find('-');
+    const auto dot = file.rfind('.');
+    if (dash == std::string_view::npos || dot == std::string_view::npos || dot < dash)
+        return HttpResponse::text(404, "not found\n");
+    const auto start = parse_u64(file.substr(0, dash));
+    const auto duration = parse_u64(file.substr(dash + 1, dot - dash - 1));
+    if (!start || !duration)
+        return HttpResponse::text(404, "not found\n");
+
+    const Pts now = channel_time_now();
+    auto window = state.playout->window(now);
+    const auto& segments = window->segments;
+    const auto it = std::find_if(segments.begin(), segments.end(), [&](const auto& seg) {
+        return static_cast<std::uint64_t>(seg->channel_pts) == *start;
+    });
+    if (it == segments.end() || static_cast<std::uint64_t>((*it)->duration_pts) != *duration ||
+        extension((*it)->container) != file.substr(dot))
+        return HttpResponse::text(404, "not found\n");
+    const auto& s = **it;
+    if (s.available_pts() > now)
+        return HttpResponse::wait_until(s.available_pts());
+
+    const auto type = s.container == Container::Fmp4 ? kFmp4Type : kTsType;
+    HttpResponse r;
+    if (auto cached = station_.library().segments().find({state.playout->channel().id(), kSourceRendition, s.sequence}))
+        r = HttpResponse::of_shared(cached, cached->bytes, type);
+    else
+        r = HttpResponse::of_file(s.ref, type);
+    r.cache_control = kSegmentCache;
+    return r;
+}
+
+} // namespace seinfeld_tv
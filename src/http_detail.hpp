@@ -0,0 +1,30 @@
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+
+/// Header-field matching shared by the server and the HTTP clients (peer
+/// fetches, the load generator). Field names and tokens are ASCII, so
+/// only A-Z fold; every other byte must match exactly.
+namespace seinfeld_tv::detail {
+
+constexpr char ascii_lower(char c) noexcept
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+inline bool iequals(std::string_view a, std::string_view b) noexcept
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return ascii_lower(x) == ascii_lower(y);
+    });
+}
+
+inline bool icontains(std::string_view haystack, std::string_view needle) noexcept
+{
+    return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char x, char y) {
+        return ascii_lower(x) == ascii_lower(y);
+    }) != haystack.end();
+}
+
+} // namespace seinfeld_tv::detail
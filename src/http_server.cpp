@@ -0,0 +1,683 @@
+#include "seinfeld_tv/http_server.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/timeline.hpp"
+#include "seinfeld_tv/trace.hpp"
+#include "seinfeld_tv/uring.hpp"
+
+#include "http_detail.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <deque>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <linux/sockios.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+constexpr std::size_t kHeaderLimit = 8192;
+constexpr std::size_t kRecvChunk = 2048;
+/// Pipes kept per thread for splicing, and the most in use at once; each
+/// is two descriptors. Senders beyond the cap queue for a pipe.
+constexpr std::size_t kPipePool = 64;
+constexpr std::size_t kMaxPipes = 256;
+constexpr int kPipeSize = 256 * 1024;
+constexpr int kListenBacklog = 4096;
+
+__kernel_timespec to_timespec(std::chrono::nanoseconds d) noexcept
+{
+    const auto ns = std::max<std::int64_t>(d.count(), 0);
+    return {ns / 1'000'000'000, ns % 1'000'000'000};
+}
+
+/// Bytes written to the socket but not yet acknowledged by the peer.
+std::uint64_t send_queue(int fd) noexcept
+{
+    int n = 0;
+    if (::ioctl(fd, SIOCOUTQ, &n) != 0 || n < 0)
+        return 0;
+    return static_cast<std::uint64_t>(n);
+}
+
+std::string_view reason(int status) noexcept
+{
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 410: return "Gone";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+using detail::icontains;
+using detail::iequals;
+
+std::string_view trim(std::string_view s) noexcept
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// Parses the request head (everything before the blank line). Returns 0
+/// or the status to reject it with.
+int parse_request(std::string_view head, HttpRequest& req) noexcept
+{
+    auto eol = head.find("\r\n");
+    std::string_view line = head.substr(0, eol);
+    head = eol == std::string_view::npos ? std::string_view{} : head.substr(eol + 2);
+
+    const auto sp1 = line.find(' ');
+    const auto sp2 = line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp2 == sp1)
+        return 400;
+    req.method = line.substr(0, sp1);
+    const auto target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    const auto version = line.substr(sp2 + 1);
+    if (target.empty() || target.front() != '/' || !version.starts_with("HTTP/1."))
+        return 400;
+    const auto q = target.find('?');
+    req.path = target.substr(0, q);
+    req.query = q == std::string_view::npos ? std::string_view{} : target.substr(q + 1);
+    req.keep_alive = version == "HTTP/1.1";
+
+    while (!head.empty()) {
+        eol = head.find("\r\n");
+        line = head.substr(0, eol);
+        head = eol == std::string_view::npos ? std::string_view{} : head.substr(eol + 2);
+        const auto colon = line.find(':');
+        if (colon == std::string_view::npos)
+            return 400;
+        const auto name = line.substr(0, colon);
+        const auto value = trim(line.substr(colon + 1));
+        if (iequals(name, "connection")) {
+            if (icontains(value, "close"))
+                req.keep_alive = false;
+            else if (icontains(value, "keep-alive"))
+                req.keep_alive = true;
+        } else if (iequals(name, "transfer-encoding") || (iequals(name, "content-length") && value != "0")) {
+            return 501;
+        }
+    }
+    if (req.method != "GET" && req.method != "HEAD")
+        return 405;
+    return 0;
+}
+
+std::string response_head(const HttpResponse& r, bool keep_alive)
+{
+    std::string h;
+    h.reserve(192);
+    h += "HTTP/1.1 ";
+    h += std::to_string(r.status);
+    h += ' ';
+    h += reason(r.status);
+    h += "\r\nContent-Type: ";
+    h += r.content_type;
+    h += "\r\nContent-Length: ";
+    h += std::to_string(r.body_size());
+    if (!r.cache_control.empty()) {
+        h += "\r\nCache-Control: ";
+        h += r.cache_control;
+    }
+    h += "\r\nAccess-Control-Allow-Origin: *";
+    h += keep_alive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+    return h;
+}
+
+struct Pipe {
+    UniqueFd read;
+    UniqueFd write;
+};
+
+UniqueFd listen_socket(const std::string& address, std::uint16_t port, std::uint16_t* bound)
+{
+    sockaddr_storage addr{};
+    socklen_t len = 0;
+    int family = AF_INET;
+    if (auto* v4 = reinterpret_cast<sockaddr_in*>(&addr); ::inet_pton(AF_INET, address.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(port);
+        len = sizeof *v4;
+    } else if (auto* v6 = reinterpret_cast<sockaddr_in6*>(&addr);
+               ::inet_pton(AF_INET6, address.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = family = AF_INET6;
+        v6->sin6_port = htons(port);
+        len = sizeof *v6;
+    } else {
+        throw std::invalid_argument("http: bad listen address " + address);
+    }
+
+    UniqueFd fd(::socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (!fd)
+        throw_errno("socket");
+    const int one = 1;
+    if (::setsockopt(fd.get(), SOL_SOCKET, SO_REUSEADDR, &one, sizeof one) != 0
+        || ::setsockopt(fd.get(), SOL_SOCKET, SO_REUSEPORT, &one, sizeof one) != 0)
+        throw_errno("setsockopt");
+    if (::bind(fd.get(), reinterpret_cast<const sockaddr*>(&addr), len) != 0)
+        throw_errno("bind");
+    if (::listen(fd.get(), kListenBacklog) != 0)
+        throw_errno("listen");
+    if (bound) {
+        len = sizeof addr;
+        if (::getsockname(fd.get(), reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+            throw_errno("getsockname");
+        *bound = ntohs(family == AF_INET ? reinterpret_cast<sockaddr_in*>(&addr)->sin_port
+                                         : reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port);
+    }
+    return fd;
+}
+
+} // namespace
+
+std::optional<std::string_view> HttpRequest::param(std::string_view name) const noexcept
+{
+    std::string_view q = query;
+    while (!q.empty()) {
+        const auto amp = q.find('&');
+        const auto pair = q.substr(0, amp);
+        q = amp == std::string_view::npos ? std::string_view{} : q.substr(amp + 1);
+        const auto eq = pair.find('=');
+        if (pair.substr(0, eq) == name)
+            return eq == std::string_view::npos ? std::string_view{} : pair.substr(eq + 1);
+    }
+    return std::nullopt;
+}
+
+HttpResponse HttpResponse::text(int status, std::string body, std::string_view content_type)
+{
+    HttpResponse r;
+    r.status = status;
+    r.content_type = content_type;
+    r.body = std::move(body);
+    return r;
+}
+
+HttpResponse HttpResponse::of_shared(std::shared_ptr<const void> owner, std::span<const std::byte> bytes,
+                                     std::string_view content_type)
+{
+    HttpResponse r;
+    r.content_type = content_type;
+    r.shared_owner = std::move(owner);
+    r.shared = bytes;
+    return r;
+}
+
+HttpResponse HttpResponse::of_file(SegmentRef ref, std::string_view content_type)
+{
+    HttpResponse r;
+    r.content_type = content_type;
+    r.file = std::move(ref);
+    return r;
+}
+
+HttpResponse HttpResponse::wait_until(Pts at)
+{
+    HttpResponse r;
+    r.retry_at = std::max<Pts>(at, 1);
+    return r;
+}
+
+std::uint64_t HttpResponse::body_size() const noexcept
+{
+    return body.size() + shared.size() + (file ? file->size() : 0);
+}
+
+struct HttpServer::Worker {
+    Worker(HttpServer& server, unsigned index, UniqueFd listen_fd)
+        : server(server), index(index), listen_fd(std::move(listen_fd)), wake_fd(::eventfd(0, EFD_CLOEXEC))
+    {
+        if (!wake_fd)
+            throw_errno("eventfd");
+    }
+
+    void run(std::promise<void>& ready);
+    DetachedTask watch_wake();
+    DetachedTask accept_loop();
+    DetachedTask connection(int fd);
+    HttpResponse handle(const HttpRequest& request);
+    Task<bool> send_all(int fd, const void* data, std::size_t size, bool more);
+    Task<bool> send_file(int fd, const SegmentRef& file);
+
+    /// Awaitable for a splice pipe: immediate when one is free, otherwise
+    /// queued until a sender returns one. Empty if none can be had.
+    struct PipeWait {
+        Worker& worker;
+        std::optional<Pipe> pipe;
+        Completion done;
+
+        explicit PipeWait(Worker& w) : worker(w) {}
+
+        bool await_ready()
+        {
+            pipe = worker.try_pipe();
+            return pipe || worker.pipes_out == 0 || worker.stopping;
+        }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            done.waiter = h;
+            worker.pipe_waiters.push_back(this);
+        }
+        std::optional<Pipe> await_resume() noexcept { return std::move(pipe); }
+    };
+
+    /// Returns its pipe to the worker; a pipe that may still hold data is
+    /// closed instead.
+    struct PipeLease {
+        Worker& worker;
+        std::optional<Pipe> pipe;
+        bool drained = false;
+
+        explicit PipeLease(Worker& w) : worker(w) {}
+        PipeLease(const PipeLease&) = delete;
+        PipeLease& operator=(const PipeLease&) = delete;
+
+        ~PipeLease()
+        {
+            if (pipe)
+                worker.release_pipe(drained ? std::move(pipe) : std::nullopt);
+        }
+    };
+
+    std::optional<Pipe> try_pipe();
+    void release_pipe(std::optional<Pipe> pipe);
+    void wake_pipe_waiters();
+
+    HttpServer& server;
+    unsigned index;
+    UniqueFd listen_fd;
+    UniqueFd wake_fd;
+    std::thread thread;
+
+    // Owned by the worker thread.
+    Ring* ring = nullptr;
+    std::vector<Pipe> pipes;
+    std::size_t pipes_out = 0;
+    std::deque<PipeWait*> pipe_waiters;
+    bool stopping = false;
+    bool accepting = false;
+    std::size_t live = 0;
+    std::uint64_t wake_value = 0;
+
+    std::atomic<std::uint64_t> accepted{0};
+    std::atomic<std::uint64_t> requests{0};
+    std::atomic<std::uint64_t> parked{0};
+    std::atomic<std::uint64_t> bytes_sent{0};
+    std::atomic<std::uint64_t> active{0};
+};
+
+void HttpServer::Worker::run(std::promise<void>& ready)
+{
+    try {
+        // One ring per core: pin so the ring, its sockets' softirq work
+        // and the connection frames stay on one CPU's caches.
+        if (const unsigned cpus = std::thread::hardware_concurrency(); cpus > 1) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(index % cpus, &set);
+            ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+        }
+        trace::set_thread_name("http-" + std::to_string(index));
+        Ring r(server.options_.ring_entries);
+        ring = &r;
+        watch_wake();
+        accept_loop();
+        ready.set_value();
+
+        while (!stopping || live > 0 || accepting) {
+            if (stopping) {
+                wake_pipe_waiters();
+                uring::cancel_all(r);
+            }
+            r.submit(1);
+            r.dispatch();
+        }
+        pipes.clear();
+        ring = nullptr;
+    } catch (...) {
+        try {
+            ready.set_exception(std::current_exception());
+        } catch (const std::future_error&) {
+            // Failed after start-up; nothing can report it.
+        }
+    }
+}
+
+DetachedTask HttpServer::Worker::watch_wake()
+{
+    co_await uring::read(*ring, wake_fd.get(), &wake_value, sizeof wake_value);
+    stopping = true;
+    ::shutdown(listen_fd.get(), SHUT_RDWR);
+}
+
+DetachedTask HttpServer::Worker::accept_loop()
+{
+    accepting = true;
+    while (!stopping) {
+        const int fd = co_await uring::accept(*ring, listen_fd.get());
+        if (stopping) {
+            if (fd >= 0)
+                ::close(fd);
+            break;
+        }
+        if (fd < 0) {
+            if (fd == -EMFILE || fd == -ENFILE) {
+                // Out of descriptors: back off instead of spinning.
+                const auto pause = to_timespec(std::chrono::milliseconds(10));
+                co_await uring::sleep(*ring, pause);
+            }
+            continue;
+        }
+        if (live >= server.options_.max_connections) {
+            ::close(fd);
+            continue;
+        }
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        accepted.fetch_add(1, std::memory_order_relaxed);
+        connection(fd);
+    }
+    accepting = false;
+}
+
+std::optional<Pipe> HttpServer::Worker::try_pipe()
+{
+    if (!pipes.empty()) {
+        Pipe p = std::move(pipes.back());
+        pipes.pop_back();
+        ++pipes_out;
+        return p;
+    }
+    int fds[2];
+    if (pipes_out >= kMaxPipes || ::pipe2(fds, O_CLOEXEC) != 0)
+        return std::nullopt;
+    ::fcntl(fds[1], F_SETPIPE_SZ, kPipeSize);
+    ++pipes_out;
+    return Pipe{UniqueFd(fds[0]), UniqueFd(fds[1])};
+}
+
+void HttpServer::Worker::release_pipe(std::optional<Pipe> pipe)
+{
+    --pipes_out;
+    if (pipe && pipes.size() < kPipePool)
+        pipes.push_back(std::move(*pipe));
+    if (pipe_waiters.empty())
+        return;
+    if (auto next = try_pipe()) {
+        auto* w = pipe_waiters.front();
+        pipe_waiters.pop_front();
+        w->pipe = std::move(next);
+        uring::post(*ring, w->done);
+    } else if (pipes_out == 0) {
+        // Cannot create any (descriptor limit): fail the queue rather
+        // than leave it waiting for a release that will not come.
+        wake_pipe_waiters();
+    }
+}
+
+void HttpServer::Worker::wake_pipe_waiters()
+{
+    for (auto* w : pipe_waiters)
+        uring::post(*ring, w->done);
+    pipe_waiters.clear();
+}
+
+HttpResponse HttpServer::Worker::handle(const HttpRequest& request)
+{
+    trace::Span span("http.handle");
+    HttpResponse response = server.handler_(request);
+    span.set_arg(static_cast<std::uint64_t>(response.status));
+    return response;
+}
+
+Task<bool> HttpServer::Worker::send_all(int fd, const void* data, std::size_t size, bool more)
+{
+    trace::AsyncSpan span("http.send", size);
+    const auto timeout = to_timespec(server.options_.send_timeout);
+    const auto* p = static_cast<const char*>(data);
+    const int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+    while (size > 0) {
+        const int n = co_await uring::send(*ring, fd, p, size, flags, &timeout);
+        if (n <= 0 || stopping)
+            co_return false;
+        p += n;
+        size -= static_cast<std::size_t>(n);
+        bytes_sent.fetch_add(static_cast<std::uint64_t>(n), std::memory_order_relaxed);
+    }
+    co_return true;
+}
+
+Task<bool> HttpServer::Worker::send_file(int fd, const SegmentRef& file)
+{
+    trace::AsyncSpan span("http.send_file", file.size());
+    PipeLease lease(*this);
+    lease.pipe = co_await PipeWait(*this);
+    if (!lease.pipe)
+        co_return false;
+    auto& pipe = lease.pipe;
+    const auto timeout = to_timespec(server.options_.send_timeout);
+    const int src = file.source->fd();
+    for (const auto& e : file.extents) {
+        std::uint64_t offset = e.offset;
+        std::uint64_t remaining = e.length;
+        while (remaining > 0) {
+            const auto want = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, kPipeSize));
+            const int in = co_await uring::splice(*ring, src, static_cast<std::int64_t>(offset), pipe->write.get(),
+                                                  want, SPLICE_F_MOVE);
+            // Zero means the source shrank underneath us.
+            if (in <= 0 || stopping)
+                co_return false;
+            offset += static_cast<std::uint64_t>(in);
+            remaining -= static_cast<std::uint64_t>(in);
+            for (int left = in; left > 0;) {
+                const int out = co_await uring::splice(*ring, pipe->read.get(), -1, fd, static_cast<std::size_t>(left),
+                                                       SPLICE_F_MOVE | SPLICE_F_MORE, &timeout);
+                // The pipe may still hold data; it is dropped, not reused.
+                if (out <= 0 || stopping)
+                    co_return false;
+                left -= out;
+                bytes_sent.fetch_add(static_cast<std::uint64_t>(out), std::memory_order_relaxed);
+            }
+        }
+    }
+    lease.drained = true;
+    co_return true;
+}
+
+DetachedTask HttpServer::Worker::connection(int fd)
+{
+    ++live;
+    active.fetch_add(1, std::memory_order_relaxed);
+    const auto& options = server.options_;
+    const auto idle = to_timespec(options.idle_timeout);
+    std::string buf;
+    std::size_t used = 0;
+
+    try {
+        while (!stopping) {
+            std::size_t head_end;
+            bool open = true;
+            while ((head_end = std::string_view(buf.data(), used).find("\r\n\r\n")) == std::string_view::npos) {
+                if (used >= kHeaderLimit) {
+                    open = false;
+                    break;
+                }
+                buf.resize(std::min(used + kRecvChunk, kHeaderLimit));
+                const int n = co_await uring::recv(*ring, fd, buf.data() + used, buf.size() - used, &idle);
+                if (n <= 0 || stopping) {
+                    open = false;
+                    break;
+                }
+                used += static_cast<std::size_t>(n);
+            }
+            if (!open) {
+                if (used >= kHeaderLimit && !stopping) {
+                    const auto r = HttpResponse::text(431, "request head too large\n");
+                    const auto out = response_head(r, false) + r.body;
+                    co_await send_all(fd, out.data(), out.size(), false);
+                }
+                break;
+            }
+            head_end += 4;
+
+            HttpRequest req;
+            HttpResponse resp;
+            if (const int bad = parse_request(std::string_view(buf.data(), head_end - 4), req)) {
+                resp = HttpResponse::text(bad, std::string(reason(bad)) + "\n");
+                req.keep_alive = false;
+            } else {
+                requests.fetch_add(1, std::memory_order_relaxed);
+                resp = handle(req);
+                // Long poll: the request stays in `buf`, untouched, while
+                // the connection sleeps on a ring timeout.
+                const auto give_up = std::chrono::steady_clock::now() + options.max_hold;
+                while (resp.retry_at != 0 && !stopping) {
+                    const auto now = std::chrono::steady_clock::now();
+                    if (now >= give_up) {
+                        resp = HttpResponse::text(503, "timed out waiting\n");
+                        break;
+                    }
+                    const auto wait = std::min<std::chrono::nanoseconds>(
+                        std::chrono::microseconds(pts_to_ms(resp.retry_at - channel_time_now()) * 1000 + 1000),
+                        give_up - now);
+                    const auto ts = to_timespec(wait);
+                    parked.fetch_add(1, std::memory_order_relaxed);
+                    const int res = co_await uring::sleep(*ring, ts);
+                    parked.fetch_sub(1, std::memory_order_relaxed);
+                    if (res == -ECANCELED)
+                        break;
+                    resp = handle(req);
+                }
+                if (stopping)
+                    break;
+            }
+
+            const bool head_only = req.method == "HEAD";
+            auto out = response_head(resp, req.keep_alive);
+            if (!head_only)
+                out += resp.body;
+            const bool measured = resp.delivery_tag != 0 && !head_only && options.on_delivered;
+            const auto started = measured ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+            const std::uint64_t queued_before = measured ? send_queue(fd) : 0;
+            const bool more = !head_only && (!resp.shared.empty() || resp.file);
+            bool ok = co_await send_all(fd, out.data(), out.size(), more);
+            if (ok && !head_only && !resp.shared.empty())
+                ok = co_await send_all(fd, resp.shared.data(), resp.shared.size(), resp.file.has_value());
+            if (ok && !head_only && resp.file)
+                ok = co_await send_file(fd, *resp.file);
+            if (ok && measured) {
+                const std::uint64_t sent = out.size() + resp.shared.size() + (resp.file ? resp.file->size() : 0);
+                const std::uint64_t queued_after = send_queue(fd);
+                HttpDelivery d;
+                d.tag = resp.delivery_tag;
+                d.bytes = sent + queued_before > queued_after ? sent + queued_before - queued_after : 0;
+                d.elapsed = std::chrono::steady_clock::now() - started;
+                options.on_delivered(d);
+            }
+            if (!ok || !req.keep_alive)
+                break;
+
+            // Keep pipelined bytes of the next request.
+            buf.erase(0, head_end);
+            used -= head_end;
+        }
+    } catch (const std::exception&) {
+        // Handler failure or allocation failure: drop the connection.
+    }
+    // Closed directly rather than through the ring: a queued close could
+    // be swept up by the cancellation that stop() keeps issuing.
+    ::close(fd);
+    active.fetch_sub(1, std::memory_order_relaxed);
+    --live;
+}
+
+HttpServer::HttpServer(HttpServerOptions options, HttpHandler handler)
+    : options_(std::move(options)), handler_(std::move(handler))
+{
+    const unsigned threads = std::max(1u, options_.threads);
+    port_ = options_.port;
+    for (unsigned i = 0; i < threads; ++i) {
+        auto fd = listen_socket(options_.address, port_, i == 0 ? &port_ : nullptr);
+        workers_.push_back(std::make_unique<Worker>(*this, i, std::move(fd)));
+    }
+}
+
+HttpServer::~HttpServer()
+{
+    stop();
+}
+
+void HttpServer::start()
+{
+    std::vector<std::promise<void>> ready(workers_.size());
+    for (std::size_t i = 0; i < workers_.size(); ++i)
+        workers_[i]->thread = std::thread([w = workers_[i].get(), p = &ready[i]] { w->run(*p); });
+    std::exception_ptr error;
+    for (auto& r : ready) {
+        try {
+            r.get_future().get();
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    if (error) {
+        stop();
+        std::rethrow_exception(error);
+    }
+}
+
+void HttpServer::stop()
+{
+    for (auto& w : workers_) {
+        if (!w->thread.joinable())
+            continue;
+        const std::uint64_t one = 1;
+        write_all(w->wake_fd.get(), &one, sizeof one);
+    }
+    for (auto& w : workers_)
+        if (w->thread.joinable())
+            w->thread.join();
+}
+
+HttpServerStats HttpServer::stats() const noexcept
+{
+    HttpServerStats s;
+    for (const auto& w : workers_) {
+        s.accepted += w->accepted.load(std::memory_order_relaxed);
+        s.active += w->active.load(std::memory_order_relaxed);
+        s.requests += w->requests.load(std::memory_order_relaxed);
+        s.parked += w->parked.load(std::memory_order_relaxed);
+        s.bytes_sent += w->bytes_sent.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+} // namespace seinfeld_tv
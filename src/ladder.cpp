@@ -0,0 +1,133 @@
+#include "seinfeld_tv/ladder.hpp"
+
+#include "seinfeld_tv/gop_index.hpp"
+#include "seinfeld_tv/segmenter.hpp"
+
+#include <cstdio>
+#include <memory>
+
+namespace seinfeld_tv {
+
+namespace {
+
+double ms(std::chrono::nanoseconds ns)
+{
+    return std::chrono::duration<double, std::milli>(ns).count();
+}
+
+std::string episode_name(const EpisodeRecord& r)
+{
+    char buf[16];
+    std::snprintf(buf, sizeof buf, "S%02uE%02u", unsigned{r.season}, unsigned{r.episode});
+    return buf;
+}
+
+/// Chunk outputs of one rendition, filled in by the index task and read
+/// by the assemble task after every encode has finished.
+struct RenditionWork {
+    const Rendition* rendition = nullptr;
+    std::filesystem::path dir;
+    std::filesystem::path output;
+    std::vector<std::filesystem::path> chunks;
+};
+
+} // namespace
+
+std::vector<LadderSource> ladder_sources(const Catalog& catalog)
+{
+    std::vector<LadderSource> out;
+    out.reserve(catalog.size());
+    for (const auto& r : catalog.episodes()) {
+        const auto loudness = catalog.loudness(r);
+        out.push_back({episode_name(r), std::filesystem::path(catalog.path(r)), r.hash,
+                       loudness ? normalization_gain_db(*loudness) : 0.0f});
+    }
+    return out;
+}
+
+LadderReport build_ladders(std::span<const LadderSource> sources, TranscodeBackend& backend,
+                           WorkStealingPool& pool, const LadderOptions& options, ReportLog* log)
+{
+    TaskGraph graph;
+    std::vector<std::unique_ptr<RenditionWork>> work;
+
+    for (const auto& src : sources) {
+        const auto episode_dir = options.output_dir / src.hash.to_hex();
+        std::vector<std::pair<RenditionWork*, TaskGraph::NodeId>> joins;
+        for (const auto& r : options.renditions) {
+            auto& w = *work.emplace_back(std::make_unique<RenditionWork>());
+            w.rendition = &r;
+            w.dir = episode_dir / r.name;
+            w.output = episode_dir / (r.name + ".ts");
+            auto join = graph.add("assemble/" + r.name, [&backend, &w] {
+                backend.concat(w.chunks, w.output);
+                std::filesystem::remove_all(w.dir);
+            });
+            joins.emplace_back(&w, join);
+        }
+
+        auto index = graph.add("index", [&graph, &backend, &src, &options, joins] {
+            const auto gop = GopIndex::open_or_build(src.media, src.hash);
+            const auto spans = plan_segments(gop.view(), 0, gop.view().duration_pts, options.chunk_target);
+            for (auto [w, join] : joins) {
+                std::filesystem::create_directories(w->dir);
+                w->chunks.reserve(spans.size());
+                for (std::size_t i = 0; i < spans.size(); ++i) {
+                    char name[32];
+                    std::snprintf(name, sizeof name, "chunk-%05zu.ts", i);
+                    w->chunks.push_back(w->dir / name);
+                }
+                for (std::size_t i = 0; i < spans.size(); ++i) {
+                    ChunkJob job{src.media, spans[i].start_pts, spans[i].end_pts, w->rendition, w->chunks[i],
+                                 src.gain_db};
+                    graph.add_child("encode/" + w->rendition->name, [&backend, job] { backend.encode_chunk(job); },
+                                    join);
+                }
+            }
+        });
+        for (auto [w, join] : joins)
+            graph.precede(index, join);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    if (log) {
+        graph.on_progress([log, started](std::uint64_t done, std::uint64_t total) {
+            char buf[128];
+            std::snprintf(buf, sizeof buf, "ladder.progress done=%llu total=%llu elapsed_ms=%.0f",
+                          static_cast<unsigned long long>(done), static_cast<unsigned long long>(total),
+                          ms(std::chrono::steady_clock::now() - started));
+            log->line(buf);
+        });
+    }
+    graph.run(pool);
+
+    LadderReport report;
+    report.wall = std::chrono::steady_clock::now() - started;
+    report.stages = graph.stats();
+    report.workers = pool.size();
+    std::chrono::nanoseconds busy{0};
+    for (const auto& s : report.stages) {
+        report.tasks += s.tasks;
+        busy += s.busy;
+    }
+
+    if (log) {
+        char buf[256];
+        for (const auto& s : report.stages) {
+            std::snprintf(buf, sizeof buf,
+                          "ladder.stage name=%s tasks=%llu busy_ms=%.1f longest_ms=%.1f span_ms=%.1f",
+                          s.name.c_str(), static_cast<unsigned long long>(s.tasks), ms(s.busy), ms(s.longest),
+                          s.tasks ? ms(s.last_end - s.first_start) : 0.0);
+            log->line(buf);
+        }
+        const double capacity = ms(report.wall) * report.workers;
+        std::snprintf(buf, sizeof buf,
+                      "ladder.total sources=%zu tasks=%llu workers=%u wall_ms=%.1f busy_ms=%.1f utilization=%.3f",
+                      sources.size(), static_cast<unsigned long long>(report.tasks), report.workers,
+                      ms(report.wall), ms(busy), capacity > 0 ? ms(busy) / capacity : 0.0);
+        log->line(buf);
+    }
+    return report;
+}
+
+} // namespace seinfeld_tv
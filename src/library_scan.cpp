@@ -0,0 +1,389 @@
+#include "seinfeld_tv/library_scan.hpp"
+
+#include "seinfeld_tv/chunking.hpp"
+#include "seinfeld_tv/gop_index.hpp"
+#include "seinfeld_tv/splice.hpp"
+#include "seinfeld_tv/task_graph.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+#include <set>
+#include <system_error>
+#include <unordered_set>
+
+#include <sys/stat.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+char lower(char c) noexcept
+{
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+bool is_digit(char c) noexcept
+{
+    return c >= '0' && c <= '9';
+}
+
+/// Share of a changed file's bytes that must survive for measurements of
+/// the old version to carry over.
+constexpr double kAncestorShare = 0.9;
+
+bool under(const std::string& path, const std::string& dir) noexcept
+{
+    return path.size() > dir.size() && path.compare(0, dir.size(), dir) == 0 && path[dir.size()] == '/';
+}
+
+std::string key_of(const std::filesystem::path& p)
+{
+    std::error_code ec;
+    auto s = std::filesystem::absolute(p, ec).lexically_normal().string();
+    if (s.size() > 1 && s.back() == '/')
+        s.pop_back();
+    return s;
+}
+
+struct Stat {
+    std::uint64_t size;
+    std::int64_t mtime_ns;
+};
+
+std::optional<Stat> stat_file(const std::string& path) noexcept
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return std::nullopt;
+    return Stat{static_cast<std::uint64_t>(st.st_size),
+                std::int64_t{st.st_mtim.tv_sec} * 1'000'000'000 + st.st_mtim.tv_nsec};
+}
+
+} // namespace
+
+std::optional<EpisodeName> parse_episode_name(std::string_view name)
+{
+    for (std::size_t i = 0; i + 4 <= name.size(); ++i) {
+        if (lower(name[i]) != 's' || !is_digit(name[i + 1]) || (i > 0 && std::isalnum(static_cast<unsigned char>(name[i - 1]))))
+            continue;
+        std::size_t j = i + 1;
+        unsigned season = 0, episode = 0;
+        while (j < name.size() && is_digit(name[j]) && j - i <= 3)
+            season = season * 10 + static_cast<unsigned>(name[j++] - '0');
+        if (j >= name.size() || lower(name[j]) != 'e' || j + 1 >= name.size() || !is_digit(name[j + 1]))
+            continue;
+        ++j;
+        const std::size_t digits = j;
+        while (j < name.size() && is_digit(name[j]) && j - digits < 3)
+            episode = episode * 10 + static_cast<unsigned>(name[j++] - '0');
+
+        EpisodeName out;
+        out.season = static_cast<std::uint16_t>(season);
+        out.episode = static_cast<std::uint16_t>(episode);
+        std::string_view rest = name.substr(j);
+        if (auto dot = rest.rfind('.'); dot != std::string_view::npos)
+            rest = rest.substr(0, dot);
+        for (char c : rest) {
+            const bool sep = c == '.' || c == '_' || c == '-' || c == ' ';
+            if (sep) {
+                if (!out.title.empty() && out.title.back() != ' ')
+                    out.title.push_back(' ');
+            } else {
+                out.title.push_back(c);
+            }
+        }
+        if (!out.title.empty() && out.title.back() == ' ')
+            out.title.pop_back();
+        return out;
+    }
+    return std::nullopt;
+}
+
+bool is_media_file(const std::filesystem::path& path)
+{
+    // Splice bridges are derived data, never programmes.
+    if (path.parent_path().extension() == ".splice")
+        return false;
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), lower);
+    return ext == ".ts" || ext == ".m2ts" || ext == ".mp4" || ext == ".m4v";
+}
+
+LibraryScanner::LibraryScanner(std::filesystem::path root, std::filesystem::path catalog_path,
+                               WorkStealingPool* pool)
+    : root_(key_of(root)), catalog_path_(std::move(catalog_path)), pool_(pool)
+{
+    std::error_code ec;
+    if (!std::filesystem::exists(catalog_path_, ec))
+        return;
+    const Catalog catalog(catalog_path_);
+    for (const auto& r : catalog.episodes()) {
+        FileState st;
+        st.size = r.file_size;
+        st.mtime_ns = r.mtime_ns;
+        st.hash = r.hash;
+        st.duration_pts = r.duration_pts;
+        st.name = {r.season, r.episode, std::string(catalog.title(r))};
+        files_.emplace(key_of(catalog.path(r)), std::move(st));
+    }
+}
+
+ScanReport LibraryScanner::rescan_all()
+{
+    const std::filesystem::path all[] = {root_};
+    auto report = rescan(all);
+    // Entries outside the root (a moved library) cannot be watched.
+    for (auto it = files_.begin(); it != files_.end();) {
+        if (!under(it->first, root_.string())) {
+            it = files_.erase(it);
+            ++report.removed;
+        } else {
+            ++it;
+        }
+    }
+    return report;
+}
+
+void LibraryScanner::drop_under(const std::string& path, ScanReport& report)
+{
+    for (auto it = files_.lower_bound(path); it != files_.end() && (it->first == path || under(it->first, path));) {
+        if (!stat_file(it->first)) {
+            dropped_.emplace_back(it->first, std::move(it->second));
+            it = files_.erase(it);
+            ++report.removed;
+        } else {
+            ++it;
+        }
+    }
+}
+
+ScanReport LibraryScanner::rescan(std::span<const std::filesystem::path> paths)
+{
+    ScanReport report;
+    dropped_.clear();
+    std::vector<std::filesystem::path> candidates;
+    for (const auto& p : paths) {
+        const std::string key = key_of(p);
+        std::error_code ec;
+        const auto status = std::filesystem::status(key, ec);
+        if (std::filesystem::is_directory(status)) {
+            auto it = std::filesystem::recursive_directory_iterator(
+                key, std::filesystem::directory_options::skip_permission_denied, ec);
+            for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+                if (it->is_regular_file(ec) && is_media_file(it->path()))
+                    candidates.push_back(it->path());
+            if (ec)
+                report.problems.push_back(key + ": " + ec.message());
+        } else if (std::filesystem::is_regular_file(status)) {
+            candidates.push_back(key);
+        }
+        drop_under(key, report);
+    }
+    examine(std::move(candidates), report);
+    // Whatever was not claimed by a rename is gone for good.
+    for (const auto& [path, st] : dropped_) {
+        std::error_code ec;
+        std::filesystem::remove(GopIndex::sidecar_path(path), ec);
+        std::filesystem::remove(ChunkManifest::sidecar_path(path), ec);
+        std::filesystem::remove_all(bridge_dir(path), ec);
+    }
+    dropped_.clear();
+    resolve(&report);
+    return report;
+}
+
+void LibraryScanner::examine(std::vector<std::filesystem::path> candidates, ScanReport& report)
+{
+    struct Job {
+        std::string path;
+        FileState state;
+        bool known = false;
+        std::string error;
+        bool moved = false;
+    };
+    std::vector<Job> jobs;
+    std::set<std::string> seen;
+    for (const auto& c : candidates) {
+        std::string key = key_of(c);
+        if (!seen.insert(key).second)
+            continue;
+        const auto st = stat_file(key);
+        auto name = is_media_file(key) ? parse_episode_name(std::filesystem::path(key).filename().string())
+                                       : std::nullopt;
+        auto it = files_.find(key);
+        if (!st || !name) {
+            if (it != files_.end()) {
+                files_.erase(it);
+                ++report.removed;
+            }
+            continue;
+        }
+        if (it != files_.end() && it->second.size == st->size && it->second.mtime_ns == st->mtime_ns) {
+            ++report.unchanged;
+            continue;
+        }
+        Job job{std::move(key), {}, it != files_.end(), {}};
+        job.state.size = st->size;
+        job.state.mtime_ns = st->mtime_ns;
+        job.state.name = std::move(*name);
+        // A rename keeps size and mtime: reuse the hash of the file that
+        // disappeared in the same batch instead of reading it again.
+        auto moved = std::find_if(dropped_.begin(), dropped_.end(), [&](const auto& d) {
+            return d.second.size == st->size && d.second.mtime_ns == st->mtime_ns;
+        });
+        if (moved != dropped_.end()) {
+            job.state.hash = moved->second.hash;
+            job.state.ancestor = moved->second.ancestor;
+            // Sidecars describe the content, which moved unchanged.
+            std::error_code ec;
+            std::filesystem::rename(GopIndex::sidecar_path(moved->first), GopIndex::sidecar_path(job.path), ec);
+            std::filesystem::rename(ChunkManifest::sidecar_path(moved->first), ChunkManifest::sidecar_path(job.path), ec);
+            std::filesystem::rename(bridge_dir(moved->first), bridge_dir(job.path), ec);
+            dropped_.erase(moved);
+            job.moved = true;
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    // Hashing is bandwidth-bound and already spreads one file over the whole
+    // pool, so files go one at a time; that also keeps reads sequential.
+    for (auto& job : jobs) {
+        if (job.moved)
+            continue;
+        try {
+            const auto sidecar = ChunkManifest::sidecar_path(job.path);
+            std::optional<ChunkManifest> older;
+            std::error_code ec;
+            if (job.known && std::filesystem::exists(sidecar, ec)) {
+                try {
+                    older = ChunkManifest::read(sidecar);
+                } catch (const std::exception&) {
+                }
+            }
+            auto manifest = chunk_file(job.path, pool_);
+            job.state.hash = manifest.root;
+            if (older && older->root != manifest.root && manifest.shared_fraction(*older) >= kAncestorShare)
+                job.state.ancestor = older->root;
+            manifest.write(sidecar);
+            // A writer that was still going between stat and hash would
+            // leave a torn hash; the next close-write event rescans it.
+            // Size alone misses a rewrite in place, so mtime counts too.
+            if (auto after = stat_file(job.path);
+                !after || after->size != job.state.size || after->mtime_ns != job.state.mtime_ns)
+                job.error = "changed while hashing";
+        } catch (const std::exception& e) {
+            job.error = e.what();
+        }
+    }
+
+    auto index = [](Job& job) {
+        if (!job.error.empty())
+            return;
+        try {
+            job.state.duration_pts = GopIndex::open_or_build(job.path, job.state.hash).view().duration_pts;
+        } catch (const std::exception& e) {
+            job.error = e.what();
+        }
+    };
+    if (pool_ && jobs.size() > 1) {
+        TaskGraph graph;
+        for (auto& job : jobs)
+            graph.add("rescan", [&index, &job] { index(job); });
+        graph.run(*pool_);
+    } else {
+        for (auto& job : jobs)
+            index(job);
+    }
+
+    for (auto& job : jobs) {
+        if (!job.error.empty()) {
+            report.problems.push_back(job.path + ": " + job.error);
+            if (files_.erase(job.path))
+                ++report.removed;
+            continue;
+        }
+        ++(job.known ? report.updated : report.added);
+        files_.insert_or_assign(std::move(job.path), std::move(job.state));
+    }
+}
+
+std::vector<std::pair<const std::string*, const LibraryScanner::FileState*>>
+LibraryScanner::resolve(ScanReport* report) const
+{
+    std::vector<std::pair<const std::string*, const FileState*>> order;
+    order.reserve(files_.size());
+    for (const auto& [path, st] : files_)
+        order.emplace_back(&path, &st);
+    // Newest first, so a re-ripped replacement wins over the old file
+    // until the old one is deleted.
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.second->mtime_ns > b.second->mtime_ns;
+    });
+    std::set<std::pair<std::uint16_t, std::uint16_t>> episodes;
+    std::unordered_set<ContentHash> hashes;
+    std::erase_if(order, [&](const auto& entry) {
+        const auto& [path, st] = entry;
+        if (!episodes.insert({st->name.season, st->name.episode}).second) {
+            if (report)
+                report->problems.push_back(*path + ": duplicate of a newer file for the same episode");
+            return true;
+        }
+        if (!hashes.insert(st->hash).second) {
+            if (report)
+                report->problems.push_back(*path + ": identical content already catalogued");
+            return true;
+        }
+        return false;
+    });
+    return order;
+}
+
+std::shared_ptr<const Catalog> LibraryScanner::publish()
+{
+    CatalogBuilder builder;
+    std::uint64_t generation = 1;
+    std::optional<Catalog> previous;
+    std::error_code ec;
+    if (std::filesystem::exists(catalog_path_, ec)) {
+        previous.emplace(catalog_path_);
+        generation = previous->generation() + 1;
+    }
+
+    std::set<std::pair<std::uint16_t, std::uint16_t>> episodes;
+    for (const auto& [path, st] : resolve(nullptr)) {
+        EpisodeInfo info;
+        info.season = st->name.season;
+        info.episode = st->name.episode;
+        info.title = st->name.title;
+        info.path = *path;
+        info.hash = st->hash;
+        info.file_size = st->size;
+        info.duration_pts = st->duration_pts;
+        info.mtime_ns = st->mtime_ns;
+        // Read loudness from the current file, not a snapshot: stv-loudness
+        // updates catalogs in place.
+        if (previous) {
+            const auto* old = previous->find(st->hash);
+            if (!old && st->ancestor)
+                old = previous->find(*st->ancestor);
+            if (old)
+                info.loudness = previous->loudness(*old);
+        }
+        episodes.insert({info.season, info.episode});
+        builder.add_episode(std::move(info));
+    }
+    if (previous) {
+        for (const auto& clip : previous->clips()) {
+            const auto& owner = previous->episode(clip.episode_id);
+            if (!episodes.contains({owner.season, owner.episode}))
+                continue;
+            builder.add_clip({owner.season, owner.episode, clip.in_pts, clip.out_pts, std::string(previous->label(clip))});
+        }
+    }
+    previous.reset();
+    builder.write(catalog_path_, generation);
+    return std::make_shared<const Catalog>(catalog_path_);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,137 @@
+#include "seinfeld_tv/library_watch.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+constexpr std::uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE
+                                     | IN_DELETE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+} // namespace
+
+LibraryWatcher::LibraryWatcher(LibraryScanner& scanner, PublishFn on_publish, std::chrono::milliseconds settle)
+    : scanner_(scanner), on_publish_(std::move(on_publish)), settle_(settle),
+      inotify_(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), wake_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (!inotify_)
+        throw_errno("inotify_init1");
+    if (!wake_)
+        throw_errno("eventfd");
+}
+
+void LibraryWatcher::stop() noexcept
+{
+    const std::uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(wake_.get(), &one, sizeof one);
+}
+
+void LibraryWatcher::watch_tree(const std::filesystem::path& dir)
+{
+    const int wd = ::inotify_add_watch(inotify_.get(), dir.c_str(), kWatchMask);
+    if (wd < 0) {
+        // The directory may already be gone again; its parent's event covers it.
+        if (errno == ENOENT || errno == ENOTDIR)
+            return;
+        throw_errno("inotify_add_watch");
+    }
+    dirs_[wd] = dir;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+        if (it->is_directory(ec) && !it->is_symlink(ec))
+            watch_tree(it->path());
+}
+
+void LibraryWatcher::drain_events()
+{
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t n = ::read(inotify_.get(), buffer, sizeof buffer);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return;
+            throw_errno("read");
+        }
+        for (ssize_t off = 0; off < n;) {
+            const auto* ev = reinterpret_cast<const struct inotify_event*>(buffer + off);
+            off += static_cast<ssize_t>(sizeof(struct inotify_event) + ev->len);
+            last_event_ = std::chrono::steady_clock::now();
+            if (ev->mask & IN_Q_OVERFLOW) {
+                overflow_ = true;
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) {
+                dirs_.erase(ev->wd);
+                continue;
+            }
+            auto dir = dirs_.find(ev->wd);
+            if (dir == dirs_.end() || ev->len == 0)
+                continue;
+            const auto path = dir->second / ev->name;
+            if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+                watch_tree(path);
+            // Files show up on close-write; a bare create is still being written.
+            if ((ev->mask & IN_CREATE) && !(ev->mask & IN_ISDIR))
+                continue;
+            dirty_.insert(path);
+        }
+    }
+}
+
+void LibraryWatcher::flush()
+{
+    ScanReport report;
+    if (overflow_) {
+        report = scanner_.rescan_all();
+    } else {
+        const std::vector<std::filesystem::path> paths(dirty_.begin(), dirty_.end());
+        report = scanner_.rescan(paths);
+    }
+    dirty_.clear();
+    overflow_ = false;
+    if (report.changed())
+        on_publish_(scanner_.publish(), report);
+}
+
+void LibraryWatcher::run()
+{
+    watch_tree(scanner_.root());
+    for (;;) {
+        int timeout = -1;
+        if (!dirty_.empty() || overflow_) {
+            const auto quiet = std::chrono::steady_clock::now() - last_event_;
+            if (quiet >= settle_) {
+                flush();
+                continue;
+            }
+            timeout = static_cast<int>(
+                std::chrono::ceil<std::chrono::milliseconds>(settle_ - quiet).count());
+        }
+        pollfd fds[2] = {{inotify_.get(), POLLIN, 0}, {wake_.get(), POLLIN, 0}};
+        if (::poll(fds, 2, timeout) < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("poll");
+        }
+        if (fds[1].revents & POLLIN) {
+            std::uint64_t v;
+            [[maybe_unused]] auto n = ::read(wake_.get(), &v, sizeof v);
+            return;
+        }
+        if (fds[0].revents & POLLIN)
+            drain_events();
+    }
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,861 @@
+#include "seinfeld_tv/load_test.hpp"
+
+#include "seinfeld_tv/bandwidth.hpp"
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/transcode.hpp"
+
+#include "http_detail.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t kHeadLimit = 16 * 1024;
+constexpr auto kRequestTimeout = std::chrono::seconds(30);
+constexpr auto kRetryDelay = std::chrono::seconds(1);
+constexpr auto kMeanRejoinGap = std::chrono::seconds(1);
+/// Bytes a paced read may run ahead of the link rate.
+constexpr double kBurstBytes = 64 * 1024;
+/// A small receive buffer, so that pacing pushes back on the server
+/// instead of the kernel soaking up whole segments.
+constexpr int kReceiveBuffer = 64 * 1024;
+/// Players tune in this many segments (or parts) behind the live edge,
+/// as HLS clients do, and start playing once the first two are in.
+constexpr std::size_t kTuneBack = 3;
+constexpr std::size_t kPlayAfter = 2;
+constexpr std::uint32_t kMinLinkBps = 250'000;
+
+double ms(std::chrono::nanoseconds d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+Clock::duration seconds(double s)
+{
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+}
+
+using detail::iequals;
+
+/// A segment (`part` < 0) or LL-HLS part listed in a playlist.
+struct Unit {
+    std::uint64_t sequence = 0;
+    int part = -1;
+    double seconds = 0;
+    std::string uri;
+};
+
+struct Playlist {
+    double target = 6;
+    std::vector<Unit> units;
+    /// Whole segments whose parts were listed, with their part counts.
+    std::vector<std::pair<std::uint64_t, int>> completed;
+    std::string map; ///< latest EXT-X-MAP URI, for fMP4 renditions
+};
+
+/// The value of `key` in an attribute list such as `DURATION=2.000,URI="x"`.
+std::string_view attribute(std::string_view line, std::string_view key)
+{
+    for (std::size_t at = line.find(':'); at != std::string_view::npos; at = line.find(',', at)) {
+        ++at;
+        if (line.substr(at, key.size()) != key || line.substr(at + key.size(), 1) != "=")
+            continue;
+        auto value = line.substr(at + key.size() + 1);
+        if (!value.empty() && value.front() == '"') {
+            value.remove_prefix(1);
+            return value.substr(0, value.find('"'));
+        }
+        return value.substr(0, value.find(','));
+    }
+    return {};
+}
+
+/// Leading decimal number of `s`, advancing past it and one separator.
+std::optional<std::uint64_t> take_number(std::string_view& s)
+{
+    std::uint64_t v = 0;
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (ec != std::errc{})
+        return std::nullopt;
+    s.remove_prefix(static_cast<std::size_t>(end - s.data()));
+    if (!s.empty())
+        s.remove_prefix(1);
+    return v;
+}
+
+double to_double(std::string_view s)
+{
+    return std::strtod(std::string(s).c_str(), nullptr);
+}
+
+/// Units of a media playlist in order. Segment names carry their
+/// sequence number ("123.ts", parts "123.0.ts"), which keeps delta
+/// updates simple: skipped segments are just absent.
+Playlist parse_playlist(std::string_view body, bool with_parts)
+{
+    Playlist out;
+    std::vector<Unit> pending; // parts of the segment being listed
+    double extinf = 0;
+    while (!body.empty()) {
+        const auto eol = body.find('\n');
+        auto line = body.substr(0, eol);
+        body.remove_prefix(eol == std::string_view::npos ? body.size() : eol + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        if (line.starts_with("#EXT-X-TARGETDURATION:")) {
+            out.target = to_double(line.substr(22));
+        } else if (line.starts_with("#EXT-X-MAP:")) {
+            out.map = attribute(line, "URI");
+        } else if (line.starts_with("#EXT-X-PART:")) {
+            if (!with_parts)
+                continue;
+            Unit u;
+            u.uri = attribute(line, "URI");
+            u.seconds = to_double(attribute(line, "DURATION"));
+            std::string_view name = u.uri;
+            const auto sequence = take_number(name);
+            const auto part = take_number(name);
+            if (!sequence || !part)
+                throw std::runtime_error("load: bad part URI " + u.uri);
+            u.sequence = *sequence;
+            u.part = static_cast<int>(*part);
+            pending.push_back(std::move(u));
+        } else if (line.starts_with("#EXTINF:")) {
+            extinf = to_double(line.substr(8));
+        } else if (!line.empty() && line.front() != '#') {
+            std::string_view name = line;
+            const auto sequence = take_number(name);
+            if (!sequence)
+                throw std::runtime_error("load: bad segment URI " + std::string(line));
+            if (pending.empty()) {
+                out.units.push_back({*sequence, -1, extinf, std::string(line)});
+            } else {
+                out.completed.emplace_back(*sequence, static_cast<int>(pending.size()));
+                std::move(pending.begin(), pending.end(), std::back_inserter(out.units));
+                pending.clear();
+            }
+        }
+    }
+    // The live segment's parts so far.
+    std::move(pending.begin(), pending.end(), std::back_inserter(out.units));
+    return out;
+}
+
+/// `"rendition":"720p"` from hint.json; empty for null.
+std::string_view hinted_rendition(std::string_view body)
+{
+    constexpr std::string_view kKey = "\"rendition\":\"";
+    const auto at = body.find(kKey);
+    if (at == std::string_view::npos)
+        return {};
+    body.remove_prefix(at + kKey.size());
+    return body.substr(0, body.find('"'));
+}
+
+struct Address {
+    sockaddr_storage storage{};
+    socklen_t length = 0;
+};
+
+Address resolve(const std::string& host, std::uint16_t port)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    const auto service = std::to_string(port);
+    if (const int rc = ::getaddrinfo(host.c_str(), service.c_str(), &hints, &found); rc != 0)
+        throw std::runtime_error("load: " + host + ": " + ::gai_strerror(rc));
+    Address a;
+    std::memcpy(&a.storage, found->ai_addr, found->ai_addrlen);
+    a.length = found->ai_addrlen;
+    ::freeaddrinfo(found);
+    return a;
+}
+
+struct Histograms {
+    metrics::Histogram segments, parts, first_byte, playlists, startup;
+};
+
+/// Per-worker counts, merged into the report at the end.
+struct Tally {
+    std::uint64_t joins = 0, leaves = 0, requests = 0, errors = 0, resyncs = 0, rebuffers = 0, switches = 0,
+                  bytes = 0;
+    Clock::duration stalled{0};
+};
+
+enum class Phase { Idle, Connecting, Writing, Reading, Throttled };
+enum class Fetch { Playlist, Unit, Map, Hint };
+
+struct Player {
+    // Who is watching; a slot is reused by the player replacing a leaver.
+    bool active = false;
+    std::uint64_t generation = 0;
+    std::string channel;
+    std::string session;
+    bool low_latency = false;
+    bool blocking = false;
+    Clock::time_point joined, leave_at;
+    double link_bps = 0;
+
+    // The connection and the one request in flight on it.
+    UniqueFd fd;
+    std::uint32_t connection = 0; ///< tags epoll events, so a stale one is ignored
+    Phase phase = Phase::Idle;
+    Fetch fetch = Fetch::Playlist;
+    bool blocking_reload = false;
+    Unit unit;
+    std::string request;
+    std::size_t request_sent = 0;
+    std::string head;
+    bool head_done = false;
+    int status = 0;
+    bool close_after = false;
+    std::size_t content_length = 0;
+    std::size_t body_received = 0;
+    std::size_t received = 0; ///< head and body, for pacing
+    std::string body;         ///< kept for playlists and hints only
+    Clock::time_point sent_at, deadline;
+    std::uint64_t timer = 0; ///< token of the one live timer
+
+    // Where it is in the stream.
+    Playlist playlist;
+    bool tuned = false;
+    std::uint64_t sequence = 0;
+    int part = 0;
+    std::string map_fetched;
+    Clock::time_point last_load;
+    bool last_load_changed = true;
+    Clock::time_point next_hint;
+    std::string rendition;
+    double measured_bps = 0;
+
+    // Modelled playback buffer.
+    bool playing = false;
+    std::size_t prebuffered = 0;
+    double prebuffer_seconds = 0;
+    Clock::time_point dry_at;
+};
+
+/// One epoll loop driving a share of the players.
+class Worker {
+public:
+    Worker(const LoadTestOptions& options, const Address& address, std::size_t first_slot, std::size_t slots,
+           Histograms& histograms)
+        : options_(options), address_(address), first_slot_(first_slot), players_(slots), histograms_(histograms),
+          rng_(options.seed * 0x9e3779b97f4a7c15ull + first_slot), epoll_(::epoll_create1(EPOLL_CLOEXEC))
+    {
+        if (!epoll_)
+            throw_errno("epoll_create1");
+    }
+
+    void run(Clock::time_point start, Clock::time_point end)
+    {
+        std::uniform_real_distribution<double> ramp(0, std::chrono::duration<double>(options_.ramp).count());
+        for (auto& p : players_)
+            schedule(p, start + seconds(ramp(rng_)));
+
+        epoll_event events[256];
+        for (;;) {
+            auto now = Clock::now();
+            if (now >= end)
+                break;
+            while (!timers_.empty() && timers_.top().when <= now) {
+                const auto t = timers_.top();
+                timers_.pop();
+                auto& p = players_[t.slot];
+                if (p.timer == t.token)
+                    on_timer(p, now);
+            }
+            auto wake = end;
+            if (!timers_.empty())
+                wake = std::min(wake, timers_.top().when);
+            const auto wait = std::chrono::ceil<std::chrono::milliseconds>(wake - Clock::now()).count();
+            const int n = ::epoll_wait(epoll_.get(), events, 256, static_cast<int>(std::max<long long>(wait, 0)));
+            if (n < 0 && errno != EINTR)
+                throw_errno("epoll_wait");
+            now = Clock::now();
+            for (int i = 0; i < n; ++i) {
+                auto& p = players_[events[i].data.u64 & 0xffffffff];
+                if (p.fd && p.connection == events[i].data.u64 >> 32)
+                    on_event(p, events[i].events, now);
+            }
+        }
+        for (auto& p : players_)
+            if (p.active)
+                finish(p, end);
+    }
+
+    const Tally& tally() const noexcept { return tally_; }
+
+private:
+    struct Timer {
+        Clock::time_point when;
+        std::size_t slot;
+        std::uint64_t token;
+        bool operator>(const Timer& o) const noexcept { return when > o.when; }
+    };
+
+    std::size_t slot(const Player& p) const noexcept { return static_cast<std::size_t>(&p - players_.data()); }
+
+    void schedule(Player& p, Clock::time_point when)
+    {
+        p.timer = ++tokens_;
+        timers_.push({when, slot(p), p.timer});
+    }
+
+    void on_timer(Player& p, Clock::time_point now)
+    {
+        switch (p.phase) {
+        case Phase::Idle:
+            step(p, now);
+            break;
+        case Phase::Throttled:
+            p.phase = Phase::Reading;
+            watch(p, EPOLLIN);
+            schedule(p, p.deadline);
+            break;
+        default:
+            fail(p, now);
+            break;
+        }
+    }
+
+    void join(Player& p, Clock::time_point now)
+    {
+        std::uniform_int_distribution<std::size_t> channel(0, options_.channels.size() - 1);
+        std::bernoulli_distribution low_latency(options_.low_latency), blocking(options_.blocking);
+        std::exponential_distribution<double> watch(1.0 / std::chrono::duration<double>(options_.mean_watch).count());
+        std::lognormal_distribution<double> link(std::log(static_cast<double>(options_.median_bandwidth_bps)), 0.6);
+
+        const auto generation = p.generation + 1;
+        const auto connection = p.connection;
+        p = Player{};
+        p.active = true;
+        p.generation = generation;
+        p.connection = connection;
+        p.channel = options_.channels[channel(rng_)];
+        p.session = "load-" + std::to_string(options_.seed) + "-" + std::to_string(first_slot_ + slot(p)) + "-" +
+                    std::to_string(generation);
+        p.low_latency = low_latency(rng_);
+        p.blocking = !p.low_latency && blocking(rng_);
+        p.joined = now;
+        p.leave_at = now + seconds(watch(rng_));
+        p.link_bps = std::max(link(rng_), double{kMinLinkBps});
+        p.next_hint = now + options_.hint_every;
+        ++tally_.joins;
+    }
+
+    void leave(Player& p, Clock::time_point now)
+    {
+        finish(p, now);
+        ++tally_.leaves;
+        disconnect(p);
+        p.active = false;
+        std::exponential_distribution<double> gap(1.0 / std::chrono::duration<double>(kMeanRejoinGap).count());
+        schedule(p, now + seconds(gap(rng_)));
+    }
+
+    /// Counts a stall still in progress when a player goes away.
+    void finish(Player& p, Clock::time_point now)
+    {
+        if (p.playing && now > p.dry_at) {
+            ++tally_.rebuffers;
+            tally_.stalled += now - p.dry_at;
+            p.dry_at = now;
+        }
+    }
+
+    /// Issues the player's next request, or schedules when it will.
+    void step(Player& p, Clock::time_point now)
+    {
+        if (!p.active)
+            join(p, now);
+        if (now >= p.leave_at)
+            return leave(p, now);
+
+        const std::string_view name = p.low_latency ? "ll.m3u8" : "live.m3u8";
+        if (!p.tuned)
+            return send(p, now, Fetch::Playlist, std::string(name) + "?session=" + p.session);
+        if (now >= p.next_hint)
+            return send(p, now, Fetch::Hint, "hint.json?session=" + p.session);
+        if (!p.playlist.map.empty() && p.playlist.map != p.map_fetched)
+            return send(p, now, Fetch::Map, p.playlist.map);
+        if (const auto* u = next_unit(p)) {
+            p.unit = *u;
+            // Tagged like playlists: the server attributes each send to
+            // the session for its bandwidth estimate.
+            return send(p, now, Fetch::Unit, p.unit.uri + "?session=" + p.session);
+        }
+
+        std::string path(name);
+        path += "?session=" + p.session;
+        if (p.low_latency || p.blocking) {
+            path += "&_HLS_msn=" + std::to_string(p.sequence);
+            if (p.low_latency)
+                path += "&_HLS_part=" + std::to_string(p.part) + "&_HLS_skip=YES";
+            p.blocking_reload = true;
+            return send(p, now, Fetch::Playlist, path);
+        }
+        // Polling: a target duration after the last load, half that when
+        // it brought nothing new.
+        const auto when = p.last_load + seconds(p.playlist.target / (p.last_load_changed ? 1 : 2));
+        if (when > now)
+            return schedule(p, when);
+        send(p, now, Fetch::Playlist, path);
+    }
+
+    /// Starts kTuneBack units behind the edge of the current playlist.
+    void tune(Player& p)
+    {
+        const auto& units = p.playlist.units;
+        if (units.empty())
+            return;
+        const auto& u = units[units.size() - std::min(kTuneBack, units.size())];
+        p.sequence = u.sequence;
+        p.part = std::max(u.part, 0);
+        p.tuned = true;
+    }
+
+    const Unit* next_unit(Player& p)
+    {
+        for (;;) {
+            const auto& units = p.playlist.units;
+            if (units.empty())
+                return nullptr;
+            if (p.sequence < units.front().sequence) {
+                // Fell out of the window: tune in again.
+                ++tally_.resyncs;
+                tune(p);
+            }
+            bool whole = false;
+            for (const auto& u : units) {
+                if (u.sequence != p.sequence)
+                    continue;
+                if (u.part == p.part || (u.part < 0 && p.part == 0))
+                    return &u;
+                whole = whole || u.part < 0;
+            }
+            const auto done = std::find_if(p.playlist.completed.begin(), p.playlist.completed.end(),
+                                           [&](const auto& c) { return c.first == p.sequence; });
+            if (whole || (done != p.playlist.completed.end() && p.part >= done->second)) {
+                // Every part is in (or only the whole segment is listed
+                // now): on to the next segment.
+                ++p.sequence;
+                p.part = 0;
+                continue;
+            }
+            return nullptr;
+        }
+    }
+
+    void send(Player& p, Clock::time_point now, Fetch fetch, const std::string& path)
+    {
+        p.fetch = fetch;
+        if (fetch != Fetch::Playlist)
+            p.blocking_reload = false;
+        p.request = "GET /" + p.channel + "/" + path + " HTTP/1.1\r\nHost: " + options_.host + "\r\n\r\n";
+        p.request_sent = 0;
+        p.head.clear();
+        p.head_done = false;
+        p.status = 0;
+        p.close_after = false;
+        p.content_length = 0;
+        p.body_received = 0;
+        p.received = 0;
+        p.body.clear();
+        p.sent_at = now;
+        p.deadline = now + kRequestTimeout;
+        ++tally_.requests;
+        schedule(p, p.deadline);
+        if (!p.fd)
+            return connect(p, now);
+        write_request(p, now);
+    }
+
+    void connect(Player& p, Clock::time_point now)
+    {
+        p.fd.reset(::socket(address_.storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+        if (!p.fd)
+            return fail(p, now);
+        const int one = 1;
+        ::setsockopt(p.fd.get(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        ::setsockopt(p.fd.get(), SOL_SOCKET, SO_RCVBUF, &kReceiveBuffer, sizeof kReceiveBuffer);
+        ++p.connection;
+        epoll_event ev{};
+        ev.events = EPOLLOUT;
+        ev.data.u64 = slot(p) | std::uint64_t{p.connection} << 32;
+        if (::epoll_ctl(epoll_.get(), EPOLL_CTL_ADD, p.fd.get(), &ev) != 0)
+            throw_errno("epoll_ctl");
+        if (::connect(p.fd.get(), reinterpret_cast<const sockaddr*>(&address_.storage), address_.length) != 0 &&
+            errno != EINPROGRESS)
+            return fail(p, now);
+        p.phase = Phase::Connecting;
+    }
+
+    void disconnect(Player& p)
+    {
+        p.fd.reset(); // closing drops it from the epoll set
+        p.phase = Phase::Idle;
+    }
+
+    void fail(Player& p, Clock::time_point now)
+    {
+        ++tally_.errors;
+        disconnect(p);
+        schedule(p, now + kRetryDelay);
+    }
+
+    void watch(Player& p, std::uint32_t events)
+    {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = slot(p) | std::uint64_t{p.connection} << 32;
+        if (::epoll_ctl(epoll_.get(), EPOLL_CTL_MOD, p.fd.get(), &ev) != 0)
+            throw_errno("epoll_ctl");
+    }
+
+    void write_request(Player& p, Clock::time_point now)
+    {
+        while (p.request_sent < p.request.size()) {
+            const ssize_t n = ::send(p.fd.get(), p.request.data() + p.request_sent, p.request.size() - p.request_sent,
+                                     MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno == EAGAIN) {
+                p.phase = Phase::Writing;
+                return watch(p, EPOLLOUT);
+            }
+            if (n < 0)
+                return fail(p, now);
+            p.request_sent += static_cast<std::size_t>(n);
+        }
+        p.phase = Phase::Reading;
+        watch(p, EPOLLIN);
+    }
+
+    void on_event(Player& p, std::uint32_t events, Clock::time_point now)
+    {
+        switch (p.phase) {
+        case Phase::Connecting: {
+            int error = 0;
+            socklen_t length = sizeof error;
+            ::getsockopt(p.fd.get(), SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0 || (events & EPOLLERR))
+                return fail(p, now);
+            return write_request(p, now);
+        }
+        case Phase::Writing:
+            return write_request(p, now);
+        case Phase::Reading:
+            return read_some(p, now);
+        case Phase::Throttled:
+            return fail(p, now);
+        case Phase::Idle:
+            // A keep-alive connection closed while idle; reconnect on the
+            // next request.
+            disconnect(p);
+            return;
+        }
+    }
+
+    /// One read, paced to the player's link rate.
+    void read_some(Player& p, Clock::time_point now)
+    {
+        const double elapsed = std::chrono::duration<double>(now - p.sent_at).count();
+        const double allowed = kBurstBytes + p.link_bps / 8 * elapsed - static_cast<double>(p.received);
+        if (allowed < 1) {
+            p.phase = Phase::Throttled;
+            watch(p, 0);
+            return schedule(p, now + seconds((1 - allowed + kBurstBytes / 4) / (p.link_bps / 8)));
+        }
+        const auto want = std::min(sizeof buffer_, static_cast<std::size_t>(allowed));
+        const ssize_t n = ::recv(p.fd.get(), buffer_, want, 0);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+            return;
+        if (n <= 0)
+            return fail(p, now);
+        p.received += static_cast<std::size_t>(n);
+        tally_.bytes += static_cast<std::size_t>(n);
+
+        std::string_view data(buffer_, static_cast<std::size_t>(n));
+        if (!p.head_done) {
+            const auto old = p.head.size();
+            p.head.append(data);
+            const auto end = p.head.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                if (p.head.size() > kHeadLimit)
+                    fail(p, now);
+                return;
+            }
+            if (!parse_head(p, end))
+                return fail(p, now);
+            // Unpaced, unlike the body: what the server itself took.
+            if (p.fetch == Fetch::Unit)
+                histograms_.first_byte.record(now - p.sent_at);
+            data.remove_prefix(end + 4 - old);
+        }
+        const auto take = std::min(data.size(), p.content_length - p.body_received);
+        if (p.fetch == Fetch::Playlist || p.fetch == Fetch::Hint)
+            p.body.append(data.substr(0, take));
+        p.body_received += take;
+        if (p.body_received == p.content_length)
+            complete(p, now);
+    }
+
+    bool parse_head(Player& p, std::size_t end)
+    {
+        p.head_done = true;
+        // "HTTP/1.1 200 OK"
+        if (p.head.size() < 12 || std::from_chars(p.head.data() + 9, p.head.data() + 12, p.status).ec != std::errc{})
+            return false;
+        bool length = false;
+        for (std::size_t at = p.head.find("\r\n") + 2; at < end;) {
+            const auto eol = p.head.find("\r\n", at);
+            const std::string_view line(p.head.data() + at, eol - at);
+            const auto colon = line.find(':');
+            auto value = colon == std::string_view::npos ? std::string_view{} : line.substr(colon + 1);
+            while (!value.empty() && value.front() == ' ')
+                value.remove_prefix(1);
+            if (colon != std::string_view::npos && iequals(line.substr(0, colon), "content-length"))
+                length = std::from_chars(value.data(), value.data() + value.size(), p.content_length).ec == std::errc{};
+            else if (colon != std::string_view::npos && iequals(line.substr(0, colon), "connection"))
+                p.close_after = iequals(value, "close");
+            at = eol + 2;
+        }
+        return length;
+    }
+
+    void complete(Player& p, Clock::time_point now)
+    {
+        p.phase = Phase::Idle;
+        if (p.close_after)
+            disconnect(p);
+        else
+            watch(p, EPOLLIN); // to notice the server closing it while idle
+
+        if (p.status != 200) {
+            ++tally_.errors;
+            // A segment gone from the window, or a reload the server
+            // refused: start over from a fresh playlist.
+            if (p.fetch == Fetch::Unit || p.fetch == Fetch::Playlist)
+                p.tuned = false;
+            if (p.fetch == Fetch::Hint)
+                p.next_hint = now + options_.hint_every;
+            if (p.fetch == Fetch::Map)
+                p.map_fetched = p.playlist.map;
+            return schedule(p, now + kRetryDelay);
+        }
+
+        switch (p.fetch) {
+        case Fetch::Playlist: {
+            if (!p.blocking_reload)
+                histograms_.playlists.record(now - p.sent_at);
+            auto playlist = parse_playlist(p.body, p.low_latency);
+            const auto last = [](const Playlist& l) {
+                return l.units.empty() ? std::pair<std::uint64_t, int>{0, -2}
+                                       : std::pair{l.units.back().sequence, l.units.back().part};
+            };
+            p.last_load_changed = last(playlist) != last(p.playlist);
+            p.last_load = p.sent_at;
+            p.playlist = std::move(playlist);
+            if (!p.tuned)
+                tune(p);
+            if (!p.tuned)
+                return schedule(p, now + kRetryDelay);
+            break;
+        }
+        case Fetch::Unit: {
+            (p.unit.part < 0 ? histograms_.segments : histograms_.parts).record(now - p.sent_at);
+            const double took = std::chrono::duration<double>(now - p.sent_at).count();
+            if (took > 0) {
+                const double bps = static_cast<double>(p.content_length) * 8 / took;
+                p.measured_bps = p.measured_bps == 0 ? bps : 0.7 * p.measured_bps + 0.3 * bps;
+            }
+            played(p, p.unit.seconds, now);
+            if (p.unit.part < 0) {
+                p.sequence = p.unit.sequence + 1;
+                p.part = 0;
+            } else {
+                p.sequence = p.unit.sequence;
+                p.part = p.unit.part + 1;
+            }
+            break;
+        }
+        case Fetch::Map:
+            p.map_fetched = p.playlist.map;
+            break;
+        case Fetch::Hint: {
+            std::string rendition(hinted_rendition(p.body));
+            if (rendition.empty()) {
+                // No estimate on the server yet: pick from what the
+                // player measured itself.
+                const auto bps = static_cast<std::uint32_t>(std::min(p.measured_bps, 4e9));
+                if (const auto i = rendition_hint(ladder_, bps))
+                    rendition = ladder_[*i].name;
+            }
+            if (!rendition.empty()) {
+                if (!p.rendition.empty() && rendition != p.rendition)
+                    ++tally_.switches;
+                p.rendition = std::move(rendition);
+            }
+            p.next_hint = now + options_.hint_every;
+            // The link drifts, so estimates and hints move over a session.
+            std::lognormal_distribution<double> drift(0, 0.3);
+            p.link_bps = std::clamp(p.link_bps * drift(rng_), double{kMinLinkBps},
+                                    20.0 * options_.median_bandwidth_bps);
+            break;
+        }
+        }
+        step(p, now);
+    }
+
+    /// Feeds `media_seconds` into the playback buffer model.
+    void played(Player& p, double media_seconds, Clock::time_point now)
+    {
+        if (!p.playing) {
+            p.prebuffer_seconds += media_seconds;
+            if (++p.prebuffered >= kPlayAfter) {
+                p.playing = true;
+                p.dry_at = now + seconds(p.prebuffer_seconds);
+                histograms_.startup.record(now - p.joined);
+            }
+        } else if (now > p.dry_at) {
+            ++tally_.rebuffers;
+            tally_.stalled += now - p.dry_at;
+            p.dry_at = now + seconds(media_seconds);
+        } else {
+            p.dry_at += seconds(media_seconds);
+        }
+    }
+
+    const LoadTestOptions& options_;
+    const Address& address_;
+    std::size_t first_slot_;
+    std::vector<Player> players_;
+    Histograms& histograms_;
+    std::vector<Rendition> ladder_ = default_ladder();
+    std::mt19937_64 rng_;
+    UniqueFd epoll_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+    std::uint64_t tokens_ = 0;
+    Tally tally_;
+    char buffer_[64 * 1024];
+};
+
+void log_latency(ReportLog& log, const char* kind, const metrics::Histogram::Snapshot& h)
+{
+    const auto q = [&](double quantile) { return ms(std::chrono::nanoseconds(h.quantile(quantile))); };
+    char buf[256];
+    std::snprintf(buf, sizeof buf, "load.latency kind=%s count=%llu mean_ms=%.2f p50_ms=%.2f p99_ms=%.2f p999_ms=%.2f",
+                  kind, static_cast<unsigned long long>(h.count),
+                  h.count ? ms(std::chrono::nanoseconds(h.sum / h.count)) : 0.0, q(0.5), q(0.99), q(0.999));
+    log.line(buf);
+}
+
+} // namespace
+
+LoadTestReport run_load_test(const LoadTestOptions& options, ReportLog* log)
+{
+    if (options.channels.empty() || options.players == 0 || options.threads == 0)
+        throw std::invalid_argument("load: need channels, players and threads");
+    if (options.mean_watch.count() <= 0 || options.duration.count() <= 0)
+        throw std::invalid_argument("load: duration and watch time must be positive");
+    const auto address = resolve(options.host, options.port);
+    const auto threads = static_cast<std::size_t>(std::min<std::size_t>(options.threads, options.players));
+
+    Histograms histograms;
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (std::size_t t = 0, first = 0; t < threads; ++t) {
+        const auto slots = options.players / threads + (t < options.players % threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(options, address, first, slots, histograms));
+        first += slots;
+    }
+
+    const auto start = Clock::now();
+    const auto end = start + options.duration;
+    {
+        std::vector<std::jthread> running;
+        std::vector<std::exception_ptr> errors(threads);
+        for (std::size_t t = 0; t < threads; ++t)
+            running.emplace_back([&, t] {
+                try {
+                    workers[t]->run(start, end);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        running.clear();
+        for (auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+    }
+
+    LoadTestReport report;
+    report.wall = Clock::now() - start;
+    for (const auto& w : workers) {
+        const auto& t = w->tally();
+        report.joins += t.joins;
+        report.leaves += t.leaves;
+        report.requests += t.requests;
+        report.errors += t.errors;
+        report.resyncs += t.resyncs;
+        report.rebuffers += t.rebuffers;
+        report.switches += t.switches;
+        report.bytes += t.bytes;
+        report.stalled += t.stalled;
+    }
+    report.segments = histograms.segments.snapshot();
+    report.parts = histograms.parts.snapshot();
+    report.first_byte = histograms.first_byte.snapshot();
+    report.playlists = histograms.playlists.snapshot();
+    report.startup = histograms.startup.snapshot();
+
+    if (log) {
+        log_latency(*log, "segment", report.segments);
+        log_latency(*log, "part", report.parts);
+        log_latency(*log, "firstbyte", report.first_byte);
+        log_latency(*log, "playlist", report.playlists);
+        log_latency(*log, "startup", report.startup);
+        char buf[384];
+        std::snprintf(buf, sizeof buf,
+                      "load.total players=%zu threads=%zu wall_ms=%.0f joins=%llu leaves=%llu requests=%llu "
+                      "errors=%llu resyncs=%llu rebuffers=%llu stalled_ms=%.0f switches=%llu mbytes=%.1f",
+                      options.players, threads, ms(report.wall), static_cast<unsigned long long>(report.joins),
+                      static_cast<unsigned long long>(report.leaves), static_cast<unsigned long long>(report.requests),
+                      static_cast<unsigned long long>(report.errors), static_cast<unsigned long long>(report.resyncs),
+                      static_cast<unsigned long long>(report.rebuffers), ms(report.stalled),
+                      static_cast<unsigned long long>(report.switches), static_cast<double>(report.bytes) / 1e6);
+        log->line(buf);
+    }
+    return report;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,214 @@
+#include "seinfeld_tv/loudness.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/subprocess.hpp"
+#include "loudness_kernels.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+using loudness_detail::FilterState;
+using loudness_detail::KWeighting;
+
+static_assert(LoudnessMeter::kMaxChannels == loudness_detail::kMaxChannels);
+
+constexpr double kAbsoluteGateLufs = -70.0;
+constexpr double kRelativeGateLu = -10.0;
+/// Headroom kept below full scale when positive gain would clip.
+constexpr double kPeakCeilingDb = -1.0;
+
+double lufs_of(double energy) noexcept
+{
+    return -0.691 + 10.0 * std::log10(energy);
+}
+
+double energy_of(double lufs) noexcept
+{
+    return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+loudness_detail::FilterFn filter_kernel()
+{
+    static const auto fn = loudness_detail::select_filter();
+    return fn;
+}
+
+loudness_detail::GainFn gain_kernel()
+{
+    static const auto fn = loudness_detail::select_gain();
+    return fn;
+}
+
+} // namespace
+
+float normalization_gain_db(const Loudness& measured, float target_lufs) noexcept
+{
+    double gain = double{target_lufs} - measured.integrated_lufs;
+    if (measured.sample_peak > 0) {
+        const double peak_db = 20.0 * std::log10(double{measured.sample_peak});
+        gain = std::min(gain, kPeakCeilingDb - peak_db);
+    }
+    return static_cast<float>(gain);
+}
+
+LoudnessMeter::LoudnessMeter(unsigned channels, unsigned sample_rate)
+    : channels_(channels), sub_block_frames_(sample_rate / 10)
+{
+    if (sample_rate < 8000)
+        throw std::invalid_argument("loudness: unsupported sample rate");
+    switch (channels) {
+    case 1:
+    case 2:
+        std::fill_n(weights_, channels, 1.0);
+        break;
+    case 6: {
+        const double w[6] = {1.0, 1.0, 1.0, 0.0, 1.41, 1.41};
+        std::copy_n(w, 6, weights_);
+        break;
+    }
+    default:
+        throw std::invalid_argument("loudness: unsupported channel layout");
+    }
+
+    // BS.1770 coefficients re-derived for the actual rate (as libebur128).
+    const double fs = sample_rate;
+    {
+        const double f0 = 1681.974450955533, gain_db = 3.999843853973347, q = 0.7071752369554196;
+        const double k = std::tan(std::numbers::pi * f0 / fs);
+        const double vh = std::pow(10.0, gain_db / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf_ = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                  2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k = std::tan(std::numbers::pi * f0 / fs);
+        const double a0 = 1.0 + k / q + k * k;
+        highpass_ = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+}
+
+void LoudnessMeter::filter(const float* samples, std::size_t frames)
+{
+    const KWeighting k{shelf_.b0,    shelf_.b1,    shelf_.b2,    shelf_.a1,    shelf_.a2,
+                       highpass_.b0, highpass_.b1, highpass_.b2, highpass_.a1, highpass_.a2};
+    FilterState st;
+    std::memcpy(st.z, state_, sizeof state_);
+    std::memcpy(st.energy, energy_, sizeof energy_);
+    st.peak = peak_;
+    filter_kernel()(samples, frames, channels_, k, st);
+    std::memcpy(state_, st.z, sizeof state_);
+    std::memcpy(energy_, st.energy, sizeof energy_);
+    peak_ = st.peak;
+}
+
+void LoudnessMeter::add(const float* samples, std::size_t frames)
+{
+    while (frames > 0) {
+        const std::size_t n = std::min(frames, sub_block_frames_ - sub_block_fill_);
+        filter(samples, n);
+        samples += n * channels_;
+        frames -= n;
+        if ((sub_block_fill_ += n) == sub_block_frames_)
+            finish_sub_block();
+    }
+}
+
+void LoudnessMeter::finish_sub_block()
+{
+    double weighted = 0;
+    for (unsigned c = 0; c < channels_; ++c) {
+        weighted += weights_[c] * energy_[c];
+        energy_[c] = 0;
+    }
+    sub_blocks_[sub_block_count_++ % 4] = weighted / static_cast<double>(sub_block_frames_);
+    sub_block_fill_ = 0;
+    if (sub_block_count_ >= 4)
+        block_energy_.push_back((sub_blocks_[0] + sub_blocks_[1] + sub_blocks_[2] + sub_blocks_[3]) / 4.0);
+}
+
+std::optional<Loudness> LoudnessMeter::result() const
+{
+    const double absolute = energy_of(kAbsoluteGateLufs);
+    double sum = 0;
+    std::size_t count = 0;
+    for (double e : block_energy_) {
+        if (e > absolute) {
+            sum += e;
+            ++count;
+        }
+    }
+    if (count == 0)
+        return std::nullopt;
+
+    const double relative = energy_of(lufs_of(sum / static_cast<double>(count)) + kRelativeGateLu);
+    const double gate = std::max(absolute, relative);
+    sum = 0;
+    count = 0;
+    for (double e : block_energy_) {
+        if (e > gate) {
+            sum += e;
+            ++count;
+        }
+    }
+    if (count == 0)
+        return std::nullopt;
+    return Loudness{static_cast<float>(lufs_of(sum / static_cast<double>(count))), peak_};
+}
+
+void apply_gain(float* samples, std::size_t n, float gain) noexcept
+{
+    gain_kernel()(samples, n, gain);
+}
+
+Loudness measure_file_loudness(const std::filesystem::path& media, const std::string& ffmpeg)
+{
+    constexpr unsigned kChannels = 2, kRate = 48000;
+    Subprocess child({ffmpeg, "-nostdin", "-loglevel", "error", "-i", media.string(), "-map", "0:a:0", "-vn",
+                      "-ac", "2", "-ar", "48000", "-f", "f32le", "-"},
+                     Subprocess::Stdout::Pipe);
+    LoudnessMeter meter(kChannels, kRate);
+
+    constexpr std::size_t kFrameBytes = kChannels * sizeof(float);
+    std::vector<float> buffer(16384 * kChannels);
+    auto* bytes = reinterpret_cast<char*>(buffer.data());
+    const std::size_t capacity = buffer.size() * sizeof(float);
+    std::size_t fill = 0;
+    for (;;) {
+        const ssize_t n = ::read(child.stdout_fd(), bytes + fill, capacity - fill);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("read");
+        }
+        if (n == 0)
+            break;
+        fill += static_cast<std::size_t>(n);
+        const std::size_t frames = fill / kFrameBytes;
+        meter.add(buffer.data(), frames);
+        // A partial frame is carried over to the front of the buffer.
+        const std::size_t used = frames * kFrameBytes;
+        std::memmove(bytes, bytes + used, fill - used);
+        fill -= used;
+    }
+    if (int status = child.wait(); status != 0)
+        throw std::runtime_error("loudness: " + ffmpeg + " exited with status " + std::to_string(status) +
+                                 " for " + media.string());
+    auto result = meter.result();
+    if (!result)
+        throw std::runtime_error("loudness: no audio above the gate in " + media.string());
+    return *result;
+}
+
+} // namespace seinfeld_tv
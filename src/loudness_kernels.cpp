@@ -0,0 +1,252 @@
+#include "loudness_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STV_LOUDNESS_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define STV_LOUDNESS_NEON 1
+#endif
+
+namespace seinfeld_tv::loudness_detail {
+
+void filter_scalar(const float* in, std::size_t frames, unsigned channels, const KWeighting& k,
+                   FilterState& st) noexcept
+{
+    for (unsigned c = 0; c < channels; ++c) {
+        double z0 = st.z[0][c], z1 = st.z[1][c], z2 = st.z[2][c], z3 = st.z[3][c];
+        double e = st.energy[c];
+        float peak = st.peak;
+        for (std::size_t f = 0; f < frames; ++f) {
+            const float xf = in[f * channels + c];
+            peak = std::max(peak, std::fabs(xf));
+            const double x = xf;
+            const double y = k.s_b0 * x + z0;
+            z0 = k.s_b1 * x - k.s_a1 * y + z1;
+            z1 = k.s_b2 * x - k.s_a2 * y;
+            const double w = k.h_b0 * y + z2;
+            z2 = k.h_b1 * y - k.h_a1 * w + z3;
+            z3 = k.h_b2 * y - k.h_a2 * w;
+            e += w * w;
+        }
+        st.z[0][c] = z0;
+        st.z[1][c] = z1;
+        st.z[2][c] = z2;
+        st.z[3][c] = z3;
+        st.energy[c] = e;
+        st.peak = peak;
+    }
+}
+
+void gain_scalar(float* samples, std::size_t n, float gain) noexcept
+{
+    for (std::size_t i = 0; i < n; ++i)
+        samples[i] = std::clamp(samples[i] * gain, -1.0f, 1.0f);
+}
+
+#if STV_LOUDNESS_X86
+
+namespace {
+
+/// Loads `lanes` (<= 2) consecutive floats widened to doubles.
+inline __m128d load2_pd(const float* p, unsigned lanes) noexcept
+{
+    if (lanes >= 2)
+        return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p))));
+    return _mm_cvtps_pd(_mm_load_ss(p));
+}
+
+/// SSE2 is baseline on x86-64: two channels per register.
+void filter_sse2(const float* in, std::size_t frames, unsigned channels, const KWeighting& k,
+                 FilterState& st) noexcept
+{
+    const __m128d sb0 = _mm_set1_pd(k.s_b0), sb1 = _mm_set1_pd(k.s_b1), sb2 = _mm_set1_pd(k.s_b2);
+    const __m128d sa1 = _mm_set1_pd(k.s_a1), sa2 = _mm_set1_pd(k.s_a2);
+    const __m128d hb0 = _mm_set1_pd(k.h_b0), hb1 = _mm_set1_pd(k.h_b1), hb2 = _mm_set1_pd(k.h_b2);
+    const __m128d ha1 = _mm_set1_pd(k.h_a1), ha2 = _mm_set1_pd(k.h_a2);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_set1_ps(st.peak);
+
+    for (unsigned c = 0; c < channels; c += 2) {
+        const unsigned lanes = std::min(2u, channels - c);
+        __m128d z0 = _mm_load_pd(&st.z[0][c]), z1 = _mm_load_pd(&st.z[1][c]);
+        __m128d z2 = _mm_load_pd(&st.z[2][c]), z3 = _mm_load_pd(&st.z[3][c]);
+        __m128d e = _mm_load_pd(&st.energy[c]);
+        for (std::size_t f = 0; f < frames; ++f) {
+            const float* p = in + f * channels + c;
+            const __m128d x = load2_pd(p, lanes);
+            peak = _mm_max_ps(peak, _mm_and_ps(_mm_cvtpd_ps(x), abs_mask));
+            const __m128d y = _mm_add_pd(_mm_mul_pd(sb0, x), z0);
+            z0 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(sb1, x), _mm_mul_pd(sa1, y)), z1);
+            z1 = _mm_sub_pd(_mm_mul_pd(sb2, x), _mm_mul_pd(sa2, y));
+            const __m128d w = _mm_add_pd(_mm_mul_pd(hb0, y), z2);
+            z2 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(hb1, y), _mm_mul_pd(ha1, w)), z3);
+            z3 = _mm_sub_pd(_mm_mul_pd(hb2, y), _mm_mul_pd(ha2, w));
+            e = _mm_add_pd(e, _mm_mul_pd(w, w));
+        }
+        _mm_store_pd(&st.z[0][c], z0);
+        _mm_store_pd(&st.z[1][c], z1);
+        _mm_store_pd(&st.z[2][c], z2);
+        _mm_store_pd(&st.z[3][c], z3);
+        _mm_store_pd(&st.energy[c], e);
+    }
+    alignas(16) float lanes_peak[4];
+    _mm_store_ps(lanes_peak, peak);
+    st.peak = std::max(std::max(lanes_peak[0], lanes_peak[1]), std::max(lanes_peak[2], lanes_peak[3]));
+}
+
+/// AVX2+FMA: four channels per register.
+__attribute__((target("avx2,fma"))) void filter_avx2(const float* in, std::size_t frames, unsigned channels,
+                                                     const KWeighting& k, FilterState& st) noexcept
+{
+    const __m256d sb0 = _mm256_set1_pd(k.s_b0), sb1 = _mm256_set1_pd(k.s_b1), sb2 = _mm256_set1_pd(k.s_b2);
+    const __m256d sa1 = _mm256_set1_pd(k.s_a1), sa2 = _mm256_set1_pd(k.s_a2);
+    const __m256d hb0 = _mm256_set1_pd(k.h_b0), hb1 = _mm256_set1_pd(k.h_b1), hb2 = _mm256_set1_pd(k.h_b2);
+    const __m256d ha1 = _mm256_set1_pd(k.h_a1), ha2 = _mm256_set1_pd(k.h_a2);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_set1_ps(st.peak);
+
+    for (unsigned c = 0; c < channels; c += 4) {
+        const unsigned lanes = std::min(4u, channels - c);
+        const __m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32(static_cast<int>(lanes)), _mm_setr_epi32(0, 1, 2, 3));
+        __m256d z0 = _mm256_load_pd(&st.z[0][c]), z1 = _mm256_load_pd(&st.z[1][c]);
+        __m256d z2 = _mm256_load_pd(&st.z[2][c]), z3 = _mm256_load_pd(&st.z[3][c]);
+        __m256d e = _mm256_load_pd(&st.energy[c]);
+        for (std::size_t f = 0; f < frames; ++f) {
+            const __m128 xf = _mm_maskload_ps(in + f * channels + c, mask);
+            peak = _mm_max_ps(peak, _mm_and_ps(xf, abs_mask));
+            const __m256d x = _mm256_cvtps_pd(xf);
+            const __m256d y = _mm256_fmadd_pd(sb0, x, z0);
+            z0 = _mm256_fnmadd_pd(sa1, y, _mm256_fmadd_pd(sb1, x, z1));
+            z1 = _mm256_fnmadd_pd(sa2, y, _mm256_mul_pd(sb2, x));
+            const __m256d w = _mm256_fmadd_pd(hb0, y, z2);
+            z2 = _mm256_fnmadd_pd(ha1, w, _mm256_fmadd_pd(hb1, y, z3));
+            z3 = _mm256_fnmadd_pd(ha2, w, _mm256_mul_pd(hb2, y));
+            e = _mm256_fmadd_pd(w, w, e);
+        }
+        _mm256_store_pd(&st.z[0][c], z0);
+        _mm256_store_pd(&st.z[1][c], z1);
+        _mm256_store_pd(&st.z[2][c], z2);
+        _mm256_store_pd(&st.z[3][c], z3);
+        _mm256_store_pd(&st.energy[c], e);
+    }
+    alignas(16) float lanes_peak[4];
+    _mm_store_ps(lanes_peak, peak);
+    st.peak = std::max(std::max(lanes_peak[0], lanes_peak[1]), std::max(lanes_peak[2], lanes_peak[3]));
+}
+
+void gain_sse2(float* samples, std::size_t n, float gain) noexcept
+{
+    const __m128 g = _mm_set1_ps(gain), lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(samples + i, _mm_min_ps(hi, _mm_max_ps(lo, _mm_mul_ps(g, _mm_loadu_ps(samples + i)))));
+    gain_scalar(samples + i, n - i, gain);
+}
+
+__attribute__((target("avx2"))) void gain_avx2(float* samples, std::size_t n, float gain) noexcept
+{
+    const __m256 g = _mm256_set1_ps(gain), lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(samples + i,
+                         _mm256_min_ps(hi, _mm256_max_ps(lo, _mm256_mul_ps(g, _mm256_loadu_ps(samples + i)))));
+    gain_scalar(samples + i, n - i, gain);
+}
+
+} // namespace
+
+FilterFn select_filter() noexcept
+{
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return filter_avx2;
+    return filter_sse2;
+}
+
+GainFn select_gain() noexcept
+{
+    if (__builtin_cpu_supports("avx2"))
+        return gain_avx2;
+    return gain_sse2;
+}
+
+#elif STV_LOUDNESS_NEON
+
+namespace {
+
+void filter_neon(const float* in, std::size_t frames, unsigned channels, const KWeighting& k,
+                 FilterState& st) noexcept
+{
+    const float64x2_t sb0 = vdupq_n_f64(k.s_b0), sb1 = vdupq_n_f64(k.s_b1), sb2 = vdupq_n_f64(k.s_b2);
+    const float64x2_t sa1 = vdupq_n_f64(k.s_a1), sa2 = vdupq_n_f64(k.s_a2);
+    const float64x2_t hb0 = vdupq_n_f64(k.h_b0), hb1 = vdupq_n_f64(k.h_b1), hb2 = vdupq_n_f64(k.h_b2);
+    const float64x2_t ha1 = vdupq_n_f64(k.h_a1), ha2 = vdupq_n_f64(k.h_a2);
+    float32x2_t peak = vdup_n_f32(st.peak);
+
+    for (unsigned c = 0; c < channels; c += 2) {
+        const bool pair = channels - c >= 2;
+        float64x2_t z0 = vld1q_f64(&st.z[0][c]), z1 = vld1q_f64(&st.z[1][c]);
+        float64x2_t z2 = vld1q_f64(&st.z[2][c]), z3 = vld1q_f64(&st.z[3][c]);
+        float64x2_t e = vld1q_f64(&st.energy[c]);
+        for (std::size_t f = 0; f < frames; ++f) {
+            const float* p = in + f * channels + c;
+            const float32x2_t xf = pair ? vld1_f32(p) : vset_lane_f32(*p, vdup_n_f32(0.0f), 0);
+            peak = vmax_f32(peak, vabs_f32(xf));
+            const float64x2_t x = vcvt_f64_f32(xf);
+            const float64x2_t y = vfmaq_f64(z0, sb0, x);
+            z0 = vfmsq_f64(vfmaq_f64(z1, sb1, x), sa1, y);
+            z1 = vfmsq_f64(vmulq_f64(sb2, x), sa2, y);
+            const float64x2_t w = vfmaq_f64(z2, hb0, y);
+            z2 = vfmsq_f64(vfmaq_f64(z3, hb1, y), ha1, w);
+            z3 = vfmsq_f64(vmulq_f64(hb2, y), ha2, w);
+            e = vfmaq_f64(e, w, w);
+        }
+        vst1q_f64(&st.z[0][c], z0);
+        vst1q_f64(&st.z[1][c], z1);
+        vst1q_f64(&st.z[2][c], z2);
+        vst1q_f64(&st.z[3][c], z3);
+        vst1q_f64(&st.energy[c], e);
+    }
+    st.peak = vmaxv_f32(peak);
+}
+
+void gain_neon(float* samples, std::size_t n, float gain) noexcept
+{
+    const float32x4_t g = vdupq_n_f32(gain), lo = vdupq_n_f32(-1.0f), hi = vdupq_n_f32(1.0f);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(samples + i, vminq_f32(hi, vmaxq_f32(lo, vmulq_f32(g, vld1q_f32(samples + i)))));
+    gain_scalar(samples + i, n - i, gain);
+}
+
+} // namespace
+
+FilterFn select_filter() noexcept
+{
+    return filter_neon;
+}
+
+GainFn select_gain() noexcept
+{
+    return gain_neon;
+}
+
+#else
+
+FilterFn select_filter() noexcept
+{
+    return filter_scalar;
+}
+
+GainFn select_gain() noexcept
+{
+    return gain_scalar;
+}
+
+#endif
+
+} // namespace seinfeld_tv::loudness_detail
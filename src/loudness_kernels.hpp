@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+/// SIMD kernels behind LoudnessMeter and apply_gain. Each kernel has a
+/// scalar reference version; the dispatcher picks the widest one the CPU
+/// supports once, on first use.
+namespace seinfeld_tv::loudness_detail {
+
+inline constexpr unsigned kMaxChannels = 8;
+
+/// Two cascaded biquads (BS.1770 pre-filter, then RLB high-pass) in
+/// direct form II transposed.
+struct KWeighting {
+    double s_b0, s_b1, s_b2, s_a1, s_a2;
+    double h_b0, h_b1, h_b2, h_a1, h_a2;
+};
+
+struct FilterState {
+    /// [0..1] pre-filter z1/z2, [2..3] high-pass z1/z2, one lane per channel.
+    alignas(32) double z[4][kMaxChannels];
+    /// Sum of squared K-weighted samples per channel.
+    alignas(32) double energy[kMaxChannels];
+    float peak;
+};
+
+/// Filters `frames` interleaved frames, accumulating per-channel energy
+/// and the absolute sample peak into `st`.
+using FilterFn = void (*)(const float* in, std::size_t frames, unsigned channels, const KWeighting& k,
+                          FilterState& st) noexcept;
+using GainFn = void (*)(float* samples, std::size_t n, float gain) noexcept;
+
+void filter_scalar(const float* in, std::size_t frames, unsigned channels, const KWeighting& k,
+                   FilterState& st) noexcept;
+void gain_scalar(float* samples, std::size_t n, float gain) noexcept;
+
+FilterFn select_filter() noexcept;
+GainFn select_gain() noexcept;
+
+} // namespace seinfeld_tv::loudness_detail
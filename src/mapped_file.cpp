@@ -0,0 +1,65 @@
+#include "seinfeld_tv/mapped_file.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace seinfeld_tv {
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    UniqueFd fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd)
+        throw_errno("open");
+
+    struct stat st {};
+    if (::fstat(fd.get(), &st) != 0)
+        throw_errno("fstat");
+    if (st.st_size == 0)
+        return;
+
+    void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (p == MAP_FAILED)
+        throw_errno("mmap");
+    data_ = static_cast<const std::byte*>(p);
+    size_ = static_cast<std::size_t>(st.st_size);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+void MappedFile::will_need() const noexcept
+{
+    if (data_)
+        ::madvise(const_cast<std::byte*>(data_), size_, MADV_WILLNEED);
+}
+
+void MappedFile::sequential() const noexcept
+{
+    if (data_)
+        ::madvise(const_cast<std::byte*>(data_), size_, MADV_SEQUENTIAL);
+}
+
+void MappedFile::unmap() noexcept
+{
+    if (data_)
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace seinfeld_tv
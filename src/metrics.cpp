@@ -0,0 +1,168 @@
+#include "seinfeld_tv/metrics.hpp"
+
+#include <bit>
+#include <cinttypes>
+#include <cstdio>
+
+namespace seinfeld_tv::metrics {
+
+namespace {
+
+/// Bucket bounds, in seconds, of every exported latency histogram.
+constexpr std::array<double, 16> kLatencyBounds = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                                   0.05,   0.1,     0.25,   0.5,   1,      2.5,   5,     10};
+
+} // namespace
+
+std::size_t thread_slot() noexcept
+{
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t mine = next.fetch_add(1, std::memory_order_relaxed) % kSlots;
+    return mine;
+}
+
+std::uint64_t Counter::value() const noexcept
+{
+    std::uint64_t total = 0;
+    for (const auto& c : cells_)
+        total += c.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+Histogram::Histogram() : slots_(std::make_unique<Slot[]>(kSlots)) {}
+
+std::size_t Histogram::bucket(std::uint64_t value) noexcept
+{
+    constexpr std::uint64_t kSub = std::uint64_t{1} << kSubBits;
+    if (value < kSub)
+        return static_cast<std::size_t>(value);
+    const auto magnitude = static_cast<unsigned>(std::bit_width(value)) - 1;
+    if (magnitude >= kMaxBits)
+        return kBuckets - 1;
+    const unsigned shift = magnitude - kSubBits;
+    return static_cast<std::size_t>((std::uint64_t{shift + 1} << kSubBits) + ((value >> shift) - kSub));
+}
+
+std::uint64_t Histogram::lower_bound(std::size_t i) noexcept
+{
+    constexpr std::uint64_t kSub = std::uint64_t{1} << kSubBits;
+    if (i < kSub)
+        return i;
+    const auto shift = static_cast<unsigned>(i >> kSubBits) - 1;
+    return (kSub + (i & (kSub - 1))) << shift;
+}
+
+Histogram::Snapshot Histogram::snapshot() const noexcept
+{
+    Snapshot out;
+    for (std::size_t s = 0; s < kSlots; ++s) {
+        const auto& slot = slots_[s];
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            const auto n = slot.counts[i].load(std::memory_order_relaxed);
+            out.counts[i] += n;
+            out.count += n;
+        }
+        out.sum += slot.sum.load(std::memory_order_relaxed);
+    }
+    return out;
+}
+
+std::uint64_t Histogram::Snapshot::count_at_or_below(std::uint64_t value) const noexcept
+{
+    std::uint64_t n = 0;
+    for (std::size_t i = 0; i < kBuckets && lower_bound(i) <= value; ++i)
+        n += counts[i];
+    return n;
+}
+
+std::uint64_t Histogram::Snapshot::quantile(double q) const noexcept
+{
+    if (count == 0)
+        return 0;
+    const auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += counts[i];
+        if (seen > rank) {
+            const auto lo = lower_bound(i);
+            const auto hi = i + 1 < kBuckets ? lower_bound(i + 1) : lo + 1;
+            return lo + (hi - lo) / 2;
+        }
+    }
+    return lower_bound(kBuckets - 1);
+}
+
+std::string label(std::string_view key, std::string_view value)
+{
+    std::string out(key);
+    out += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"')
+            out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+void Exposition::family(std::string_view name, std::string_view type, std::string_view help)
+{
+    out_ += "# HELP ";
+    out_ += name;
+    out_ += ' ';
+    out_ += help;
+    out_ += "\n# TYPE ";
+    out_ += name;
+    out_ += ' ';
+    out_ += type;
+    out_ += '\n';
+}
+
+void Exposition::series(std::string_view name, std::string_view labels)
+{
+    out_ += name;
+    if (!labels.empty()) {
+        out_ += '{';
+        out_ += labels;
+        out_ += '}';
+    }
+    out_ += ' ';
+}
+
+void Exposition::sample(std::string_view name, std::string_view labels, std::uint64_t value)
+{
+    series(name, labels);
+    out_ += std::to_string(value);
+    out_ += '\n';
+}
+
+void Exposition::sample(std::string_view name, std::string_view labels, double value)
+{
+    series(name, labels);
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.9g", value);
+    out_ += buf;
+    out_ += '\n';
+}
+
+void Exposition::latency(std::string_view name, std::string_view labels, const Histogram& histogram)
+{
+    const auto snap = histogram.snapshot();
+    const std::string bucket = std::string(name) + "_bucket";
+    const std::string sep = labels.empty() ? "" : ",";
+    char le[48];
+    for (const double bound : kLatencyBounds) {
+        std::snprintf(le, sizeof le, "le=\"%g\"", bound);
+        sample(bucket, std::string(labels) + sep + le,
+               snap.count_at_or_below(static_cast<std::uint64_t>(bound * 1e9)));
+    }
+    sample(bucket, std::string(labels) + sep + "le=\"+Inf\"", snap.count);
+    sample(std::string(name) + "_sum", labels, static_cast<double>(snap.sum) / 1e9);
+    sample(std::string(name) + "_count", labels, snap.count);
+}
+
+} // namespace seinfeld_tv::metrics
@@ -0,0 +1,1032 @@
+#include "seinfeld_tv/mux.hpp"
+
+#include "seinfeld_tv/ts_packet.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// The PCR runs this far ahead of the decode time it accompanies.
+constexpr std::int64_t kPcrLead = kPtsPerSecond / 10;
+constexpr std::int64_t kTimestampMask = ts::kPtsWrap - 1;
+constexpr std::size_t kTsPayload = kTsPacketSize - 4;
+
+constexpr std::uint32_t kSyncSampleFlags = 0x02000000;    ///< depends on nothing
+constexpr std::uint32_t kNonSyncSampleFlags = 0x01010000; ///< depends on others, non-sync
+/// Duration given to a lone video sample, which has no successor to
+/// measure against.
+constexpr std::uint32_t kDefaultFrameTicks = 3003;
+constexpr std::uint32_t kAacFrameSamples = 1024;
+/// Both tracks use the 90 kHz clock of the source timestamps.
+constexpr std::uint64_t kTimescale = kPtsPerSecond;
+
+constexpr std::uint32_t kAdtsSampleRates[16] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+                                                16000, 12000, 11025, 8000,  7350,  0,     0,     0};
+
+std::uint32_t crc32_mpeg(std::span<const std::uint8_t> data) noexcept
+{
+    std::uint32_t crc = 0xffffffff;
+    for (auto b : data) {
+        crc ^= std::uint32_t{b} << 24;
+        for (int i = 0; i < 8; ++i)
+            crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+    return crc;
+}
+
+std::int64_t wrap(std::int64_t t) noexcept
+{
+    return t & kTimestampMask;
+}
+
+/// Signed distance from `reference` to `raw`, both 33-bit.
+std::int64_t wrapped_delta(std::int64_t raw, std::int64_t reference) noexcept
+{
+    std::int64_t d = wrap(raw - reference);
+    return d >= ts::kPtsWrap / 2 ? d - ts::kPtsWrap : d;
+}
+
+/// Appends big-endian fields and ISO-BMFF boxes.
+class Writer {
+public:
+    explicit Writer(std::pmr::vector<std::byte>& out) noexcept : out_(out) {}
+
+    void u8(std::uint32_t v) { out_.push_back(static_cast<std::byte>(v)); }
+    void u16(std::uint32_t v)
+    {
+        u8(v >> 8);
+        u8(v);
+    }
+    void u24(std::uint32_t v)
+    {
+        u8(v >> 16);
+        u16(v);
+    }
+    void u32(std::uint32_t v)
+    {
+        u16(v >> 16);
+        u16(v);
+    }
+    void u64(std::uint64_t v)
+    {
+        u32(static_cast<std::uint32_t>(v >> 32));
+        u32(static_cast<std::uint32_t>(v));
+    }
+    void fourcc(const char* c) { bytes({reinterpret_cast<const std::uint8_t*>(c), 4}); }
+    void bytes(std::span<const std::uint8_t> b)
+    {
+        const auto* p = reinterpret_cast<const std::byte*>(b.data());
+        out_.insert(out_.end(), p, p + b.size());
+    }
+    void zeros(std::size_t n) { out_.insert(out_.end(), n, std::byte{0}); }
+
+    std::size_t size() const noexcept { return out_.size(); }
+
+    /// Starts a box; close() fills in its size.
+    std::size_t open(const char* type)
+    {
+        const std::size_t at = size();
+        u32(0);
+        fourcc(type);
+        return at;
+    }
+    std::size_t open_full(const char* type, std::uint8_t version, std::uint32_t flags)
+    {
+        const std::size_t at = open(type);
+        u32(std::uint32_t{version} << 24 | flags);
+        return at;
+    }
+    void close(std::size_t at) { patch32(at, static_cast<std::uint32_t>(size() - at)); }
+
+    void patch32(std::size_t at, std::uint32_t v) noexcept
+    {
+        for (int i = 0; i < 4; ++i)
+            out_[at + static_cast<std::size_t>(i)] = static_cast<std::byte>(v >> (24 - 8 * i));
+    }
+
+private:
+    std::pmr::vector<std::byte>& out_;
+};
+
+// --- MPEG-TS ---------------------------------------------------------------
+
+using TsPacketBytes = std::array<std::uint8_t, kTsPacketSize>;
+
+TsPacketBytes psi_packet(std::uint16_t pid, std::span<const std::uint8_t> section)
+{
+    TsPacketBytes p;
+    p.fill(0xff);
+    p[0] = ts::kSyncByte;
+    p[1] = static_cast<std::uint8_t>(0x40 | pid >> 8);
+    p[2] = static_cast<std::uint8_t>(pid);
+    p[3] = 0x10;
+    p[4] = 0; // pointer field
+    std::copy(section.begin(), section.end(), p.begin() + 5);
+    const std::uint32_t crc = crc32_mpeg(section);
+    for (std::size_t i = 0; i < 4; ++i)
+        p[5 + section.size() + i] = static_cast<std::uint8_t>(crc >> (24 - 8 * i));
+    return p;
+}
+
+struct PsiPackets {
+    TsPacketBytes pat;
+    TsPacketBytes pmt;
+};
+
+PsiPackets make_psi(std::uint16_t pmt_pid, std::uint16_t video_pid, std::uint8_t video_type, std::uint16_t audio_pid,
+                    std::uint8_t audio_type)
+{
+    const std::uint8_t pat[] = {0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00, 0x00, 0x01,
+                                static_cast<std::uint8_t>(0xe0 | pmt_pid >> 8), static_cast<std::uint8_t>(pmt_pid)};
+    std::uint8_t pmt[] = {0x02, 0xb0, 0, 0x00, 0x01, 0xc1, 0x00, 0x00,
+                          static_cast<std::uint8_t>(0xe0 | video_pid >> 8), static_cast<std::uint8_t>(video_pid), 0xf0, 0x00,
+                          video_type, static_cast<std::uint8_t>(0xe0 | video_pid >> 8), static_cast<std::uint8_t>(video_pid),
+                          0xf0, 0x00,
+                          audio_type, static_cast<std::uint8_t>(0xe0 | audio_pid >> 8), static_cast<std::uint8_t>(audio_pid),
+                          0xf0, 0x00};
+    const std::size_t pmt_size = audio_type ? sizeof pmt : sizeof pmt - 5;
+    pmt[2] = static_cast<std::uint8_t>(pmt_size - 3 + 4);
+    return {psi_packet(0, pat), psi_packet(pmt_pid, {pmt, pmt_size})};
+}
+
+void emit_psi(std::pmr::vector<std::byte>& out, const TsPacketBytes& packet, std::uint8_t& cc)
+{
+    const auto* p = reinterpret_cast<const std::byte*>(packet.data());
+    const std::size_t at = out.size();
+    out.insert(out.end(), p, p + kTsPacketSize);
+    out[at + 3] = static_cast<std::byte>(0x10 | cc);
+    cc = (cc + 1) & 0x0f;
+}
+
+void write_timestamp(std::uint8_t* p, std::uint8_t marker, std::int64_t t) noexcept
+{
+    const auto v = static_cast<std::uint64_t>(t);
+    p[0] = static_cast<std::uint8_t>(marker << 4 | ((v >> 29) & 0x0e) | 1);
+    p[1] = static_cast<std::uint8_t>(v >> 22);
+    p[2] = static_cast<std::uint8_t>(((v >> 14) & 0xfe) | 1);
+    p[3] = static_cast<std::uint8_t>(v >> 7);
+    p[4] = static_cast<std::uint8_t>(((v << 1) & 0xfe) | 1);
+}
+
+/// Writes a PES header into `h` (at least 19 bytes) and returns its size.
+/// `dts` is only written when it differs from `pts`; a zero length leaves
+/// the PES unbounded.
+std::size_t pes_header(std::uint8_t* h, std::uint8_t stream_id, std::int64_t pts, std::int64_t dts,
+                       std::size_t es_size, bool bounded) noexcept
+{
+    const bool with_pts = pts >= 0;
+    const bool with_dts = with_pts && dts >= 0 && dts != pts;
+    const std::size_t fields = with_dts ? 10 : with_pts ? 5 : 0;
+    const std::size_t length = 3 + fields + es_size;
+    h[0] = 0;
+    h[1] = 0;
+    h[2] = 1;
+    h[3] = stream_id;
+    h[4] = bounded && length <= 0xffff ? static_cast<std::uint8_t>(length >> 8) : 0;
+    h[5] = bounded && length <= 0xffff ? static_cast<std::uint8_t>(length) : 0;
+    h[6] = 0x80;
+    h[7] = with_dts ? 0xc0 : with_pts ? 0x80 : 0;
+    h[8] = static_cast<std::uint8_t>(fields);
+    if (with_pts)
+        write_timestamp(h + 9, with_dts ? 3 : 2, pts);
+    if (with_dts)
+        write_timestamp(h + 14, 1, dts);
+    return 9 + fields;
+}
+
+/// One PES as up to three pieces (header, optional delimiter, payload).
+struct PesPieces {
+    std::array<std::span<const std::uint8_t>, 3> parts;
+
+    std::size_t size() const noexcept { return parts[0].size() + parts[1].size() + parts[2].size(); }
+};
+
+/// Splits a PES over TS packets, stuffing the last one. The first packet's
+/// adaptation field carries the random access flag and a PCR when
+/// `pcr` is not negative.
+void packetize(std::pmr::vector<std::byte>& out, std::uint16_t pid, std::uint8_t& cc, const PesPieces& pes,
+               bool random_access, std::int64_t pcr)
+{
+    std::size_t part = 0;
+    std::size_t pos = 0;
+    std::size_t left = pes.size();
+    bool first = true;
+    while (left > 0) {
+        const std::size_t at = out.size();
+        out.resize(at + kTsPacketSize);
+        auto* p = reinterpret_cast<std::uint8_t*>(out.data() + at);
+        const bool flagged = first && (random_access || pcr >= 0);
+        std::size_t adaptation = flagged ? (pcr >= 0 ? 8 : 2) : 0; // including its length byte
+        if (left < kTsPayload - adaptation)
+            adaptation = kTsPayload - left;
+        p[0] = ts::kSyncByte;
+        p[1] = static_cast<std::uint8_t>((first ? 0x40 : 0) | pid >> 8);
+        p[2] = static_cast<std::uint8_t>(pid);
+        p[3] = static_cast<std::uint8_t>((adaptation ? 0x30 : 0x10) | cc);
+        cc = (cc + 1) & 0x0f;
+        std::size_t h = 4;
+        if (adaptation) {
+            p[4] = static_cast<std::uint8_t>(adaptation - 1);
+            if (adaptation > 1) {
+                p[5] = static_cast<std::uint8_t>((flagged && random_access ? 0x40 : 0) | (flagged && pcr >= 0 ? 0x10 : 0));
+                std::size_t f = 6;
+                if (flagged && pcr >= 0) {
+                    const auto base = static_cast<std::uint64_t>(pcr);
+                    p[f++] = static_cast<std::uint8_t>(base >> 25);
+                    p[f++] = static_cast<std::uint8_t>(base >> 17);
+                    p[f++] = static_cast<std::uint8_t>(base >> 9);
+                    p[f++] = static_cast<std::uint8_t>(base >> 1);
+                    p[f++] = static_cast<std::uint8_t>((base & 1) << 7 | 0x7e);
+                    p[f++] = 0;
+                }
+                std::memset(p + f, 0xff, 4 + adaptation - f);
+            }
+            h += adaptation;
+        }
+        std::size_t room = kTsPacketSize - h;
+        left -= room;
+        while (room > 0) {
+            const auto& s = pes.parts[part];
+            const std::size_t n = std::min(room, s.size() - pos);
+            std::memcpy(p + h, s.data() + pos, n);
+            h += n;
+            pos += n;
+            room -= n;
+            if (pos == s.size()) {
+                ++part;
+                pos = 0;
+            }
+        }
+        first = false;
+    }
+}
+
+template <nal::Codec V>
+constexpr auto delimiter_nal() noexcept
+{
+    constexpr auto d = VideoTraits<V>::kDelimiter;
+    std::array<std::uint8_t, 4 + d.size()> out{0, 0, 0, 1};
+    std::copy(d.begin(), d.end(), out.begin() + 4);
+    return out;
+}
+
+// --- NAL units -------------------------------------------------------------
+
+/// Calls f(nal) for each NAL unit of an Annex-B access unit, start codes
+/// and trailing zero bytes removed.
+template <class F>
+void for_each_nal(std::span<const std::uint8_t> es, F&& f)
+{
+    const std::uint8_t* end = es.data() + es.size();
+    const std::uint8_t* nal = nal::find_start_code(es.data(), end);
+    while (nal < end) {
+        const std::uint8_t* next = nal::find_start_code(nal, end);
+        const std::uint8_t* nal_end = next == end ? end : next - 3;
+        while (nal_end > nal && nal_end[-1] == 0)
+            --nal_end;
+        if (nal_end > nal)
+            f(std::span<const std::uint8_t>(nal, static_cast<std::size_t>(nal_end - nal)));
+        nal = next;
+    }
+}
+
+/// Exp-Golomb reader over an RBSP copy of the start of a NAL unit. Reads
+/// past the end return zeros, so a truncated header yields junk values,
+/// never a fault.
+class BitReader {
+public:
+    explicit BitReader(std::span<const std::uint8_t> unit) noexcept : size_(nal::unescape_rbsp(unit, rbsp_)) {}
+
+    void skip(std::size_t bits) noexcept { bit_ += bits; }
+    std::uint32_t bits(unsigned n) noexcept
+    {
+        std::uint32_t v = 0;
+        for (unsigned i = 0; i < n; ++i, ++bit_) {
+            const std::size_t byte = bit_ / 8;
+            const unsigned b = byte < size_ ? (rbsp_[byte] >> (7 - bit_ % 8)) & 1 : 0;
+            v = v << 1 | b;
+        }
+        return v;
+    }
+    bool flag() noexcept { return bits(1) != 0; }
+    std::uint32_t ue() noexcept
+    {
+        unsigned leading = 0;
+        while (!flag() && leading < 31 && bit_ < size_ * 8)
+            ++leading;
+        return (std::uint32_t{1} << leading) - 1 + bits(leading);
+    }
+    std::int32_t se() noexcept
+    {
+        const std::uint32_t k = ue();
+        return k & 1 ? static_cast<std::int32_t>((k + 1) / 2) : -static_cast<std::int32_t>(k / 2);
+    }
+
+private:
+    std::array<std::uint8_t, 256> rbsp_{};
+    std::size_t size_ = 0;
+    std::size_t bit_ = 0;
+};
+
+struct PictureFormat {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t chroma_format = 1;
+    std::uint32_t bit_depth_luma = 8;
+    std::uint32_t bit_depth_chroma = 8;
+    std::uint32_t sub_layers = 1; ///< HEVC
+    bool temporal_nesting = false;
+};
+
+void skip_scaling_list(BitReader& r, int size) noexcept
+{
+    std::int32_t last = 8;
+    std::int32_t next = 8;
+    for (int i = 0; i < size; ++i) {
+        if (next != 0)
+            next = (last + r.se() + 256) % 256;
+        last = next == 0 ? last : next;
+    }
+}
+
+PictureFormat parse_h264_sps(std::span<const std::uint8_t> sps) noexcept
+{
+    PictureFormat f;
+    BitReader r(sps);
+    r.skip(8); // NAL header
+    const std::uint32_t profile = r.bits(8);
+    r.skip(16); // constraint flags, level
+    r.ue();     // seq_parameter_set_id
+    if (profile == 100 || profile == 110 || profile == 122 || profile == 244 || profile == 44 || profile == 83
+        || profile == 86 || profile == 118 || profile == 128 || profile == 138 || profile == 139 || profile == 134
+        || profile == 135) {
+        f.chroma_format = r.ue();
+        if (f.chroma_format == 3)
+            r.skip(1);
+        f.bit_depth_luma = 8 + r.ue();
+        f.bit_depth_chroma = 8 + r.ue();
+        r.skip(1); // qpprime_y_zero_transform_bypass
+        if (r.flag())
+            for (int i = 0; i < (f.chroma_format == 3 ? 12 : 8); ++i)
+                if (r.flag())
+                    skip_scaling_list(r, i < 6 ? 16 : 64);
+    }
+    r.ue(); // log2_max_frame_num_minus4
+    if (const auto poc_type = r.ue(); poc_type == 0) {
+        r.ue();
+    } else if (poc_type == 1) {
+        r.skip(1);
+        r.se();
+        r.se();
+        for (std::uint32_t i = 0, n = std::min<std::uint32_t>(r.ue(), 255); i < n; ++i)
+            r.se();
+    }
+    r.ue();    // max_num_ref_frames
+    r.skip(1); // gaps_in_frame_num_allowed
+    const std::uint32_t width_mbs = r.ue() + 1;
+    const std::uint32_t height_units = r.ue() + 1;
+    const bool frame_mbs_only = r.flag();
+    if (!frame_mbs_only)
+        r.skip(1);
+    r.skip(1); // direct_8x8_inference
+    std::uint32_t crop[4] = {};
+    if (r.flag())
+        for (auto& c : crop)
+            c = r.ue();
+    const std::uint32_t unit_x = f.chroma_format == 1 || f.chroma_format == 2 ? 2 : 1;
+    const std::uint32_t unit_y = (f.chroma_format == 1 ? 2 : 1) * (frame_mbs_only ? 1 : 2);
+    f.width = width_mbs * 16 - unit_x * (crop[0] + crop[1]);
+    f.height = (frame_mbs_only ? 1 : 2) * height_units * 16 - unit_y * (crop[2] + crop[3]);
+    return f;
+}
+
+PictureFormat parse_hevc_sps(std::span<const std::uint8_t> sps) noexcept
+{
+    PictureFormat f;
+    BitReader r(sps);
+    r.skip(16 + 4); // NAL header, sps_video_parameter_set_id
+    const std::uint32_t max_sub_layers_minus1 = r.bits(3);
+    f.sub_layers = max_sub_layers_minus1 + 1;
+    f.temporal_nesting = r.flag();
+    r.skip(96); // general profile_tier_level
+    bool profile_present[8] = {};
+    bool level_present[8] = {};
+    for (std::uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+        profile_present[i] = r.flag();
+        level_present[i] = r.flag();
+    }
+    if (max_sub_layers_minus1 > 0)
+        r.skip(2 * (8 - max_sub_layers_minus1));
+    for (std::uint32_t i = 0; i < max_sub_layers_minus1; ++i)
+        r.skip((profile_present[i] ? 88 : 0) + (level_present[i] ? 8 : 0));
+    r.ue(); // sps_seq_parameter_set_id
+    f.chroma_format = r.ue();
+    if (f.chroma_format == 3)
+        r.skip(1);
+    f.width = r.ue();
+    f.height = r.ue();
+    if (r.flag()) {
+        const std::uint32_t sub_w = f.chroma_format == 1 || f.chroma_format == 2 ? 2 : 1;
+        const std::uint32_t sub_h = f.chroma_format == 1 ? 2 : 1;
+        const std::uint32_t left = r.ue(), right = r.ue(), top = r.ue(), bottom = r.ue();
+        f.width -= sub_w * (left + right);
+        f.height -= sub_h * (top + bottom);
+    }
+    f.bit_depth_luma = 8 + r.ue();
+    f.bit_depth_chroma = 8 + r.ue();
+    return f;
+}
+
+// --- fMP4 ------------------------------------------------------------------
+
+struct Sample {
+    std::uint64_t decode = 0; ///< ticks from the fragment's first video decode time
+    std::uint32_t duration = 0;
+    std::uint32_t size = 0;
+    std::int32_t composition = 0;
+    bool sync = false;
+    std::uint32_t first_piece = 0; ///< into the pieces list
+    std::uint32_t pieces = 0;
+};
+
+/// Payload pieces of the samples of one track, written to mdat in order.
+/// Video pieces are NAL units, each preceded by its 4-byte length.
+struct Track {
+    std::pmr::vector<Sample> samples;
+    std::pmr::vector<std::span<const std::uint8_t>> pieces;
+    std::int64_t base = 0; ///< 33-bit raw decode time of the first sample
+    std::uint64_t bytes = 0;
+
+    explicit Track(std::pmr::memory_resource* mr) : samples(mr), pieces(mr) {}
+};
+
+struct AdtsFrame {
+    std::size_t header = 0;
+    std::size_t length = 0; ///< including the header
+    std::uint32_t object_type = 2;
+    std::uint32_t rate_index = 0;
+    std::uint32_t channels = 0;
+};
+
+std::optional<AdtsFrame> parse_adts(std::span<const std::uint8_t> b) noexcept
+{
+    if (b.size() < 7 || b[0] != 0xff || (b[1] & 0xf0) != 0xf0)
+        return std::nullopt;
+    AdtsFrame f;
+    f.header = b[1] & 1 ? 7 : 9;
+    f.length = std::size_t(b[3] & 3) << 11 | std::size_t{b[4]} << 3 | b[5] >> 5;
+    f.object_type = (b[2] >> 6) + 1u;
+    f.rate_index = (b[2] >> 2) & 0x0f;
+    f.channels = (b[2] & 1u) << 2 | b[3] >> 6;
+    if (f.length <= f.header || f.length > b.size())
+        return std::nullopt;
+    return f;
+}
+
+template <nal::Codec V>
+void collect_video(const PesPacket& pes, Track& track)
+{
+    using VT = VideoTraits<V>;
+    static_assert(Fmp4Muxer<V, AudioCodec::None>::kTimescale == kTimescale);
+    if (track.samples.empty())
+        track.base = pes.dts;
+    Sample s;
+    s.decode = static_cast<std::uint64_t>(wrapped_delta(pes.dts, track.base));
+    s.composition = static_cast<std::int32_t>(wrapped_delta(pes.pts, pes.dts));
+    s.sync = pes.random_access;
+    s.first_piece = static_cast<std::uint32_t>(track.pieces.size());
+    for_each_nal({pes.payload.data(), pes.payload.size()}, [&](std::span<const std::uint8_t> nal) {
+        const unsigned type = VT::type(nal[0]);
+        // Parameter sets live in the sample entry; delimiters are TS-only.
+        if (VT::is_parameter_set(type) || VT::is_delimiter(type))
+            return;
+        track.pieces.push_back(nal);
+        s.size += 4 + static_cast<std::uint32_t>(nal.size());
+    });
+    s.pieces = static_cast<std::uint32_t>(track.pieces.size()) - s.first_piece;
+    if (s.pieces == 0)
+        return;
+    track.bytes += s.size;
+    track.samples.push_back(s);
+}
+
+void collect_aac(const PesPacket& pes, Track& track)
+{
+    std::span<const std::uint8_t> b(pes.payload.data(), pes.payload.size());
+    if (track.samples.empty())
+        track.base = pes.pts;
+    const std::int64_t start = wrapped_delta(pes.pts, track.base);
+    for (std::uint64_t k = 0; auto frame = parse_adts(b); ++k) {
+        const std::uint32_t rate = kAdtsSampleRates[frame->rate_index];
+        if (rate == 0)
+            break;
+        Sample s;
+        s.decode = static_cast<std::uint64_t>(start) + k * kAacFrameSamples * kTimescale / rate;
+        s.duration = kAacFrameSamples * kTimescale / rate;
+        s.sync = true;
+        s.first_piece = static_cast<std::uint32_t>(track.pieces.size());
+        s.pieces = 1;
+        track.pieces.push_back(b.subspan(frame->header, frame->length - frame->header));
+        s.size = static_cast<std::uint32_t>(frame->length - frame->header);
+        track.bytes += s.size;
+        track.samples.push_back(s);
+        b = b.subspan(frame->length);
+    }
+}
+
+/// Durations from decode-time differences. The last sample keeps the
+/// duration it was collected with or, failing that, repeats the one
+/// before it.
+void fill_durations(Track& track) noexcept
+{
+    auto& s = track.samples;
+    for (std::size_t i = 0; i + 1 < s.size(); ++i)
+        if (s[i + 1].decode > s[i].decode)
+            s[i].duration = static_cast<std::uint32_t>(s[i + 1].decode - s[i].decode);
+    if (!s.empty() && s.back().duration == 0)
+        s.back().duration = s.size() > 1 ? s[s.size() - 2].duration : kDefaultFrameTicks;
+}
+
+/// traf for one track; returns where its trun data offset goes.
+std::size_t write_traf(Writer& w, std::uint32_t track_id, const Track& track, std::uint64_t decode_base, bool video)
+{
+    const auto traf = w.open("traf");
+    const auto tfhd = w.open_full("tfhd", 0, 0x020000); // default-base-is-moof
+    w.u32(track_id);
+    w.close(tfhd);
+    const auto tfdt = w.open_full("tfdt", 1, 0);
+    w.u64(decode_base + track.samples.front().decode);
+    w.close(tfdt);
+    // data offset, duration, size, flags, and for video composition offsets
+    const auto trun = w.open_full("trun", 1, video ? 0x000f01 : 0x000701);
+    w.u32(static_cast<std::uint32_t>(track.samples.size()));
+    const std::size_t data_offset = w.size();
+    w.u32(0);
+    for (const auto& s : track.samples) {
+        w.u32(s.duration);
+        w.u32(s.size);
+        w.u32(s.sync ? kSyncSampleFlags : kNonSyncSampleFlags);
+        if (video)
+            w.u32(static_cast<std::uint32_t>(s.composition));
+    }
+    w.close(trun);
+    w.close(traf);
+    return data_offset;
+}
+
+void write_pieces(Writer& w, const Track& track, bool length_prefixed)
+{
+    for (const auto& piece : track.pieces) {
+        if (length_prefixed)
+            w.u32(static_cast<std::uint32_t>(piece.size()));
+        w.bytes(piece);
+    }
+}
+
+constexpr std::uint32_t kMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+void write_matrix(Writer& w)
+{
+    for (auto v : kMatrix)
+        w.u32(v);
+}
+
+void write_tkhd(Writer& w, std::uint32_t track_id, bool audio, std::uint32_t width, std::uint32_t height)
+{
+    const auto tkhd = w.open_full("tkhd", 0, 3); // enabled, in movie
+    w.u32(0);
+    w.u32(0);
+    w.u32(track_id);
+    w.u32(0);
+    w.u32(0); // duration: fragmented
+    w.zeros(8);
+    w.u16(0); // layer
+    w.u16(0); // alternate group
+    w.u16(audio ? 0x0100 : 0);
+    w.u16(0);
+    write_matrix(w);
+    w.u32(width << 16);
+    w.u32(height << 16);
+    w.close(tkhd);
+}
+
+void write_media_header(Writer& w, std::uint32_t timescale, const char* handler, const char* name)
+{
+    const auto mdhd = w.open_full("mdhd", 0, 0);
+    w.u32(0);
+    w.u32(0);
+    w.u32(timescale);
+    w.u32(0);
+    w.u16(0x55c4); // "und"
+    w.u16(0);
+    w.close(mdhd);
+    const auto hdlr = w.open_full("hdlr", 0, 0);
+    w.u32(0);
+    w.fourcc(handler);
+    w.zeros(12);
+    w.bytes({reinterpret_cast<const std::uint8_t*>(name), std::strlen(name) + 1});
+    w.close(hdlr);
+}
+
+void write_data_information(Writer& w)
+{
+    const auto dinf = w.open("dinf");
+    const auto dref = w.open_full("dref", 0, 0);
+    w.u32(1);
+    const auto url = w.open_full("url ", 0, 1); // media is in this file
+    w.close(url);
+    w.close(dref);
+    w.close(dinf);
+}
+
+/// Empty sample tables: every sample is in a fragment.
+void write_empty_tables(Writer& w)
+{
+    for (const char* t : {"stts", "stsc", "stco"}) {
+        const auto b = w.open_full(t, 0, 0);
+        w.u32(0);
+        w.close(b);
+    }
+    const auto stsz = w.open_full("stsz", 0, 0);
+    w.u32(0);
+    w.u32(0);
+    w.close(stsz);
+}
+
+void write_avcc(Writer& w, std::span<const std::uint8_t> sps, std::span<const std::uint8_t> pps,
+                const PictureFormat& format)
+{
+    const auto avcc = w.open("avcC");
+    w.u8(1);
+    w.u8(sps.size() > 1 ? sps[1] : 0); // profile
+    w.u8(sps.size() > 2 ? sps[2] : 0); // compatibility
+    w.u8(sps.size() > 3 ? sps[3] : 0); // level
+    w.u8(0xff);                        // 4-byte NAL lengths
+    w.u8(0xe1);
+    w.u16(static_cast<std::uint32_t>(sps.size()));
+    w.bytes(sps);
+    w.u8(1);
+    w.u16(static_cast<std::uint32_t>(pps.size()));
+    w.bytes(pps);
+    if (const unsigned profile = sps.size() > 1 ? sps[1] : 0; profile == 100 || profile == 110 || profile == 122 || profile == 144) {
+        w.u8(0xfc | format.chroma_format);
+        w.u8(0xf8 | (format.bit_depth_luma - 8));
+        w.u8(0xf8 | (format.bit_depth_chroma - 8));
+        w.u8(0);
+    }
+    w.close(avcc);
+}
+
+void write_hvcc(Writer& w, std::span<const std::span<const std::uint8_t>> param_sets, std::span<const std::uint8_t> sps,
+                const PictureFormat& format)
+{
+    const auto hvcc = w.open("hvcC");
+    w.u8(1);
+    // general_profile_space .. general_level_idc: the 12 bytes after the
+    // SPS header byte that carries sub-layer count and nesting.
+    std::array<std::uint8_t, 12> ptl{};
+    for (std::size_t i = 0; i < ptl.size() && 3 + i < sps.size(); ++i)
+        ptl[i] = sps[3 + i];
+    w.bytes(ptl);
+    w.u16(0xf000); // min_spatial_segmentation_idc
+    w.u8(0xfc);    // parallelismType
+    w.u8(0xfc | format.chroma_format);
+    w.u8(0xf8 | (format.bit_depth_luma - 8));
+    w.u8(0xf8 | (format.bit_depth_chroma - 8));
+    w.u16(0); // avgFrameRate
+    w.u8(format.sub_layers << 3 | (format.temporal_nesting ? 4u : 0u) | 3u);
+    w.u8(static_cast<std::uint32_t>(param_sets.size()));
+    for (const auto& nal : param_sets) {
+        w.u8(0x80 | VideoTraits<nal::Codec::Hevc>::type(nal[0]));
+        w.u16(1);
+        w.u16(static_cast<std::uint32_t>(nal.size()));
+        w.bytes(nal);
+    }
+    w.close(hvcc);
+}
+
+void write_esds(Writer& w, const AdtsFrame& adts)
+{
+    const std::uint8_t config[2] = {
+        static_cast<std::uint8_t>(adts.object_type << 3 | adts.rate_index >> 1),
+        static_cast<std::uint8_t>((adts.rate_index & 1) << 7 | adts.channels << 3)};
+    const auto esds = w.open_full("esds", 0, 0);
+    w.u8(0x03); // ES_Descriptor
+    w.u8(23);
+    w.u16(2); // ES_ID
+    w.u8(0);
+    w.u8(0x04); // DecoderConfigDescriptor
+    w.u8(15);
+    w.u8(0x40); // MPEG-4 audio
+    w.u8(0x15); // audio stream
+    w.u24(0);
+    w.u32(0);
+    w.u32(0);
+    w.u8(0x05); // DecoderSpecificInfo
+    w.u8(2);
+    w.bytes(config);
+    w.u8(0x06); // SLConfigDescriptor
+    w.u8(1);
+    w.u8(2);
+    w.close(esds);
+}
+
+} // namespace
+
+template <nal::Codec V, AudioCodec A>
+void TsMuxer<V, A>::mux(std::span<const PesPacket> packets, std::int64_t offset, MuxState& state,
+                        std::pmr::vector<std::byte>& out)
+{
+    using VT = VideoTraits<V>;
+    static const PsiPackets psi = [] {
+        if constexpr (AudioTraits<A>::kPresent)
+            return make_psi(kPmtPid, kVideoPid, VT::kStreamType, kAudioPid, AudioTraits<A>::kStreamType);
+        else
+            return make_psi(kPmtPid, kVideoPid, VT::kStreamType, 0, 0);
+    }();
+    static constexpr auto kDelimiter = delimiter_nal<V>();
+
+    std::size_t estimate = 2;
+    for (const auto& pes : packets)
+        estimate += (pes.payload.size() + 32) / kTsPayload + 1;
+    out.reserve(out.size() + estimate * kTsPacketSize);
+
+    emit_psi(out, psi.pat, state.continuity[0]);
+    emit_psi(out, psi.pmt, state.continuity[1]);
+    for (const auto& pes : packets) {
+        std::uint8_t header[19];
+        const std::span<const std::uint8_t> es(pes.payload.data(), pes.payload.size());
+        const std::int64_t pts = pes.pts < 0 ? -1 : wrap(pes.pts + offset);
+        const std::int64_t dts = pes.dts < 0 ? pts : wrap(pes.dts + offset);
+        if (pes.stream_type == VT::kStreamType) {
+            const std::uint8_t* nal = nal::find_start_code(es.data(), es.data() + es.size());
+            const bool delimited = nal < es.data() + es.size() && VT::is_delimiter(VT::type(*nal));
+            const std::span<const std::uint8_t> delimiter = delimited ? std::span<const std::uint8_t>{} : kDelimiter;
+            const std::size_t h = pes_header(header, 0xe0, pts, dts, 0, false);
+            const std::int64_t pcr = pes.random_access && dts >= 0 ? wrap(dts - kPcrLead) : -1;
+            packetize(out, kVideoPid, state.continuity[2], {{std::span(header, h), delimiter, es}}, pes.random_access, pcr);
+        } else if constexpr (AudioTraits<A>::kPresent) {
+            const std::size_t h = pes_header(header, AudioTraits<A>::kStreamId, pts, pts, es.size(), true);
+            packetize(out, kAudioPid, state.continuity[3], {{std::span(header, h), {}, es}}, false, -1);
+        }
+    }
+}
+
+template <nal::Codec V, AudioCodec A>
+void Fmp4Muxer<V, A>::init_segment(std::span<const PesPacket> packets, std::pmr::vector<std::byte>& out)
+{
+    using VT = VideoTraits<V>;
+    const PesPacket* key = nullptr;
+    const PesPacket* audio = nullptr;
+    for (const auto& pes : packets) {
+        if (!key && pes.stream_type == VT::kStreamType && pes.random_access)
+            key = &pes;
+        else if (AudioTraits<A>::kPresent && !audio && pes.stream_type != VT::kStreamType)
+            audio = &pes;
+    }
+    if (!key)
+        throw std::runtime_error("fmp4 mux: no random access point");
+    std::optional<AdtsFrame> adts;
+    if constexpr (AudioTraits<A>::kPresent) {
+        if (!audio || !(adts = parse_adts({audio->payload.data(), audio->payload.size()})))
+            throw std::runtime_error("fmp4 mux: no ADTS header");
+    }
+
+    std::array<std::span<const std::uint8_t>, 3> param_sets; // VPS, SPS, PPS (H.264: SPS, PPS)
+    std::size_t found = 0;
+    std::span<const std::uint8_t> sps;
+    std::span<const std::uint8_t> pps;
+    for_each_nal({key->payload.data(), key->payload.size()}, [&](std::span<const std::uint8_t> nal) {
+        const unsigned type = VT::type(nal[0]);
+        if (!VT::is_parameter_set(type) || found == param_sets.size())
+            return;
+        param_sets[found++] = nal;
+        if (type == 7 || (V == nal::Codec::Hevc && type == 33))
+            sps = nal;
+        else if (type == 8 || (V == nal::Codec::Hevc && type == 34))
+            pps = nal;
+    });
+    if (sps.empty() || pps.empty())
+        throw std::runtime_error("fmp4 mux: no in-band parameter sets");
+    const PictureFormat format = V == nal::Codec::H264 ? parse_h264_sps(sps) : parse_hevc_sps(sps);
+
+    Writer w(out);
+    const auto ftyp = w.open("ftyp");
+    w.fourcc("iso6");
+    w.u32(0);
+    for (const char* brand : {"iso6", "cmfc", "isom", VT::kSampleEntry})
+        w.fourcc(brand);
+    w.close(ftyp);
+
+    const auto moov = w.open("moov");
+    const auto mvhd = w.open_full("mvhd", 0, 0);
+    w.u32(0);
+    w.u32(0);
+    w.u32(kTimescale);
+    w.u32(0);
+    w.u32(0x00010000); // rate
+    w.u16(0x0100);     // volume
+    w.zeros(10);
+    write_matrix(w);
+    w.zeros(24);
+    w.u32(AudioTraits<A>::kPresent ? 3 : 2); // next track id
+    w.close(mvhd);
+
+    {
+        const auto trak = w.open("trak");
+        write_tkhd(w, 1, false, format.width, format.height);
+        const auto mdia = w.open("mdia");
+        write_media_header(w, kTimescale, "vide", "VideoHandler");
+        const auto minf = w.open("minf");
+        const auto vmhd = w.open_full("vmhd", 0, 1);
+        w.zeros(8);
+        w.close(vmhd);
+        write_data_information(w);
+        const auto stbl = w.open("stbl");
+        const auto stsd = w.open_full("stsd", 0, 0);
+        w.u32(1);
+        const auto entry = w.open(VT::kSampleEntry);
+        w.zeros(6);
+        w.u16(1); // data reference index
+        w.zeros(16);
+        w.u16(format.width);
+        w.u16(format.height);
+        w.u32(0x00480000); // 72 dpi
+        w.u32(0x00480000);
+        w.u32(0);
+        w.u16(1); // frame count
+        w.zeros(32);
+        w.u16(0x0018);
+        w.u16(0xffff);
+        if constexpr (V == nal::Codec::H264)
+            write_avcc(w, sps, pps, format);
+        else
+            write_hvcc(w, {param_sets.data(), found}, sps, format);
+        w.close(entry);
+        w.close(stsd);
+        write_empty_tables(w);
+        w.close(stbl);
+        w.close(minf);
+        w.close(mdia);
+        w.close(trak);
+    }
+    if constexpr (AudioTraits<A>::kPresent) {
+        const auto trak = w.open("trak");
+        write_tkhd(w, 2, true, 0, 0);
+        const auto mdia = w.open("mdia");
+        write_media_header(w, kTimescale, "soun", "SoundHandler");
+        const auto minf = w.open("minf");
+        const auto smhd = w.open_full("smhd", 0, 0);
+        w.u32(0);
+        w.close(smhd);
+        write_data_information(w);
+        const auto stbl = w.open("stbl");
+        const auto stsd = w.open_full("stsd", 0, 0);
+        w.u32(1);
+        const auto entry = w.open("mp4a");
+        w.zeros(6);
+        w.u16(1);
+        w.zeros(8);
+        w.u16(adts->channels ? adts->channels : 2);
+        w.u16(16);
+        w.u32(0);
+        w.u32(kAdtsSampleRates[adts->rate_index] << 16);
+        write_esds(w, *adts);
+        w.close(entry);
+        w.close(stsd);
+        write_empty_tables(w);
+        w.close(stbl);
+        w.close(minf);
+        w.close(mdia);
+        w.close(trak);
+    }
+    const auto mvex = w.open("mvex");
+    for (std::uint32_t id = 1; id <= (AudioTraits<A>::kPresent ? 2u : 1u); ++id) {
+        const auto trex = w.open_full("trex", 0, 0);
+        w.u32(id);
+        w.u32(1);
+        w.u32(0);
+        w.u32(0);
+        w.u32(id == 1 ? kNonSyncSampleFlags : kSyncSampleFlags);
+        w.close(trex);
+    }
+    w.close(mvex);
+    w.close(moov);
+}
+
+template <nal::Codec V, AudioCodec A>
+void Fmp4Muxer<V, A>::fragment(std::span<const PesPacket> packets, std::int64_t offset, MuxState& state,
+                               std::pmr::vector<std::byte>& out)
+{
+    using VT = VideoTraits<V>;
+    auto* mr = out.get_allocator().resource();
+    Track video(mr);
+    Track audio(mr);
+    video.samples.reserve(packets.size());
+    for (const auto& pes : packets) {
+        if (pes.stream_type == VT::kStreamType) {
+            if (pes.dts >= 0)
+                collect_video<V>(pes, video);
+        } else if constexpr (AudioTraits<A>::kPresent) {
+            if (pes.pts >= 0)
+                collect_aac(pes, audio);
+        }
+    }
+    if (video.samples.empty())
+        throw std::runtime_error("fmp4 mux: no video samples");
+    fill_durations(video);
+    fill_durations(audio);
+
+    // Decode times are 64-bit in fMP4: unwrap every track against the
+    // first video sample and add the offset without folding it back.
+    const auto base = static_cast<std::uint64_t>(video.base + offset);
+    for (auto& s : audio.samples)
+        s.decode += static_cast<std::uint64_t>(wrapped_delta(audio.base, video.base));
+
+    out.reserve(out.size() + 1024 + 16 * (video.samples.size() + audio.samples.size()) + video.bytes + audio.bytes);
+    Writer w(out);
+    const std::size_t moof_at = w.size();
+    const auto moof = w.open("moof");
+    const auto mfhd = w.open_full("mfhd", 0, 0);
+    w.u32(state.fragment_sequence++);
+    w.close(mfhd);
+    const std::size_t video_offset = write_traf(w, 1, video, base, true);
+    std::size_t audio_offset = 0;
+    if (!audio.samples.empty())
+        audio_offset = write_traf(w, 2, audio, base, false);
+    w.close(moof);
+
+    const std::size_t moof_size = w.size() - moof_at;
+    w.patch32(video_offset, static_cast<std::uint32_t>(moof_size + 8));
+    if (audio_offset)
+        w.patch32(audio_offset, static_cast<std::uint32_t>(moof_size + 8 + video.bytes));
+    const auto mdat = w.open("mdat");
+    write_pieces(w, video, true);
+    write_pieces(w, audio, false);
+    w.close(mdat);
+}
+
+template class TsMuxer<nal::Codec::H264, AudioCodec::Aac>;
+template class TsMuxer<nal::Codec::H264, AudioCodec::None>;
+template class TsMuxer<nal::Codec::Hevc, AudioCodec::Aac>;
+template class TsMuxer<nal::Codec::Hevc, AudioCodec::None>;
+template class Fmp4Muxer<nal::Codec::H264, AudioCodec::Aac>;
+template class Fmp4Muxer<nal::Codec::H264, AudioCodec::None>;
+template class Fmp4Muxer<nal::Codec::Hevc, AudioCodec::Aac>;
+template class Fmp4Muxer<nal::Codec::Hevc, AudioCodec::None>;
+
+namespace {
+
+/// Calls f.template operator()<M<V, A>>() for the program's codec pair.
+template <template <nal::Codec, AudioCodec> class M, class F>
+void with_muxer(const ts::ProgramMap& program, F&& f)
+{
+    auto with_audio = [&]<nal::Codec V>() {
+        if (program.audio_type == AudioTraits<AudioCodec::Aac>::kStreamType)
+            f.template operator()<M<V, AudioCodec::Aac>>();
+        else if (program.audio_type == 0)
+            f.template operator()<M<V, AudioCodec::None>>();
+        else
+            throw std::runtime_error("mux: unsupported audio stream type");
+    };
+    if (program.video_type == VideoTraits<nal::Codec::H264>::kStreamType)
+        with_audio.template operator()<nal::Codec::H264>();
+    else if (program.video_type == VideoTraits<nal::Codec::Hevc>::kStreamType)
+        with_audio.template operator()<nal::Codec::Hevc>();
+    else
+        throw std::runtime_error("mux: unsupported video stream type");
+}
+
+} // namespace
+
+void remux_ts(std::span<const std::byte> segment, Container to, std::int64_t offset, MuxState& state,
+              std::pmr::memory_resource* mr, std::pmr::vector<std::byte>& out)
+{
+    TsDemuxer demux(mr);
+    demux.feed(segment);
+    demux.flush();
+    std::span<const PesPacket> packets = demux.packets();
+    if (to == Container::MpegTs)
+        with_muxer<TsMuxer>(demux.program(), [&]<class M>() { M::mux(packets, offset, state, out); });
+    else if (to == Container::Fmp4)
+        with_muxer<Fmp4Muxer>(demux.program(), [&]<class M>() { M::fragment(packets, offset, state, out); });
+    else
+        throw std::invalid_argument("mux: unknown output container");
+}
+
+void fmp4_init_from_ts(std::span<const std::byte> segment, std::pmr::memory_resource* mr,
+                       std::pmr::vector<std::byte>& out)
+{
+    TsDemuxer demux(mr);
+    demux.feed(segment);
+    demux.flush();
+    std::span<const PesPacket> packets = demux.packets();
+    with_muxer<Fmp4Muxer>(demux.program(), [&]<class M>() { M::init_segment(packets, out); });
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,203 @@
+#include "seinfeld_tv/nal.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STV_NAL_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define STV_NAL_NEON 1
+#endif
+
+namespace seinfeld_tv::nal {
+
+namespace {
+
+// Every scanner returns the first p with p[0] == 0, p[1] == 0 and
+// p[2] == Third in [p, end - 2), or `end`. Third is 1 for start codes and
+// 3 for emulation-prevention bytes.
+using ScanFn = const std::uint8_t* (*)(const std::uint8_t*, const std::uint8_t*) noexcept;
+
+template <std::uint8_t Third>
+const std::uint8_t* scan_scalar(const std::uint8_t* p, const std::uint8_t* end) noexcept
+{
+    for (; end - p >= 3; ++p) {
+        // No match can start at p, p + 1 or p + 2 unless p[2] is 0 or Third.
+        if (p[2] > Third) {
+            p += 2;
+            continue;
+        }
+        if (p[2] == Third && p[1] == 0 && p[0] == 0)
+            return p;
+    }
+    return end;
+}
+
+#if STV_NAL_X86
+
+// Compares byte i + 2 against Third first: Third bytes are rare in coded
+// slice data, so most blocks are rejected after one load and compare.
+template <std::uint8_t Third>
+const std::uint8_t* scan_sse2(const std::uint8_t* p, const std::uint8_t* end) noexcept
+{
+    const __m128i zero = _mm_setzero_si128(), third = _mm_set1_epi8(Third);
+    for (; end - p >= 18; p += 16) {
+        const auto* q = reinterpret_cast<const __m128i*>(p);
+        unsigned m = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2)), third)));
+        if (m == 0)
+            continue;
+        const __m128i b0 = _mm_cmpeq_epi8(_mm_loadu_si128(q), zero);
+        const __m128i b1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1)), zero);
+        m &= static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(b0, b1)));
+        if (m != 0)
+            return p + __builtin_ctz(m);
+    }
+    return scan_scalar<Third>(p, end);
+}
+
+template <std::uint8_t Third>
+__attribute__((target("avx2"))) const std::uint8_t* scan_avx2(const std::uint8_t* p, const std::uint8_t* end) noexcept
+{
+    const __m256i zero = _mm256_setzero_si256(), third = _mm256_set1_epi8(Third);
+    for (; end - p >= 34; p += 32) {
+        auto m = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2)), third)));
+        if (m == 0)
+            continue;
+        const __m256i b0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), zero);
+        const __m256i b1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1)), zero);
+        m &= static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(b0, b1)));
+        if (m != 0)
+            return p + __builtin_ctz(m);
+    }
+    return scan_sse2<Third>(p, end);
+}
+
+template <std::uint8_t Third>
+ScanFn select_scan() noexcept
+{
+    if (__builtin_cpu_supports("avx2"))
+        return scan_avx2<Third>;
+    return scan_sse2<Third>;
+}
+
+#elif STV_NAL_NEON
+
+/// One 4-bit lane per byte of a compare result; NEON has no movemask.
+inline std::uint64_t nibble_mask(uint8x16_t eq) noexcept
+{
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+template <std::uint8_t Third>
+const std::uint8_t* scan_neon(const std::uint8_t* p, const std::uint8_t* end) noexcept
+{
+    const uint8x16_t third = vdupq_n_u8(Third);
+    for (; end - p >= 18; p += 16) {
+        const uint8x16_t b2 = vceqq_u8(vld1q_u8(p + 2), third);
+        if (vmaxvq_u8(b2) == 0)
+            continue;
+        const uint8x16_t b01 = vandq_u8(vceqzq_u8(vld1q_u8(p)), vceqzq_u8(vld1q_u8(p + 1)));
+        const std::uint64_t m = nibble_mask(vandq_u8(b01, b2));
+        if (m != 0)
+            return p + __builtin_ctzll(m) / 4;
+    }
+    return scan_scalar<Third>(p, end);
+}
+
+template <std::uint8_t Third>
+ScanFn select_scan() noexcept
+{
+    return scan_neon<Third>;
+}
+
+#else
+
+template <std::uint8_t Third>
+ScanFn select_scan() noexcept
+{
+    return scan_scalar<Third>;
+}
+
+#endif
+
+template <std::uint8_t Third>
+const std::uint8_t* scan(const std::uint8_t* p, const std::uint8_t* end) noexcept
+{
+    static const ScanFn fn = select_scan<Third>();
+    return fn(p, end);
+}
+
+} // namespace
+
+const std::uint8_t* find_start_code(const std::uint8_t* p, const std::uint8_t* end) noexcept
+{
+    const std::uint8_t* at = scan<1>(p, end);
+    return at == end ? end : at + 3;
+}
+
+std::size_t unescape_rbsp(std::span<const std::uint8_t> nal, std::span<std::uint8_t> out) noexcept
+{
+    const std::uint8_t* p = nal.data();
+    const std::uint8_t* end = p + nal.size();
+    std::size_t size = 0;
+    while (p < end && size < out.size()) {
+        const std::uint8_t* at = scan<3>(p, end);
+        // Keep the two zeros, drop the 03.
+        const std::uint8_t* run_end = at == end ? end : at + 2;
+        const auto n = std::min(static_cast<std::size_t>(run_end - p), out.size() - size);
+        std::memcpy(out.data() + size, p, n);
+        size += n;
+        p = at == end ? end : at + 3;
+    }
+    return size;
+}
+
+AccessUnitInfo inspect_access_unit(Codec codec, std::span<const std::uint8_t> es) noexcept
+{
+    AccessUnitInfo info;
+    const std::uint8_t* end = es.data() + es.size();
+    const std::uint8_t* nal = find_start_code(es.data(), end);
+    std::uint64_t fp = kFnvOffset;
+
+    while (nal < end) {
+        const std::uint8_t* next = find_start_code(nal, end);
+        // Trim the start code (and any zero_byte of a 4-byte one) off this NAL.
+        const std::uint8_t* nal_end = next == end ? end : next - 3;
+        while (nal_end > nal && nal_end[-1] == 0)
+            --nal_end;
+
+        bool slice = false;
+        bool param_set = false;
+        if (codec == Codec::H264) {
+            const unsigned type = nal[0] & 0x1f;
+            param_set = type == 7 || type == 8;
+            slice = type >= 1 && type <= 5;
+            if (type == 5)
+                info.random_access = info.closed = true;
+        } else {
+            const unsigned type = (nal[0] >> 1) & 0x3f;
+            param_set = type >= 32 && type <= 34;
+            slice = type <= 31;
+            if (type >= 16 && type <= 23)
+                info.random_access = true;
+            if (type == 19 || type == 20)
+                info.closed = true;
+        }
+        if (param_set) {
+            info.has_param_sets = true;
+            fp = fnv1a({nal, static_cast<std::size_t>(nal_end - nal)}, fp);
+        }
+        if (slice)
+            break;
+        nal = next;
+    }
+    if (info.has_param_sets)
+        info.param_fingerprint = fp;
+    return info;
+}
+
+} // namespace seinfeld_tv::nal
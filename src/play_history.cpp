@@ -0,0 +1,543 @@
+#include "seinfeld_tv/play_history.hpp"
+
+#include "seinfeld_tv/varint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STV_HISTORY_X86 1
+#endif
+
+#include <fcntl.h>
+
+namespace seinfeld_tv {
+
+using namespace history_format;
+
+struct PlayHistory::Ring {
+    alignas(64) std::atomic<std::uint64_t> head{0}; ///< advanced by the recording thread
+    std::atomic<std::uint64_t> dropped{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0}; ///< advanced by the flusher
+    std::thread::id owner;
+    alignas(64) std::array<PlayEvent, kRingEvents> events{};
+};
+
+namespace {
+
+constexpr std::uint64_t kRingMask = PlayHistory::kRingEvents - 1;
+static_assert((PlayHistory::kRingEvents & kRingMask) == 0, "ring size must be a power of two");
+
+/// Tells PlayHistory instances apart in the per-thread ring cache, even
+/// one reusing a destroyed one's address.
+std::atomic<std::uint64_t> g_next_id{1};
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("history: ") + what);
+}
+
+std::uint64_t zigzag(std::int64_t v) noexcept
+{
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+std::int64_t unzigzag(std::uint64_t v) noexcept
+{
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+std::uint32_t fnv1a(const std::uint8_t* p, std::size_t n) noexcept
+{
+    std::uint32_t h = 0x811c9dc5u;
+    for (std::size_t i = 0; i < n; ++i)
+        h = (h ^ p[i]) * 0x01000193u;
+    return h;
+}
+
+template <typename Get>
+void put_runs(std::vector<std::uint8_t>& out, std::size_t n, Get get)
+{
+    for (std::size_t i = 0; i < n;) {
+        const std::uint32_t v = get(i);
+        std::size_t j = i + 1;
+        while (j < n && get(j) == v)
+            ++j;
+        varint::put(out, v);
+        varint::put(out, j - i);
+        i = j;
+    }
+}
+
+/// Differences wrap in 64 bits, so any pair of values round-trips.
+template <typename Get>
+void put_deltas(std::vector<std::uint8_t>& out, std::size_t n, std::int64_t first, Get get)
+{
+    auto prev = static_cast<std::uint64_t>(first);
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto v = static_cast<std::uint64_t>(get(i));
+        varint::put(out, zigzag(static_cast<std::int64_t>(v - prev)));
+        prev = v;
+    }
+}
+
+/// Indexes in [begin, end) of `values` equal to `value`, into `out`;
+/// returns how many. `out` needs room for end - begin.
+using SelectFn = std::size_t (*)(const std::uint32_t* values, std::size_t begin, std::size_t end,
+                                 std::uint32_t value, std::uint32_t* out) noexcept;
+
+std::size_t select_scalar(const std::uint32_t* values, std::size_t begin, std::size_t end, std::uint32_t value,
+                          std::uint32_t* out) noexcept
+{
+    // Branch-free: always store, advance only on a match.
+    std::size_t k = 0;
+    for (std::size_t i = begin; i < end; ++i) {
+        out[k] = static_cast<std::uint32_t>(i);
+        k += values[i] == value;
+    }
+    return k;
+}
+
+#if STV_HISTORY_X86
+std::size_t select_sse2(const std::uint32_t* values, std::size_t begin, std::size_t end, std::uint32_t value,
+                        std::uint32_t* out) noexcept
+{
+    const __m128i want = _mm_set1_epi32(static_cast<int>(value));
+    std::size_t k = 0, i = begin;
+    for (; i + 4 <= end; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        for (auto mask = static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, want)))); mask;
+             mask &= mask - 1)
+            out[k++] = static_cast<std::uint32_t>(i + static_cast<unsigned>(__builtin_ctz(mask)));
+    }
+    return k + select_scalar(values, i, end, value, out + k);
+}
+
+/// Eight rows per compare; a block mostly of other episodes costs one
+/// compare and a zero mask test per eight.
+__attribute__((target("avx2"))) std::size_t select_avx2(const std::uint32_t* values, std::size_t begin,
+                                                        std::size_t end, std::uint32_t value,
+                                                        std::uint32_t* out) noexcept
+{
+    const __m256i want = _mm256_set1_epi32(static_cast<int>(value));
+    std::size_t k = 0, i = begin;
+    for (; i + 8 <= end; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        for (auto mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, want))));
+             mask; mask &= mask - 1)
+            out[k++] = static_cast<std::uint32_t>(i + static_cast<unsigned>(__builtin_ctz(mask)));
+    }
+    return k + select_scalar(values, i, end, value, out + k);
+}
+#endif
+
+SelectFn select_rows() noexcept
+{
+#if STV_HISTORY_X86
+    static const SelectFn fn = __builtin_cpu_supports("avx2") ? select_avx2 : select_sse2;
+    return fn;
+#else
+    return select_scalar;
+#endif
+}
+
+/// Leading airing rows of a block: rows are sorted by kind first.
+std::size_t airing_rows(const HistoryBlock& block)
+{
+    std::size_t n = 0;
+    for (const auto& [kind, run] : history_runs(block, kKind))
+        if (kind == static_cast<std::uint32_t>(PlayKind::Airing))
+            n += run;
+    return n;
+}
+
+} // namespace
+
+void encode_history_block(std::span<PlayEvent> rows, std::vector<std::uint8_t>& out)
+{
+    if (rows.empty())
+        return;
+    if (rows.size() > UINT32_MAX)
+        throw std::invalid_argument("history: block too large");
+    std::sort(rows.begin(), rows.end(), [](const PlayEvent& a, const PlayEvent& b) {
+        return std::tie(a.kind, a.channel, a.episode, a.channel_pts, a.viewer) <
+               std::tie(b.kind, b.channel, b.episode, b.channel_pts, b.viewer);
+    });
+    const auto n = rows.size();
+
+    std::vector<std::uint32_t> dictionary;
+    for (const auto& r : rows)
+        if (dictionary.empty() || dictionary.back() != r.episode)
+            dictionary.push_back(r.episode);
+    std::sort(dictionary.begin(), dictionary.end());
+    dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+    const auto code = [&](std::uint32_t key) {
+        return static_cast<std::uint32_t>(std::lower_bound(dictionary.begin(), dictionary.end(), key) -
+                                          dictionary.begin());
+    };
+
+    const auto [lo, hi] = std::minmax_element(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        return a.channel_pts < b.channel_pts;
+    });
+    std::array<std::vector<std::uint8_t>, kColumns> columns;
+    put_runs(columns[kKind], n, [&](std::size_t i) { return static_cast<std::uint32_t>(rows[i].kind); });
+    put_runs(columns[kChannel], n, [&](std::size_t i) { return rows[i].channel; });
+    // Runs of one episode are contiguous, so only a run's first row
+    // searches the dictionary.
+    std::uint32_t last_key = ~rows[0].episode, last_code = 0;
+    put_runs(columns[kEpisode], n, [&](std::size_t i) {
+        if (rows[i].episode != last_key) {
+            last_key = rows[i].episode;
+            last_code = code(last_key);
+        }
+        return last_code;
+    });
+    put_runs(columns[kSeconds], n, [&](std::size_t i) { return rows[i].seconds; });
+    put_deltas(columns[kPts], n, lo->channel_pts, [&](std::size_t i) { return rows[i].channel_pts; });
+    put_deltas(columns[kViewer], n, 0, [&](std::size_t i) { return static_cast<std::int64_t>(rows[i].viewer); });
+    put_deltas(columns[kOffset], n, 0, [&](std::size_t i) { return std::int64_t{rows[i].offset_s}; });
+
+    BlockHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.rows = static_cast<std::uint32_t>(n);
+    header.dictionary_size = static_cast<std::uint32_t>(dictionary.size());
+    header.min_pts = lo->channel_pts;
+    header.max_pts = hi->channel_pts;
+    std::size_t payload = dictionary.size() * sizeof(std::uint32_t);
+    for (std::uint32_t c = 0; c < kColumns; ++c) {
+        header.column_bytes[c] = static_cast<std::uint32_t>(columns[c].size());
+        payload += columns[c].size();
+    }
+    header.payload_bytes = static_cast<std::uint32_t>(payload);
+
+    const auto start = out.size();
+    out.resize(start + sizeof header);
+    const auto* dict = reinterpret_cast<const std::uint8_t*>(dictionary.data());
+    out.insert(out.end(), dict, dict + dictionary.size() * sizeof(std::uint32_t));
+    for (const auto& c : columns)
+        out.insert(out.end(), c.begin(), c.end());
+    header.checksum = fnv1a(out.data() + start + sizeof header, payload);
+    std::memcpy(out.data() + start, &header, sizeof header);
+    out.resize(start + next_block(0, header.payload_bytes), 0);
+}
+
+PlayHistory::PlayHistory(const std::filesystem::path& path, PlayHistoryOptions options)
+    : options_(options), fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)),
+      id_(g_next_id.fetch_add(1, std::memory_order_relaxed))
+{
+    if (!fd_)
+        throw_errno("open");
+    if (options_.block_rows == 0 || options_.block_rows > UINT32_MAX)
+        throw std::invalid_argument("history: bad block_rows");
+    flusher_ = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+PlayHistory::~PlayHistory()
+{
+    flusher_.request_stop();
+    flusher_.join();
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Counted in failed_; nothing more to do at destruction.
+    }
+}
+
+PlayHistory::Ring& PlayHistory::ring()
+{
+    // One-entry cache: a thread records into the same log almost always.
+    thread_local std::uint64_t t_owner = 0;
+    thread_local Ring* t_ring = nullptr;
+    if (t_owner == id_)
+        return *t_ring;
+
+    const auto self = std::this_thread::get_id();
+    std::lock_guard lock(rings_mutex_);
+    auto it = std::find_if(rings_.begin(), rings_.end(), [&](const auto& r) { return r->owner == self; });
+    if (it == rings_.end()) {
+        auto r = std::make_unique<Ring>();
+        r->owner = self;
+        it = rings_.insert(rings_.end(), std::move(r));
+    }
+    t_owner = id_;
+    t_ring = it->get();
+    return *t_ring;
+}
+
+void PlayHistory::record(const PlayEvent& event) noexcept
+{
+    Ring* r = nullptr;
+    try {
+        r = &ring();
+    } catch (...) {
+        return;
+    }
+    const auto head = r->head.load(std::memory_order_relaxed);
+    if (head - r->tail.load(std::memory_order_acquire) >= kRingEvents) {
+        r->dropped.store(r->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    r->events[head & kRingMask] = event;
+    r->head.store(head + 1, std::memory_order_release);
+}
+
+void PlayHistory::flush()
+{
+    std::lock_guard lock(flush_mutex_);
+    drain();
+    while (!pending_.empty())
+        write_block();
+}
+
+PlayHistory::Stats PlayHistory::stats() const
+{
+    Stats s;
+    {
+        std::lock_guard lock(rings_mutex_);
+        for (const auto& r : rings_) {
+            s.events += r->head.load(std::memory_order_relaxed);
+            s.dropped += r->dropped.load(std::memory_order_relaxed);
+        }
+    }
+    s.blocks = blocks_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.failed = failed_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void PlayHistory::run(std::stop_token stop)
+{
+    while (!stop.stop_requested()) {
+        {
+            std::unique_lock lock(wake_mutex_);
+            wake_.wait_for(lock, stop, options_.drain_every, [] { return false; });
+        }
+        if (stop.stop_requested())
+            break;
+        std::lock_guard lock(flush_mutex_);
+        drain();
+        while (pending_.size() >= options_.block_rows)
+            write_block();
+        if (!pending_.empty() && std::chrono::steady_clock::now() - block_opened_ >= options_.max_block_age)
+            write_block();
+    }
+}
+
+void PlayHistory::drain()
+{
+    std::lock_guard lock(rings_mutex_);
+    for (auto& r : rings_) {
+        const auto tail = r->tail.load(std::memory_order_relaxed);
+        const auto head = r->head.load(std::memory_order_acquire);
+        if (head == tail)
+            continue;
+        if (pending_.empty())
+            block_opened_ = std::chrono::steady_clock::now();
+        for (auto i = tail; i != head; ++i)
+            pending_.push_back(r->events[i & kRingMask]);
+        r->tail.store(head, std::memory_order_release);
+    }
+}
+
+void PlayHistory::write_block()
+{
+    const auto n = std::min(pending_.size(), options_.block_rows);
+    if (n == 0)
+        return;
+    encoded_.clear();
+    encode_history_block(std::span(pending_).first(n), encoded_);
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(n));
+    if (!pending_.empty())
+        block_opened_ = std::chrono::steady_clock::now();
+    try {
+        write_all(fd_.get(), encoded_.data(), encoded_.size());
+        blocks_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(encoded_.size(), std::memory_order_relaxed);
+    } catch (const std::exception&) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+HistoryLog::HistoryLog(const std::filesystem::path& path) : file_(path)
+{
+    const auto* base = reinterpret_cast<const std::uint8_t*>(file_.data());
+    const std::uint64_t size = file_.size();
+    for (std::uint64_t at = 0; at < size;) {
+        if (size - at < sizeof(BlockHeader)) {
+            truncated_ = true;
+            break;
+        }
+        const auto* header = reinterpret_cast<const BlockHeader*>(base + at);
+        if (std::memcmp(header->magic, kMagic, sizeof kMagic) != 0)
+            corrupt("bad block magic");
+        if (header->version != kVersion)
+            corrupt("unsupported version");
+        if (header->payload_bytes > size - at - sizeof(BlockHeader)) {
+            truncated_ = true;
+            break;
+        }
+        const auto* payload = base + at + sizeof(BlockHeader);
+        if (fnv1a(payload, header->payload_bytes) != header->checksum)
+            corrupt("checksum mismatch");
+        std::uint64_t used = std::uint64_t{header->dictionary_size} * sizeof(std::uint32_t);
+        for (std::uint32_t c = 0; c < kColumns; ++c)
+            used += header->column_bytes[c];
+        if (used != header->payload_bytes)
+            corrupt("column sizes do not add up");
+
+        HistoryBlock b;
+        b.header = header;
+        b.dictionary = {reinterpret_cast<const std::uint32_t*>(payload), header->dictionary_size};
+        const auto* p = payload + b.dictionary.size_bytes();
+        for (std::uint32_t c = 0; c < kColumns; ++c) {
+            b.columns[c] = {p, header->column_bytes[c]};
+            p += header->column_bytes[c];
+        }
+        blocks_.push_back(b);
+        rows_ += header->rows;
+        at = next_block(at, header->payload_bytes);
+    }
+}
+
+std::vector<std::pair<std::uint32_t, std::uint32_t>> history_runs(const HistoryBlock& block, Column column)
+{
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> out;
+    const auto& bytes = block.columns[column];
+    const auto* p = bytes.data();
+    const auto* end = p + bytes.size();
+    std::uint64_t total = 0;
+    while (p < end) {
+        std::uint64_t value = 0, run = 0;
+        if (!varint::get(p, end, value) || !varint::get(p, end, run) || value > UINT32_MAX || run == 0 ||
+            run > block.rows() - total)
+            corrupt("bad run");
+        total += run;
+        out.emplace_back(static_cast<std::uint32_t>(value), static_cast<std::uint32_t>(run));
+    }
+    if (total != block.rows())
+        corrupt("runs do not cover the block");
+    return out;
+}
+
+void expand_history_column(const HistoryBlock& block, Column column, std::vector<std::uint32_t>& out)
+{
+    out.clear();
+    out.reserve(block.rows());
+    for (const auto& [value, run] : history_runs(block, column))
+        out.insert(out.end(), run, value);
+}
+
+void undelta_history_column(const HistoryBlock& block, Column column, std::vector<std::int64_t>& out)
+{
+    const auto& bytes = block.columns[column];
+    const auto* p = bytes.data();
+    const auto* end = p + bytes.size();
+    out.resize(block.rows());
+    auto prev = static_cast<std::uint64_t>(column == kPts ? block.header->min_pts : 0);
+    for (auto& v : out) {
+        std::uint64_t delta = 0;
+        if (!varint::get(p, end, delta))
+            corrupt("bad delta");
+        prev += static_cast<std::uint64_t>(unzigzag(delta));
+        v = static_cast<std::int64_t>(prev);
+    }
+    if (p != end)
+        corrupt("trailing bytes in a delta column");
+}
+
+std::vector<PlayEvent> history_events(const HistoryBlock& block)
+{
+    std::vector<std::uint32_t> kind, channel, episode, seconds;
+    std::vector<std::int64_t> pts, viewer, offset;
+    expand_history_column(block, kKind, kind);
+    expand_history_column(block, kChannel, channel);
+    expand_history_column(block, kEpisode, episode);
+    expand_history_column(block, kSeconds, seconds);
+    undelta_history_column(block, kPts, pts);
+    undelta_history_column(block, kViewer, viewer);
+    undelta_history_column(block, kOffset, offset);
+
+    std::vector<PlayEvent> out(block.rows());
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        if (episode[i] >= block.dictionary.size() || kind[i] > static_cast<std::uint32_t>(PlayKind::ViewerMinute))
+            corrupt("value out of range");
+        auto& e = out[i];
+        e.channel_pts = pts[i];
+        e.viewer = static_cast<std::uint64_t>(viewer[i]);
+        e.channel = channel[i];
+        e.episode = block.dictionary[episode[i]];
+        e.offset_s = static_cast<std::uint32_t>(offset[i]);
+        e.seconds = seconds[i];
+        e.kind = static_cast<PlayKind>(kind[i]);
+    }
+    return out;
+}
+
+std::vector<EpisodeViews> most_watched(const HistoryLog& log, std::size_t top)
+{
+    std::unordered_map<std::uint32_t, EpisodeViews> by_episode;
+    for (const auto& block : log.blocks()) {
+        const std::uint64_t airings = airing_rows(block);
+        std::uint64_t row = 0;
+        for (const auto& [code, run] : history_runs(block, kEpisode)) {
+            if (code >= block.dictionary.size())
+                corrupt("episode code out of range");
+            auto& e = by_episode[block.dictionary[code]];
+            e.episode = block.dictionary[code];
+            // An episode's run may straddle the end of the airings.
+            const auto aired = row < airings ? std::min<std::uint64_t>(run, airings - row) : 0;
+            e.airings += aired;
+            e.viewer_minutes += run - aired;
+            row += run;
+        }
+    }
+    std::vector<EpisodeViews> out;
+    out.reserve(by_episode.size());
+    for (const auto& [key, views] : by_episode)
+        out.push_back(views);
+    std::sort(out.begin(), out.end(), [](const EpisodeViews& a, const EpisodeViews& b) {
+        return std::tie(b.viewer_minutes, b.airings, a.episode) < std::tie(a.viewer_minutes, a.airings, b.episode);
+    });
+    if (out.size() > top)
+        out.resize(top);
+    return out;
+}
+
+std::vector<std::uint64_t> watch_curve(const HistoryLog& log, std::uint32_t episode)
+{
+    // An episode is well under a day long; anything past it is noise.
+    constexpr std::int64_t kMaxMinute = 24 * 60;
+    std::vector<std::uint64_t> curve;
+    std::vector<std::uint32_t> codes, selected;
+    std::vector<std::int64_t> offsets;
+    const auto select = select_rows();
+    for (const auto& block : log.blocks()) {
+        const auto it = std::lower_bound(block.dictionary.begin(), block.dictionary.end(), episode);
+        if (it == block.dictionary.end() || *it != episode)
+            continue;
+        const auto code = static_cast<std::uint32_t>(it - block.dictionary.begin());
+        const auto first = airing_rows(block);
+        expand_history_column(block, kEpisode, codes);
+        undelta_history_column(block, kOffset, offsets);
+        selected.resize(codes.size());
+        const auto n = select(codes.data(), first, codes.size(), code, selected.data());
+        for (std::size_t k = 0; k < n; ++k) {
+            const auto minute = offsets[selected[k]] / 60;
+            if (minute < 0 || minute >= kMaxMinute)
+                continue;
+            if (static_cast<std::size_t>(minute) >= curve.size())
+                curve.resize(static_cast<std::size_t>(minute) + 1);
+            ++curve[static_cast<std::size_t>(minute)];
+        }
+    }
+    return curve;
+}
+
+} // namespace seinfeld_tv
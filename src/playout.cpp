@@ -0,0 +1,333 @@
+#include "seinfeld_tv/playout.hpp"
+
+#include "seinfeld_tv/splice.hpp"
+#include "seinfeld_tv/trace.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+std::size_t LiveSegment::available_parts(Pts now) const noexcept
+{
+    auto it = std::partition_point(parts.begin(), parts.end(),
+        [&](const LivePart& p) { return p.available_pts() <= now; });
+    return static_cast<std::size_t>(it - parts.begin());
+}
+
+const LiveSegment* LiveWindow::find(std::uint64_t sequence) const noexcept
+{
+    if (segments.empty() || sequence < segments.front()->sequence)
+        return nullptr;
+    const auto i = sequence - segments.front()->sequence;
+    return i < segments.size() ? segments[i].get() : nullptr;
+}
+
+std::size_t LiveWindow::available_end(Pts now) const noexcept
+{
+    auto it = std::partition_point(segments.begin(), segments.end(),
+        [&](const std::shared_ptr<const LiveSegment>& s) { return s->available_pts() <= now; });
+    return static_cast<std::size_t>(it - segments.begin());
+}
+
+Playout::Playout(Library& library, const Channel& channel, PlayoutOptions options)
+    : library_(library), channel_(channel), options_(options), window_(std::make_unique<const LiveWindow>())
+{
+    if (options_.target_duration <= 0 || options_.playlist_segments == 0)
+        throw std::invalid_argument("playout: bad options");
+}
+
+std::vector<SequencePoint> Playout::positions() const
+{
+    auto window = window_.read();
+    std::vector<SequencePoint> out;
+    out.reserve(window->segments.size());
+    for (const auto& s : window->segments)
+        out.push_back({s->channel_pts, s->sequence, s->discontinuity});
+    return out;
+}
+
+void Playout::resume(std::vector<SequencePoint> points)
+{
+    std::lock_guard lock(extend_mutex_);
+    if (!started_)
+        resume_ = std::move(points);
+}
+
+void Playout::set_history(PlayHistory* history)
+{
+    std::lock_guard lock(extend_mutex_);
+    history_ = history;
+}
+
+Playout::WindowGuard Playout::window(Pts now)
+{
+    if (now + options_.lookahead > planned_until_.load(std::memory_order_acquire)) {
+        // Until something is planned everybody waits; afterwards a reader
+        // that loses the race serves the window as it is.
+        std::unique_lock lock(extend_mutex_, std::defer_lock);
+        if (planned_until_.load(std::memory_order_relaxed) == 0)
+            lock.lock();
+        else
+            lock.try_lock();
+        if (lock.owns_lock() && now + options_.lookahead > planned_until_.load(std::memory_order_relaxed))
+            extend(now);
+    }
+    return window_.read();
+}
+
+void Playout::extend(Pts now)
+{
+    trace::Span trace_span("playout.extend");
+    metrics::Timer timer(build_latency_);
+    const Pts target = options_.target_duration;
+    const Pts horizon = now + options_.lookahead;
+    const Pts join = now - static_cast<Pts>(options_.playlist_segments) * target;
+    Pts t = planned_until_.load(std::memory_order_relaxed);
+
+    std::vector<std::shared_ptr<const LiveSegment>> segments;
+    if (!started_ || t < join) {
+        // First request, or nobody asked for so long that the window aired
+        // unseen: start over a playlist's length behind the live edge.
+        t = join;
+        next_sequence_ = std::max<std::uint64_t>(next_sequence_, static_cast<std::uint64_t>(std::max<Pts>(join, 0) / target));
+        discontinuity_ += started_;
+        airing_ = {};
+        started_ = true;
+    } else {
+        plan_lag_.record(static_cast<std::uint64_t>(std::max<Pts>(horizon - t, 0)) * 1'000'000'000 / kPtsPerSecond);
+        auto current = window_.read();
+        segments = current->segments;
+    }
+
+    bool new_source = false;
+    while (t < horizon) {
+        auto timeline = channel_.scheduler().timeline();
+        const auto pos = timeline->at(t);
+        if (!pos)
+            break; // past the published timeline; retried on the next request
+        const auto& catalog = timeline->catalog();
+        const auto& entry = pos->entry;
+        if (entry.episode_id >= catalog.size())
+            break;
+        const auto& record = catalog.episode(entry.episode_id);
+        const Airing airing{entry.start_pts, record.hash, entry.in_pts, entry.out_pts};
+
+        if (airing != airing_) {
+            airing_ = airing;
+            spans_.clear();
+            next_span_ = 0;
+            source_.reset();
+            init_.reset();
+            try {
+                index_ = library_.gop_index(catalog, record);
+                const std::filesystem::path media(catalog.path(record));
+                source_ = std::make_shared<const SourceFile>(media);
+                spans_ = plan_spans(entry, record, media);
+            } catch (const std::exception&) {
+                // Missing or unreadable master: dead air is worse than a
+                // skipped episode, so move on to the next entry.
+                spans_.clear();
+            }
+            new_source = true;
+            if (spans_.empty()) {
+                t = entry.end_pts();
+                continue;
+            }
+            if (index_->container() == Container::Fmp4)
+                init_ = std::make_shared<const SegmentRef>(make_init_segment(source_, index_->view()));
+            init_sequence_ = next_sequence_;
+            if (history_ && !(entry.flags & kEntryBreak))
+                log_airing(*timeline, pos->index, record);
+        }
+        if (next_span_ >= spans_.size()) {
+            t = entry.end_pts();
+            continue;
+        }
+
+        const auto& [span, bridge] = spans_[next_span_++];
+        const Pts end = next_span_ == spans_.size()
+            ? entry.end_pts()
+            : entry.start_pts + std::clamp<Pts>(span.end_pts - entry.in_pts, 0, entry.duration());
+        if (end <= t)
+            continue;
+        // Joining mid-span (a first request or a restart): air the whole
+        // span, as every other playout of the airing does. Past the first
+        // segment, t is what has been published: an airing that changes
+        // under it (a new plan or catalog) is cut from t, never overlapping.
+        if (segments.empty())
+            t = std::min(t, entry.start_pts + std::clamp<Pts>(span.start_pts - entry.in_pts, 0, entry.duration()));
+
+        // A bridge is a separate encode: the player resets its decoder
+        // going into it and coming out.
+        new_source = new_source || bridge || after_bridge_;
+        after_bridge_ = bridge != nullptr;
+        if (!resume_.empty()) {
+            // Cuts are a function of the timeline, so the previous process
+            // cut a segment here too if it planned this far back.
+            const auto it = std::lower_bound(resume_.begin(), resume_.end(), t,
+                [](const SequencePoint& p, Pts at) { return p.channel_pts < at; });
+            if (it != resume_.end() && it->channel_pts == t) {
+                if (init_sequence_ == next_sequence_)
+                    init_sequence_ = it->sequence;
+                next_sequence_ = it->sequence;
+                discontinuity_ = it->discontinuity;
+            }
+            resume_.clear();
+        }
+        auto seg = std::make_shared<LiveSegment>();
+        if (new_source && next_sequence_ > 0 && !segments.empty())
+            ++discontinuity_;
+        seg->sequence = next_sequence_++;
+        seg->discontinuity = discontinuity_;
+        seg->channel_pts = t;
+        seg->duration_pts = end - t;
+        seg->new_source = new_source;
+        if (bridge) {
+            seg->ref = {bridge, span.start_pts, span.duration(), {}};
+            seg->ref.extents.push_back({0, bridge->size()});
+            seg->container = Container::MpegTs;
+            if (options_.part_target > 0)
+                seg->parts.push_back({t, end - t, seg->ref});
+        } else {
+            seg->ref = make_segment(source_, index_->view(), span);
+            seg->init = init_;
+            seg->init_sequence = init_sequence_;
+            seg->container = index_->container();
+            if (options_.part_target > 0)
+                seg->parts = make_parts(span, t, end);
+        }
+        segments.push_back(std::move(seg));
+        new_source = false;
+        t = end;
+    }
+
+    const Pts keep_from =
+        now - static_cast<Pts>(options_.playlist_segments + options_.history_segments) * target;
+    const auto stale = std::partition_point(segments.begin(), segments.end(),
+        [&](const std::shared_ptr<const LiveSegment>& s) { return s->available_pts() < keep_from; });
+    segments.erase(segments.begin(), stale);
+
+    trace_span.set_arg(segments.size());
+    auto next = std::make_unique<LiveWindow>();
+    next->segments = std::move(segments);
+    window_.publish(std::move(next));
+    planned_until_.store(std::max<Pts>(t, 1), std::memory_order_release);
+}
+
+void Playout::log_airing(const Timeline& timeline, std::size_t index, const EpisodeRecord& record)
+{
+    const auto entries = timeline.entries();
+    const auto& first = entries[index];
+    const bool resumes = (first.flags & kEntrySplit) && first.episode_id == logged_episode_ &&
+                         first.in_pts == logged_out_pts_;
+    if (first.start_pts < logged_until_ && first.episode_id == logged_episode_)
+        return;
+
+    // Gather the parts still to come, so the row carries the whole airtime.
+    Pts airtime = first.duration();
+    logged_episode_ = first.episode_id;
+    logged_until_ = first.end_pts();
+    logged_out_pts_ = first.out_pts;
+    for (auto i = index + 1; i < entries.size(); ++i) {
+        const auto& e = entries[i];
+        if (e.flags & kEntryBreak)
+            continue;
+        if (!(e.flags & kEntrySplit) || e.episode_id != logged_episode_ || e.in_pts != logged_out_pts_)
+            break;
+        airtime += e.duration();
+        logged_until_ = e.end_pts();
+        logged_out_pts_ = e.out_pts;
+    }
+    // A part picked up from the previous timeline belongs to the airing
+    // recorded there.
+    if (resumes)
+        return;
+    history_->record({first.start_pts, 0, channel_.id(), episode_key(record),
+                      static_cast<std::uint32_t>(first.in_pts / kPtsPerSecond),
+                      static_cast<std::uint32_t>(airtime / kPtsPerSecond), PlayKind::Airing});
+}
+
+std::vector<Playout::PlannedSpan> Playout::plan_spans(const TimelineEntry& entry, const EpisodeRecord& record,
+                                                      const std::filesystem::path& media) const
+{
+    const auto view = index_->view();
+    auto open_bridge = [&](Pts pts, BridgeEnd end) -> std::shared_ptr<const SourceFile> {
+        try {
+            return std::make_shared<const SourceFile>(bridge_path(media, record.hash, pts, end));
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+    };
+
+    Pts copy_from = entry.in_pts;
+    Pts copy_to = entry.out_pts;
+    SplicePlan in_plan;
+    SplicePlan out_plan;
+    std::shared_ptr<const SourceFile> tail;
+    std::shared_ptr<const SourceFile> head;
+    if ((entry.flags & kEntrySplit) && view.container == Container::MpegTs && !view.gops.empty()) {
+        if (entry.in_pts > 0) {
+            in_plan = plan_splice(view, entry.in_pts);
+            if (!in_plan.clean && in_plan.straddle.end_pts < entry.out_pts &&
+                (tail = open_bridge(entry.in_pts, BridgeEnd::Tail)))
+                copy_from = in_plan.straddle.end_pts;
+        }
+        if (entry.out_pts < record.duration_pts) {
+            out_plan = plan_splice(view, entry.out_pts);
+            if (!out_plan.clean && out_plan.straddle.start_pts > copy_from &&
+                (head = open_bridge(entry.out_pts, BridgeEnd::Head)))
+                copy_to = out_plan.straddle.start_pts;
+        }
+    }
+
+    std::vector<PlannedSpan> spans;
+    if (tail)
+        spans.push_back({{entry.in_pts, copy_from, 0, tail->size()}, tail});
+    for (const auto& span : plan_segments(view, copy_from, copy_to, options_.target_duration))
+        spans.push_back({span, nullptr});
+    if (head)
+        spans.push_back({{copy_to, entry.out_pts, 0, head->size()}, head});
+    return spans;
+}
+
+std::vector<LivePart> Playout::make_parts(const SegmentSpan& span, Pts from, Pts to) const
+{
+    // Parts air on the same clock as their segment: source time maps to
+    // channel time the way segment ends do, clamped to [from, to). A slice
+    // that maps to no airtime is merged into a neighbour: forwards for the
+    // pre-roll before the in-point, so its keyframe still leads, backwards
+    // for anything past the out-point.
+    struct Slice {
+        SegmentSpan cut;
+        Pts begin;
+        Pts end;
+    };
+    std::vector<Slice> slices;
+    Pts begin = from;
+    for (auto cut : plan_parts(index_->view(), span, options_.part_target)) {
+        if (!slices.empty() && slices.back().end <= slices.back().begin) {
+            cut.start_pts = slices.back().cut.start_pts;
+            cut.begin_offset = slices.back().cut.begin_offset;
+            slices.pop_back();
+        }
+        const Pts end = std::clamp<Pts>(airing_.start_pts + (cut.end_pts - airing_.in_pts), begin, to);
+        if (end <= begin && !slices.empty()) {
+            slices.back().cut.end_pts = cut.end_pts;
+            slices.back().cut.end_offset = cut.end_offset;
+            continue;
+        }
+        slices.push_back({cut, begin, end});
+        begin = end;
+    }
+    slices.back().end = to;
+
+    std::vector<LivePart> parts;
+    parts.reserve(slices.size());
+    for (const auto& s : slices)
+        parts.push_back({s.begin, s.end - s.begin, make_segment(source_, index_->view(), s.cut)});
+    return parts;
+}
+
+} // namespace seinfeld_tv
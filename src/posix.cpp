@@ -0,0 +1,68 @@
+#include "seinfeld_tv/posix.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+void throw_errno(const char* what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void UniqueFd::reset(int fd) noexcept
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = fd;
+}
+
+void write_all(int fd, const void* data, std::size_t size)
+{
+    auto* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("write");
+        }
+        p += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+void fsync_or_throw(int fd)
+{
+    if (::fsync(fd) != 0)
+        throw_errno("fsync");
+}
+
+void write_file_atomic(const std::filesystem::path& path, std::span<const std::byte> data)
+{
+    // A unique temp name lets concurrent writers of the same target race
+    // harmlessly: each rename publishes a complete file and the last wins.
+    std::string tmp = path.string() + ".tmp.XXXXXX";
+    {
+        UniqueFd fd(::mkostemp(tmp.data(), O_CLOEXEC));
+        if (!fd)
+            throw_errno("mkostemp");
+        try {
+            if (::fchmod(fd.get(), 0644) != 0)
+                throw_errno("fchmod");
+            write_all(fd.get(), data.data(), data.size());
+            fsync_or_throw(fd.get());
+        } catch (...) {
+            ::unlink(tmp.c_str());
+            throw;
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,136 @@
+#include "seinfeld_tv/prefetch.hpp"
+
+#include "seinfeld_tv/segmenter.hpp"
+#include "seinfeld_tv/trace.hpp"
+
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/ioprio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+constexpr std::uint16_t kIdlePriority = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0);
+
+/// Sorted, with overlapping and touching extents joined: every TS segment
+/// repeats the PAT/PMT packets at the head of the file.
+std::vector<FileExtent> merge_extents(std::vector<FileExtent> extents)
+{
+    std::sort(extents.begin(), extents.end(),
+              [](const FileExtent& a, const FileExtent& b) { return a.offset < b.offset; });
+    std::vector<FileExtent> out;
+    for (const auto& e : extents) {
+        if (!out.empty() && e.offset <= out.back().offset + out.back().length)
+            out.back().length = std::max(out.back().length, e.offset + e.length - out.back().offset);
+        else if (e.length > 0)
+            out.push_back(e);
+    }
+    return out;
+}
+
+} // namespace
+
+Prefetcher::Prefetcher(Library& library, PrefetchOptions options)
+    : library_(library), options_(options), ring_(std::max(options.queue_depth, 1u))
+{
+    if (options_.queue_depth == 0 || options_.read_size == 0 || options_.target_duration <= 0)
+        throw std::invalid_argument("prefetch: queue depth, read size and target duration must be positive");
+    buffer_.resize(options_.queue_depth * options_.read_size);
+    slots_.resize(options_.queue_depth);
+    // Best effort: without it the reads still carry the idle class, only
+    // the fadvise readahead does not.
+    ::syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, kIdlePriority);
+}
+
+std::uint64_t Prefetcher::prefetch(const Timeline& timeline, Pts now)
+{
+    std::erase_if(warmed_, [now](const auto& w) { return w.second < now; });
+    const Catalog& catalog = timeline.catalog();
+    std::uint64_t total = 0;
+    for (const auto& entry : timeline.entries()) {
+        if (entry.start_pts >= now + options_.lead)
+            break;
+        if (entry.start_pts < now)
+            continue;
+        const auto& record = catalog.episode(entry.episode_id);
+        const auto [it, fresh] = warmed_.try_emplace({record.hash, entry.in_pts}, entry.start_pts);
+        if (!fresh) {
+            it->second = std::max(it->second, entry.start_pts);
+            continue;
+        }
+
+        trace::Span span("prefetch.airing");
+        try {
+            const auto index = library_.gop_index(catalog, record);
+            const auto source = std::make_shared<const SourceFile>(std::filesystem::path(catalog.path(record)));
+            auto spans = plan_segments(index->view(), entry.in_pts, entry.out_pts, options_.target_duration);
+            spans.resize(std::min(spans.size(), options_.segments));
+
+            std::vector<FileExtent> extents;
+            for (const auto& e : make_init_segment(source, index->view()).extents)
+                extents.push_back(e);
+            for (const auto& s : spans)
+                for (const auto& e : make_segment(source, index->view(), s).extents)
+                    extents.push_back(e);
+            const std::uint64_t n = read_extents(source->fd(), merge_extents(std::move(extents)));
+            span.set_arg(n);
+            ++stats_.airings;
+            stats_.bytes += n;
+            total += n;
+        } catch (const std::exception&) {
+            // The airing itself will hit the same error; playout reports it.
+            ++stats_.failures;
+        }
+    }
+    return total;
+}
+
+std::uint64_t Prefetcher::read_extents(int fd, const std::vector<FileExtent>& extents)
+{
+    for (const auto& e : extents)
+        ::posix_fadvise(fd, static_cast<off_t>(e.offset), static_cast<off_t>(e.length), POSIX_FADV_WILLNEED);
+
+    std::uint64_t bytes = 0;
+    bool failed = false;
+    unsigned queued = 0;
+    auto drain = [&] {
+        for (unsigned reaped = 0; reaped < queued;) {
+            ring_.submit(queued - reaped);
+            reaped += ring_.dispatch();
+        }
+        for (unsigned i = 0; i < queued; ++i) {
+            if (slots_[i].result < 0)
+                failed = true;
+            else
+                bytes += static_cast<std::uint64_t>(slots_[i].result);
+        }
+        queued = 0;
+    };
+
+    // The data itself is discarded: reading it is what fills the cache.
+    for (const auto& e : extents) {
+        for (std::uint64_t at = e.offset; at < e.offset + e.length; at += options_.read_size) {
+            const auto len = static_cast<std::size_t>(std::min<std::uint64_t>(options_.read_size, e.offset + e.length - at));
+            auto& slot = slots_[queued];
+            slot.waiter = std::noop_coroutine();
+            uring::read_at(ring_, fd, buffer_.data() + queued * options_.read_size, len, at, kIdlePriority, slot);
+            if (++queued == options_.queue_depth)
+                drain();
+        }
+    }
+    drain();
+    if (failed)
+        ++stats_.failures;
+    return bytes;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,92 @@
+#include "seinfeld_tv/rcu.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <thread>
+
+namespace seinfeld_tv::rcu {
+
+namespace {
+
+struct alignas(64) ReaderSlot {
+    /// Epoch observed on entry to the outermost section; 0 when quiescent.
+    std::atomic<std::uint64_t> active{0};
+    std::atomic<bool> claimed{false};
+};
+
+std::array<ReaderSlot, kMaxReaderThreads> g_slots;
+std::atomic<std::size_t> g_high_water{0};
+alignas(64) std::atomic<std::uint64_t> g_epoch{1};
+
+struct ThreadState {
+    ReaderSlot* slot = nullptr;
+    unsigned depth = 0;
+
+    ~ThreadState()
+    {
+        if (slot) {
+            slot->active.store(0, std::memory_order_release);
+            slot->claimed.store(false, std::memory_order_release);
+        }
+    }
+
+    ReaderSlot& claim() noexcept
+    {
+        if (slot)
+            return *slot;
+        for (std::size_t i = 0; i < kMaxReaderThreads; ++i) {
+            bool expected = false;
+            if (!g_slots[i].claimed.load(std::memory_order_relaxed)
+                && g_slots[i].claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                std::size_t hw = g_high_water.load(std::memory_order_relaxed);
+                while (hw < i + 1 && !g_high_water.compare_exchange_weak(hw, i + 1, std::memory_order_acq_rel)) {
+                }
+                slot = &g_slots[i];
+                return *slot;
+            }
+        }
+        std::abort(); // more concurrent reader threads than kMaxReaderThreads
+    }
+};
+
+thread_local ThreadState t_state;
+
+} // namespace
+
+void read_lock() noexcept
+{
+    if (t_state.depth++ == 0) {
+        ReaderSlot& slot = t_state.claim();
+        slot.active.store(g_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+}
+
+void read_unlock() noexcept
+{
+    if (--t_state.depth == 0)
+        t_state.slot->active.store(0, std::memory_order_release);
+}
+
+std::uint64_t advance() noexcept
+{
+    return g_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+}
+
+bool quiescent_since(std::uint64_t epoch) noexcept
+{
+    std::size_t n = g_high_water.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::uint64_t seen = g_slots[i].active.load(std::memory_order_seq_cst);
+        if (seen != 0 && seen < epoch)
+            return false;
+    }
+    return true;
+}
+
+void wait_for_readers(std::uint64_t epoch) noexcept
+{
+    while (!quiescent_since(epoch))
+        std::this_thread::yield();
+}
+
+} // namespace seinfeld_tv::rcu
@@ -0,0 +1,25 @@
+#include "seinfeld_tv/report_log.hpp"
+
+#include <string>
+
+#include <fcntl.h>
+
+namespace seinfeld_tv {
+
+ReportLog::ReportLog(const std::filesystem::path& path)
+    : fd_(::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644))
+{
+    if (!fd_)
+        throw_errno("open");
+}
+
+void ReportLog::line(std::string_view text)
+{
+    std::string buf;
+    buf.reserve(text.size() + 1);
+    buf.append(text);
+    buf.push_back('\n');
+    write_all(fd_.get(), buf.data(), buf.size());
+}
+
+} // namespace seinfeld_tv
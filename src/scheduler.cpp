@@ -0,0 +1,241 @@
+#include "seinfeld_tv/scheduler.hpp"
+
+#include "seinfeld_tv/shuffle.hpp"
+#include "seinfeld_tv/trace.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+namespace {
+
+struct Airing {
+    EpisodeId id;
+    Pts in_pts;
+    Pts out_pts;
+    std::uint32_t flags;
+};
+
+/// Cyclic list of airings for one source; empty when nothing qualifies.
+class Playlist {
+public:
+    void add(Airing a)
+    {
+        if (a.out_pts > a.in_pts)
+            items_.push_back(a);
+    }
+    bool empty() const noexcept { return items_.empty(); }
+    void restart() noexcept { cursor_ = 0; }
+    const Airing& peek() const noexcept { return items_[cursor_]; }
+
+    const Airing& next() noexcept
+    {
+        const Airing& a = items_[cursor_];
+        cursor_ = (cursor_ + 1) % items_.size();
+        return a;
+    }
+
+private:
+    std::vector<Airing> items_;
+    std::size_t cursor_ = 0;
+};
+
+Playlist block_playlist(const Catalog& catalog, const ProgramBlock& block)
+{
+    Playlist list;
+    auto add_episode = [&](const EpisodeRecord& r) {
+        list.add({catalog.id_of(r), 0, r.duration_pts, 0});
+    };
+    switch (block.kind) {
+    case BlockKind::Shuffle:
+        break;
+    case BlockKind::Marathon:
+        for (const auto& r : block.season ? catalog.season(block.season) : catalog.episodes())
+            add_episode(r);
+        break;
+    case BlockKind::Episodes:
+        for (auto [season, episode] : block.episodes)
+            if (const auto* r = catalog.find(season, episode))
+                add_episode(*r);
+        break;
+    case BlockKind::Clips:
+        for (const auto& c : catalog.clips())
+            if (catalog.label(c).find(block.clip_label) != std::string_view::npos)
+                list.add({c.episode_id, c.in_pts, c.out_pts, kEntryClip});
+        break;
+    }
+    return list;
+}
+
+Pts floor_mod(Pts a, Pts m) noexcept
+{
+    Pts r = a % m;
+    return r < 0 ? r + m : r;
+}
+
+} // namespace
+
+std::vector<TimelineEntry> build_timeline(const Catalog& catalog, const SchedulePlan& plan, Pts from, Pts horizon,
+                                          const SpliceFinder& splices)
+{
+    std::vector<const ProgramBlock*> blocks;
+    for (const auto& b : plan.blocks) {
+        if (b.duration <= 0 || b.week_offset < 0 || b.week_offset + b.duration > kPtsPerWeek)
+            throw std::invalid_argument("schedule: block outside the week");
+        blocks.push_back(&b);
+    }
+    std::sort(blocks.begin(), blocks.end(),
+        [](const ProgramBlock* a, const ProgramBlock* b) { return a->week_offset < b->week_offset; });
+    for (std::size_t i = 1; i < blocks.size(); ++i)
+        if (blocks[i - 1]->week_offset + blocks[i - 1]->duration > blocks[i]->week_offset)
+            throw std::invalid_argument("schedule: overlapping blocks");
+
+    std::vector<Playlist> playlists;
+    playlists.reserve(blocks.size());
+    for (const auto* b : blocks)
+        playlists.push_back(block_playlist(catalog, *b));
+    SeekableShuffle deck(catalog, plan.seed);
+    const auto& breaks = plan.breaks;
+    Playlist break_clips;
+    if (breaks.every > 0 && breaks.clips_per_break > 0)
+        break_clips = block_playlist(catalog, {0, 0, BlockKind::Clips, 0, {}, breaks.clip_label});
+
+    std::vector<TimelineEntry> out;
+    const Pts end = from + horizon;
+    Pts t = from;
+    while (t < end) {
+        const Pts rel = floor_mod(t - plan.week_origin, kPtsPerWeek);
+        Playlist* source = nullptr; // the shuffle
+        Pts window_end = t + (kPtsPerWeek - rel);
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            const auto* b = blocks[i];
+            if (rel < b->week_offset) {
+                window_end = t + (b->week_offset - rel);
+                break;
+            }
+            if (rel < b->week_offset + b->duration) {
+                window_end = t + (b->week_offset + b->duration - rel);
+                if (!playlists[i].empty() && b->kind != BlockKind::Shuffle) {
+                    source = &playlists[i];
+                    // Marathons and themed nights start from the top each week,
+                    // unless we are resuming a block already under way.
+                    if (rel == b->week_offset)
+                        source->restart();
+                }
+                break;
+            }
+        }
+        window_end = std::min(window_end, end);
+
+        if (source ? source->empty() : deck.empty()) {
+            t = window_end;
+            continue;
+        }
+        // The shuffle runs on the clock, not on what aired before: pick it
+        // up wherever it is, mid-episode if need be, so a timeline built
+        // from any point agrees with every other. Breaks add airtime the
+        // clock does not count, so with breaks that holds per window.
+        std::optional<ShuffleSlot> slot;
+        Pts offset = 0;
+        if (!source) {
+            slot = deck.at(t - plan.week_origin);
+            offset = t - plan.week_origin - slot->start;
+        }
+        while (t < window_end) {
+            Airing a;
+            if (source) {
+                a = source->next();
+            } else {
+                a = {slot->episode, offset, slot->duration, offset > 0 ? kEntrySplit : 0u};
+                offset = 0;
+                slot = deck.after(*slot);
+            }
+            const bool with_breaks = !break_clips.empty() && !(a.flags & kEntryClip);
+            // Breaks sit on a grid of source time, never in the last half
+            // interval so the credits are not interrupted.
+            Pts nominal = with_breaks ? (a.in_pts / breaks.every + 1) * breaks.every : a.out_pts;
+            Pts pos = a.in_pts;
+            while (pos < a.out_pts && t < window_end) {
+                Pts cut = a.out_pts;
+                while (with_breaks && nominal <= pos)
+                    nominal += breaks.every;
+                if (nominal + breaks.every / 2 < a.out_pts) {
+                    const Airing& insert = break_clips.peek();
+                    std::optional<Pts> at;
+                    if (splices)
+                        at = splices(catalog, a.id, nominal, breaks.window, insert.id, insert.in_pts);
+                    cut = at && *at > pos && *at < a.out_pts ? *at : nominal;
+                }
+                const Pts length = std::min(cut - pos, window_end - t);
+                std::uint32_t flags = a.flags;
+                if (length < cut - pos)
+                    flags |= kEntryTruncated;
+                if (cut < a.out_pts || pos > a.in_pts)
+                    flags |= kEntrySplit;
+                out.push_back({t, a.id, flags, pos, pos + length});
+                t += length;
+                pos += length;
+                if (pos != cut || cut == a.out_pts)
+                    break;
+                nominal += breaks.every;
+                for (std::size_t i = 0; i < breaks.clips_per_break && t < window_end; ++i) {
+                    const Airing& c = break_clips.next();
+                    const Pts clip_length = std::min(c.out_pts - c.in_pts, window_end - t);
+                    out.push_back({t, c.id, c.flags | kEntryBreak, c.in_pts, c.in_pts + clip_length});
+                    t += clip_length;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+Scheduler::Scheduler(std::shared_ptr<const Catalog> catalog, SchedulePlan plan, SpliceFinder splices)
+    : catalog_(std::make_unique<const std::shared_ptr<const Catalog>>(std::move(catalog))),
+      plan_(std::make_unique<const SchedulePlan>(std::move(plan))), splices_(std::move(splices))
+{
+}
+
+std::optional<TimelinePosition> Scheduler::now_playing(Pts t) const noexcept
+{
+    auto guard = timeline_.read();
+    if (!guard)
+        return std::nullopt;
+    return guard->at(t);
+}
+
+void Scheduler::rebuild(Pts from)
+{
+    trace::Span span("sched.rebuild");
+    std::shared_ptr<const Catalog> catalog = *catalog_.read();
+    std::vector<TimelineEntry> entries;
+    {
+        auto plan = plan_.read();
+        entries = build_timeline(*catalog, *plan, from, kPtsPerWeek, splices_);
+    }
+    span.set_arg(entries.size());
+    timeline_.publish(std::make_unique<const Timeline>(std::move(catalog), std::move(entries)));
+    revision_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void Scheduler::restore(std::vector<TimelineEntry> entries)
+{
+    std::shared_ptr<const Catalog> catalog = *catalog_.read();
+    timeline_.publish(std::make_unique<const Timeline>(std::move(catalog), std::move(entries)));
+    revision_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void Scheduler::set_plan(SchedulePlan plan, Pts from)
+{
+    plan_.publish(std::make_unique<const SchedulePlan>(std::move(plan)));
+    rebuild(from);
+}
+
+void Scheduler::set_catalog(std::shared_ptr<const Catalog> catalog, Pts from)
+{
+    catalog_.publish(std::make_unique<const std::shared_ptr<const Catalog>>(std::move(catalog)));
+    rebuild(from);
+}
+
+} // namespace seinfeld_tv
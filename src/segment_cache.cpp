@@ -0,0 +1,280 @@
+#include "seinfeld_tv/segment_cache.hpp"
+
+#include "seinfeld_tv/trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// Map node, queue slot and control block, roughly.
+constexpr std::size_t kEntryOverhead = 160;
+constexpr std::uint8_t kMaxFreq = 3;
+
+} // namespace
+
+struct SegmentCache::Node {
+    SegmentKey key;
+    Value value;
+    std::size_t charge = 0;
+    std::atomic<std::uint8_t> freq{0};
+    bool in_main = false;
+};
+
+struct SegmentCache::Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<SegmentKey, std::unique_ptr<Node>, SegmentKeyHash> map;
+    std::deque<Node*> small;
+    std::deque<Node*> main;
+    /// Keys evicted from `small` without a second hit; a count per key
+    /// since the same key can be queued more than once.
+    std::deque<SegmentKey> ghost_fifo;
+    std::unordered_map<SegmentKey, std::uint32_t, SegmentKeyHash> ghost;
+    std::size_t budget = 0;
+    std::size_t small_budget = 0;
+    std::size_t bytes = 0;
+    std::size_t small_bytes = 0;
+
+    std::mutex flight_mutex;
+    std::unordered_map<SegmentKey, std::shared_future<Value>, SegmentKeyHash> flights;
+
+    std::atomic<std::uint64_t> coalesced{0}, inserts{0}, evictions{0}, rejected{0};
+
+    Node* lookup(const SegmentKey& key) const noexcept
+    {
+        auto it = map.find(key);
+        return it == map.end() ? nullptr : it->second.get();
+    }
+
+    void remember_ghost(const SegmentKey& key)
+    {
+        ghost_fifo.push_back(key);
+        ++ghost[key];
+        while (ghost_fifo.size() > std::max<std::size_t>(map.size(), 64)) {
+            auto it = ghost.find(ghost_fifo.front());
+            if (--it->second == 0)
+                ghost.erase(it);
+            ghost_fifo.pop_front();
+        }
+    }
+
+    bool take_ghost(const SegmentKey& key)
+    {
+        auto it = ghost.find(key);
+        if (it == ghost.end())
+            return false;
+        // Leave the FIFO slot; it is dropped from the counts when it ages out.
+        ghost.erase(it);
+        return true;
+    }
+
+    void drop(Node* node)
+    {
+        bytes -= node->charge;
+        const SegmentKey key = node->key;
+        map.erase(key);
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Frees one entry. Requires at least one.
+    void evict_one()
+    {
+        for (;;) {
+            if (!small.empty() && (small_bytes > small_budget || main.empty())) {
+                Node* node = small.front();
+                small.pop_front();
+                small_bytes -= node->charge;
+                if (node->freq.load(std::memory_order_relaxed) > 0) {
+                    node->freq.store(0, std::memory_order_relaxed);
+                    node->in_main = true;
+                    main.push_back(node);
+                    continue;
+                }
+                const SegmentKey key = node->key;
+                drop(node);
+                remember_ghost(key);
+                return;
+            }
+            Node* node = main.front();
+            main.pop_front();
+            if (auto f = node->freq.load(std::memory_order_relaxed); f > 0) {
+                node->freq.store(f - 1, std::memory_order_relaxed);
+                main.push_back(node);
+                continue;
+            }
+            drop(node);
+            return;
+        }
+    }
+};
+
+SegmentCache::SegmentCache(std::size_t byte_budget, std::size_t shards)
+    : budget_(byte_budget)
+{
+    shards = std::max<std::size_t>(shards, 1);
+    shards_.reserve(shards);
+    for (std::size_t i = 0; i < shards; ++i) {
+        auto& s = *shards_.emplace_back(std::make_unique<Shard>());
+        s.budget = byte_budget / shards;
+        s.small_budget = s.budget / 10;
+    }
+}
+
+SegmentCache::~SegmentCache() = default;
+
+std::size_t SegmentCache::charge(const CachedSegment& value) noexcept
+{
+    return value.bytes.size() + kEntryOverhead;
+}
+
+SegmentCache::Shard& SegmentCache::shard_of(const SegmentKey& key) const noexcept
+{
+    // The high bits; the low bits pick the bucket inside the shard's map.
+    return *shards_[(SegmentKeyHash{}(key) >> 48) % shards_.size()];
+}
+
+SegmentCache::Value SegmentCache::find(const SegmentKey& key)
+{
+    auto& s = shard_of(key);
+    std::shared_lock lock(s.mutex);
+    Node* node = s.lookup(key);
+    if (!node) {
+        misses_.add();
+        trace::instant("cache.miss");
+        return nullptr;
+    }
+    // Racy increments may be lost; the counter is only a recency hint.
+    if (auto f = node->freq.load(std::memory_order_relaxed); f < kMaxFreq)
+        node->freq.store(f + 1, std::memory_order_relaxed);
+    hits_.add();
+    return node->value;
+}
+
+void SegmentCache::insert(const SegmentKey& key, Value value)
+{
+    if (!value)
+        return;
+    auto& s = shard_of(key);
+    const std::size_t need = charge(*value);
+    std::unique_lock lock(s.mutex);
+    if (need > s.budget) {
+        s.rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (Node* node = s.lookup(key)) {
+        s.bytes = s.bytes - node->charge + need;
+        if (!node->in_main)
+            s.small_bytes = s.small_bytes - node->charge + need;
+        node->value = std::move(value);
+        node->charge = need;
+        while (s.bytes > s.budget)
+            s.evict_one();
+        return;
+    }
+
+    while (s.bytes + need > s.budget)
+        s.evict_one();
+    auto node = std::make_unique<Node>();
+    node->key = key;
+    node->value = std::move(value);
+    node->charge = need;
+    node->in_main = s.take_ghost(key);
+    (node->in_main ? s.main : s.small).push_back(node.get());
+    if (!node->in_main)
+        s.small_bytes += need;
+    s.bytes += need;
+    s.map.emplace(key, std::move(node));
+    s.inserts.fetch_add(1, std::memory_order_relaxed);
+}
+
+SegmentCache::Value SegmentCache::get_or_build(const SegmentKey& key, const Builder& build)
+{
+    if (auto v = find(key))
+        return v;
+
+    auto& s = shard_of(key);
+    std::promise<Value> promise;
+    {
+        std::unique_lock lock(s.flight_mutex);
+        if (auto it = s.flights.find(key); it != s.flights.end()) {
+            auto future = it->second;
+            lock.unlock();
+            s.coalesced.fetch_add(1, std::memory_order_relaxed);
+            trace::Span span("cache.coalesce");
+            return future.get();
+        }
+        s.flights.emplace(key, promise.get_future().share());
+    }
+    auto finish = [&] {
+        std::lock_guard lock(s.flight_mutex);
+        s.flights.erase(key);
+    };
+
+    // A build may have completed between our miss and registering.
+    {
+        std::shared_lock lock(s.mutex);
+        if (Node* node = s.lookup(key)) {
+            Value v = node->value;
+            lock.unlock();
+            promise.set_value(v);
+            finish();
+            return v;
+        }
+    }
+
+    Value v;
+    try {
+        trace::Span span("cache.build");
+        v = build();
+    } catch (...) {
+        finish();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    // Publish before retiring the flight so later callers either join it
+    // or hit the cache.
+    insert(key, v);
+    promise.set_value(v);
+    finish();
+    return v;
+}
+
+std::vector<SegmentKey> SegmentCache::hot_keys() const
+{
+    std::vector<SegmentKey> out;
+    for (const auto& sp : shards_) {
+        std::shared_lock lock(sp->mutex);
+        for (auto it = sp->main.rbegin(); it != sp->main.rend(); ++it)
+            out.push_back((*it)->key);
+        for (auto it = sp->small.rbegin(); it != sp->small.rend(); ++it)
+            out.push_back((*it)->key);
+    }
+    return out;
+}
+
+SegmentCacheStats SegmentCache::stats() const noexcept
+{
+    SegmentCacheStats out;
+    out.hits = hits_.value();
+    out.misses = misses_.value();
+    for (const auto& sp : shards_) {
+        const auto& s = *sp;
+        out.coalesced += s.coalesced.load(std::memory_order_relaxed);
+        out.inserts += s.inserts.load(std::memory_order_relaxed);
+        out.evictions += s.evictions.load(std::memory_order_relaxed);
+        out.rejected += s.rejected.load(std::memory_order_relaxed);
+        std::shared_lock lock(s.mutex);
+        out.bytes += s.bytes;
+        out.entries += s.map.size();
+    }
+    return out;
+}
+
+} // namespace seinfeld_tv
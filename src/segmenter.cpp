@@ -0,0 +1,186 @@
+#include "seinfeld_tv/segmenter.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+SourceFile::SourceFile(const std::filesystem::path& path)
+    : fd_(::open(path.c_str(), O_RDONLY | O_CLOEXEC)), path_(path)
+{
+    if (!fd_)
+        throw_errno("open");
+    struct stat st {};
+    if (::fstat(fd_.get(), &st) != 0)
+        throw_errno("fstat");
+    size_ = static_cast<std::uint64_t>(st.st_size);
+    ::posix_fadvise(fd_.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+std::vector<SegmentSpan> plan_segments(const GopView& index, Pts in_pts, Pts out_pts, Pts target)
+{
+    std::vector<SegmentSpan> spans;
+    const auto gops = index.gops;
+    if (gops.empty() || out_pts <= in_pts)
+        return spans;
+
+    auto by_pts = [](const GopEntry& g, Pts t) { return g.pts < t; };
+    auto first = std::lower_bound(gops.begin(), gops.end(), in_pts, by_pts);
+    if (first == gops.end() || (first != gops.begin() && first->pts > in_pts))
+        --first;
+
+    auto cur = first;
+    while (cur != gops.end() && cur->pts < out_pts) {
+        auto next = std::lower_bound(cur + 1, gops.end(), std::min(cur->pts + target, out_pts), by_pts);
+        SegmentSpan s{cur->pts, 0, cur->offset, 0};
+        if (next == gops.end()) {
+            s.end_pts = std::max(index.duration_pts, cur->pts);
+            s.end_offset = index.file_size;
+        } else {
+            s.end_pts = next->pts;
+            s.end_offset = next->offset;
+        }
+        spans.push_back(s);
+        cur = next;
+    }
+    return spans;
+}
+
+std::vector<SegmentSpan> plan_parts(const GopView& index, const SegmentSpan& span, Pts part_target)
+{
+    std::vector<SegmentSpan> parts;
+    const auto gops = index.gops;
+    auto by_offset = [](const GopEntry& g, std::uint64_t off) { return g.offset < off; };
+    auto cur = std::lower_bound(gops.begin(), gops.end(), span.begin_offset, by_offset);
+    const auto last = std::lower_bound(cur, gops.end(), span.end_offset, by_offset);
+    if (part_target <= 0 || cur == last)
+        return {span};
+
+    SegmentSpan part{span.start_pts, 0, span.begin_offset, 0};
+    for (++cur; cur != last; ++cur) {
+        // Cut before this GOP unless the part still fits with it included.
+        const Pts gop_end = std::next(cur) == last ? span.end_pts : std::next(cur)->pts;
+        if (gop_end - part.start_pts <= part_target)
+            continue;
+        part.end_pts = cur->pts;
+        part.end_offset = cur->offset;
+        parts.push_back(part);
+        part = {cur->pts, 0, cur->offset, 0};
+    }
+    part.end_pts = span.end_pts;
+    part.end_offset = span.end_offset;
+    parts.push_back(part);
+    return parts;
+}
+
+SegmentRef make_segment(std::shared_ptr<const SourceFile> source, const GopView& index,
+                        const SegmentSpan& span, std::pmr::memory_resource* mr)
+{
+    SegmentRef seg{nullptr, 0, 0, std::pmr::vector<FileExtent>(mr)};
+    seg.source = std::move(source);
+    seg.start_pts = span.start_pts;
+    seg.duration_pts = span.duration();
+    if (index.container == Container::MpegTs) {
+        seg.extents.reserve(index.init.size() + 1);
+        seg.extents.insert(seg.extents.end(), index.init.begin(), index.init.end());
+    }
+    seg.extents.push_back({span.begin_offset, span.end_offset - span.begin_offset});
+    return seg;
+}
+
+SegmentRef make_init_segment(std::shared_ptr<const SourceFile> source, const GopView& index)
+{
+    SegmentRef seg;
+    seg.source = std::move(source);
+    if (index.container == Container::Fmp4)
+        seg.extents.assign(index.init.begin(), index.init.end());
+    return seg;
+}
+
+namespace {
+
+/// Drains data already in the fallback pipe. Returns false on EAGAIN.
+bool drain_pipe(int out_fd, SendCursor& c)
+{
+    while (c.in_pipe > 0) {
+        ssize_t n = ::splice(c.pipe_read.get(), nullptr, out_fd, nullptr, c.in_pipe, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return false;
+            throw_errno("splice");
+        }
+        c.in_pipe -= static_cast<std::uint64_t>(n);
+        c.total += static_cast<std::uint64_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+SendStatus send_segment(int out_fd, const SegmentRef& segment, SendCursor& c)
+{
+    const int in_fd = segment.source->fd();
+    if (!drain_pipe(out_fd, c))
+        return SendStatus::WouldBlock;
+
+    while (c.extent < segment.extents.size()) {
+        const FileExtent& e = segment.extents[c.extent];
+        if (c.offset >= e.length) {
+            ++c.extent;
+            c.offset = 0;
+            continue;
+        }
+        off_t pos = static_cast<off_t>(e.offset + c.offset);
+        const std::size_t want = static_cast<std::size_t>(e.length - c.offset);
+
+        if (!c.use_splice) {
+            ssize_t n = ::sendfile(out_fd, in_fd, &pos, want);
+            if (n > 0) {
+                c.offset += static_cast<std::uint64_t>(n);
+                c.total += static_cast<std::uint64_t>(n);
+                continue;
+            }
+            if (n == 0)
+                throw std::system_error(EIO, std::generic_category(), "sendfile: source truncated");
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN)
+                return SendStatus::WouldBlock;
+            if (errno != EINVAL && errno != ENOSYS)
+                throw_errno("sendfile");
+            c.use_splice = true;
+        }
+
+        if (!c.pipe_read) {
+            int fds[2];
+            if (::pipe2(fds, O_CLOEXEC) != 0)
+                throw_errno("pipe2");
+            c.pipe_read.reset(fds[0]);
+            c.pipe_write.reset(fds[1]);
+        }
+        ssize_t n = ::splice(in_fd, &pos, c.pipe_write.get(), nullptr, want, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("splice");
+        }
+        if (n == 0)
+            throw std::system_error(EIO, std::generic_category(), "splice: source truncated");
+        c.offset += static_cast<std::uint64_t>(n);
+        c.in_pipe += static_cast<std::uint64_t>(n);
+        if (!drain_pipe(out_fd, c))
+            return SendStatus::WouldBlock;
+    }
+    return SendStatus::Done;
+}
+
+} // namespace seinfeld_tv
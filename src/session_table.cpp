@@ -0,0 +1,178 @@
+#include "seinfeld_tv/session_table.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+SessionTable::SessionTable(std::size_t capacity)
+    : index_(std::bit_ceil(2 * std::max<std::size_t>(capacity, 1)), kEmpty),
+      key_(capacity),
+      generation_(capacity),
+      channel_(capacity),
+      rendition_(capacity),
+      bandwidth_(capacity),
+      last_sequence_(capacity),
+      segments_(capacity),
+      joined_(capacity),
+      last_seen_(capacity)
+{
+    if (capacity == 0 || capacity >= kEmpty)
+        throw std::invalid_argument("session table: capacity out of range");
+    free_.reserve(capacity);
+    for (std::size_t slot = capacity; slot-- > 0;)
+        free_.push_back(static_cast<std::uint32_t>(slot));
+}
+
+std::size_t SessionTable::bucket_of(std::uint64_t key) const noexcept
+{
+    // Fibonacci hashing: std::hash of a string may leave the low bits weak.
+    return static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ull) >> (64 - std::countr_zero(index_.size())));
+}
+
+std::optional<SessionHandle> SessionTable::touch(std::string_view key, std::uint32_t channel, Pts now)
+{
+    const std::uint64_t k = std::hash<std::string_view>{}(key);
+    const std::size_t mask = index_.size() - 1;
+    std::lock_guard lock(mutex_);
+    std::size_t b = bucket_of(k);
+    for (; index_[b] != kEmpty; b = (b + 1) & mask) {
+        const std::uint32_t slot = index_[b];
+        if (key_[slot] == k) {
+            channel_[slot] = channel;
+            last_seen_[slot] = std::max(last_seen_[slot], now);
+            return SessionHandle{slot, generation_[slot]};
+        }
+    }
+    if (free_.empty())
+        return std::nullopt;
+
+    const std::uint32_t slot = free_.back();
+    free_.pop_back();
+    high_ = std::max(high_, slot + 1);
+    index_[b] = slot;
+    key_[slot] = k;
+    ++generation_[slot];
+    channel_[slot] = channel;
+    rendition_[slot] = 0;
+    bandwidth_[slot] = 0;
+    last_sequence_[slot] = 0;
+    segments_[slot] = 0;
+    joined_[slot] = last_seen_[slot] = now;
+    return SessionHandle{slot, generation_[slot]};
+}
+
+std::optional<SessionHandle> SessionTable::find(std::string_view key) const
+{
+    const std::uint64_t k = std::hash<std::string_view>{}(key);
+    const std::size_t mask = index_.size() - 1;
+    std::lock_guard lock(mutex_);
+    for (std::size_t b = bucket_of(k); index_[b] != kEmpty; b = (b + 1) & mask)
+        if (key_[index_[b]] == k)
+            return SessionHandle{index_[b], generation_[index_[b]]};
+    return std::nullopt;
+}
+
+bool SessionTable::served(SessionHandle h, std::uint64_t sequence, std::uint32_t rendition, Pts now)
+{
+    std::lock_guard lock(mutex_);
+    if (!live(h.slot, h.generation))
+        return false;
+    last_sequence_[h.slot] = sequence;
+    rendition_[h.slot] = rendition;
+    ++segments_[h.slot];
+    last_seen_[h.slot] = std::max(last_seen_[h.slot], now);
+    return true;
+}
+
+bool SessionTable::set_bandwidth(SessionHandle h, std::uint32_t bps)
+{
+    std::lock_guard lock(mutex_);
+    if (!live(h.slot, h.generation))
+        return false;
+    bandwidth_[h.slot] = bps;
+    return true;
+}
+
+std::size_t SessionTable::blend_bandwidth(std::span<const BandwidthSample> samples, double weight)
+{
+    std::lock_guard lock(mutex_);
+    std::size_t applied = 0;
+    for (const auto& s : samples) {
+        if (!live(s.session.slot, s.session.generation))
+            continue;
+        auto& bw = bandwidth_[s.session.slot];
+        bw = bw == 0 ? s.bps : static_cast<std::uint32_t>(bw + weight * (static_cast<double>(s.bps) - bw));
+        ++applied;
+    }
+    return applied;
+}
+
+std::optional<SessionInfo> SessionTable::get(SessionHandle h) const
+{
+    std::lock_guard lock(mutex_);
+    if (!live(h.slot, h.generation))
+        return std::nullopt;
+    const auto s = h.slot;
+    return SessionInfo{channel_[s],       rendition_[s], bandwidth_[s],  last_sequence_[s],
+                       segments_[s],      joined_[s],    last_seen_[s]};
+}
+
+void SessionTable::unindex(std::uint32_t slot) noexcept
+{
+    const std::size_t mask = index_.size() - 1;
+    std::size_t hole = bucket_of(key_[slot]);
+    while (index_[hole] != slot)
+        hole = (hole + 1) & mask;
+    // Backward-shift deletion: pull later entries of the probe run into
+    // the hole unless that would move them before their home bucket.
+    for (std::size_t next = (hole + 1) & mask; index_[next] != kEmpty; next = (next + 1) & mask) {
+        const std::size_t home = bucket_of(key_[index_[next]]);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index_[hole] = index_[next];
+            hole = next;
+        }
+    }
+    index_[hole] = kEmpty;
+}
+
+std::size_t SessionTable::reap(Pts cutoff)
+{
+    std::lock_guard lock(mutex_);
+    std::size_t closed = 0;
+    for (std::uint32_t slot = 0; slot < high_; ++slot) {
+        if ((generation_[slot] & 1) == 0 || last_seen_[slot] >= cutoff)
+            continue;
+        unindex(slot);
+        ++generation_[slot];
+        free_.push_back(slot);
+        ++closed;
+    }
+    // Keep handing out the lowest slots first so sweeps stay short.
+    if (closed)
+        std::sort(free_.begin(), free_.end(), std::greater<>());
+    return closed;
+}
+
+std::size_t SessionTable::count(std::vector<std::size_t>* counts) const
+{
+    std::lock_guard lock(mutex_);
+    if (counts)
+        std::fill(counts->begin(), counts->end(), 0);
+    std::size_t open = 0;
+    for (std::uint32_t slot = 0; slot < high_; ++slot) {
+        if ((generation_[slot] & 1) == 0)
+            continue;
+        ++open;
+        if (counts) {
+            if (channel_[slot] >= counts->size())
+                counts->resize(channel_[slot] + 1);
+            ++(*counts)[channel_[slot]];
+        }
+    }
+    return open;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,123 @@
+#include "seinfeld_tv/shuffle.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+namespace {
+
+std::uint64_t splitmix64(std::uint64_t& state) noexcept
+{
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+std::int64_t floor_div(Pts a, Pts b) noexcept
+{
+    const Pts q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+} // namespace
+
+FeistelPermutation::FeistelPermutation(std::uint64_t size, std::uint64_t key) : size_(size)
+{
+    if (size == 0)
+        throw std::invalid_argument("shuffle: empty permutation");
+    const auto bits = static_cast<unsigned>(std::bit_width(size - 1));
+    half_bits_ = std::max(1u, (bits + 1) / 2);
+    half_mask_ = (std::uint64_t{1} << half_bits_) - 1;
+    std::uint64_t state = key;
+    for (auto& k : keys_)
+        k = splitmix64(state);
+}
+
+std::uint64_t FeistelPermutation::encrypt(std::uint64_t x) const noexcept
+{
+    std::uint64_t left = x >> half_bits_;
+    std::uint64_t right = x & half_mask_;
+    for (const std::uint64_t k : keys_) {
+        std::uint64_t state = right ^ k;
+        const std::uint64_t f = splitmix64(state) & half_mask_;
+        const std::uint64_t next = left ^ f;
+        left = right;
+        right = next;
+    }
+    return left << half_bits_ | right;
+}
+
+std::uint64_t FeistelPermutation::operator()(std::uint64_t i) const noexcept
+{
+    // Cycle walking: i's cycle through the larger domain returns to
+    // [0, size) before it closes, so this ends.
+    do
+        i = encrypt(i);
+    while (i >= size_);
+    return i;
+}
+
+SeekableShuffle::SeekableShuffle(const Catalog& catalog, std::uint64_t seed) : seed_(seed)
+{
+    for (const auto& r : catalog.episodes()) {
+        if (r.duration_pts <= 0)
+            continue;
+        ids_.push_back(catalog.id_of(r));
+        durations_.push_back(r.duration_pts);
+        round_length_ += r.duration_pts;
+    }
+}
+
+FeistelPermutation SeekableShuffle::order(std::int64_t round) const
+{
+    std::uint64_t state = seed_ ^ static_cast<std::uint64_t>(round) * 0xd6e8feb86659fd93ull;
+    return FeistelPermutation(ids_.size(), splitmix64(state));
+}
+
+EpisodeId SeekableShuffle::episode(std::int64_t round, std::uint32_t index) const noexcept
+{
+    return ids_[order(round)(index)];
+}
+
+const std::vector<Pts>& SeekableShuffle::offsets(std::int64_t round)
+{
+    if (cached_ && cached_round_ == round)
+        return offsets_;
+    const auto perm = order(round);
+    offsets_.resize(ids_.size());
+    Pts at = 0;
+    for (std::uint64_t k = 0; k < ids_.size(); ++k) {
+        offsets_[k] = at;
+        at += durations_[perm(k)];
+    }
+    cached_round_ = round;
+    cached_ = true;
+    return offsets_;
+}
+
+ShuffleSlot SeekableShuffle::at(Pts t)
+{
+    const std::int64_t round = floor_div(t, round_length_);
+    const Pts round_start = round * round_length_;
+    const auto& offs = offsets(round);
+    const auto k = static_cast<std::uint32_t>(std::upper_bound(offs.begin(), offs.end(), t - round_start) - offs.begin() - 1);
+    const auto i = order(round)(k);
+    return {ids_[i], round_start + offs[k], durations_[i], round, k};
+}
+
+ShuffleSlot SeekableShuffle::after(const ShuffleSlot& slot)
+{
+    ShuffleSlot next;
+    next.start = slot.start + slot.duration;
+    next.round = slot.index + 1 < ids_.size() ? slot.round : slot.round + 1;
+    next.index = slot.index + 1 < ids_.size() ? slot.index + 1 : 0;
+    const auto i = order(next.round)(next.index);
+    next.episode = ids_[i];
+    next.duration = durations_[i];
+    return next;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,198 @@
+#include "seinfeld_tv/snapshot.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace seinfeld_tv {
+
+using namespace snapshot_format;
+
+namespace {
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("snapshot: ") + what);
+}
+
+template <typename T>
+std::span<const T> section(const MappedFile& file, std::uint64_t offset, std::uint64_t count)
+{
+    if (offset % alignof(T) != 0 || offset > file.size() || count > (file.size() - offset) / sizeof(T))
+        corrupt("section out of bounds");
+    return {reinterpret_cast<const T*>(file.data() + offset), static_cast<std::size_t>(count)};
+}
+
+/// FNV-1a, fed field by field so padding never reaches it.
+struct Fnv {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+
+    void bytes(const void* data, std::size_t size) noexcept
+    {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i)
+            h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+    template <typename T>
+    void value(T v) noexcept
+    {
+        bytes(&v, sizeof v);
+    }
+    void string(std::string_view s) noexcept
+    {
+        value(s.size());
+        bytes(s.data(), s.size());
+    }
+};
+
+} // namespace
+
+std::uint64_t plan_fingerprint(const SchedulePlan& plan)
+{
+    Fnv f;
+    f.value(plan.week_origin);
+    f.value(plan.seed);
+    f.value(plan.blocks.size());
+    for (const auto& b : plan.blocks) {
+        f.value(b.week_offset);
+        f.value(b.duration);
+        f.value(b.kind);
+        f.value(b.season);
+        f.value(b.episodes.size());
+        for (const auto& [season, episode] : b.episodes) {
+            f.value(season);
+            f.value(episode);
+        }
+        f.string(b.clip_label);
+    }
+    f.value(plan.breaks.every);
+    f.string(plan.breaks.clip_label);
+    f.value(plan.breaks.clips_per_break);
+    f.value(plan.breaks.window);
+    return f.h;
+}
+
+void save_snapshot(const std::filesystem::path& path, Station& station, HlsService& hls, Pts timeline_from)
+{
+    std::vector<ChannelRecord> channels(station.size());
+    std::vector<TimelineEntry> entries;
+    std::vector<SequencePoint> points;
+    std::string strings;
+    const auto catalog_generation = station.library().catalog()->generation();
+    for (std::uint32_t id = 0; id < station.size(); ++id) {
+        const auto& channel = *station.channel(id);
+        auto& r = channels[id];
+        r.name_offset = static_cast<std::uint32_t>(strings.size());
+        r.name_length = static_cast<std::uint32_t>(channel.name().size());
+        strings += channel.name();
+        r.plan_fingerprint = plan_fingerprint(channel.scheduler().plan());
+        {
+            auto timeline = channel.scheduler().timeline();
+            // A timeline from another generation (mid-rescan) would not
+            // match on restore anyway.
+            if (timeline && timeline->catalog().generation() == catalog_generation) {
+                r.first_entry = entries.size();
+                r.entry_count = timeline->entries().size();
+                entries.insert(entries.end(), timeline->entries().begin(), timeline->entries().end());
+            }
+        }
+        if (const auto* playout = hls.playout(channel.name())) {
+            const auto window = playout->positions();
+            r.first_point = points.size();
+            r.point_count = window.size();
+            points.insert(points.end(), window.begin(), window.end());
+        }
+    }
+    const auto keys = station.library().segments().hot_keys();
+    const auto indexes = station.library().cached_index_hashes();
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.header_size = sizeof header;
+    header.catalog_generation = catalog_generation;
+    header.saved_pts = channel_time_now();
+    header.timeline_from = timeline_from;
+    header.channel_count = static_cast<std::uint32_t>(channels.size());
+    header.entry_count = entries.size();
+    header.point_count = points.size();
+    header.key_count = keys.size();
+    header.index_count = indexes.size();
+    header.channels_offset = align_section(sizeof header);
+    header.entries_offset = align_section(header.channels_offset + channels.size() * sizeof(ChannelRecord));
+    header.points_offset = align_section(header.entries_offset + entries.size() * sizeof(TimelineEntry));
+    header.keys_offset = align_section(header.points_offset + points.size() * sizeof(SequencePoint));
+    header.indexes_offset = align_section(header.keys_offset + keys.size() * sizeof(SegmentKey));
+    header.strings_offset = align_section(header.indexes_offset + indexes.size() * sizeof(ContentHash));
+    header.strings_size = strings.size();
+    header.file_size = header.strings_offset + strings.size();
+
+    std::vector<std::byte> image(header.file_size);
+    auto put = [&](std::uint64_t offset, const void* data, std::size_t size) {
+        if (size > 0)
+            std::memcpy(image.data() + offset, data, size);
+    };
+    put(0, &header, sizeof header);
+    put(header.channels_offset, channels.data(), channels.size() * sizeof(ChannelRecord));
+    put(header.entries_offset, entries.data(), entries.size() * sizeof(TimelineEntry));
+    put(header.points_offset, points.data(), points.size() * sizeof(SequencePoint));
+    put(header.keys_offset, keys.data(), keys.size() * sizeof(SegmentKey));
+    put(header.indexes_offset, indexes.data(), indexes.size() * sizeof(ContentHash));
+    put(header.strings_offset, strings.data(), strings.size());
+
+    write_file_atomic(path, image);
+}
+
+Snapshot::Snapshot(const std::filesystem::path& path) : file_(path)
+{
+    if (file_.size() < sizeof(SnapshotHeader))
+        corrupt("truncated header");
+    header_ = reinterpret_cast<const SnapshotHeader*>(file_.data());
+    if (std::memcmp(header_->magic, kMagic, sizeof kMagic) != 0)
+        corrupt("bad magic");
+    if (header_->version != kVersion)
+        corrupt("unsupported version");
+    if (header_->header_size != sizeof(SnapshotHeader) || header_->file_size != file_.size())
+        corrupt("size mismatch");
+
+    channels_ = section<ChannelRecord>(file_, header_->channels_offset, header_->channel_count);
+    entries_ = section<TimelineEntry>(file_, header_->entries_offset, header_->entry_count);
+    points_ = section<SequencePoint>(file_, header_->points_offset, header_->point_count);
+    keys_ = section<SegmentKey>(file_, header_->keys_offset, header_->key_count);
+    indexes_ = section<ContentHash>(file_, header_->indexes_offset, header_->index_count);
+    const auto strings = section<char>(file_, header_->strings_offset, header_->strings_size);
+    strings_ = strings.data();
+
+    for (const auto& c : channels_) {
+        if (std::uint64_t{c.name_offset} + c.name_length > strings.size())
+            corrupt("string out of bounds");
+        if (c.first_entry > entries_.size() || c.entry_count > entries_.size() - c.first_entry ||
+            c.first_point > points_.size() || c.point_count > points_.size() - c.first_point)
+            corrupt("channel range out of bounds");
+        const auto t = timeline(c);
+        const auto p = positions(c);
+        if (!std::is_sorted(t.begin(), t.end(), [](const auto& a, const auto& b) { return a.start_pts < b.start_pts; }) ||
+            !std::is_sorted(p.begin(), p.end(), [](const auto& a, const auto& b) { return a.channel_pts < b.channel_pts; }))
+            corrupt("channel not sorted");
+    }
+}
+
+bool Snapshot::matches(const Catalog& catalog, Pts from) const noexcept
+{
+    if (header_->catalog_generation != catalog.generation() || header_->timeline_from != from)
+        return false;
+    return std::all_of(entries_.begin(), entries_.end(),
+                       [&](const TimelineEntry& e) { return e.episode_id < catalog.size(); });
+}
+
+const ChannelRecord* Snapshot::channel(std::string_view name) const noexcept
+{
+    auto it = std::find_if(channels_.begin(), channels_.end(), [&](const auto& c) { return this->name(c) == name; });
+    return it == channels_.end() ? nullptr : &*it;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,175 @@
+#include "seinfeld_tv/splice.hpp"
+
+#include "seinfeld_tv/station.hpp"
+#include "seinfeld_tv/timeline.hpp"
+#include "seinfeld_tv/trace.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+namespace seinfeld_tv {
+
+namespace {
+
+std::size_t gop_at(const GopView& index, Pts pts) noexcept
+{
+    auto it = std::upper_bound(index.gops.begin(), index.gops.end(), pts,
+                               [](Pts t, const GopEntry& g) { return t < g.pts; });
+    return it == index.gops.begin() ? 0 : static_cast<std::size_t>(it - index.gops.begin()) - 1;
+}
+
+bool clean_at(const GopView& index, std::size_t i, std::optional<std::uint64_t> params) noexcept
+{
+    const auto& g = index.gops[i];
+    if (!(g.flags & kGopClosed))
+        return false;
+    return !params || (g.param_set < index.param_sets.size() && index.param_sets[g.param_set] == *params);
+}
+
+/// Rendition for bridges: the source's size, at a rate high enough that
+/// a second of re-encode is not the weakest picture of the hour.
+Rendition bridge_rendition()
+{
+    return {"bridge", kSourceHeight, 8000, 192};
+}
+
+} // namespace
+
+std::optional<Pts> find_splice_point(const GopView& index, Pts at, Pts window, std::optional<std::uint64_t> params)
+{
+    if (index.gops.empty())
+        return std::nullopt;
+    // Walk outwards from `at`, so the first hit is the nearest. The first
+    // GOP is never a splice point: cutting there leaves nothing before it.
+    const std::size_t mid = gop_at(index, at);
+    std::optional<Pts> best;
+    for (std::size_t i = mid + 1; i < index.gops.size() && index.gops[i].pts - at <= window; ++i)
+        if (clean_at(index, i, params)) {
+            best = index.gops[i].pts;
+            break;
+        }
+    for (std::size_t i = mid + 1; i-- > 1 && at - index.gops[i].pts <= window;)
+        if (clean_at(index, i, params)) {
+            if (!best || at - index.gops[i].pts <= *best - at)
+                best = index.gops[i].pts;
+            break;
+        }
+    return best;
+}
+
+std::optional<std::uint64_t> params_at(const GopView& index, Pts pts) noexcept
+{
+    if (index.gops.empty())
+        return std::nullopt;
+    const auto& g = index.gops[gop_at(index, pts)];
+    if (g.param_set >= index.param_sets.size())
+        return std::nullopt;
+    return index.param_sets[g.param_set];
+}
+
+SplicePlan plan_splice(const GopView& index, Pts pts)
+{
+    const std::size_t i = gop_at(index, pts);
+    const auto& g = index.gops[i];
+    SplicePlan plan;
+    plan.pts = pts;
+    plan.clean = g.pts == pts && (g.flags & kGopClosed);
+    plan.straddle.start_pts = g.pts;
+    plan.straddle.begin_offset = g.offset;
+    if (i + 1 < index.gops.size()) {
+        plan.straddle.end_pts = index.gops[i + 1].pts;
+        plan.straddle.end_offset = index.gops[i + 1].offset;
+    } else {
+        plan.straddle.end_pts = std::max(index.duration_pts, g.pts);
+        plan.straddle.end_offset = index.file_size;
+    }
+    return plan;
+}
+
+std::filesystem::path bridge_dir(const std::filesystem::path& media)
+{
+    auto dir = media;
+    dir += ".splice";
+    return dir;
+}
+
+std::filesystem::path bridge_path(const std::filesystem::path& media, const ContentHash& hash, Pts pts,
+                                  BridgeEnd end)
+{
+    return bridge_dir(media) / (hash.to_hex().substr(0, 16) + "-" + std::to_string(pts) +
+                  (end == BridgeEnd::Head ? "-head.ts" : "-tail.ts"));
+}
+
+void encode_bridge(TranscodeBackend& backend, const std::filesystem::path& media, const ContentHash& hash,
+                   const SplicePlan& plan, BridgeEnd end)
+{
+    trace::Span span("splice.bridge", static_cast<std::uint64_t>(plan.pts));
+    const auto path = bridge_path(media, hash, plan.pts, end);
+    std::filesystem::create_directories(path.parent_path());
+    auto tmp = path;
+    tmp += ".tmp";
+    const Rendition rendition = bridge_rendition();
+    ChunkJob job;
+    job.source = media;
+    job.start_pts = end == BridgeEnd::Head ? plan.straddle.start_pts : plan.pts;
+    job.end_pts = end == BridgeEnd::Head ? plan.pts : plan.straddle.end_pts;
+    job.rendition = &rendition;
+    job.output = tmp;
+    backend.encode_chunk(job);
+    std::filesystem::rename(tmp, path);
+}
+
+std::size_t prepare_bridges(Library& library, const Timeline& timeline, Pts from, Pts until,
+                            TranscodeBackend& backend)
+{
+    const auto& catalog = timeline.catalog();
+    std::size_t encoded = 0;
+    for (const auto& entry : timeline.entries()) {
+        if (entry.end_pts() <= from || !(entry.flags & kEntrySplit))
+            continue;
+        if (entry.start_pts >= until)
+            break;
+        const auto& record = catalog.episode(entry.episode_id);
+        const std::filesystem::path media(catalog.path(record));
+        try {
+            const auto index = library.gop_index(catalog, record);
+            if (index->container() != Container::MpegTs || index->gops().empty())
+                continue;
+            auto bridge = [&](Pts pts, BridgeEnd end) {
+                if (pts <= 0 || pts >= record.duration_pts)
+                    return;
+                const auto plan = plan_splice(index->view(), pts);
+                if (plan.clean || std::filesystem::exists(bridge_path(media, record.hash, pts, end)))
+                    return;
+                encode_bridge(backend, media, record.hash, plan, end);
+                ++encoded;
+            };
+            bridge(entry.in_pts, BridgeEnd::Tail);
+            bridge(entry.out_pts, BridgeEnd::Head);
+        } catch (const std::exception&) {
+            // Missing master or failed encode: playout falls back to a
+            // keyframe cut for this splice.
+        }
+    }
+    return encoded;
+}
+
+std::optional<Pts> choose_splice_point(Library& library, const Catalog& catalog, EpisodeId episode, Pts at,
+                                       Pts window, EpisodeId insert, Pts insert_in)
+{
+    try {
+        const auto program = library.gop_index(catalog, catalog.episode(episode));
+        const auto clip = library.gop_index(catalog, catalog.episode(insert));
+        if (const auto params = params_at(clip->view(), insert_in))
+            if (auto p = find_splice_point(program->view(), at, window, params))
+                return p;
+        // Different parameters still splice without re-encoding; the
+        // player resets its decoder at the discontinuity.
+        return find_splice_point(program->view(), at, window);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+} // namespace seinfeld_tv
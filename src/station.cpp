@@ -0,0 +1,143 @@
+#include "seinfeld_tv/station.hpp"
+
+#include "seinfeld_tv/splice.hpp"
+#include "seinfeld_tv/trace.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace seinfeld_tv {
+
+Library::Library(std::shared_ptr<const Catalog> catalog, std::size_t segment_budget)
+    : catalog_(std::make_unique<const std::shared_ptr<const Catalog>>(std::move(catalog))),
+      segments_(segment_budget)
+{
+}
+
+std::shared_ptr<const GopIndex> Library::gop_index(const Catalog& catalog, const EpisodeRecord& record)
+{
+    auto& shard = shard_of(record.hash);
+    std::promise<std::shared_ptr<const GopIndex>> promise;
+    std::shared_future<std::shared_ptr<const GopIndex>> future;
+    {
+        std::lock_guard lock(shard.mutex);
+        auto [it, inserted] = shard.indexes.try_emplace(record.hash);
+        if (!inserted)
+            future = it->second;
+        else
+            it->second = promise.get_future().share();
+    }
+    if (future.valid())
+        return future.get();
+
+    try {
+        trace::Span span("library.gop_index");
+        auto index = std::make_shared<const GopIndex>(
+            GopIndex::open_or_build(std::filesystem::path(catalog.path(record)), record.hash));
+        promise.set_value(index);
+        return index;
+    } catch (...) {
+        {
+            std::lock_guard lock(shard.mutex);
+            shard.indexes.erase(record.hash);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+}
+
+void Library::set_catalog(std::shared_ptr<const Catalog> catalog)
+{
+    std::unordered_set<ContentHash> live;
+    live.reserve(catalog->size());
+    for (const auto& r : catalog->episodes())
+        live.insert(r.hash);
+    catalog_.publish(std::make_unique<const std::shared_ptr<const Catalog>>(std::move(catalog)));
+
+    // Channels still airing old entries hold their own shared_ptr, so
+    // dropping ours only unmaps once the last user is done.
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        std::erase_if(shard.indexes, [&](const auto& kv) { return !live.contains(kv.first); });
+    }
+}
+
+std::size_t Library::cached_indexes() const
+{
+    std::size_t n = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        n += shard.indexes.size();
+    }
+    return n;
+}
+
+std::vector<ContentHash> Library::cached_index_hashes() const
+{
+    std::vector<ContentHash> out;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        for (const auto& kv : shard.indexes)
+            out.push_back(kv.first);
+    }
+    return out;
+}
+
+Station::Station(std::shared_ptr<const Catalog> catalog, std::size_t segment_budget)
+    : library_(std::move(catalog), segment_budget)
+{
+}
+
+Channel& Station::emplace_channel(std::string name, SchedulePlan plan)
+{
+    if (channel(name))
+        throw std::invalid_argument("station: duplicate channel " + name);
+    const auto id = static_cast<std::uint32_t>(channels_.size());
+    auto splices = [this](const Catalog& catalog, EpisodeId episode, Pts at, Pts window, EpisodeId insert,
+                          Pts insert_in) {
+        return choose_splice_point(library_, catalog, episode, at, window, insert, insert_in);
+    };
+    return *channels_.emplace_back(
+        std::make_unique<Channel>(id, std::move(name), library_.catalog(), std::move(plan), std::move(splices)));
+}
+
+Channel& Station::add_channel(std::string name, SchedulePlan plan, Pts from)
+{
+    auto& ch = emplace_channel(std::move(name), std::move(plan));
+    try {
+        ch.scheduler().rebuild(from);
+    } catch (...) {
+        channels_.pop_back();
+        throw;
+    }
+    return ch;
+}
+
+Channel& Station::add_channel(std::string name, SchedulePlan plan, std::vector<TimelineEntry> entries)
+{
+    auto& ch = emplace_channel(std::move(name), std::move(plan));
+    ch.scheduler().restore(std::move(entries));
+    return ch;
+}
+
+Channel* Station::channel(std::string_view name) noexcept
+{
+    auto it = std::find_if(channels_.begin(), channels_.end(), [&](const auto& ch) { return ch->name() == name; });
+    return it == channels_.end() ? nullptr : it->get();
+}
+
+void Station::set_catalog(std::shared_ptr<const Catalog> catalog, Pts from)
+{
+    library_.set_catalog(catalog);
+    for (auto& ch : channels_)
+        ch->scheduler().set_catalog(catalog, from);
+}
+
+void Station::rebuild(Pts from)
+{
+    for (auto& ch : channels_)
+        ch->scheduler().rebuild(from);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,84 @@
+#include "seinfeld_tv/subprocess.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace seinfeld_tv {
+
+Subprocess::Subprocess(const std::vector<std::string>& argv, Stdout out)
+{
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const auto& a : argv)
+        args.push_back(const_cast<char*>(a.c_str()));
+    args.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    UniqueFd child_end;
+    if (out == Stdout::Pipe) {
+        int fds[2];
+        if (::pipe2(fds, O_CLOEXEC) != 0) {
+            posix_spawn_file_actions_destroy(&actions);
+            throw_errno("pipe2");
+        }
+        stdout_.reset(fds[0]);
+        child_end.reset(fds[1]);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    } else if (out == Stdout::Null) {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+
+    int rc = ::posix_spawnp(&pid_, args[0], &actions, nullptr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) {
+        pid_ = -1;
+        throw std::system_error(rc, std::generic_category(), "posix_spawnp " + argv[0]);
+    }
+}
+
+Subprocess::Subprocess(Subprocess&& other) noexcept
+    : pid_(std::exchange(other.pid_, -1)), stdout_(std::move(other.stdout_))
+{
+}
+
+Subprocess::~Subprocess()
+{
+    if (pid_ > 0) {
+        ::kill(pid_, SIGKILL);
+        int status;
+        while (::waitpid(pid_, &status, 0) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+int Subprocess::wait()
+{
+    stdout_.reset();
+    int status = 0;
+    while (::waitpid(pid_, &status, 0) < 0) {
+        if (errno != EINTR)
+            throw_errno("waitpid");
+    }
+    pid_ = -1;
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WEXITSTATUS(status);
+}
+
+void run_process(const std::vector<std::string>& argv)
+{
+    Subprocess child(argv);
+    if (int status = child.wait(); status != 0)
+        throw std::runtime_error(argv[0] + " exited with status " + std::to_string(status));
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,479 @@
+#include "seinfeld_tv/subtitle_index.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/varint.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+namespace seinfeld_tv {
+
+using namespace subtitle_format;
+
+namespace {
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("subtitles: ") + what);
+}
+
+constexpr std::uint64_t align8(std::uint64_t v) noexcept
+{
+    return (v + 7) & ~std::uint64_t{7};
+}
+
+std::string_view next_line(std::string_view& text) noexcept
+{
+    const auto nl = text.find('\n');
+    std::string_view line = text.substr(0, nl);
+    text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return line;
+}
+
+/// "HH:MM:SS,mmm" (or with '.') to PTS.
+std::optional<Pts> parse_srt_time(std::string_view s) noexcept
+{
+    unsigned h = 0, m = 0, sec = 0, ms = 0;
+    auto field = [&](unsigned& out, char sep) {
+        auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+        if (ec != std::errc())
+            return false;
+        s.remove_prefix(static_cast<std::size_t>(p - s.data()));
+        if (sep == 0)
+            return true;
+        if (s.empty() || (s.front() != sep && !(sep == ',' && s.front() == '.')))
+            return false;
+        s.remove_prefix(1);
+        return true;
+    };
+    if (!field(h, ':') || !field(m, ':') || !field(sec, ',') || !field(ms, 0) || m > 59 || sec > 59)
+        return std::nullopt;
+    return pts_from_ms((std::int64_t{h} * 3600 + m * 60 + sec) * 1000 + ms);
+}
+
+std::string_view trim(std::string_view s) noexcept
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// Appends `line` to `out` without <html> or {ass} markup.
+void append_text(std::string& out, std::string_view line)
+{
+    if (!out.empty())
+        out.push_back(' ');
+    char closing = 0;
+    for (char c : line) {
+        if (closing) {
+            if (c == closing)
+                closing = 0;
+        } else if (c == '<') {
+            closing = '>';
+        } else if (c == '{') {
+            closing = '}';
+        } else {
+            out.push_back(c);
+        }
+    }
+}
+
+/// Walks one term's postings.
+class PostingCursor {
+public:
+    PostingCursor(const std::uint8_t* p, const TermRecord& term, std::span<const SkipEntry> skips,
+                  std::size_t cue_count) noexcept
+        : base_(p), p_(p), end_(p + term.postings_size), total_(term.cue_count), skips_(skips),
+          cue_count_(cue_count)
+    {
+    }
+
+    std::uint64_t cue() const noexcept { return cue_; }
+
+    bool next() noexcept
+    {
+        std::uint64_t delta, count;
+        if (consumed_ == total_ || !varint::get(p_, end_, delta) || !varint::get(p_, end_, count))
+            return false;
+        cue_ = consumed_ == 0 ? delta : cue_ + delta;
+        ++consumed_;
+        positions_ = p_;
+        position_count_ = count;
+        for (std::uint64_t i = 0; i < count; ++i) {
+            std::uint64_t skip;
+            if (!varint::get(p_, end_, skip))
+                return false;
+        }
+        return cue_ < cue_count_;
+    }
+
+    /// Advances to the first posting at or after `target`.
+    bool seek(std::uint64_t target) noexcept
+    {
+        if (cue_ >= target)
+            return true;
+        // Only search the skips when the next one is still short of the
+        // target; nearby targets are cheaper to decode to.
+        const std::size_t next_skip = consumed_ / kSkipInterval;
+        if (next_skip < skips_.size() && skips_[next_skip].last_cue < target) {
+            auto it = std::partition_point(skips_.begin() + static_cast<std::ptrdiff_t>(next_skip), skips_.end(),
+                [&](const SkipEntry& s) { return s.last_cue < target; });
+            const auto k = static_cast<std::size_t>(it - skips_.begin() - 1);
+            const std::size_t index = (k + 1) * kSkipInterval;
+            if (index > consumed_) {
+                p_ = base_ + skips_[k].byte_offset;
+                cue_ = skips_[k].last_cue;
+                consumed_ = index;
+            }
+        }
+        while (cue_ < target)
+            if (!next())
+                return false;
+        return true;
+    }
+
+    void positions(std::vector<std::uint64_t>& out) const
+    {
+        out.clear();
+        const std::uint8_t* p = positions_;
+        std::uint64_t pos = 0;
+        for (std::uint64_t i = 0; i < position_count_; ++i) {
+            std::uint64_t delta = 0;
+            varint::get(p, end_, delta);
+            pos += delta;
+            out.push_back(pos);
+        }
+    }
+
+private:
+    const std::uint8_t* base_;
+    const std::uint8_t* p_;
+    const std::uint8_t* end_;
+    std::size_t total_;
+    std::span<const SkipEntry> skips_;
+    std::size_t cue_count_;
+    std::size_t consumed_ = 0;
+    std::uint64_t cue_ = 0;
+    const std::uint8_t* positions_ = nullptr;
+    std::uint64_t position_count_ = 0;
+};
+
+std::size_t skip_count(std::uint32_t cue_count) noexcept
+{
+    return cue_count == 0 ? 0 : (cue_count - 1) / kSkipInterval;
+}
+
+} // namespace
+
+std::vector<SubtitleCue> parse_srt(std::string_view srt)
+{
+    if (srt.starts_with("\xEF\xBB\xBF"))
+        srt.remove_prefix(3);
+    std::vector<SubtitleCue> cues;
+    while (!srt.empty()) {
+        std::string_view line = next_line(srt);
+        if (trim(line).empty())
+            continue;
+        // The counter line is optional in the wild; accept a block that
+        // starts directly with its timing line.
+        if (line.find("-->") == std::string_view::npos)
+            line = next_line(srt);
+        const auto arrow = line.find("-->");
+        if (arrow == std::string_view::npos)
+            continue;
+        auto start = parse_srt_time(trim(line.substr(0, arrow)));
+        auto rest = trim(line.substr(arrow + 3));
+        auto end = parse_srt_time(rest.substr(0, rest.find(' ')));
+
+        SubtitleCue cue;
+        while (!srt.empty()) {
+            std::string_view text = next_line(srt);
+            if (trim(text).empty())
+                break;
+            append_text(cue.text, trim(text));
+        }
+        if (!start || !end || *end < *start || cue.text.empty())
+            continue;
+        cue.start_pts = *start;
+        cue.end_pts = *end;
+        cues.push_back(std::move(cue));
+    }
+    return cues;
+}
+
+std::vector<std::string> subtitle_terms(std::string_view text)
+{
+    std::vector<std::string> terms;
+    std::string current;
+    auto flush = [&] {
+        if (!current.empty())
+            terms.push_back(std::move(current));
+        current.clear();
+    };
+    for (char c : text) {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+            current.push_back(c);
+        else if (c >= 'A' && c <= 'Z')
+            current.push_back(static_cast<char>(c - 'A' + 'a'));
+        else if (c != '\'')
+            flush();
+    }
+    flush();
+    return terms;
+}
+
+std::filesystem::path SubtitleIndex::path_for(const std::filesystem::path& catalog)
+{
+    auto p = catalog;
+    p += ".subs";
+    return p;
+}
+
+SubtitleIndex::SubtitleIndex(const std::filesystem::path& path)
+    : file_(path)
+{
+    if (file_.size() < sizeof(SubtitleHeader))
+        corrupt("truncated header");
+    header_ = reinterpret_cast<const SubtitleHeader*>(file_.data());
+    if (std::memcmp(header_->magic, kMagic, sizeof kMagic) != 0)
+        corrupt("bad magic");
+    if (header_->version != kVersion || header_->header_size != sizeof(SubtitleHeader))
+        corrupt("unsupported version");
+    if (header_->file_size != file_.size())
+        corrupt("size mismatch");
+
+    auto in_bounds = [&](std::uint64_t offset, std::uint64_t size) {
+        return offset <= file_.size() && size <= file_.size() - offset;
+    };
+    if (header_->cues_offset % alignof(CueRecord) || header_->terms_offset % alignof(TermRecord)
+        || !in_bounds(header_->cues_offset, std::uint64_t{header_->cue_count} * sizeof(CueRecord))
+        || !in_bounds(header_->terms_offset, std::uint64_t{header_->term_count} * sizeof(TermRecord))
+        || header_->skips_offset % alignof(SkipEntry)
+        || !in_bounds(header_->skips_offset, std::uint64_t{header_->skip_count} * sizeof(SkipEntry))
+        || !in_bounds(header_->postings_offset, header_->postings_size)
+        || !in_bounds(header_->strings_offset, header_->strings_size))
+        corrupt("section out of bounds");
+
+    cues_ = {reinterpret_cast<const CueRecord*>(file_.data() + header_->cues_offset), header_->cue_count};
+    terms_ = {reinterpret_cast<const TermRecord*>(file_.data() + header_->terms_offset), header_->term_count};
+    skips_ = {reinterpret_cast<const SkipEntry*>(file_.data() + header_->skips_offset), header_->skip_count};
+    postings_ = reinterpret_cast<const std::uint8_t*>(file_.data() + header_->postings_offset);
+    strings_ = reinterpret_cast<const char*>(file_.data() + header_->strings_offset);
+
+    auto check_string = [&](std::uint32_t offset, std::uint32_t length) {
+        if (std::uint64_t{offset} + length > header_->strings_size)
+            corrupt("string out of bounds");
+    };
+    for (const auto& c : cues_)
+        check_string(c.text_offset, c.text_length);
+    for (std::size_t i = 0; i < terms_.size(); ++i) {
+        const auto& t = terms_[i];
+        check_string(t.string_offset, t.string_length);
+        if (t.postings_offset + t.postings_size > header_->postings_size
+            || std::uint64_t{t.first_skip} + skip_count(t.cue_count) > skips_.size())
+            corrupt("postings out of bounds");
+        for (const auto& skip : skips_.subspan(t.first_skip, skip_count(t.cue_count)))
+            if (skip.byte_offset >= t.postings_size)
+                corrupt("skip out of bounds");
+        if (i > 0 && !(string_at(terms_[i - 1].string_offset, terms_[i - 1].string_length)
+                       < string_at(t.string_offset, t.string_length)))
+            corrupt("terms not sorted");
+    }
+}
+
+const TermRecord* SubtitleIndex::find_term(std::string_view term) const noexcept
+{
+    auto it = std::lower_bound(terms_.begin(), terms_.end(), term, [&](const TermRecord& t, std::string_view key) {
+        return string_at(t.string_offset, t.string_length) < key;
+    });
+    if (it == terms_.end() || string_at(it->string_offset, it->string_length) != term)
+        return nullptr;
+    return &*it;
+}
+
+std::vector<SubtitleHit> SubtitleIndex::search(std::string_view phrase, std::size_t limit) const
+{
+    std::vector<SubtitleHit> hits;
+    const auto words = subtitle_terms(phrase);
+    if (words.empty() || limit == 0)
+        return hits;
+
+    std::vector<PostingCursor> cursors;
+    cursors.reserve(words.size());
+    for (const auto& w : words) {
+        const TermRecord* term = find_term(w);
+        if (!term)
+            return hits;
+        cursors.emplace_back(postings_ + term->postings_offset, *term,
+                             skips_.subspan(term->first_skip, skip_count(term->cue_count)), cues_.size());
+    }
+
+    // Leapfrog intersection on cue id, then check word positions line up.
+    for (auto& c : cursors)
+        if (!c.next())
+            return hits;
+    std::vector<std::vector<std::uint64_t>> positions(cursors.size());
+    for (;;) {
+        std::uint64_t target = 0;
+        for (const auto& c : cursors)
+            target = std::max(target, c.cue());
+        bool aligned = true;
+        for (auto& c : cursors) {
+            if (!c.seek(target))
+                return hits;
+            aligned &= c.cue() == target;
+        }
+        if (!aligned)
+            continue;
+
+        for (std::size_t i = 0; i < cursors.size(); ++i)
+            cursors[i].positions(positions[i]);
+        const bool match = std::any_of(positions[0].begin(), positions[0].end(), [&](std::uint64_t start) {
+            for (std::size_t i = 1; i < positions.size(); ++i)
+                if (!std::binary_search(positions[i].begin(), positions[i].end(), start + i))
+                    return false;
+            return true;
+        });
+        if (match) {
+            const auto& cue = cues_[target];
+            hits.push_back({cue.episode_id, cue.start_pts, cue.end_pts, string_at(cue.text_offset, cue.text_length),
+                            (cue.flags & kCueClip) != 0});
+            if (hits.size() == limit)
+                return hits;
+        }
+        if (!cursors[0].next())
+            return hits;
+    }
+}
+
+void SubtitleIndexBuilder::add_cues(EpisodeId episode, std::span<const SubtitleCue> cues)
+{
+    for (const auto& c : cues)
+        cues_.push_back({episode, 0, c});
+}
+
+void SubtitleIndexBuilder::add_clips(const Catalog& catalog)
+{
+    for (const auto& clip : catalog.clips())
+        cues_.push_back({clip.episode_id, kCueClip, {clip.in_pts, clip.out_pts, std::string(catalog.label(clip))}});
+}
+
+void SubtitleIndexBuilder::write(const std::filesystem::path& path, std::uint64_t catalog_generation) const
+{
+    std::vector<const Pending*> order;
+    order.reserve(cues_.size());
+    for (const auto& c : cues_)
+        order.push_back(&c);
+    std::stable_sort(order.begin(), order.end(), [](const Pending* a, const Pending* b) {
+        return std::tie(a->episode, a->cue.start_pts) < std::tie(b->episode, b->cue.start_pts);
+    });
+
+    struct TermPostings {
+        std::uint32_t cue_count = 0;
+        std::uint64_t last_cue = 0;
+        std::vector<std::uint8_t> bytes;
+        std::vector<SkipEntry> skips;
+    };
+    std::unordered_map<std::string, TermPostings> postings;
+    std::string strings;
+    auto intern = [&](std::string_view s, std::uint32_t& offset, std::uint32_t& length) {
+        if (strings.size() + s.size() > UINT32_MAX)
+            throw std::runtime_error("subtitles: string table too large");
+        offset = static_cast<std::uint32_t>(strings.size());
+        length = static_cast<std::uint32_t>(s.size());
+        strings.append(s);
+    };
+
+    std::vector<CueRecord> cues(order.size());
+    std::unordered_map<std::string, std::vector<std::uint64_t>> cue_terms;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const Pending& p = *order[i];
+        auto& r = cues[i];
+        r.start_pts = p.cue.start_pts;
+        r.end_pts = p.cue.end_pts;
+        r.episode_id = p.episode;
+        r.flags = p.flags;
+        intern(p.cue.text, r.text_offset, r.text_length);
+
+        cue_terms.clear();
+        const auto words = subtitle_terms(p.cue.text);
+        for (std::size_t pos = 0; pos < words.size(); ++pos)
+            cue_terms[words[pos]].push_back(pos);
+        for (auto& [word, positions] : cue_terms) {
+            auto& t = postings[word];
+            if (t.cue_count > 0 && t.cue_count % kSkipInterval == 0)
+                t.skips.push_back({static_cast<std::uint32_t>(t.last_cue), static_cast<std::uint32_t>(t.bytes.size())});
+            varint::put(t.bytes, t.cue_count == 0 ? i : i - t.last_cue);
+            varint::put(t.bytes, positions.size());
+            std::uint64_t prev = 0;
+            for (auto pos : positions) {
+                varint::put(t.bytes, pos - prev);
+                prev = pos;
+            }
+            t.last_cue = i;
+            ++t.cue_count;
+        }
+    }
+
+    std::vector<const std::pair<const std::string, TermPostings>*> sorted;
+    sorted.reserve(postings.size());
+    for (const auto& kv : postings)
+        sorted.push_back(&kv);
+    std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    std::vector<TermRecord> terms(sorted.size());
+    std::vector<SkipEntry> skips;
+    std::vector<std::uint8_t> blob;
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const auto& [word, t] = *sorted[i];
+        auto& r = terms[i];
+        intern(word, r.string_offset, r.string_length);
+        r.cue_count = t.cue_count;
+        r.postings_offset = blob.size();
+        r.postings_size = static_cast<std::uint32_t>(t.bytes.size());
+        r.first_skip = static_cast<std::uint32_t>(skips.size());
+        skips.insert(skips.end(), t.skips.begin(), t.skips.end());
+        blob.insert(blob.end(), t.bytes.begin(), t.bytes.end());
+    }
+
+    SubtitleHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof kMagic);
+    header.version = kVersion;
+    header.header_size = sizeof header;
+    header.catalog_generation = catalog_generation;
+    header.cue_count = static_cast<std::uint32_t>(cues.size());
+    header.term_count = static_cast<std::uint32_t>(terms.size());
+    header.cues_offset = sizeof header;
+    header.terms_offset = header.cues_offset + cues.size() * sizeof(CueRecord);
+    header.skips_offset = header.terms_offset + terms.size() * sizeof(TermRecord);
+    header.skip_count = static_cast<std::uint32_t>(skips.size());
+    header.postings_offset = header.skips_offset + skips.size() * sizeof(SkipEntry);
+    header.postings_size = blob.size();
+    header.strings_offset = align8(header.postings_offset + blob.size());
+    header.strings_size = strings.size();
+    header.file_size = header.strings_offset + strings.size();
+
+    std::vector<std::byte> image(header.file_size);
+    auto put = [&](std::uint64_t offset, const void* data, std::size_t size) {
+        if (size > 0)
+            std::memcpy(image.data() + offset, data, size);
+    };
+    put(0, &header, sizeof header);
+    put(header.cues_offset, cues.data(), cues.size() * sizeof(CueRecord));
+    put(header.terms_offset, terms.data(), terms.size() * sizeof(TermRecord));
+    put(header.skips_offset, skips.data(), skips.size() * sizeof(SkipEntry));
+    put(header.postings_offset, blob.data(), blob.size());
+    put(header.strings_offset, strings.data(), strings.size());
+    write_file_atomic(path, image);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,149 @@
+#include "seinfeld_tv/task_graph.hpp"
+
+#include <algorithm>
+
+namespace seinfeld_tv {
+
+namespace {
+
+std::int64_t steady_ns() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+TaskGraph::NodeId TaskGraph::add_locked(std::string_view stage, std::function<void()> fn)
+{
+    auto it = std::find(stages_.begin(), stages_.end(), stage);
+    if (it == stages_.end())
+        it = stages_.insert(stages_.end(), std::string(stage));
+    Node& n = nodes_.emplace_back();
+    n.graph = this;
+    n.fn = std::move(fn);
+    n.stage = static_cast<std::size_t>(it - stages_.begin());
+    return nodes_.size() - 1;
+}
+
+TaskGraph::NodeId TaskGraph::add(std::string_view stage, std::function<void()> fn)
+{
+    std::lock_guard lock(mutex_);
+    return add_locked(stage, std::move(fn));
+}
+
+void TaskGraph::precede(NodeId before, NodeId after)
+{
+    std::lock_guard lock(mutex_);
+    nodes_[before].successors.push_back(&nodes_[after]);
+    nodes_[after].pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+TaskGraph::NodeId TaskGraph::add_child(std::string_view stage, std::function<void()> fn, NodeId join)
+{
+    Node* child;
+    NodeId id;
+    {
+        std::lock_guard lock(mutex_);
+        id = add_locked(stage, std::move(fn));
+        child = &nodes_[id];
+        child->successors.push_back(&nodes_[join]);
+        nodes_[join].pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    remaining_.fetch_add(1, std::memory_order_relaxed);
+    pool_->submit(child);
+    return id;
+}
+
+void TaskGraph::on_progress(Progress fn, std::chrono::milliseconds interval)
+{
+    progress_ = std::move(fn);
+    progress_interval_ = interval;
+}
+
+void TaskGraph::run(WorkStealingPool& pool)
+{
+    pool_ = &pool;
+    std::vector<Node*> roots;
+    {
+        std::lock_guard lock(mutex_);
+        remaining_.store(nodes_.size(), std::memory_order_relaxed);
+        for (auto& n : nodes_)
+            if (n.pending.load(std::memory_order_relaxed) == 0)
+                roots.push_back(&n);
+    }
+    if (roots.empty())
+        return;
+    for (Node* n : roots)
+        pool.submit(n);
+
+    {
+        std::unique_lock lock(done_mutex_);
+        done_cv_.wait(lock, [&] { return complete_; });
+    }
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+void TaskGraph::Node::run()
+{
+    if (!graph->failed_.load(std::memory_order_relaxed)) {
+        start = std::chrono::steady_clock::now();
+        try {
+            fn();
+        } catch (...) {
+            if (!graph->failed_.exchange(true))
+                graph->error_ = std::current_exception();
+        }
+        end = std::chrono::steady_clock::now();
+    }
+    fn = nullptr;
+    graph->finished(*this);
+}
+
+void TaskGraph::finished(Node& n)
+{
+    for (Node* s : n.successors)
+        if (s->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            pool_->submit(s);
+
+    const std::uint64_t done = done_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (progress_) {
+        const std::int64_t now = steady_ns();
+        std::int64_t due = next_progress_ns_.load(std::memory_order_relaxed);
+        if (now >= due && next_progress_ns_.compare_exchange_strong(
+                due, now + std::chrono::nanoseconds(progress_interval_).count()))
+            progress_(done, done + remaining_.load(std::memory_order_relaxed) - 1);
+    }
+
+    // Notify under the lock: once run() observes completion the graph may
+    // be destroyed, so nothing here may touch it after unlocking.
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard lock(done_mutex_);
+        complete_ = true;
+        done_cv_.notify_all();
+    }
+}
+
+std::vector<StageStats> TaskGraph::stats() const
+{
+    std::lock_guard lock(mutex_);
+    std::vector<StageStats> out(stages_.size());
+    for (std::size_t i = 0; i < stages_.size(); ++i)
+        out[i].name = stages_[i];
+    for (const auto& n : nodes_) {
+        if (n.end == std::chrono::steady_clock::time_point{})
+            continue;
+        auto& s = out[n.stage];
+        const auto took = std::chrono::duration_cast<std::chrono::nanoseconds>(n.end - n.start);
+        if (s.tasks == 0 || n.start < s.first_start)
+            s.first_start = n.start;
+        s.last_end = std::max(s.last_end, n.end);
+        s.longest = std::max(s.longest, took);
+        s.busy += took;
+        ++s.tasks;
+    }
+    return out;
+}
+
+} // namespace seinfeld_tv
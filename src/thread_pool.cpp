@@ -0,0 +1,129 @@
+#include "seinfeld_tv/thread_pool.hpp"
+
+#include "seinfeld_tv/trace.hpp"
+
+#include <string>
+
+namespace seinfeld_tv {
+
+namespace {
+
+struct WorkerIdentity {
+    const WorkStealingPool* pool = nullptr;
+    int index = -1;
+};
+
+thread_local WorkerIdentity t_worker;
+
+/// Spins before parking; stealing attempts are cheap compared with a
+/// futex round trip when work arrives in bursts.
+constexpr int kSpinRounds = 64;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = 1;
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        workers_.push_back(std::make_unique<Worker>());
+    for (unsigned i = 0; i < threads; ++i)
+        workers_[i]->thread = std::thread([this, i] { worker_loop(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    stop_.store(true, std::memory_order_seq_cst);
+    signal_.fetch_add(1, std::memory_order_seq_cst);
+    signal_.notify_all();
+    for (auto& w : workers_)
+        w->thread.join();
+}
+
+int WorkStealingPool::current_worker() const noexcept
+{
+    return t_worker.pool == this ? t_worker.index : -1;
+}
+
+void WorkStealingPool::submit(PoolTask* task)
+{
+    if (int self = current_worker(); self >= 0) {
+        workers_[static_cast<std::size_t>(self)]->deque.push(task);
+    } else {
+        std::lock_guard lock(inject_mutex_);
+        injected_.push_back(task);
+        injected_count_.fetch_add(1, std::memory_order_release);
+    }
+    notify();
+}
+
+void WorkStealingPool::notify() noexcept
+{
+    signal_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) > 0)
+        signal_.notify_one();
+}
+
+PoolTask* WorkStealingPool::find_work(unsigned index, std::uint64_t& rng) noexcept
+{
+    if (PoolTask* t = workers_[index]->deque.pop())
+        return t;
+
+    if (injected_count_.load(std::memory_order_acquire) > 0) {
+        std::lock_guard lock(inject_mutex_);
+        if (!injected_.empty()) {
+            PoolTask* t = injected_.front();
+            injected_.pop_front();
+            injected_count_.fetch_sub(1, std::memory_order_relaxed);
+            return t;
+        }
+    }
+
+    const std::size_t n = workers_.size();
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    const std::size_t start = static_cast<std::size_t>(rng % n);
+    for (std::size_t k = 0; k < n; ++k) {
+        const std::size_t victim = (start + k) % n;
+        if (victim == index)
+            continue;
+        if (PoolTask* t = workers_[victim]->deque.steal())
+            return t;
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::worker_loop(unsigned index)
+{
+    t_worker = {this, static_cast<int>(index)};
+    trace::set_thread_name("pool-" + std::to_string(index));
+    std::uint64_t rng = 0x9e3779b97f4a7c15ull * (index + 1);
+
+    while (!stop_.load(std::memory_order_acquire)) {
+        PoolTask* task = nullptr;
+        for (int spin = 0; spin < kSpinRounds && !task; ++spin) {
+            task = find_work(index, rng);
+            if (!task)
+                std::this_thread::yield();
+        }
+        if (task) {
+            task->run();
+            continue;
+        }
+
+        // Park. Read the signal before the final check so a submit that
+        // races with us bumps it and the wait returns immediately.
+        const std::uint32_t seen = signal_.load(std::memory_order_seq_cst);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        task = find_work(index, rng);
+        if (!task && !stop_.load(std::memory_order_acquire))
+            signal_.wait(seen, std::memory_order_seq_cst);
+        sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+        if (task)
+            task->run();
+    }
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,389 @@
+#include "seinfeld_tv/thumbnails.hpp"
+
+#include "seinfeld_tv/gop_index.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/subprocess.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if SEINFELD_TV_HAVE_JPEG
+#include <jpeglib.h>
+#endif
+
+namespace seinfeld_tv {
+
+namespace {
+
+double ms(std::chrono::nanoseconds ns)
+{
+    return std::chrono::duration<double, std::milli>(ns).count();
+}
+
+/// WebVTT cue time, "HH:MM:SS.mmm".
+std::string cue_time(Pts pts)
+{
+    const auto total = pts_to_ms(pts);
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%02lld:%02lld:%02lld.%03lld", static_cast<long long>(total / 3'600'000),
+                  static_cast<long long>(total / 60'000 % 60), static_cast<long long>(total / 1000 % 60),
+                  static_cast<long long>(total % 1000));
+    return buf;
+}
+
+std::string sheet_name(std::size_t i)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "sprite-%03zu.jpg", i);
+    return buf;
+}
+
+/// One source's thumbnails, filled in by its index task, written by the
+/// decode tasks one batch each and read by its pack task.
+struct EpisodeWork {
+    const LadderSource* source = nullptr;
+    std::filesystem::path dir;
+    std::shared_ptr<const MappedFile> media;
+    Container container = Container::Unknown;
+    std::vector<FileExtent> init;
+    std::vector<GopEntry> gops;        ///< the GOPs whose keyframes are decoded
+    std::vector<std::uint32_t> tiles;  ///< per interval, index into gops
+    std::vector<FrameBatch> batches;   ///< options.batch keyframes each
+    Pts duration = 0;
+};
+
+/// A decoder input in the temp directory, not the output tree, removed
+/// however the decode ends.
+struct ScratchInput {
+    std::filesystem::path path;
+
+    explicit ScratchInput(Container container)
+    {
+        static std::atomic<std::uint64_t> next{0};
+        path = std::filesystem::temp_directory_path() /
+               ("stv-thumbs-" + std::to_string(::getpid()) + "-" + std::to_string(next.fetch_add(1)) +
+                (container == Container::Fmp4 ? ".mp4" : ".ts"));
+    }
+    ~ScratchInput()
+    {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+    ScratchInput(const ScratchInput&) = delete;
+    ScratchInput& operator=(const ScratchInput&) = delete;
+};
+
+void write_input(const std::filesystem::path& path, const EpisodeWork& w, std::size_t first, std::size_t last)
+{
+    UniqueFd fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if (!fd)
+        throw_errno("thumbnails: open");
+    const auto* base = w.media->data();
+    for (const auto& e : w.init)
+        write_all(fd.get(), base + e.offset, e.length);
+    for (std::size_t i = first; i < last; ++i)
+        write_all(fd.get(), base + w.gops[i].offset, w.gops[i].size);
+}
+
+void pack(const EpisodeWork& w, const ThumbnailOptions& options, std::atomic<std::uint64_t>& sheets)
+{
+    const int tw = options.width, th = options.height;
+    const std::size_t per_sheet = static_cast<std::size_t>(options.columns) * options.rows;
+    auto tile = [&](std::size_t k) {
+        const std::size_t g = w.tiles[k];
+        return w.batches[g / options.batch].frame(g % options.batch);
+    };
+
+    std::string vtt = "WEBVTT\n";
+    std::vector<std::uint8_t> sheet;
+    for (std::size_t first = 0; first < w.tiles.size(); first += per_sheet) {
+        const std::size_t n = std::min(per_sheet, w.tiles.size() - first);
+        const int cols = static_cast<int>(std::min<std::size_t>(n, options.columns));
+        const int rows = static_cast<int>((n + options.columns - 1) / options.columns);
+        const std::size_t stride = static_cast<std::size_t>(cols) * tw * 3;
+        sheet.assign(stride * rows * th, 0);
+        const auto name = sheet_name(first / per_sheet);
+        for (std::size_t i = 0; i < n; ++i) {
+            const int x = static_cast<int>(i % options.columns) * tw;
+            const int y = static_cast<int>(i / options.columns) * th;
+            const auto* src = tile(first + i);
+            for (int row = 0; row < th; ++row)
+                std::memcpy(sheet.data() + (y + row) * stride + x * 3, src + row * tw * 3, tw * 3);
+
+            const Pts from = static_cast<Pts>(first + i) * options.interval;
+            const Pts to = std::min(from + options.interval, w.duration);
+            vtt += '\n';
+            vtt += cue_time(from);
+            vtt += " --> ";
+            vtt += cue_time(to);
+            vtt += '\n';
+            vtt += name;
+            vtt += "#xywh=";
+            vtt += std::to_string(x);
+            vtt += ',';
+            vtt += std::to_string(y);
+            vtt += ',';
+            vtt += std::to_string(tw);
+            vtt += ',';
+            vtt += std::to_string(th);
+            vtt += '\n';
+        }
+        write_file_atomic(w.dir / name, encode_jpeg(sheet.data(), cols * tw, rows * th, options.quality));
+        sheets.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Last, so its presence means the directory is complete.
+    write_file_atomic(w.dir / "thumbs.vtt", std::as_bytes(std::span(vtt)));
+}
+
+} // namespace
+
+FfmpegFrameDecoder::FfmpegFrameDecoder(std::string ffmpeg, HwDecode hw, std::string vaapi_device)
+    : ffmpeg_(std::move(ffmpeg)), hw_(hw), vaapi_device_(std::move(vaapi_device))
+{
+}
+
+FrameBatch FfmpegFrameDecoder::decode(const FrameJob& job)
+{
+    if (hardware()) {
+        try {
+            return run(job, hw_);
+        } catch (const std::exception& e) {
+            if (!hw_failed_.exchange(true)) {
+                std::lock_guard lock(fallback_mutex_);
+                fallback_reason_ = e.what();
+            }
+        }
+    }
+    return run(job, HwDecode::None);
+}
+
+std::string FfmpegFrameDecoder::fallback_reason() const
+{
+    std::lock_guard lock(fallback_mutex_);
+    return fallback_reason_;
+}
+
+FrameBatch FfmpegFrameDecoder::run(const FrameJob& job, HwDecode hw) const
+{
+    const std::string w = std::to_string(job.width), h = std::to_string(job.height);
+    std::vector<std::string> argv = {ffmpeg_, "-nostdin", "-loglevel", "error", "-skip_frame", "nokey"};
+    std::string filter;
+    switch (hw) {
+    case HwDecode::None:
+        argv.insert(argv.end(), {"-threads", "1"});
+        filter = "scale=" + w + ":" + h;
+        break;
+    case HwDecode::Cuda:
+        argv.insert(argv.end(), {"-hwaccel", "cuda", "-hwaccel_output_format", "cuda"});
+        filter = "scale_cuda=" + w + ":" + h + ",hwdownload,format=nv12";
+        break;
+    case HwDecode::Vaapi:
+        argv.insert(argv.end(), {"-hwaccel", "vaapi", "-hwaccel_device", vaapi_device_, "-hwaccel_output_format", "vaapi"});
+        filter = "scale_vaapi=w=" + w + ":h=" + h + ":format=nv12,hwdownload,format=nv12";
+        break;
+    }
+    argv.insert(argv.end(), {"-i", job.input.string(), "-map", "0:v:0", "-an", "-sn", "-vf", filter, "-fps_mode",
+                             "passthrough", "-pix_fmt", "rgb24", "-f", "rawvideo", "-"});
+    Subprocess child(argv, Subprocess::Stdout::Pipe);
+
+    FrameBatch batch;
+    batch.width = job.width;
+    batch.height = job.height;
+    // One frame more than expected, so an over-long output is noticed.
+    batch.rgb.resize((job.keyframes + 1) * batch.frame_bytes());
+    std::size_t fill = 0;
+    for (;;) {
+        if (fill == batch.rgb.size())
+            batch.rgb.resize(batch.rgb.size() + batch.frame_bytes());
+        const ssize_t n = ::read(child.stdout_fd(), batch.rgb.data() + fill, batch.rgb.size() - fill);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("read");
+        }
+        if (n == 0)
+            break;
+        fill += static_cast<std::size_t>(n);
+    }
+    if (int status = child.wait(); status != 0)
+        throw std::runtime_error("thumbnails: " + ffmpeg_ + " exited with status " + std::to_string(status) +
+                                 " for " + job.input.string());
+    if (fill != job.keyframes * batch.frame_bytes())
+        throw std::runtime_error("thumbnails: expected " + std::to_string(job.keyframes) + " keyframes from " +
+                                 job.input.string() + ", got " + std::to_string(fill / batch.frame_bytes()));
+    batch.count = job.keyframes;
+    batch.rgb.resize(fill);
+    return batch;
+}
+
+#if SEINFELD_TV_HAVE_JPEG
+
+std::vector<std::byte> encode_jpeg(const std::uint8_t* rgb, int width, int height, int quality)
+{
+    jpeg_compress_struct cinfo{};
+    jpeg_error_mgr jerr{};
+    cinfo.err = jpeg_std_error(&jerr);
+    // libjpeg must not exit(); unwinding through it is safe as long as
+    // nothing it allocated outlives the destroy below.
+    jerr.error_exit = [](j_common_ptr c) {
+        char message[JMSG_LENGTH_MAX];
+        (*c->err->format_message)(c, message);
+        throw std::runtime_error(std::string("jpeg: ") + message);
+    };
+    unsigned char* out = nullptr;
+    unsigned long size = 0;
+    struct Cleanup {
+        jpeg_compress_struct* cinfo;
+        unsigned char** out;
+        ~Cleanup()
+        {
+            jpeg_destroy_compress(cinfo);
+            std::free(*out);
+        }
+    };
+
+    jpeg_create_compress(&cinfo);
+    Cleanup cleanup{&cinfo, &out};
+    jpeg_mem_dest(&cinfo, &out, &size);
+    cinfo.image_width = static_cast<JDIMENSION>(width);
+    cinfo.image_height = static_cast<JDIMENSION>(height);
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    const std::size_t stride = static_cast<std::size_t>(width) * 3;
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<JSAMPROW>(rgb + cinfo.next_scanline * stride);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    const auto* bytes = reinterpret_cast<const std::byte*>(out);
+    return {bytes, bytes + size};
+}
+
+#else
+
+std::vector<std::byte> encode_jpeg(const std::uint8_t*, int, int, int)
+{
+    throw std::runtime_error("thumbnails: built without libjpeg");
+}
+
+#endif
+
+ThumbnailReport build_thumbnails(std::span<const LadderSource> sources, FrameDecoder& decoder,
+                                 WorkStealingPool& pool, const ThumbnailOptions& options, ReportLog* log)
+{
+    if (options.interval <= 0 || options.width <= 0 || options.height <= 0 || options.columns <= 0 ||
+        options.rows <= 0 || options.batch == 0)
+        throw std::invalid_argument("thumbnails: options out of range");
+
+    char variant[64];
+    std::snprintf(variant, sizeof variant, "thumbs-%dx%d-%llds", options.width, options.height,
+                  static_cast<long long>(options.interval / kPtsPerSecond));
+    TaskGraph graph;
+    std::vector<std::unique_ptr<EpisodeWork>> work;
+    std::atomic<std::uint64_t> skipped{0}, sheets{0};
+
+    for (const auto& src : sources) {
+        auto& w = *work.emplace_back(std::make_unique<EpisodeWork>());
+        w.source = &src;
+        w.dir = options.output_dir / src.hash.to_hex() / variant;
+        auto join = graph.add("pack", [&w, &options, &sheets] {
+            if (!w.tiles.empty())
+                pack(w, options, sheets);
+        });
+
+        auto index = graph.add("index", [&graph, &decoder, &w, &options, &skipped, join] {
+            if (std::filesystem::exists(w.dir / "thumbs.vtt")) {
+                skipped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const auto gop = GopIndex::open_or_build(w.source->media, w.source->hash);
+            const auto& view = gop.view();
+            if (view.gops.empty())
+                throw std::runtime_error("thumbnails: no keyframes in " + w.source->media.string());
+            w.duration = view.duration_pts;
+            w.container = view.container;
+            w.init.assign(view.init.begin(), view.init.end());
+            // One tile per interval, from the GOP it falls in; a GOP that
+            // spans several intervals is decoded once.
+            const auto intervals = static_cast<std::size_t>(std::max<Pts>(
+                (view.duration_pts + options.interval - 1) / options.interval, 1));
+            std::size_t last = view.gops.size();
+            for (std::size_t k = 0; k < intervals; ++k) {
+                const auto g = gop.seek(static_cast<Pts>(k) * options.interval);
+                if (g != last) {
+                    w.gops.push_back(view.gops[g]);
+                    last = g;
+                }
+                w.tiles.push_back(static_cast<std::uint32_t>(w.gops.size() - 1));
+            }
+            w.media = std::make_shared<const MappedFile>(w.source->media);
+            std::filesystem::create_directories(w.dir);
+
+            const std::size_t batches = (w.gops.size() + options.batch - 1) / options.batch;
+            w.batches.resize(batches);
+            for (std::size_t b = 0; b < batches; ++b) {
+                graph.add_child("decode", [&decoder, &w, &options, b] {
+                    const std::size_t first = b * options.batch;
+                    const std::size_t last = std::min(first + options.batch, w.gops.size());
+                    const ScratchInput input(w.container);
+                    write_input(input.path, w, first, last);
+                    w.batches[b] = decoder.decode({input.path, last - first, options.width, options.height});
+                }, join);
+            }
+        });
+        graph.precede(index, join);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    if (log) {
+        graph.on_progress([log, started](std::uint64_t done, std::uint64_t total) {
+            char buf[128];
+            std::snprintf(buf, sizeof buf, "thumbs.progress done=%llu total=%llu elapsed_ms=%.0f",
+                          static_cast<unsigned long long>(done), static_cast<unsigned long long>(total),
+                          ms(std::chrono::steady_clock::now() - started));
+            log->line(buf);
+        });
+    }
+    graph.run(pool);
+
+    ThumbnailReport report;
+    report.wall = std::chrono::steady_clock::now() - started;
+    report.stages = graph.stats();
+    report.workers = pool.size();
+    report.sheets = sheets.load();
+    report.skipped = skipped.load();
+    report.fallback = decoder.fallback_reason();
+    for (const auto& s : report.stages)
+        report.tasks += s.tasks;
+
+    if (log) {
+        char buf[256];
+        for (const auto& s : report.stages) {
+            std::snprintf(buf, sizeof buf, "thumbs.stage name=%s tasks=%llu busy_ms=%.1f longest_ms=%.1f",
+                          s.name.c_str(), static_cast<unsigned long long>(s.tasks), ms(s.busy), ms(s.longest));
+            log->line(buf);
+        }
+        if (!report.fallback.empty())
+            log->line("thumbs.fallback software reason=\"" + report.fallback + "\"");
+        std::snprintf(buf, sizeof buf, "thumbs.total sources=%zu skipped=%llu sheets=%llu workers=%u wall_ms=%.1f",
+                      sources.size(), static_cast<unsigned long long>(report.skipped),
+                      static_cast<unsigned long long>(report.sheets), report.workers, ms(report.wall));
+        log->line(buf);
+    }
+    return report;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,28 @@
+#include "seinfeld_tv/timeline.hpp"
+
+#include <algorithm>
+
+namespace seinfeld_tv {
+
+std::optional<std::size_t> Timeline::index_at(Pts t) const noexcept
+{
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), t,
+        [](Pts key, const TimelineEntry& e) { return key < e.start_pts; });
+    if (it == entries_.begin())
+        return std::nullopt;
+    --it;
+    if (t >= it->end_pts())
+        return std::nullopt;
+    return static_cast<std::size_t>(it - entries_.begin());
+}
+
+std::optional<TimelinePosition> Timeline::at(Pts t) const noexcept
+{
+    auto index = index_at(t);
+    if (!index)
+        return std::nullopt;
+    const auto& e = entries_[*index];
+    return TimelinePosition{e, *index, t - e.start_pts};
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,272 @@
+#include "seinfeld_tv/trace.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+
+#include "json_detail.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace seinfeld_tv::trace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+constexpr std::uint64_t kMask = kRingEvents - 1;
+static_assert((kRingEvents & kMask) == 0, "ring size must be a power of two");
+
+enum Kind : std::uint64_t { kComplete = 0, kInstant = 1, kAsync = 2 };
+constexpr int kKindShift = 56;
+constexpr std::uint64_t kDurationMask = (std::uint64_t{1} << kKindShift) - 1;
+
+/// Fields are relaxed atomics so a concurrent export is a benign race, not
+/// undefined behaviour; on x86 they compile to plain moves.
+struct Slot {
+    std::atomic<std::uint64_t> ts;
+    std::atomic<std::uint64_t> duration_kind;
+    std::atomic<std::uintptr_t> name;
+    std::atomic<std::uint64_t> arg;
+};
+static_assert(sizeof(Slot) == 32);
+
+/// One thread's events. `claimed` moves before a slot is rewritten and
+/// `committed` after, so the exporter can tell which slots it copied
+/// were being overwritten underneath it.
+struct Ring {
+    alignas(64) std::atomic<std::uint64_t> claimed{0};
+    std::atomic<std::uint64_t> committed{0};
+    Slot slots[kRingEvents];
+    long tid = 0;
+    std::string name;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings; ///< kept after their thread exits
+};
+
+Registry& registry()
+{
+    static Registry r;
+    return r;
+}
+
+thread_local Ring* t_ring = nullptr;
+thread_local std::string t_name; ///< applied when the ring is created
+
+Ring& ring()
+{
+    if (!t_ring) {
+        auto r = std::make_unique<Ring>();
+        r->tid = ::syscall(SYS_gettid);
+        r->name = t_name;
+        auto& reg = registry();
+        std::lock_guard lock(reg.mutex);
+        t_ring = reg.rings.emplace_back(std::move(r)).get();
+    }
+    return *t_ring;
+}
+
+void record(const char* name, std::uint64_t ts, std::uint64_t duration, Kind kind, std::uint64_t arg) noexcept
+{
+    if (!enabled())
+        return;
+    Ring* r = t_ring;
+    if (!r) {
+        try {
+            r = &ring();
+        } catch (...) {
+            return;
+        }
+    }
+    const std::uint64_t i = r->claimed.load(std::memory_order_relaxed);
+    r->claimed.store(i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Slot& s = r->slots[i & kMask];
+    s.ts.store(ts, std::memory_order_relaxed);
+    s.duration_kind.store((duration & kDurationMask) | (std::uint64_t{kind} << kKindShift), std::memory_order_relaxed);
+    s.name.store(reinterpret_cast<std::uintptr_t>(name), std::memory_order_relaxed);
+    s.arg.store(arg, std::memory_order_relaxed);
+    r->committed.store(i + 1, std::memory_order_release);
+}
+
+std::uint64_t steady_ns() noexcept
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+/// Clock pair taken at enable(), against which export scales raw stamps.
+std::atomic<std::uint64_t> g_origin_ticks{0};
+std::atomic<std::uint64_t> g_origin_ns{0};
+
+using seinfeld_tv::detail::append_json_string;
+
+} // namespace
+
+std::uint64_t now() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return steady_ns();
+#endif
+}
+
+void enable(bool on) noexcept
+{
+    if (on && g_origin_ticks.load(std::memory_order_relaxed) == 0) {
+        g_origin_ns.store(steady_ns(), std::memory_order_relaxed);
+        g_origin_ticks.store(now(), std::memory_order_relaxed);
+    }
+    detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+void set_thread_name(std::string_view name)
+{
+    // Rings are only created on a thread's first event, so naming a thread
+    // that never records costs nothing.
+    t_name = name;
+    if (t_ring) {
+        std::lock_guard lock(registry().mutex);
+        t_ring->name = name;
+    }
+}
+
+void complete(const char* name, std::uint64_t begin, std::uint64_t arg) noexcept
+{
+    const std::uint64_t end = now();
+    record(name, begin, end - begin, kComplete, arg);
+}
+
+void instant(const char* name, std::uint64_t arg) noexcept
+{
+    record(name, now(), 0, kInstant, arg);
+}
+
+void async(const char* name, std::uint64_t begin, std::uint64_t arg) noexcept
+{
+    const std::uint64_t end = now();
+    record(name, begin, end - begin, kAsync, arg);
+}
+
+std::string export_chrome_json()
+{
+    // Scale raw stamps by the clock rate observed since enable().
+    const std::uint64_t origin_ticks = g_origin_ticks.load(std::memory_order_relaxed);
+    const std::uint64_t origin_ns = g_origin_ns.load(std::memory_order_relaxed);
+    const std::uint64_t ticks = now();
+    const std::uint64_t ns = steady_ns();
+    const double us_per_tick = ticks > origin_ticks && ns > origin_ns
+        ? static_cast<double>(ns - origin_ns) / static_cast<double>(ticks - origin_ticks) / 1000.0
+        : 0.001;
+    auto to_us = [&](std::uint64_t t) {
+        return static_cast<double>(static_cast<std::int64_t>(t - origin_ticks)) * us_per_tick;
+    };
+
+    const long pid = ::getpid();
+    std::string out;
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    char buf[256];
+    std::uint64_t async_id = 0;
+    std::vector<Slot> copy(kRingEvents);
+
+    auto& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    for (const auto& r : reg.rings) {
+        if (!first)
+            out += ",\n";
+        first = false;
+        std::snprintf(buf, sizeof buf, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":",
+                      pid, r->tid);
+        out += buf;
+        append_json_string(out, r->name.empty() ? "thread-" + std::to_string(r->tid) : r->name);
+        out += "}}";
+
+        const std::uint64_t end = r->committed.load(std::memory_order_acquire);
+        const std::uint64_t begin = end > kRingEvents ? end - kRingEvents : 0;
+        for (std::uint64_t i = begin; i < end; ++i) {
+            const Slot& s = r->slots[i & kMask];
+            Slot& c = copy[i & kMask];
+            c.ts.store(s.ts.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            c.duration_kind.store(s.duration_kind.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            c.name.store(s.name.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            c.arg.store(s.arg.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Anything the writer claimed since may have landed on the oldest
+        // slots we copied.
+        const std::uint64_t claimed = r->claimed.load(std::memory_order_relaxed);
+        const std::uint64_t valid = std::max(begin, claimed > kRingEvents ? claimed - kRingEvents : 0);
+
+        for (std::uint64_t i = valid; i < end; ++i) {
+            const Slot& c = copy[i & kMask];
+            const auto* name = reinterpret_cast<const char*>(c.name.load(std::memory_order_relaxed));
+            const std::uint64_t dk = c.duration_kind.load(std::memory_order_relaxed);
+            const auto kind = static_cast<Kind>(dk >> kKindShift);
+            const double ts = to_us(c.ts.load(std::memory_order_relaxed));
+            const double dur = static_cast<double>(dk & kDurationMask) * us_per_tick;
+            const std::string_view full(name);
+            const auto dot = full.find('.');
+            const std::string_view category = dot == std::string_view::npos ? full : full.substr(0, dot);
+            const auto arg = static_cast<unsigned long long>(c.arg.load(std::memory_order_relaxed));
+
+            out += ",\n{\"name\":";
+            append_json_string(out, full);
+            out += ",\"cat\":";
+            append_json_string(out, category);
+            switch (kind) {
+            case kInstant:
+                std::snprintf(buf, sizeof buf, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld,\"args\":{\"arg\":%llu}}",
+                              ts, pid, r->tid, arg);
+                out += buf;
+                break;
+            case kAsync: {
+                const auto id = static_cast<unsigned long long>(++async_id);
+                std::snprintf(buf, sizeof buf, ",\"ph\":\"b\",\"id\":%llu,\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld,\"args\":{\"arg\":%llu}}",
+                              id, ts, pid, r->tid, arg);
+                out += buf;
+                out += ",\n{\"name\":";
+                append_json_string(out, full);
+                out += ",\"cat\":";
+                append_json_string(out, category);
+                std::snprintf(buf, sizeof buf, ",\"ph\":\"e\",\"id\":%llu,\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld}", id,
+                              ts + dur, pid, r->tid);
+                out += buf;
+                break;
+            }
+            default:
+                std::snprintf(buf, sizeof buf, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld,\"args\":{\"arg\":%llu}}",
+                              ts, dur, pid, r->tid, arg);
+                out += buf;
+                break;
+            }
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+void write_chrome_json(const std::filesystem::path& path)
+{
+    const std::string json = export_chrome_json();
+    write_file_atomic(path, std::as_bytes(std::span(json)));
+}
+
+} // namespace seinfeld_tv::trace
@@ -0,0 +1,79 @@
+#include "seinfeld_tv/transcode.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+#include "seinfeld_tv/subprocess.hpp"
+
+#include <cstdio>
+#include <span>
+
+namespace seinfeld_tv {
+
+namespace {
+
+std::string seconds(Pts pts)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.6f", static_cast<double>(pts) / kPtsPerSecond);
+    return buf;
+}
+
+} // namespace
+
+std::vector<Rendition> default_ladder()
+{
+    return {
+        {"1080p", 1080, 5000, 160},
+        {"720p", 720, 3000, 128},
+        {"480p", 480, 1200, 96},
+        {"audio", 0, 0, 96},
+    };
+}
+
+void FfmpegBackend::encode_chunk(const ChunkJob& job)
+{
+    const Rendition& r = *job.rendition;
+    std::vector<std::string> argv = {
+        ffmpeg_, "-nostdin", "-loglevel", "error", "-y", "-threads", "1",
+        "-ss", seconds(job.start_pts), "-i", job.source.string(),
+        "-t", seconds(job.end_pts - job.start_pts),
+    };
+    if (r.audio_only()) {
+        argv.insert(argv.end(), {"-vn"});
+    } else {
+        const std::string kbps = std::to_string(r.video_kbps) + "k";
+        argv.insert(argv.end(), {
+            "-map", "0:v:0", "-map", "0:a:0?",
+            "-c:v", "libx264", "-preset", "medium", "-b:v", kbps, "-maxrate", kbps,
+            "-bufsize", std::to_string(2 * r.video_kbps) + "k",
+            "-x264-params", "threads=1",
+        });
+        if (r.height != kSourceHeight)
+            argv.insert(argv.end(), {"-vf", "scale=-2:" + std::to_string(r.height)});
+    }
+    if (job.gain_db != 0) {
+        char filter[64];
+        std::snprintf(filter, sizeof filter, "volume=%.2fdB", static_cast<double>(job.gain_db));
+        argv.insert(argv.end(), {"-af", filter});
+    }
+    argv.insert(argv.end(), {
+        "-c:a", "aac", "-b:a", std::to_string(r.audio_kbps) + "k",
+        "-output_ts_offset", seconds(job.start_pts),
+        "-f", "mpegts", job.output.string(),
+    });
+    run_process(argv);
+}
+
+void FfmpegBackend::concat(const std::vector<std::filesystem::path>& chunks, const std::filesystem::path& output)
+{
+    auto list_path = output;
+    list_path += ".concat";
+    std::string list;
+    for (const auto& c : chunks)
+        list += "file '" + c.string() + "'\n";
+    write_file_atomic(list_path, std::as_bytes(std::span(list)));
+    run_process({ffmpeg_, "-nostdin", "-loglevel", "error", "-y", "-f", "concat", "-safe", "0",
+                 "-i", list_path.string(), "-c", "copy", "-f", "mpegts", output.string()});
+    std::filesystem::remove(list_path);
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,99 @@
+#include "seinfeld_tv/ts_demux.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace seinfeld_tv {
+
+namespace {
+
+/// Video PES packets span many TS packets. Each one starts with room for
+/// a little more than the previous frame, which avoids most geometric
+/// regrowth (and the dead copies it leaves behind in the arena).
+constexpr std::size_t kMinVideoReserve = 2 * 1024;
+
+} // namespace
+
+TsDemuxer::TsDemuxer(std::pmr::memory_resource* mr)
+    : mr_(mr), packets_(mr)
+{
+}
+
+void TsDemuxer::feed(std::span<const std::byte> packets, std::uint64_t base_offset)
+{
+    const std::size_t n = packets.size() / kTsPacketSize;
+    for (std::size_t i = 0; i < n; ++i) {
+        auto pkt = ts::parse_packet(packets.data() + i * kTsPacketSize);
+        if (!pkt)
+            throw std::runtime_error("ts demux: lost sync");
+        on_packet(*pkt, base_offset + i * kTsPacketSize);
+    }
+}
+
+void TsDemuxer::on_packet(const ts::Packet& pkt, std::uint64_t offset)
+{
+    if (pkt.pid == ts::kPatPid) {
+        if (auto pmt = ts::parse_pat(ts::psi_section(pkt)))
+            pmt_pid_ = *pmt;
+        return;
+    }
+    if (pkt.pid == pmt_pid_) {
+        if (auto map = ts::parse_pmt(ts::psi_section(pkt)); map.has_video())
+            program_ = map;
+        return;
+    }
+
+    std::ptrdiff_t* open;
+    std::uint8_t type;
+    if (program_.has_video() && pkt.pid == program_.video_pid) {
+        open = &open_video_;
+        type = program_.video_type;
+    } else if (program_.audio_type && pkt.pid == program_.audio_pid) {
+        open = &open_audio_;
+        type = program_.audio_type;
+    } else {
+        return;
+    }
+
+    if (pkt.payload_start) {
+        if (open == &open_video_ && *open >= 0)
+            last_video_size_ = packets_[static_cast<std::size_t>(*open)].payload.size();
+        *open = -1;
+        auto header = ts::parse_pes_header(pkt);
+        if (!header)
+            return;
+        PesPacket& pes = packets_.emplace_back(mr_);
+        pes.pid = pkt.pid;
+        pes.stream_type = type;
+        pes.stream_id = header->stream_id;
+        pes.pts = header->pts.value_or(-1);
+        pes.dts = header->dts.value_or(pes.pts);
+        pes.random_access = pkt.random_access;
+        pes.offset = offset;
+        auto* es = reinterpret_cast<const std::uint8_t*>(pkt.payload);
+        if (open == &open_video_)
+            pes.payload.reserve(std::max(kMinVideoReserve, last_video_size_ + last_video_size_ / 4));
+        pes.payload.assign(es + header->header_size, es + pkt.payload_size);
+        *open = static_cast<std::ptrdiff_t>(packets_.size() - 1);
+        return;
+    }
+    if (*open >= 0 && pkt.payload) {
+        auto* es = reinterpret_cast<const std::uint8_t*>(pkt.payload);
+        auto& payload = packets_[static_cast<std::size_t>(*open)].payload;
+        payload.insert(payload.end(), es, es + pkt.payload_size);
+    }
+}
+
+void TsDemuxer::flush()
+{
+    open_video_ = open_audio_ = -1;
+}
+
+void TsDemuxer::clear() noexcept
+{
+    // Drop the capacity too: it lives in memory the caller is about to reset.
+    packets_ = std::pmr::vector<PesPacket>(mr_);
+    open_video_ = open_audio_ = -1;
+}
+
+} // namespace seinfeld_tv
@@ -0,0 +1,286 @@
+#include "seinfeld_tv/uring.hpp"
+
+#include "seinfeld_tv/posix.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace seinfeld_tv {
+
+namespace {
+
+template <typename T>
+T* at(void* base, std::uint32_t offset) noexcept
+{
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+std::uint32_t load_acquire(std::uint32_t* p) noexcept
+{
+    return std::atomic_ref(*p).load(std::memory_order_acquire);
+}
+
+void store_release(std::uint32_t* p, std::uint32_t v) noexcept
+{
+    std::atomic_ref(*p).store(v, std::memory_order_release);
+}
+
+void* map_ring(int fd, std::size_t size, std::uint64_t offset)
+{
+    void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                     static_cast<off_t>(offset));
+    if (p == MAP_FAILED)
+        throw_errno("mmap io_uring");
+    return p;
+}
+
+void add_timeout(Ring& ring, io_uring_sqe* op, const __kernel_timespec* timeout)
+{
+    if (!timeout)
+        return;
+    op->flags |= IOSQE_IO_LINK;
+    auto* t = ring.sqe();
+    t->opcode = IORING_OP_LINK_TIMEOUT;
+    t->fd = -1;
+    t->addr = reinterpret_cast<std::uint64_t>(timeout);
+    t->len = 1;
+    t->user_data = kIgnoredCompletion;
+}
+
+} // namespace
+
+Ring::Ring(unsigned entries)
+{
+    io_uring_params params{};
+    // One thread submits and reaps, so the kernel may defer task work to
+    // our next io_uring_enter instead of interrupting us for it.
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0 && errno == EINVAL) {
+        params = {};
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    }
+    if (fd_ < 0)
+        throw_errno("io_uring_setup");
+    features_ = params.features;
+
+    try {
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (features_ & IORING_FEAT_SINGLE_MMAP) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+            sq_ring_ = cq_ring_ = map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+        } else {
+            sq_ring_ = map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = map_ring(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+        }
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map_ring(fd_, sqes_size_, IORING_OFF_SQES));
+    } catch (...) {
+        unmap();
+        throw;
+    }
+
+    sq_head_ = at<std::uint32_t>(sq_ring_, params.sq_off.head);
+    sq_tail_ = at<std::uint32_t>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = *at<std::uint32_t>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = *at<std::uint32_t>(sq_ring_, params.sq_off.ring_entries);
+    // SQE slots are used in ring order, so the indirection array is the
+    // identity and never has to be written again.
+    auto* array = at<std::uint32_t>(sq_ring_, params.sq_off.array);
+    for (std::uint32_t i = 0; i < sq_entries_; ++i)
+        array[i] = i;
+    sqe_tail_ = submitted_ = *sq_tail_;
+    cq_head_ = at<std::uint32_t>(cq_ring_, params.cq_off.head);
+    cq_tail_ = at<std::uint32_t>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = *at<std::uint32_t>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = at<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+Ring::~Ring()
+{
+    unmap();
+}
+
+void Ring::unmap() noexcept
+{
+    if (sqes_)
+        ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_)
+        ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_)
+        ::munmap(sq_ring_, sq_ring_size_);
+    if (fd_ >= 0)
+        ::close(fd_);
+    sqes_ = nullptr;
+    sq_ring_ = cq_ring_ = nullptr;
+    fd_ = -1;
+}
+
+io_uring_sqe* Ring::sqe(unsigned room)
+{
+    while (sq_entries_ - (sqe_tail_ - load_acquire(sq_head_)) < room)
+        submit();
+    auto* e = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    std::memset(e, 0, sizeof *e);
+    return e;
+}
+
+void Ring::submit(unsigned wait_for)
+{
+    store_release(sq_tail_, sqe_tail_);
+    const unsigned pending = sqe_tail_ - submitted_;
+    const unsigned flags = wait_for ? IORING_ENTER_GETEVENTS : 0;
+    const long n = ::syscall(__NR_io_uring_enter, fd_, pending, wait_for, flags, nullptr, 0);
+    if (n < 0) {
+        // EBUSY/EAGAIN: completions are backed up; reaping them frees room.
+        if (errno == EINTR || errno == EBUSY || errno == EAGAIN)
+            return;
+        throw_errno("io_uring_enter");
+    }
+    submitted_ += static_cast<std::uint32_t>(n);
+}
+
+unsigned Ring::dispatch()
+{
+    unsigned n = 0;
+    std::uint32_t head = *cq_head_;
+    for (std::uint32_t tail = load_acquire(cq_tail_); head != tail; tail = load_acquire(cq_tail_)) {
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            const std::uint64_t user_data = cqe.user_data;
+            const std::int32_t result = cqe.res;
+            const std::uint32_t flags = cqe.flags;
+            // Release the slot before resuming: the coroutine may queue
+            // more work that completes into it.
+            store_release(cq_head_, ++head);
+            ++n;
+            if (user_data == kIgnoredCompletion)
+                continue;
+            auto* done = reinterpret_cast<Completion*>(user_data);
+            done->result = result;
+            done->flags = flags;
+            done->waiter.resume();
+        }
+    }
+    return n;
+}
+
+namespace uring {
+
+RingOp accept(Ring& ring, int fd)
+{
+    auto* e = ring.sqe();
+    e->opcode = IORING_OP_ACCEPT;
+    e->fd = fd;
+    e->accept_flags = SOCK_CLOEXEC;
+    return RingOp(e);
+}
+
+RingOp recv(Ring& ring, int fd, void* buf, std::size_t len, const __kernel_timespec* timeout)
+{
+    auto* e = ring.sqe(timeout ? 2 : 1);
+    e->opcode = IORING_OP_RECV;
+    e->fd = fd;
+    e->addr = reinterpret_cast<std::uint64_t>(buf);
+    e->len = static_cast<std::uint32_t>(len);
+    add_timeout(ring, e, timeout);
+    return RingOp(e);
+}
+
+RingOp send(Ring& ring, int fd, const void* buf, std::size_t len, int flags, const __kernel_timespec* timeout)
+{
+    auto* e = ring.sqe(timeout ? 2 : 1);
+    e->opcode = IORING_OP_SEND;
+    e->fd = fd;
+    e->addr = reinterpret_cast<std::uint64_t>(buf);
+    e->len = static_cast<std::uint32_t>(len);
+    e->msg_flags = static_cast<std::uint32_t>(flags);
+    add_timeout(ring, e, timeout);
+    return RingOp(e);
+}
+
+RingOp splice(Ring& ring, int fd_in, std::int64_t off_in, int fd_out, std::size_t len, unsigned flags,
+              const __kernel_timespec* timeout)
+{
+    auto* e = ring.sqe(timeout ? 2 : 1);
+    e->opcode = IORING_OP_SPLICE;
+    e->fd = fd_out;
+    e->off = ~std::uint64_t{0};
+    e->splice_fd_in = fd_in;
+    e->splice_off_in = static_cast<std::uint64_t>(off_in);
+    e->len = static_cast<std::uint32_t>(len);
+    e->splice_flags = flags;
+    add_timeout(ring, e, timeout);
+    return RingOp(e);
+}
+
+RingOp read(Ring& ring, int fd, void* buf, std::size_t len)
+{
+    auto* e = ring.sqe();
+    e->opcode = IORING_OP_READ;
+    e->fd = fd;
+    e->addr = reinterpret_cast<std::uint64_t>(buf);
+    e->len = static_cast<std::uint32_t>(len);
+    e->off = ~std::uint64_t{0};
+    return RingOp(e);
+}
+
+void read_at(Ring& ring, int fd, void* buf, std::size_t len, std::uint64_t offset, std::uint16_t ioprio,
+             Completion& done)
+{
+    auto* e = ring.sqe();
+    e->opcode = IORING_OP_READ;
+    e->fd = fd;
+    e->addr = reinterpret_cast<std::uint64_t>(buf);
+    e->len = static_cast<std::uint32_t>(len);
+    e->off = offset;
+    e->ioprio = ioprio;
+    e->user_data = reinterpret_cast<std::uint64_t>(&done);
+}
+
+RingOp close(Ring& ring, int fd)
+{
+    auto* e = ring.sqe();
+    e->opcode = IORING_OP_CLOSE;
+    e->fd = fd;
+    return RingOp(e);
+}
+
+RingOp sleep(Ring& ring, const __kernel_timespec& ts)
+{
+    auto* e = ring.sqe();
+    e->opcode = IORING_OP_TIMEOUT;
+    e->fd = -1;
+    e->addr = reinterpret_cast<std::uint64_t>(&ts);
+    e->len = 1;
+    return RingOp(e);
+}
+
+void post(Ring& ring, Completion& done)
+{
+    auto* e = ring.sqe();
+    e->opcode = IORING_OP_NOP;
+    e->user_data = reinterpret_cast<std::uint64_t>(&done);
+}
+
+void cancel_all(Ring& ring, int fd)
+{
+    auto* e = ring.sqe();
+    e->opcode = IORING_OP_ASYNC_CANCEL;
+    e->fd = fd;
+    e->cancel_flags = fd < 0 ? IORING_ASYNC_CANCEL_ANY : (IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL);
+    e->user_data = kIgnoredCompletion;
+}
+
+} // namespace uring
+
+} // namespace seinfeld_tv
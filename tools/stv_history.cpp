@@ -0,0 +1,101 @@
+// Queries the play-history log stv-serve --history writes.
+//
+//   stv-history top <log> [--limit N]     episodes by viewer-minutes
+//   stv-history curve <log> <SxxEyy>      viewers by minute into an episode,
+//                                         with its steepest drop-offs
+
+#include "seinfeld_tv/play_history.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace seinfeld_tv;
+
+namespace {
+
+/// "S04E11" (either case) into an episode_key().
+bool parse_episode(std::string_view s, std::uint32_t& key)
+{
+    unsigned season = 0, episode = 0;
+    char a = 0, b = 0;
+    if (std::sscanf(std::string(s).c_str(), "%c%u%c%u", &a, &season, &b, &episode) != 4 || (a | 0x20) != 's' ||
+        (b | 0x20) != 'e' || season > 0xffff || episode > 0xffff)
+        return false;
+    key = episode_key(static_cast<std::uint16_t>(season), static_cast<std::uint16_t>(episode));
+    return true;
+}
+
+void print_scan(const HistoryLog& log, std::chrono::steady_clock::duration elapsed)
+{
+    std::fprintf(stderr, "%llu rows in %zu blocks%s, scanned in %.3f ms\n", static_cast<unsigned long long>(log.rows()),
+                 log.blocks().size(), log.truncated() ? " (last one partial)" : "",
+                 std::chrono::duration<double, std::milli>(elapsed).count());
+}
+
+int top(const char* path, std::size_t limit)
+{
+    HistoryLog log(path);
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto episodes = most_watched(log, limit);
+    print_scan(log, std::chrono::steady_clock::now() - t0);
+    for (const auto& e : episodes)
+        std::printf("S%02uE%02u %10llu viewer-minutes %6llu airings\n", e.episode >> 16, e.episode & 0xffff,
+                    static_cast<unsigned long long>(e.viewer_minutes), static_cast<unsigned long long>(e.airings));
+    return 0;
+}
+
+int curve(const char* path, std::uint32_t episode)
+{
+    HistoryLog log(path);
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto viewers = watch_curve(log, episode);
+    print_scan(log, std::chrono::steady_clock::now() - t0);
+    if (viewers.empty()) {
+        std::printf("no viewer-minutes for S%02uE%02u\n", episode >> 16, episode & 0xffff);
+        return 0;
+    }
+    const double peak = static_cast<double>(*std::max_element(viewers.begin(), viewers.end()));
+    std::vector<std::pair<std::uint64_t, std::size_t>> drops; // (viewers lost, minute)
+    for (std::size_t m = 0; m < viewers.size(); ++m) {
+        std::printf("%3zu min %8llu %5.1f%%\n", m, static_cast<unsigned long long>(viewers[m]),
+                    100.0 * static_cast<double>(viewers[m]) / peak);
+        if (m > 0 && viewers[m] < viewers[m - 1])
+            drops.emplace_back(viewers[m - 1] - viewers[m], m);
+    }
+    std::sort(drops.rbegin(), drops.rend());
+    for (std::size_t i = 0; i < std::min<std::size_t>(3, drops.size()); ++i)
+        std::printf("drop-off at %zu min: %llu viewers\n", drops[i].second,
+                    static_cast<unsigned long long>(drops[i].first));
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::string_view command = argc > 1 ? argv[1] : "";
+    std::uint32_t episode = 0;
+    if (!((command == "top" && (argc == 3 || argc == 5)) ||
+          (command == "curve" && argc == 4 && parse_episode(argv[3], episode)))) {
+        std::fprintf(stderr, "usage: %s top <log> [--limit N]\n       %s curve <log> <SxxEyy>\n", argv[0], argv[0]);
+        return 2;
+    }
+    try {
+        if (command == "curve")
+            return curve(argv[2], episode);
+        std::size_t limit = 20;
+        if (argc == 5 && std::string_view(argv[3]) == "--limit")
+            limit = std::strtoul(argv[4], nullptr, 10);
+        return top(argv[2], limit);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-history: %s\n", e.what());
+        return 1;
+    }
+}
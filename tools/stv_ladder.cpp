@@ -0,0 +1,62 @@
+// Builds the ABR ladder for every episode in a catalog.
+//
+//   stv-ladder <catalog> <output-dir> [--workers N] [--chunk-seconds S]
+//              [--ffmpeg PATH] [--report PATH]
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/ladder.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace seinfeld_tv;
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr,
+                     "usage: %s <catalog> <output-dir> [--workers N] [--chunk-seconds S] [--ffmpeg PATH] "
+                     "[--report PATH]\n",
+                     argv[0]);
+        return 2;
+    }
+    unsigned workers = std::thread::hardware_concurrency();
+    std::string ffmpeg = "ffmpeg";
+    std::string report_path(kBenchOutputPath);
+    LadderOptions options;
+    options.output_dir = argv[2];
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string_view flag = argv[i];
+        if (flag == "--workers")
+            workers = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (flag == "--chunk-seconds")
+            options.chunk_target = std::strtoll(argv[i + 1], nullptr, 10) * kPtsPerSecond;
+        else if (flag == "--ffmpeg")
+            ffmpeg = argv[i + 1];
+        else if (flag == "--report")
+            report_path = argv[i + 1];
+        else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    try {
+        Catalog catalog(argv[1]);
+        auto sources = ladder_sources(catalog);
+        FfmpegBackend backend(ffmpeg);
+        WorkStealingPool pool(workers);
+        ReportLog log(report_path);
+        auto report = build_ladders(sources, backend, pool, options, &log);
+        std::printf("%llu tasks on %u workers in %.1f s\n", static_cast<unsigned long long>(report.tasks),
+                    report.workers, std::chrono::duration<double>(report.wall).count());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-ladder: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Load-tests a running stv-serve with simulated HLS and LL-HLS players.
+//
+//   stv-load <host:port> [--channel NAME]... [--players N] [--threads N]
+//            [--duration S] [--ramp S] [--watch S] [--ll FRACTION]
+//            [--blocking FRACTION] [--bandwidth BPS] [--hint-every S]
+//            [--seed N] [--report PATH]
+//
+// --players are kept watching at once: joins are spread over --ramp, each
+// player leaves after an exponential watch time (mean --watch) and is
+// replaced. --ll of them use ll.m3u8; --blocking of the rest reload with
+// _HLS_msn, the others poll. Links are log-normal around --bandwidth.
+// Segment, part and playlist latency percentiles, time to first byte of
+// segments and parts (the server's share, unpaced by the link) and
+// rebuffer counts are printed and appended to --report
+// (bench_output.txt by default).
+
+#include "seinfeld_tv/load_test.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+
+using namespace seinfeld_tv;
+
+namespace {
+
+std::chrono::seconds parse_seconds(const char* s)
+{
+    return std::chrono::seconds(std::strtoull(s, nullptr, 10));
+}
+
+void print_latency(const char* kind, const metrics::Histogram::Snapshot& h)
+{
+    const auto q = [&](double quantile) { return static_cast<double>(h.quantile(quantile)) / 1e6; };
+    std::printf("%-9s %8llu  p50 %8.2f ms  p99 %8.2f ms  p999 %8.2f ms\n", kind,
+                static_cast<unsigned long long>(h.count), q(0.5), q(0.99), q(0.999));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr,
+                     "usage: %s <host:port> [--channel NAME]... [--players N] [--threads N] [--duration S] "
+                     "[--ramp S] [--watch S] [--ll FRACTION] [--blocking FRACTION] [--bandwidth BPS] "
+                     "[--hint-every S] [--seed N] [--report PATH]\n",
+                     argv[0]);
+        return 2;
+    }
+    LoadTestOptions options;
+    std::string report_path(kBenchOutputPath);
+    {
+        const std::string_view target = argv[1];
+        const auto colon = target.rfind(':');
+        if (colon == std::string_view::npos) {
+            std::fprintf(stderr, "bad target %s\n", argv[1]);
+            return 2;
+        }
+        options.host = target.substr(0, colon);
+        options.port = static_cast<std::uint16_t>(std::strtoul(argv[1] + colon + 1, nullptr, 10));
+    }
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string_view flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--channel")
+            options.channels.emplace_back(value);
+        else if (flag == "--players")
+            options.players = std::strtoull(value, nullptr, 10);
+        else if (flag == "--threads")
+            options.threads = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--duration")
+            options.duration = parse_seconds(value);
+        else if (flag == "--ramp")
+            options.ramp = parse_seconds(value);
+        else if (flag == "--watch")
+            options.mean_watch = parse_seconds(value);
+        else if (flag == "--ll")
+            options.low_latency = std::strtod(value, nullptr);
+        else if (flag == "--blocking")
+            options.blocking = std::strtod(value, nullptr);
+        else if (flag == "--bandwidth")
+            options.median_bandwidth_bps = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (flag == "--hint-every")
+            options.hint_every = parse_seconds(value);
+        else if (flag == "--seed")
+            options.seed = std::strtoull(value, nullptr, 10);
+        else if (flag == "--report")
+            report_path = value;
+        else {
+            std::fprintf(stderr, "bad option %s %s\n", argv[i], value);
+            return 2;
+        }
+    }
+    if (options.channels.empty())
+        options.channels.emplace_back("seinfeld"); // stv-serve's default
+
+    try {
+        ReportLog log(report_path);
+        const auto report = run_load_test(options, &log);
+        print_latency("segment", report.segments);
+        print_latency("part", report.parts);
+        print_latency("1st byte", report.first_byte);
+        print_latency("playlist", report.playlists);
+        print_latency("startup", report.startup);
+        std::printf("%llu join(s), %llu leave(s), %llu request(s), %llu error(s), %llu resync(s), "
+                    "%llu rebuffer(s) (%.1f s stalled), %llu switch(es), %.1f MB in %.1f s\n",
+                    static_cast<unsigned long long>(report.joins), static_cast<unsigned long long>(report.leaves),
+                    static_cast<unsigned long long>(report.requests), static_cast<unsigned long long>(report.errors),
+                    static_cast<unsigned long long>(report.resyncs),
+                    static_cast<unsigned long long>(report.rebuffers),
+                    std::chrono::duration<double>(report.stalled).count(),
+                    static_cast<unsigned long long>(report.switches), static_cast<double>(report.bytes) / 1e6,
+                    std::chrono::duration<double>(report.wall).count());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-load: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
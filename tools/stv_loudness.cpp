@@ -0,0 +1,67 @@
+// Measures EBU R128 loudness for every episode the catalog has no
+// measurement for and caches the result in the catalog in place.
+//
+//   stv-loudness <catalog> [--workers N] [--ffmpeg PATH] [--all]
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/loudness.hpp"
+#include "seinfeld_tv/task_graph.hpp"
+#include "seinfeld_tv/thread_pool.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace seinfeld_tv;
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <catalog> [--workers N] [--ffmpeg PATH] [--all]\n", argv[0]);
+        return 2;
+    }
+    unsigned workers = std::thread::hardware_concurrency();
+    std::string ffmpeg = "ffmpeg";
+    bool remeasure = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string_view flag = argv[i];
+        if (flag == "--all")
+            remeasure = true;
+        else if (flag == "--workers" && i + 1 < argc)
+            workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (flag == "--ffmpeg" && i + 1 < argc)
+            ffmpeg = argv[++i];
+        else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    try {
+        const std::filesystem::path path = argv[1];
+        Catalog catalog(path);
+        TaskGraph graph;
+        for (const auto& r : catalog.episodes()) {
+            if (!remeasure && catalog.loudness(r))
+                continue;
+            const EpisodeId id = catalog.id_of(r);
+            const std::filesystem::path media(catalog.path(r));
+            graph.add("measure", [&path, &ffmpeg, id, media, season = r.season, episode = r.episode] {
+                const auto loudness = measure_file_loudness(media, ffmpeg);
+                Catalog::store_loudness(path, id, loudness);
+                std::printf("S%02uE%02u %.1f LUFS peak %.3f gain %+.1f dB\n", unsigned{season}, unsigned{episode},
+                            static_cast<double>(loudness.integrated_lufs), static_cast<double>(loudness.sample_peak),
+                            static_cast<double>(normalization_gain_db(loudness)));
+            });
+        }
+        WorkStealingPool pool(workers);
+        graph.run(pool);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-loudness: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
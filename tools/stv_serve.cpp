@@ -0,0 +1,410 @@
+// Serves a station's channels as live HLS.
+//
+//   stv-serve <catalog> [--port N] [--threads N] [--channel NAME[:SEASON]]...
+//             [--breaks MINUTES] [--ffmpeg PATH] [--prefetch MINUTES] [--trace PATH]
+//             [--peers HOST:PORT,... --self N] [--snapshot PATH] [--history PATH]
+//
+// Without --channel, one whole-series shuffle channel named "seinfeld" is
+// served. A season of 0 (or none) shuffles the whole library; otherwise
+// the channel runs that season as a marathon. Playlists are at
+// http://host:port/<name>/live.m3u8, or ll.m3u8 for low-latency HLS.
+//
+// --breaks puts a break of "bumper" clips into episodes every MINUTES of
+// programme. A background thread encodes the splice bridges of the next
+// two hours with ffmpeg.
+//
+// --prefetch warms the page cache with the first segments of every airing
+// starting within MINUTES (default 10; 0 disables), at idle I/O priority.
+//
+// --peers runs the node as member N (from 0) of a cluster listed in the
+// same order, with the same channel flags, on every node. Each segment is
+// read from storage by its owner only; the others copy it from there.
+//
+// --snapshot saves the warm state to PATH at shutdown and restores it at
+// start-up: timelines are taken from it instead of rebuilt while the
+// catalog, anchor and channel flags are unchanged, segment numbering
+// carries on where the last process stopped, and the GOP indexes and
+// (clustered) cached segments it had are warmed in the background.
+//
+// --history appends every airing and viewer-minute to the columnar log at
+// PATH, for stv-history to query.
+//
+// Prometheus metrics are at http://host:port/metrics.
+//
+// --trace records hot-path events and writes them to PATH as a Chrome
+// trace (chrome://tracing, Perfetto) on SIGUSR1 and at exit.
+
+#include "seinfeld_tv/cluster.hpp"
+#include "seinfeld_tv/hls_service.hpp"
+#include "seinfeld_tv/http_server.hpp"
+#include "seinfeld_tv/metrics.hpp"
+#include "seinfeld_tv/play_history.hpp"
+#include "seinfeld_tv/prefetch.hpp"
+#include "seinfeld_tv/snapshot.hpp"
+#include "seinfeld_tv/splice.hpp"
+#include "seinfeld_tv/station.hpp"
+#include "seinfeld_tv/timeline.hpp"
+#include "seinfeld_tv/trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace seinfeld_tv;
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+std::atomic<bool> g_dump{false};
+
+void on_signal(int)
+{
+    g_stop = true;
+}
+
+void on_dump(int)
+{
+    g_dump = true;
+}
+
+void dump_trace(const std::string& path)
+{
+    try {
+        trace::write_chrome_json(path);
+        std::printf("trace written to %s\n", path.c_str());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-serve: trace: %s\n", e.what());
+    }
+    std::fflush(stdout);
+}
+
+/// How far ahead splice bridges are encoded, and how often that is checked.
+constexpr Pts kBridgeLead = 2 * kPtsPerHour;
+constexpr auto kBridgeInterval = std::chrono::seconds(60);
+constexpr auto kPrefetchInterval = std::chrono::seconds(30);
+/// Viewer sessions not seen for this long are closed.
+constexpr Pts kSessionIdle = 60 * kPtsPerSecond;
+
+/// Where the timeline in force at `now` starts. Anchors fall every half
+/// week, an hour early so joining viewers get a full playlist straight
+/// away, and leave at least three days of schedule ahead. Being a
+/// function of the clock alone, every node of a cluster, and a restarted
+/// node, airs the same schedule.
+Pts timeline_anchor(Pts now) noexcept
+{
+    constexpr Pts kHalfWeek = kPtsPerWeek / 2;
+    return now - now % kHalfWeek - kPtsPerHour;
+}
+
+/// The entries of `timeline` overlapping [from, until), as a timeline of
+/// their own, so background work holds no RCU guard while it runs.
+Timeline entries_between(const Timeline& timeline, Pts from, Pts until)
+{
+    std::vector<TimelineEntry> entries;
+    for (const auto& e : timeline.entries())
+        if (e.end_pts() > from && e.start_pts < until)
+            entries.push_back(e);
+    return Timeline(timeline.catalog_ptr(), std::move(entries));
+}
+
+/// Sleeps for `d` in one-second steps, returning early on shutdown.
+void idle(std::chrono::seconds d, const std::stop_token& stop)
+{
+    for (auto waited = std::chrono::seconds(0); waited < d && !g_stop && !stop.stop_requested();
+         waited += std::chrono::seconds(1))
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+}
+
+SchedulePlan plan_for(const std::string& name, std::uint16_t season, Pts break_every)
+{
+    SchedulePlan plan;
+    plan.seed = std::hash<std::string>{}(name);
+    plan.breaks.every = break_every;
+    if (season != 0) {
+        ProgramBlock block;
+        block.duration = kPtsPerWeek;
+        block.kind = BlockKind::Marathon;
+        block.season = season;
+        plan.blocks.push_back(std::move(block));
+    }
+    return plan;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr,
+                     "usage: %s <catalog> [--port N] [--threads N] [--channel NAME[:SEASON]]... "
+                     "[--breaks MINUTES] [--ffmpeg PATH] [--prefetch MINUTES] [--trace PATH] "
+                     "[--peers HOST:PORT,... --self N] [--snapshot PATH] [--history PATH]\n",
+                     argv[0]);
+        return 2;
+    }
+    HttpServerOptions options;
+    Pts break_every = 0;
+    PrefetchOptions prefetch;
+    std::string ffmpeg = "ffmpeg";
+    std::string trace_path;
+    std::string peers;
+    std::string snapshot_path;
+    std::string history_path;
+    std::size_t self = 0;
+    std::vector<std::pair<std::string, std::uint16_t>> channels;
+    for (int i = 2; i < argc; ++i) {
+        std::string_view flag = argv[i];
+        if (flag == "--port" && i + 1 < argc) {
+            options.port = static_cast<std::uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (flag == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (flag == "--channel" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            const auto colon = spec.find(':');
+            const auto season = colon == std::string::npos ? 0ul : std::strtoul(spec.c_str() + colon + 1, nullptr, 10);
+            channels.emplace_back(spec.substr(0, colon), static_cast<std::uint16_t>(season));
+        } else if (flag == "--breaks" && i + 1 < argc) {
+            break_every = static_cast<Pts>(std::strtod(argv[++i], nullptr) * 60 * kPtsPerSecond);
+        } else if (flag == "--ffmpeg" && i + 1 < argc) {
+            ffmpeg = argv[++i];
+        } else if (flag == "--prefetch" && i + 1 < argc) {
+            prefetch.lead = static_cast<Pts>(std::strtod(argv[++i], nullptr) * 60 * kPtsPerSecond);
+        } else if (flag == "--peers" && i + 1 < argc) {
+            peers = argv[++i];
+        } else if (flag == "--self" && i + 1 < argc) {
+            self = std::strtoul(argv[++i], nullptr, 10);
+        } else if (flag == "--snapshot" && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (flag == "--history" && i + 1 < argc) {
+            history_path = argv[++i];
+        } else if (flag == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (channels.empty())
+        channels.emplace_back("seinfeld", 0);
+
+    if (!trace_path.empty()) {
+        trace::enable(true);
+        trace::set_thread_name("main");
+    }
+
+    try {
+        const auto started = std::chrono::steady_clock::now();
+        Station station(std::make_shared<const Catalog>(argv[1]));
+        Pts from = timeline_anchor(channel_time_now());
+
+        std::optional<Snapshot> snapshot;
+        if (!snapshot_path.empty() && std::filesystem::exists(snapshot_path)) {
+            try {
+                snapshot.emplace(snapshot_path);
+                if (!snapshot->matches(*station.library().catalog(), from)) {
+                    std::printf("snapshot is from another catalog or timeline anchor; rebuilding\n");
+                    snapshot.reset();
+                }
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "stv-serve: %s\n", e.what());
+                snapshot.reset();
+            }
+        }
+        std::size_t restored = 0;
+        for (const auto& [name, season] : channels) {
+            auto plan = plan_for(name, season, break_every);
+            const auto* saved = snapshot ? snapshot->channel(name) : nullptr;
+            if (saved && saved->entry_count > 0 && saved->plan_fingerprint == plan_fingerprint(plan)) {
+                const auto entries = snapshot->timeline(*saved);
+                station.add_channel(name, std::move(plan), std::vector<TimelineEntry>(entries.begin(), entries.end()));
+                ++restored;
+            } else {
+                station.add_channel(name, std::move(plan), from);
+            }
+        }
+
+        // Re-map the GOP indexes the last process had, off the serving path.
+        std::jthread indexer;
+        if (snapshot && !snapshot->indexes().empty())
+            indexer = std::jthread([&station, hashes = std::vector<ContentHash>(snapshot->indexes().begin(),
+                                                                                 snapshot->indexes().end())] {
+                trace::set_thread_name("indexer");
+                const auto catalog = station.library().catalog();
+                for (const auto& hash : hashes) {
+                    if (g_stop)
+                        break;
+                    if (const auto* record = catalog->find(hash)) {
+                        try {
+                            station.library().gop_index(*catalog, *record);
+                        } catch (const std::exception&) {
+                            // Built again, and reported, when it airs.
+                        }
+                    }
+                }
+            });
+
+        // Bridges are encoded off the serving path, from a copy of the
+        // coming entries so no RCU guard is held across an encode.
+        std::jthread bridger;
+        if (break_every > 0)
+            bridger = std::jthread([&station, ffmpeg](std::stop_token stop) {
+                trace::set_thread_name("bridger");
+                FfmpegBackend backend(ffmpeg);
+                while (!g_stop && !stop.stop_requested()) {
+                    const Pts now = channel_time_now();
+                    for (std::uint32_t id = 0; id < station.size() && !g_stop; ++id) {
+                        const auto ahead =
+                            entries_between(*station.channel(id)->scheduler().timeline(), now, now + kBridgeLead);
+                        if (const auto n = prepare_bridges(station.library(), ahead, now, now + kBridgeLead, backend)) {
+                            std::printf("%s: encoded %zu splice bridge(s)\n", station.channel(id)->name().c_str(), n);
+                            std::fflush(stdout);
+                        }
+                    }
+                    idle(kBridgeInterval, stop);
+                }
+            });
+
+        // The prefetcher owns an io_uring, so it is created on its thread.
+        std::jthread prefetcher;
+        if (prefetch.lead > 0)
+            prefetcher = std::jthread([&station, prefetch](std::stop_token stop) {
+                trace::set_thread_name("prefetch");
+                try {
+                    Prefetcher warm(station.library(), prefetch);
+                    while (!g_stop && !stop.stop_requested()) {
+                        const Pts now = channel_time_now();
+                        const auto before = warm.stats();
+                        for (std::uint32_t id = 0; id < station.size() && !g_stop; ++id)
+                            warm.prefetch(entries_between(*station.channel(id)->scheduler().timeline(), now,
+                                                          now + prefetch.lead),
+                                          now);
+                        if (const auto& s = warm.stats(); s.airings != before.airings) {
+                            std::printf("prefetched %llu KiB for %llu airing(s)\n",
+                                        static_cast<unsigned long long>((s.bytes - before.bytes) >> 10),
+                                        static_cast<unsigned long long>(s.airings - before.airings));
+                            std::fflush(stdout);
+                        }
+                        idle(kPrefetchInterval, stop);
+                    }
+                } catch (const std::exception& e) {
+                    std::fprintf(stderr, "stv-serve: prefetch: %s\n", e.what());
+                }
+            });
+
+        std::optional<PlayHistory> history; // outlives hls, which records into it
+        if (!history_path.empty())
+            history.emplace(history_path);
+        HlsService hls(station);
+        if (history) {
+            hls.enable_history(*history);
+            hls.add_metrics([&history](metrics::Exposition& out) {
+                const auto s = history->stats();
+                out.family("stv_history_events_total", "counter", "Airings and viewer-minutes recorded.");
+                out.sample("stv_history_events_total", "", s.events);
+                out.family("stv_history_dropped_total", "counter", "Events dropped on a full ring.");
+                out.sample("stv_history_dropped_total", "", s.dropped);
+                out.family("stv_history_written_bytes_total", "counter", "Encoded history written.");
+                out.sample("stv_history_written_bytes_total", "", s.bytes);
+            });
+        }
+        if (!peers.empty()) {
+            ClusterMap cluster(parse_nodes(peers), self);
+            std::printf("cluster node %zu of %zu (%s)\n", self, cluster.size(), cluster.node(self).name().c_str());
+            hls.enable_cluster(std::move(cluster));
+        }
+        if (snapshot) {
+            for (const auto& [name, season] : channels)
+                if (const auto* saved = snapshot->channel(name)) {
+                    const auto points = snapshot->positions(*saved);
+                    hls.playout(name)->resume(std::vector<SequencePoint>(points.begin(), points.end()));
+                }
+            const auto warming = hls.warm(snapshot->hot_segments());
+            std::printf("restored %zu of %zu channel(s) from snapshot in %.0f ms; warming %zu segment(s), %zu index(es)\n",
+                        restored, station.size(),
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count(),
+                        warming, snapshot->indexes().size());
+            snapshot.reset();
+        }
+        options.on_delivered = [&hls](const HttpDelivery& d) { hls.on_delivered(d); };
+        HttpServer server(options, [&hls](const HttpRequest& r) { return hls.handle(r); });
+        hls.add_metrics([&server](metrics::Exposition& out) {
+            const auto s = server.stats();
+            out.family("stv_http_requests_total", "counter", "Requests parsed.");
+            out.sample("stv_http_requests_total", "", s.requests);
+            out.family("stv_http_sent_bytes_total", "counter", "Response bytes written to sockets.");
+            out.sample("stv_http_sent_bytes_total", "", s.bytes_sent);
+            out.family("stv_http_connections", "gauge", "Open connections.");
+            out.sample("stv_http_connections", "", s.active);
+            out.family("stv_http_parked", "gauge", "Requests parked until their segment or playlist exists.");
+            out.sample("stv_http_parked", "", s.parked);
+        });
+        server.start();
+        std::printf("serving %zu channel(s) on port %u\n", station.size(), unsigned{server.port()});
+        std::fflush(stdout);
+
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        if (!trace_path.empty())
+            std::signal(SIGUSR1, on_dump);
+        auto next_stats = std::chrono::steady_clock::now();
+        auto next_reap = next_stats;
+        while (!g_stop) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (g_dump.exchange(false))
+                dump_trace(trace_path);
+            if (const Pts anchor = timeline_anchor(channel_time_now()); anchor != from) {
+                from = anchor;
+                station.rebuild(from);
+            }
+            if (std::chrono::steady_clock::now() >= next_reap) {
+                next_reap += std::chrono::seconds(1);
+                hls.update_estimates();
+                hls.sessions().reap(channel_time_now() - kSessionIdle);
+            }
+            if (std::chrono::steady_clock::now() >= next_stats) {
+                next_stats += std::chrono::seconds(10);
+                const auto s = server.stats();
+                const auto c = station.library().segments().stats();
+                std::printf("connections %llu active, %llu parked, %llu requests, %llu MiB sent, cache hit %.1f%%, "
+                            "%zu viewers\n",
+                            static_cast<unsigned long long>(s.active), static_cast<unsigned long long>(s.parked),
+                            static_cast<unsigned long long>(s.requests),
+                            static_cast<unsigned long long>(s.bytes_sent >> 20), 100.0 * c.hit_rate(),
+                            hls.sessions().count());
+                if (const auto* p = hls.peers()) {
+                    const auto ps = p->stats();
+                    std::printf("peers: %llu fetched (%llu MiB), %llu failed, %llu refused\n",
+                                static_cast<unsigned long long>(ps.fetched),
+                                static_cast<unsigned long long>(ps.bytes >> 20),
+                                static_cast<unsigned long long>(ps.failed),
+                                static_cast<unsigned long long>(ps.refused));
+                }
+                std::fflush(stdout);
+            }
+        }
+        server.stop();
+        if (!snapshot_path.empty()) {
+            try {
+                save_snapshot(snapshot_path, station, hls, from);
+            } catch (const std::exception& e) {
+                std::fprintf(stderr, "stv-serve: saving snapshot: %s\n", e.what());
+            }
+        }
+        if (!trace_path.empty())
+            dump_trace(trace_path);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-serve: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
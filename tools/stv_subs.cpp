@@ -0,0 +1,89 @@
+// Builds and queries the subtitle/quote index next to a catalog.
+//
+//   stv-subs build <catalog>            index <episode>.srt beside each file
+//   stv-subs search <catalog> <phrase> [--limit N]
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/mapped_file.hpp"
+#include "seinfeld_tv/subtitle_index.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+
+using namespace seinfeld_tv;
+
+namespace {
+
+int build(const std::filesystem::path& catalog_path)
+{
+    Catalog catalog(catalog_path);
+    SubtitleIndexBuilder builder;
+    std::size_t files = 0, cues = 0;
+    for (const auto& r : catalog.episodes()) {
+        auto srt = std::filesystem::path(catalog.path(r)).replace_extension(".srt");
+        std::error_code ec;
+        if (!std::filesystem::exists(srt, ec))
+            continue;
+        MappedFile file(srt);
+        auto parsed = parse_srt({reinterpret_cast<const char*>(file.data()), file.size()});
+        builder.add_cues(catalog.id_of(r), parsed);
+        ++files;
+        cues += parsed.size();
+    }
+    builder.add_clips(catalog);
+    builder.write(SubtitleIndex::path_for(catalog_path), catalog.generation());
+    std::printf("indexed %zu cues from %zu subtitle files and %zu clips\n", cues, files, catalog.clips().size());
+    return 0;
+}
+
+int search(const std::filesystem::path& catalog_path, std::string_view phrase, std::size_t limit)
+{
+    Catalog catalog(catalog_path);
+    SubtitleIndex index(SubtitleIndex::path_for(catalog_path));
+    if (index.catalog_generation() != catalog.generation())
+        std::fprintf(stderr, "stv-subs: index is from catalog generation %llu, run build\n",
+                     static_cast<unsigned long long>(index.catalog_generation()));
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto hits = index.search(phrase, limit);
+    const auto elapsed = std::chrono::steady_clock::now() - t0;
+    for (const auto& h : hits) {
+        if (h.episode >= catalog.size())
+            continue;
+        const auto& r = catalog.episode(h.episode);
+        const auto ms = pts_to_ms(h.start_pts);
+        std::printf("S%02uE%02u %02lld:%02lld:%02lld%s %.*s\n", unsigned{r.season}, unsigned{r.episode},
+                    static_cast<long long>(ms / 3600000), static_cast<long long>(ms / 60000 % 60),
+                    static_cast<long long>(ms / 1000 % 60), h.clip ? " [clip]" : "", static_cast<int>(h.text.size()),
+                    h.text.data());
+    }
+    std::fprintf(stderr, "%zu hits in %.3f ms\n", hits.size(),
+                 std::chrono::duration<double, std::milli>(elapsed).count());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::string_view command = argc > 1 ? argv[1] : "";
+    if (!((command == "build" && argc == 3) || (command == "search" && argc >= 4))) {
+        std::fprintf(stderr, "usage: %s build <catalog>\n       %s search <catalog> <phrase> [--limit N]\n", argv[0],
+                     argv[0]);
+        return 2;
+    }
+    try {
+        if (command == "build")
+            return build(argv[2]);
+        std::size_t limit = 50;
+        if (argc == 6 && std::string_view(argv[4]) == "--limit")
+            limit = std::strtoul(argv[5], nullptr, 10);
+        return search(argv[2], argv[3], limit);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-subs: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,106 @@
+// Builds scrubbing thumbnails and sprite sheets for every episode in a
+// catalog.
+//
+//   stv-thumbs <catalog> <output-dir> [--workers N] [--interval S] [--size WxH]
+//              [--grid COLSxROWS] [--hw none|cuda|vaapi] [--vaapi-device PATH]
+//              [--ffmpeg PATH] [--report PATH]
+//
+// Only keyframes are decoded. --hw decodes and scales them on the GPU
+// and falls back to software if that fails. Episodes whose thumbnails
+// already exist (by content hash) are skipped.
+
+#include "seinfeld_tv/catalog.hpp"
+#include "seinfeld_tv/thumbnails.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace seinfeld_tv;
+
+namespace {
+
+/// "AxB" into two positive ints.
+bool parse_pair(std::string_view s, int& a, int& b)
+{
+    const auto x = s.find('x');
+    if (x == std::string_view::npos)
+        return false;
+    a = std::atoi(std::string(s.substr(0, x)).c_str());
+    b = std::atoi(std::string(s.substr(x + 1)).c_str());
+    return a > 0 && b > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr,
+                     "usage: %s <catalog> <output-dir> [--workers N] [--interval S] [--size WxH] "
+                     "[--grid COLSxROWS] [--hw none|cuda|vaapi] [--vaapi-device PATH] [--ffmpeg PATH] "
+                     "[--report PATH]\n",
+                     argv[0]);
+        return 2;
+    }
+    unsigned workers = std::thread::hardware_concurrency();
+    std::string ffmpeg = "ffmpeg";
+    std::string vaapi_device = "/dev/dri/renderD128";
+    std::string report_path(kBenchOutputPath);
+    HwDecode hw = HwDecode::None;
+    ThumbnailOptions options;
+    options.output_dir = argv[2];
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string_view flag = argv[i];
+        std::string_view value = argv[i + 1];
+        bool ok = true;
+        if (flag == "--workers")
+            workers = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (flag == "--interval")
+            options.interval = static_cast<Pts>(std::strtod(argv[i + 1], nullptr) * kPtsPerSecond);
+        else if (flag == "--size")
+            ok = parse_pair(value, options.width, options.height);
+        else if (flag == "--grid")
+            ok = parse_pair(value, options.columns, options.rows);
+        else if (flag == "--hw" && value == "none")
+            hw = HwDecode::None;
+        else if (flag == "--hw" && value == "cuda")
+            hw = HwDecode::Cuda;
+        else if (flag == "--hw" && value == "vaapi")
+            hw = HwDecode::Vaapi;
+        else if (flag == "--vaapi-device")
+            vaapi_device = value;
+        else if (flag == "--ffmpeg")
+            ffmpeg = value;
+        else if (flag == "--report")
+            report_path = value;
+        else
+            ok = false;
+        if (!ok) {
+            std::fprintf(stderr, "bad option %s %s\n", argv[i], argv[i + 1]);
+            return 2;
+        }
+    }
+
+    try {
+        Catalog catalog(argv[1]);
+        auto sources = ladder_sources(catalog);
+        FfmpegFrameDecoder decoder(ffmpeg, hw, vaapi_device);
+        WorkStealingPool pool(workers);
+        ReportLog log(report_path);
+        auto report = build_thumbnails(sources, decoder, pool, options, &log);
+        if (!report.fallback.empty())
+            std::fprintf(stderr, "stv-thumbs: hardware decode failed, using software: %s\n", report.fallback.c_str());
+        std::printf("%llu sheet(s) for %zu episode(s), %llu already done, %s decode, %.1f s\n",
+                    static_cast<unsigned long long>(report.sheets), sources.size() - report.skipped,
+                    static_cast<unsigned long long>(report.skipped), decoder.hardware() ? "hardware" : "software",
+                    std::chrono::duration<double>(report.wall).count());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-thumbs: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Keeps a catalog in sync with a library directory: one full rescan at
+// start, then incremental rescans on filesystem events.
+//
+//   stv-watch <library-dir> <catalog> [--workers N] [--settle-ms MS] [--once]
+
+#include "seinfeld_tv/library_scan.hpp"
+#include "seinfeld_tv/library_watch.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string_view>
+#include <thread>
+
+using namespace seinfeld_tv;
+
+namespace {
+
+LibraryWatcher* g_watcher = nullptr;
+
+void on_signal(int)
+{
+    if (g_watcher)
+        g_watcher->stop();
+}
+
+void print(const Catalog& catalog, const ScanReport& r)
+{
+    std::printf("generation %llu: %zu episodes (+%zu ~%zu -%zu, %zu unchanged)\n",
+                static_cast<unsigned long long>(catalog.generation()), catalog.size(), r.added, r.updated, r.removed,
+                r.unchanged);
+    for (const auto& p : r.problems)
+        std::printf("  %s\n", p.c_str());
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <library-dir> <catalog> [--workers N] [--settle-ms MS] [--once]\n", argv[0]);
+        return 2;
+    }
+    unsigned workers = std::thread::hardware_concurrency();
+    long settle_ms = 2000;
+    bool once = false;
+    for (int i = 3; i < argc; ++i) {
+        std::string_view flag = argv[i];
+        if (flag == "--once")
+            once = true;
+        else if (flag == "--workers" && i + 1 < argc)
+            workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (flag == "--settle-ms" && i + 1 < argc)
+            settle_ms = std::strtol(argv[++i], nullptr, 10);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    try {
+        WorkStealingPool pool(workers);
+        LibraryScanner scanner(argv[1], argv[2], &pool);
+        auto report = scanner.rescan_all();
+        if (report.changed())
+            print(*scanner.publish(), report);
+        else
+            for (const auto& p : report.problems)
+                std::printf("  %s\n", p.c_str());
+        if (once)
+            return 0;
+
+        LibraryWatcher watcher(scanner, [](std::shared_ptr<const Catalog> catalog, const ScanReport& r) {
+            print(*catalog, r);
+        }, std::chrono::milliseconds(settle_ms));
+        g_watcher = &watcher;
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        watcher.run();
+        g_watcher = nullptr;
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "stv-watch: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}